@@ -1,4 +1,5 @@
 #include "CanvasItem.h"
+#include "timelapse_export.h"
 #include <QPainter>
 #include <QMouseEvent>
 #include <QHoverEvent>
@@ -11,16 +12,119 @@
 #include <QPainterPath>
 #include <QBuffer>
 #include <QUrl>
+#include <QFile>
 #include <QFileInfo>
 #include <QGuiApplication>
 #include <QCursor>
 #include <QKeyEvent>
 #include <QTabletEvent>
 #include <QSvgRenderer>
+#include <QDateTime>
+#include <algorithm>
+#include <cmath>
 
 
 using namespace artflow;
 
+namespace {
+
+constexpr int kAutosaveIntervalMs = 15000;
+
+// Draws the `region` part of a buffer (buffer pixels) into the matching part
+// of `target`, which maps the whole buffer. Tiled buffers are drawn tile by
+// tile straight from tile memory, so empty tiles of sparse layers and tiles
+// outside the region cost nothing. Buffers are premultiplied, which is what
+// the raster paint engine blends natively, so no pixels are converted.
+void drawImageBuffer(QPainter *painter, const ImageBuffer &buffer, const QRectF &target, const QRect &region)
+{
+    const qreal sx = target.width() / buffer.width();
+    const qreal sy = target.height() / buffer.height();
+
+    if (!buffer.isTiled()) {
+        QImage img(buffer.data(), buffer.width(), buffer.height(), QImage::Format_RGBA8888_Premultiplied);
+        QRectF dst(target.x() + region.x() * sx, target.y() + region.y() * sy,
+                   region.width() * sx, region.height() * sy);
+        painter->drawImage(dst, img, QRectF(region));
+        return;
+    }
+
+    const int ts = ImageBuffer::kTileSize;
+    const int tx0 = region.left() / ts, tx1 = region.right() / ts;
+    const int ty0 = region.top() / ts, ty1 = region.bottom() / ts;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            if (!buffer.isTileAllocated(tx, ty)) continue;
+
+            int tw = qMin(ts, buffer.width() - tx * ts);
+            int th = qMin(ts, buffer.height() - ty * ts);
+            QImage tile(buffer.tileData(tx, ty), tw, th, ImageBuffer::kTileStride, QImage::Format_RGBA8888_Premultiplied);
+            QRectF dst(target.x() + tx * ts * sx, target.y() + ty * ts * sy, tw * sx, th * sy);
+            painter->drawImage(dst, tile);
+        }
+    }
+}
+
+// Selection operation named by a QML/Python mode string
+SelectionMask::Op selectionOp(const QString &mode)
+{
+    if (mode == "add") return SelectionMask::Op::Add;
+    if (mode == "subtract") return SelectionMask::Op::Subtract;
+    if (mode == "intersect") return SelectionMask::Op::Intersect;
+    return SelectionMask::Op::Replace;
+}
+
+// QPainter equivalent of a layer blend mode (same W3C formulas)
+QPainter::CompositionMode compositionModeFor(BlendMode mode)
+{
+    switch (mode) {
+        case BlendMode::Multiply:   return QPainter::CompositionMode_Multiply;
+        case BlendMode::Screen:     return QPainter::CompositionMode_Screen;
+        case BlendMode::Overlay:    return QPainter::CompositionMode_Overlay;
+        case BlendMode::SoftLight:  return QPainter::CompositionMode_SoftLight;
+        case BlendMode::HardLight:  return QPainter::CompositionMode_HardLight;
+        case BlendMode::ColorDodge: return QPainter::CompositionMode_ColorDodge;
+        case BlendMode::ColorBurn:  return QPainter::CompositionMode_ColorBurn;
+        case BlendMode::Darken:     return QPainter::CompositionMode_Darken;
+        case BlendMode::Lighten:    return QPainter::CompositionMode_Lighten;
+        case BlendMode::Difference: return QPainter::CompositionMode_Difference;
+        case BlendMode::Exclusion:  return QPainter::CompositionMode_Exclusion;
+        case BlendMode::Normal:     break;
+    }
+    return QPainter::CompositionMode_SourceOver;
+}
+
+// Box of the allocated tiles of a tiled buffer (everything for linear
+// storage): where anything can be painted
+DirtyRect allocatedBounds(const ImageBuffer &buffer)
+{
+    if (!buffer.isTiled()) return DirtyRect{0, 0, buffer.width(), buffer.height()};
+    DirtyRect bounds;
+    const int ts = ImageBuffer::kTileSize;
+    for (int ty = 0; ty < buffer.tileCountY(); ++ty) {
+        for (int tx = 0; tx < buffer.tileCountX(); ++tx) {
+            if (buffer.isTileAllocated(tx, ty)) bounds.unite(DirtyRect{tx * ts, ty * ts, ts, ts});
+        }
+    }
+    return bounds.intersected(buffer.width(), buffer.height());
+}
+
+Resampling resamplingFor(const QString &quality)
+{
+    if (quality == "bilinear") return Resampling::Bilinear;
+    if (quality == "lanczos") return Resampling::Lanczos3;
+    return Resampling::Bicubic;
+}
+
+// Deep copy of a buffer as a QImage (thumbnails, export)
+QImage toQImage(const ImageBuffer &buffer)
+{
+    QImage img(buffer.width(), buffer.height(), QImage::Format_RGBA8888_Premultiplied);
+    buffer.readRegion(0, 0, buffer.width(), buffer.height(), img.bits(), img.bytesPerLine());
+    return img;
+}
+
+} // namespace
+
 CanvasItem::CanvasItem(QQuickItem *parent)
     : QQuickPaintedItem(parent)
     , m_brushSize(20)
@@ -53,10 +157,23 @@ CanvasItem::CanvasItem(QQuickItem *parent)
 
     m_layerManager = new LayerManager(m_canvasWidth, m_canvasHeight);
     m_brushEngine = new BrushEngine();
+    m_undoStack = new UndoStack();
+    m_strokeLog = new StrokeLog();
+    // Strokes render on their own thread; results are picked up on the GUI
+    // thread (the item outlives the thread, queued calls die with it)
+    m_paintThread = new PaintThread(m_layerManager, [this]() {
+        QMetaObject::invokeMethod(this, [this]() { presentPaintUpdates(); }, Qt::QueuedConnection);
+    });
 
     m_layerManager->addLayer("Layer 1");
     m_activeLayerIndex = 1;
     m_layerManager->setActiveLayer(m_activeLayerIndex);
+    startTimelapse();
+
+    m_autosave = new AutosaveJournal();
+    m_autosaveTimer.setInterval(kAutosaveIntervalMs);
+    connect(&m_autosaveTimer, &QTimer::timeout, this, &CanvasItem::autosaveCheckpoint);
+    m_autosaveTimer.start();
     
     m_availableBrushes << "Pencil HB" << "Pencil 6B" << "Ink Pen" << "Marker" 
                        << "G-Pen" << "Maru Pen" << "Watercolor" << "Watercolor Wet" 
@@ -70,6 +187,14 @@ CanvasItem::CanvasItem(QQuickItem *parent)
 
 CanvasItem::~CanvasItem()
 {
+    m_transformJob.waitForFinished();
+    m_cancelTimelapseExport = true;
+    m_timelapseExport.waitForFinished();
+    delete m_timelapse;    // Writes the frames still queued
+    delete m_autosave;     // Writes the checkpoints still queued
+    delete m_paintThread;  // Joins the paint thread before layers go away
+    delete m_undoStack;    // Joins the history worker before layers go away
+    delete m_strokeLog;
     delete m_brushEngine;
     delete m_layerManager;
 }
@@ -77,20 +202,55 @@ CanvasItem::~CanvasItem()
 void CanvasItem::paint(QPainter *painter)
 {
     if (!m_layerManager) return;
+    auto canvasLock = m_paintThread->lockCanvas();
     
-    // Simplistic rendering of layers with blend modes and opacity
+    // Basic mapping for preview
+    QRectF targetRect(m_viewOffset.x() * m_zoomLevel, m_viewOffset.y() * m_zoomLevel, 
+                     m_canvasWidth * m_zoomLevel, m_canvasHeight * m_zoomLevel);
+
+    // Partial updates (update(QRect)) arrive with the painter clipped to the
+    // dirty area; only the canvas pixels under it are redrawn.
+    QRect region(0, 0, m_canvasWidth, m_canvasHeight);
+    if (painter->hasClipping()) {
+        QRectF clip = painter->clipBoundingRect();
+        QRectF canvasClip(clip.x() / m_zoomLevel - m_viewOffset.x(), clip.y() / m_zoomLevel - m_viewOffset.y(),
+                          clip.width() / m_zoomLevel, clip.height() / m_zoomLevel);
+        region &= canvasClip.toAlignedRect().adjusted(-1, -1, 1, 1);
+        if (region.isEmpty()) return;
+    }
+
+    // Layers below and above the active one come from LayerManager's cached
+    // composites, so a frame draws three buffers regardless of layer count.
     // Note: In a full engine we'd use OpenGL for composition
-    for (int i = 0; i < m_layerManager->getLayerCount(); ++i) {
+    drawImageBuffer(painter, m_layerManager->compositeBelowActive(), targetRect, region);
+
+    const int activeIndex = m_layerManager->getActiveLayerIndex();
+    const bool cacheAbove = m_layerManager->canCacheAboveActive();
+    const int last = cacheAbove ? activeIndex : m_layerManager->getLayerCount() - 1;
+    for (int i = activeIndex; i <= last; ++i) {
         Layer* layer = m_layerManager->getLayer(i);
-        if (!layer->visible) continue;
+        if (!layer || !layer->visible) continue;
 
-        QImage img(layer->buffer->data(), layer->buffer->width(), layer->buffer->height(), QImage::Format_RGBA8888);
+        painter->setCompositionMode(compositionModeFor(layer->blendMode));
         painter->setOpacity(layer->opacity);
-        
-        // Basic mapping for preview
-        QRectF targetRect(m_viewOffset.x() * m_zoomLevel, m_viewOffset.y() * m_zoomLevel, 
-                         m_canvasWidth * m_zoomLevel, m_canvasHeight * m_zoomLevel);
-        painter->drawImage(targetRect, img);
+        drawImageBuffer(painter, *layer->buffer, targetRect, region);
+
+        // Transformed content floats above the layer it was lifted from
+        if (m_transformPreview && layer->id == m_transformLayerId) {
+            const qreal s = m_transformPreviewScale;
+            QRectF previewTarget(targetRect.topLeft(),
+                                 QSizeF(m_transformPreview->width() / s * m_zoomLevel,
+                                        m_transformPreview->height() / s * m_zoomLevel));
+            QRect previewRegion = QRectF(region.x() * s, region.y() * s, region.width() * s, region.height() * s)
+                                      .toAlignedRect() & QRect(0, 0, m_transformPreview->width(), m_transformPreview->height());
+            if (!previewRegion.isEmpty()) drawImageBuffer(painter, *m_transformPreview, previewTarget, previewRegion);
+        }
+    }
+    painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter->setOpacity(1.0);
+
+    if (cacheAbove) {
+        drawImageBuffer(painter, m_layerManager->compositeAboveActive(), targetRect, region);
     }
 }
 
@@ -190,7 +350,12 @@ void CanvasItem::setCursorRotation(float value) {
     emit cursorRotationChanged();
 }
 
-void CanvasItem::setZoomLevel(float zoom) { m_zoomLevel = zoom; emit zoomLevelChanged(); update(); }
+void CanvasItem::setZoomLevel(float zoom) {
+    m_zoomLevel = zoom;
+    if (m_isTransforming) renderTransformPreview();
+    emit zoomLevelChanged();
+    update();
+}
 void CanvasItem::setCurrentTool(const QString &tool) { 
     if (m_currentTool != tool) {
         m_currentTool = tool; 
@@ -206,6 +371,27 @@ void CanvasItem::setCurrentTool(const QString &tool) {
     }
 }
 
+void CanvasItem::setFillTolerance(int tolerance) {
+    if (m_fillTolerance != tolerance) {
+        m_fillTolerance = tolerance;
+        emit fillToleranceChanged();
+    }
+}
+
+void CanvasItem::setFillExpand(int pixels) {
+    if (m_fillExpand != pixels) {
+        m_fillExpand = pixels;
+        emit fillExpandChanged();
+    }
+}
+
+void CanvasItem::setFillSampleAll(bool sampleAll) {
+    if (m_fillSampleAll != sampleAll) {
+        m_fillSampleAll = sampleAll;
+        emit fillSampleAllChanged();
+    }
+}
+
 void CanvasItem::loadRecentProjectsAsync()
 {
     (void)QtConcurrent::run([this]() {
@@ -235,6 +421,8 @@ QVariantList CanvasItem::_scanSync()
     QFileInfoList entries = dir.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot, QDir::Time);
     for (const QFileInfo &info : entries) {
         if (info.fileName().endsWith(".json") && info.isFile()) continue;
+        // Autosave journals and saves in progress sit next to the projects
+        if (info.fileName().endsWith(".journal") || info.fileName().endsWith(".tmp")) continue;
         
         QVariantMap item;
         item["name"] = info.fileName();
@@ -253,17 +441,16 @@ void CanvasItem::handle_shortcuts(int key, int modifiers) {
 
     // Undo / Redo
     if (ctrl && key == Qt::Key_Z) {
-        if (shift) qDebug() << "Redo not implemented yet"; 
-        else qDebug() << "Undo not implemented yet";
+        if (shift) redo();
+        else undo();
     }
     // Transform
     else if (ctrl && key == Qt::Key_T) {
-        m_isTransforming = true;
-        emit isTransformingChanged();
+        startTransform();
     }
     // Select None
     else if (ctrl && key == Qt::Key_D) {
-        // Clear selection logic
+        clearSelection();
     }
     // Space (Pan)
     else if (key == Qt::Key_Space) {
@@ -285,7 +472,10 @@ void CanvasItem::fitToView() { qDebug() << "Fitting to view"; }
 
 void CanvasItem::addLayer()
 {
-    m_layerManager->addLayer("New Layer");
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_layerManager->addLayer("New Layer");
+    }
     m_activeLayerIndex = m_layerManager->getLayerCount() - 1;
     emit activeLayerChanged();
     updateLayersList();
@@ -294,7 +484,10 @@ void CanvasItem::addLayer()
 
 void CanvasItem::removeLayer(int index)
 {
-    m_layerManager->removeLayer(index);
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_layerManager->removeLayer(index);
+    }
     m_activeLayerIndex = qMax(0, (int)m_layerManager->getLayerCount() - 1);
     emit activeLayerChanged();
     updateLayersList();
@@ -303,14 +496,20 @@ void CanvasItem::removeLayer(int index)
 
 void CanvasItem::duplicateLayer(int index)
 {
-    m_layerManager->duplicateLayer(index);
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_layerManager->duplicateLayer(index);
+    }
     updateLayersList();
     update();
 }
 
 void CanvasItem::mergeDown(int index)
 {
-    m_layerManager->mergeDown(index);
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_layerManager->mergeDown(index);
+    }
     updateLayersList();
     update();
 }
@@ -333,19 +532,120 @@ void CanvasItem::setBackgroundColor(const QString &color) {
 
 
 
+// Layers come back decoding lazily (see ProjectReader), so a large project
+// opens in about the time it takes to read its metadata
 bool CanvasItem::loadProject(const QString &path) {
-    qDebug() << "Loading project from:" << path;
-    m_currentProjectPath = path;
-    m_currentProjectName = QFileInfo(path).baseName();
+    const QString localPath = QUrl(path).isLocalFile() ? QUrl(path).toLocalFile() : path;
+    artflow::ProjectReader project;
+    std::string error;
+    if (!project.open(localPath.toStdString(), &error)) {
+        qWarning() << "Cannot open project:" << QString::fromStdString(error);
+        return false;
+    }
+    std::vector<std::unique_ptr<ImageBuffer>> layers = project.loadLayers(&error);
+    if (!error.empty()) {
+        qWarning() << "Project:" << QString::fromStdString(error);   // Those layers load empty
+    }
+    // Changes autosaved since the file was written (e.g. before a crash).
+    // The journal being kept may be this one: finish with it first.
+    m_autosave->stop(false);
+    m_autosave->flush();
+    artflow::ProjectInfo info = project.info();
+    std::vector<artflow::AutosaveLayerState> recovered;
+    if (artflow::replayAutosave(localPath.toStdString(), info, layers, &recovered, &error)) {
+        qInfo() << "Recovered autosaved changes to" << localPath;
+    }
+    std::unique_ptr<LayerManager> stack = artflow::buildLayerStack(info, std::move(layers));
+
+    m_paintThread->waitIdle();
+    m_transformJob.waitForFinished();
+    resetTransform();
+    m_undoStack->clear();
+    m_strokeLog->clear();
+    m_selection.reset();
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        delete m_layerManager;
+        m_layerManager = stack.release();
+        m_layerManager->setTileStore(m_tileStore);
+        m_activeLayerIndex = m_layerManager->getActiveLayerIndex();
+        m_autosave->start(localPath.toStdString(), project.info().created, *m_layerManager, recovered);
+    }
+    m_canvasWidth = project.info().width;
+    m_canvasHeight = project.info().height;
+    m_paintThread->setLayerManager(m_layerManager);
+    startTimelapse(&project);
+
+    m_currentProjectPath = localPath;
+    m_loadedProjectPath = localPath;
+    m_currentProjectName = project.info().name.empty() ? QFileInfo(localPath).completeBaseName()
+                                                       : QString::fromStdString(project.info().name);
     emit currentProjectPathChanged();
     emit currentProjectNameChanged();
-    
-    // In a real app, you'd load layers from file here
-    return true; 
+    emit canvasWidthChanged();
+    emit canvasHeightChanged();
+    emit activeLayerChanged();
+    emit selectionChanged();
+    updateLayersList();
+    update();
+    return true;
 }
 
+// The layers are snapshotted (copy-on-write) under the canvas lock; the
+// compression itself runs on the thread pool without holding it
 bool CanvasItem::saveProject(const QString &path) {
-    qDebug() << "Saving project to:" << path;
+    if (!m_layerManager) return false;
+    const QString localPath = QUrl(path).isLocalFile() ? QUrl(path).toLocalFile() : path;
+
+    m_paintThread->waitIdle();   // Strokes already drawn belong in the file
+    artflow::ProjectSnapshot project;
+    ImageBuffer composite(m_canvasWidth, m_canvasHeight);
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        project = artflow::snapshotProject(*m_layerManager);
+        m_layerManager->compositeAll(composite);
+    }
+    project.info.created = QDateTime::currentDateTime().toString(Qt::ISODateWithMs).toStdString();
+
+    // Thumbnail for the gallery, on white like the Python app's
+    QImage preview(m_canvasWidth, m_canvasHeight, QImage::Format_ARGB32_Premultiplied);
+    preview.fill(Qt::white);
+    {
+        QPainter painter(&preview);
+        painter.drawImage(0, 0, QImage(composite.data(), m_canvasWidth, m_canvasHeight,
+                                       QImage::Format_RGBA8888_Premultiplied));
+    }
+    QByteArray previewPng;
+    QBuffer previewBuffer(&previewPng);
+    previewBuffer.open(QIODevice::WriteOnly);
+    preview.scaled(400, 300, Qt::KeepAspectRatio, Qt::SmoothTransformation).save(&previewBuffer, "PNG");
+
+    artflow::ProjectSaveOptions options;
+    options.previewPng.assign(previewPng.begin(), previewPng.end());
+    if (m_timelapse && m_timelapse->frameCount() > 0) {
+        m_timelapse->flush();
+        options.files.emplace_back(artflow::kProjectTimelapseMember, m_timelapsePath.toStdString());
+    }
+    options.carryTimelapseFrom = m_currentProjectPath.toStdString();
+    options.loadedFrom = m_loadedProjectPath.toStdString();
+
+    std::string error;
+    if (!artflow::saveProject(localPath.toStdString(), project, options, &error)) {
+        qWarning() << "Cannot save project:" << QString::fromStdString(error);
+        return false;
+    }
+    {
+        // The layers are still what was saved: journal from here on
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_autosave->stop(true);
+        m_autosave->start(localPath.toStdString(), project.info.created, *m_layerManager);
+    }
+    if (m_currentProjectPath != localPath) {
+        m_currentProjectPath = localPath;
+        m_currentProjectName = QFileInfo(localPath).completeBaseName();
+        emit currentProjectPathChanged();
+        emit currentProjectNameChanged();
+    }
     return true;
 }
 
@@ -358,9 +658,12 @@ bool CanvasItem::exportImage(const QString &path, const QString &format) {
     
     // Create a composite image
     ImageBuffer composite(m_canvasWidth, m_canvasHeight);
-    m_layerManager->compositeAll(composite);
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_layerManager->compositeAll(composite);
+    }
     
-    QImage img(composite.data(), m_canvasWidth, m_canvasHeight, QImage::Format_RGBA8888);
+    QImage img(composite.data(), m_canvasWidth, m_canvasHeight, QImage::Format_RGBA8888_Premultiplied);
     // Convert path to local file if it's a URL
     QString localPath = path;
     if (localPath.startsWith("file:///")) {
@@ -375,12 +678,133 @@ bool CanvasItem::importABR(const QString &path) {
     return true;
 }
 
+// Lifts the selected pixels (or the whole layer) off the active layer into
+// a TransformSource; the layer keeps what is left until apply or cancel.
+void CanvasItem::startTransform() {
+    if (m_isTransforming || m_isDrawing) return;
+    Layer* layer = m_layerManager->getActiveLayer();
+    if (!layer || layer->locked) return;
+
+    // The previous stroke may still be rendering; close its history first
+    if (m_undoStack->isRecording()) {
+        m_paintThread->waitIdle();
+        presentPaintUpdates();
+    }
+    settleUndoStep();
+
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        const DirtyRect area = m_selection ? m_selection->bounds() : allocatedBounds(*layer->buffer);
+        m_transformSource = std::make_shared<TransformSource>(*layer->buffer, area, m_selection.get());
+        m_transformOriginal = std::make_unique<ImageBuffer>(layer->buffer->width(), layer->buffer->height(),
+                                                            layer->buffer->storage());
+        m_transformOriginal->copyFrom(*layer->buffer);
+        m_undoStack->beginStroke(layer->id, *layer->buffer, m_strokeLog->strokeCount());
+        eraseRegion(*layer->buffer, area, m_selection.get());
+    }
+    m_transformLayerId = layer->id;
+    m_transformMatrix = Affine();
+    m_isTransforming = true;
+    renderTransformPreview();
+    emit isTransformingChanged();
+    update();
+}
+
 void CanvasItem::updateTransformProperties(float x, float y, float scale, float rotation, float w, float h) {
-    // This would update the transformation matrix for a selection
+    if (!m_isTransforming || m_transformApplying) return;
+    // Same as the QML item: scaled and rotated about its center
+    m_transformMatrix = Affine::translation(-w / 2.0, -h / 2.0)
+                            .then(Affine::scaling(scale, scale))
+                            .then(Affine::rotation(rotation))
+                            .then(Affine::translation(x + w / 2.0, y + h / 2.0));
+    renderTransformPreview();
+    update();
+}
+
+// Bilinear proxy at about one pixel per screen pixel (at most 1:1 and
+// 2048 px on the long side), cheap enough to redo on every drag event
+void CanvasItem::renderTransformPreview() {
+    if (!m_transformSource) return;
+    float s = std::clamp(m_zoomLevel, 0.125f, 1.0f);
+    s = std::min(s, 2048.0f / std::max(m_canvasWidth, m_canvasHeight));
+    const int w = std::max(1, static_cast<int>(std::ceil(m_canvasWidth * s)));
+    const int h = std::max(1, static_cast<int>(std::ceil(m_canvasHeight * s)));
+    if (!m_transformPreview || m_transformPreview->width() != w || m_transformPreview->height() != h) {
+        m_transformPreview = std::make_unique<ImageBuffer>(w, h);
+    } else {
+        m_transformPreview->clear();
+    }
+    m_transformPreviewScale = s;
+    transformImage(*m_transformSource, m_transformMatrix.then(Affine::scaling(s, s)), *m_transformPreview,
+                   Resampling::Bilinear);
+}
+
+// The full-resolution pass runs off the GUI thread; the preview stays up
+// until the result is composited back
+void CanvasItem::applyTransform(const QString &quality) {
+    if (!m_isTransforming || m_transformApplying) return;
+    m_transformApplying = true;
+
+    auto source = m_transformSource;
+    const Affine matrix = m_transformMatrix;
+    const Resampling resampling = resamplingFor(quality);
+    const int w = m_canvasWidth, h = m_canvasHeight;
+    m_transformJob = QtConcurrent::run([this, source, matrix, resampling, w, h]() {
+        auto result = std::make_shared<ImageBuffer>(w, h, ImageBuffer::Storage::Tiled);
+        transformImage(*source, matrix, *result, resampling);
+        QMetaObject::invokeMethod(this, [this, result]() { finishTransform(result); }, Qt::QueuedConnection);
+    });
+}
+
+void CanvasItem::finishTransform(const std::shared_ptr<ImageBuffer> &result) {
+    if (!m_transformApplying) return;   // Canvas was reset meanwhile
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        Layer* layer = m_layerManager->findLayerById(m_transformLayerId);
+        if (layer) {
+            layer->buffer->composite(*result);
+            const size_t undone = m_undoStack->redoLogPosition();
+            m_undoStack->endStroke(*layer->buffer);
+            if (!m_undoStack->canRedo()) dropUndoneStrokes(undone);
+        } else {
+            m_undoStack->cancelStroke();
+        }
+        m_layerManager->invalidateComposite();
+    }
+    resetTransform();
+    updateLayersList();
+    update();
+}
+
+void CanvasItem::cancelTransform() {
+    if (!m_isTransforming || m_transformApplying) return;
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        Layer* layer = m_layerManager->findLayerById(m_transformLayerId);
+        if (layer && m_transformOriginal) layer->buffer->copyFrom(*m_transformOriginal);
+        m_undoStack->cancelStroke();
+        m_layerManager->invalidateComposite();
+    }
+    resetTransform();
+    update();
+}
+
+void CanvasItem::resetTransform() {
+    m_transformSource.reset();
+    m_transformOriginal.reset();
+    m_transformPreview.reset();
+    m_transformMatrix = Affine();
+    m_transformLayerId = -1;
+    m_transformApplying = false;
+    if (m_isTransforming) {
+        m_isTransforming = false;
+        emit isTransformingChanged();
+    }
 }
 
 void CanvasItem::updateLayersList() {
     if (!m_layerManager) return;
+    auto canvasLock = m_paintThread->lockCanvas();
     
     QVariantList layerList;
     for (int i = 0; i < m_layerManager->getLayerCount(); ++i) {
@@ -400,7 +824,7 @@ void CanvasItem::updateLayersList() {
         // Add thumbnail if active or requested (real app would cache these)
         if (i == m_activeLayerIndex || i == 0) {
             int tw = 60, th = 40;
-            QImage full(l->buffer->data(), m_canvasWidth, m_canvasHeight, QImage::Format_RGBA8888);
+            QImage full = toQImage(*l->buffer);
             QImage thumb = full.scaled(tw, th, Qt::KeepAspectRatio, Qt::SmoothTransformation);
             QByteArray ba;
             QBuffer buffer(&ba);
@@ -420,15 +844,29 @@ void CanvasItem::resizeCanvas(int w, int h) {
     m_canvasWidth = w;
     m_canvasHeight = h;
     
-    delete m_layerManager;
-    m_layerManager = new LayerManager(w, h);
-    
-    m_layerManager->addLayer("Layer 1");
-    m_activeLayerIndex = 1;
-    m_layerManager->setActiveLayer(m_activeLayerIndex);
+    m_paintThread->waitIdle();
+    m_transformJob.waitForFinished();
+    resetTransform();
+    m_undoStack->clear();
+    m_strokeLog->clear();
+    m_selection.reset();
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        delete m_layerManager;
+        m_layerManager = new LayerManager(w, h);
+        m_layerManager->setTileStore(m_tileStore);
+        
+        m_layerManager->addLayer("Layer 1");
+        m_activeLayerIndex = 1;
+        m_layerManager->setActiveLayer(m_activeLayerIndex);
+        m_autosave->stop(false);
+    }
+    m_paintThread->setLayerManager(m_layerManager);
+    startTimelapse();
     
     emit canvasWidthChanged();
     emit canvasHeightChanged();
+    emit selectionChanged();
     updateLayersList();
     update();
 }
@@ -444,7 +882,10 @@ QString CanvasItem::sampleColor(int x, int y, int mode) {
     float cx = (x - m_viewOffset.x() * m_zoomLevel) / m_zoomLevel;
     float cy = (y - m_viewOffset.y() * m_zoomLevel) / m_zoomLevel;
     
-    m_layerManager->sampleColor(static_cast<int>(cx), static_cast<int>(cy), &r, &g, &b, &a, mode);
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_layerManager->sampleColor(static_cast<int>(cx), static_cast<int>(cy), &r, &g, &b, &a, mode);
+    }
     return QColor(r, g, b, a).name();
 }
 
@@ -474,23 +915,118 @@ void CanvasItem::toggleVisibility(int index) {
     Layer* l = m_layerManager->getLayer(index);
     if (l) {
         l->visible = !l->visible;
+        m_layerManager->invalidateComposite();
         updateLayersList();
         update();
     }
 }
 
 void CanvasItem::clearLayer(int index) {
+    if (m_isDrawing) return;
     Layer* l = m_layerManager->getLayer(index);
     if (l) {
-        l->buffer->clear();
+        // The previous stroke may still be rendering; close its history first
+        if (m_undoStack->isRecording()) {
+            m_paintThread->waitIdle();
+            presentPaintUpdates();
+        }
+        settleUndoStep();
+        {
+            auto canvasLock = m_paintThread->lockCanvas();
+            const size_t undone = m_undoStack->redoLogPosition();
+            m_undoStack->beginStroke(l->id, *l->buffer, m_strokeLog->strokeCount());
+            l->buffer->clear();
+            m_undoStack->endStroke(*l->buffer);
+            if (!m_undoStack->canRedo()) dropUndoneStrokes(undone);
+            m_layerManager->invalidateComposite();
+        }
         update();
     }
 }
 
+// Bucket fill on the active layer at a view position
+void CanvasItem::apply_color_drop(float x, float y, const QColor &color) {
+    if (m_isDrawing || m_isTransforming) return;
+    Layer* layer = m_layerManager->getActiveLayer();
+    if (!layer || layer->locked || !layer->visible) return;
+
+    int cx = static_cast<int>((x - m_viewOffset.x() * m_zoomLevel) / m_zoomLevel);
+    int cy = static_cast<int>((y - m_viewOffset.y() * m_zoomLevel) / m_zoomLevel);
+
+    // The previous stroke may still be rendering; close its history first
+    if (m_undoStack->isRecording()) {
+        m_paintThread->waitIdle();
+        presentPaintUpdates();
+    }
+    settleUndoStep();
+
+    FillOptions options;
+    options.tolerance = m_fillTolerance;
+    options.expand = m_fillExpand;
+    options.selectionMask = m_selection.get();
+    DirtyRect filled;
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        const size_t undone = m_undoStack->redoLogPosition();
+        m_undoStack->beginStroke(layer->id, *layer->buffer, m_strokeLog->strokeCount());
+        filled = m_layerManager->floodFill(m_layerManager->getActiveLayerIndex(), cx, cy,
+                                           color.red(), color.green(), color.blue(), color.alpha(),
+                                           options, m_fillSampleAll);
+        if (filled.isEmpty()) m_undoStack->cancelStroke();
+        else m_undoStack->endStroke(*layer->buffer);
+        if (!m_undoStack->canRedo()) dropUndoneStrokes(undone);
+    }
+    updateCanvasRect(filled);
+}
+
+// Apply `edit` to a copy of the selection and publish it; an empty result
+// drops the selection
+template <typename Edit>
+void CanvasItem::editSelection(Edit edit) {
+    auto next = m_selection ? std::make_shared<SelectionMask>(*m_selection)
+                            : std::make_shared<SelectionMask>(m_canvasWidth, m_canvasHeight);
+    edit(*next);
+    if (next->isEmpty()) m_selection.reset();
+    else m_selection = std::move(next);
+    emit selectionChanged();
+    update();
+}
+
+void CanvasItem::selectRect(int x, int y, int w, int h, const QString &mode) {
+    editSelection([&](SelectionMask &mask) { mask.selectRect(x, y, w, h, selectionOp(mode)); });
+}
+
+void CanvasItem::selectLasso(const QVariantList &points, const QString &mode) {
+    std::vector<float> xy;
+    xy.reserve(points.size() * 2);
+    for (const QVariant &p : points) {
+        const QPointF point = p.toPointF();
+        xy.push_back(static_cast<float>(point.x()));
+        xy.push_back(static_cast<float>(point.y()));
+    }
+    editSelection([&](SelectionMask &mask) { mask.selectPolygon(xy.data(), xy.size() / 2, selectionOp(mode)); });
+}
+
+void CanvasItem::selectAll() {
+    editSelection([](SelectionMask &mask) { mask.selectAll(); });
+}
+
+void CanvasItem::invertSelection() {
+    editSelection([](SelectionMask &mask) { mask.invert(); });
+}
+
+void CanvasItem::clearSelection() {
+    if (!m_selection) return;
+    m_selection.reset();
+    emit selectionChanged();
+    update();
+}
+
 void CanvasItem::setLayerOpacity(int index, float opacity) {
     Layer* l = m_layerManager->getLayer(index);
     if (l) {
         l->opacity = opacity;
+        m_layerManager->invalidateComposite();
         updateLayersList();
         update();
     }
@@ -503,6 +1039,15 @@ void CanvasItem::setLayerBlendMode(int index, const QString &mode) {
         else if (mode == "Multiply") l->blendMode = BlendMode::Multiply;
         else if (mode == "Screen") l->blendMode = BlendMode::Screen;
         else if (mode == "Overlay") l->blendMode = BlendMode::Overlay;
+        else if (mode == "Soft Light") l->blendMode = BlendMode::SoftLight;
+        else if (mode == "Hard Light") l->blendMode = BlendMode::HardLight;
+        else if (mode == "Color Dodge") l->blendMode = BlendMode::ColorDodge;
+        else if (mode == "Color Burn") l->blendMode = BlendMode::ColorBurn;
+        else if (mode == "Darken") l->blendMode = BlendMode::Darken;
+        else if (mode == "Lighten") l->blendMode = BlendMode::Lighten;
+        else if (mode == "Difference") l->blendMode = BlendMode::Difference;
+        else if (mode == "Exclusion") l->blendMode = BlendMode::Exclusion;
+        m_layerManager->invalidateComposite();
         
         updateLayersList();
         update();
@@ -518,6 +1063,105 @@ void CanvasItem::setActiveLayer(int index) {
     }
 }
 
+qint64 CanvasItem::layerMemoryUsage(int index) const {
+    if (!m_layerManager) return 0;
+    return static_cast<qint64>(m_layerManager->getLayerMemoryUsage(index));
+}
+
+// Undo/redo tiles are decoded on the history worker; the patch is installed
+// back on the GUI thread once ready, or earlier by settleUndoStep().
+void CanvasItem::undo() {
+    if (m_isDrawing || m_undoStack->isRecording()) return;
+    m_undoStack->undo([this](std::shared_ptr<UndoStack::Patch> patch) {
+        {
+            std::lock_guard<std::mutex> lock(m_undoPatchMutex);
+            m_undoPatch = std::move(patch);
+        }
+        QMetaObject::invokeMethod(this, [this]() { applyUndoPatch(); }, Qt::QueuedConnection);
+    });
+}
+
+void CanvasItem::redo() {
+    if (m_isDrawing || m_undoStack->isRecording()) return;
+    m_undoStack->redo([this](std::shared_ptr<UndoStack::Patch> patch) {
+        {
+            std::lock_guard<std::mutex> lock(m_undoPatchMutex);
+            m_undoPatch = std::move(patch);
+        }
+        QMetaObject::invokeMethod(this, [this]() { applyUndoPatch(); }, Qt::QueuedConnection);
+    });
+}
+
+bool CanvasItem::canUndo() const { return m_undoStack->canUndo(); }
+bool CanvasItem::canRedo() const { return m_undoStack->canRedo(); }
+
+void CanvasItem::setUndoMemoryLimit(int megabytes) {
+    m_undoStack->setMemoryLimit(static_cast<size_t>(qMax(megabytes, 1)) * 1024 * 1024);
+}
+
+// New layers and tiles go to the store from now on; tiles the layers hold
+// move over (undo history keeps its own until it is trimmed)
+bool CanvasItem::setScratchStorage(bool enabled, const QString &directory, int residentMegabytes) {
+    const size_t budget = static_cast<size_t>(qMax(residentMegabytes, 1)) * 1024 * 1024;
+    std::shared_ptr<TileStore> store;
+    if (enabled) {
+        std::string error;
+        store = TileStore::create(directory.toStdString(), budget, &error);
+        if (!store) {
+            qWarning() << "Scratch storage:" << QString::fromStdString(error);
+            return false;
+        }
+    }
+    m_paintThread->waitIdle();
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_tileStore = store;
+        m_layerManager->setTileStore(m_tileStore);
+    }
+    return true;
+}
+
+void CanvasItem::applyUndoPatch() {
+    std::shared_ptr<UndoStack::Patch> patch;
+    {
+        std::lock_guard<std::mutex> lock(m_undoPatchMutex);
+        patch = std::move(m_undoPatch);
+    }
+    if (!patch) return;   // Applied by settleUndoStep() already
+
+    auto canvasLock = m_paintThread->lockCanvas();
+    int layerId = m_undoStack->apply(patch, *m_layerManager);
+    if (layerId >= 0) {
+        const Layer* active = m_layerManager->getActiveLayer();
+        if (!active || active->id != layerId) m_layerManager->invalidateComposite();
+        update();
+    }
+}
+
+// An edit must not begin while an undo/redo is still decoding: recording
+// would call the step off (UndoStack::beginStroke()). Wait for it and apply
+// it first, so the edit starts from the layer the user asked for.
+void CanvasItem::settleUndoStep() {
+    if (!m_undoStack->isBusy()) return;
+    m_undoStack->waitIdle();
+    applyUndoPatch();
+}
+
+// Steps that can no longer be redone must leave the stroke log too, or
+// replay would paint strokes the user undid. `undone` is the
+// redoLogPosition() from before the edit that dropped them.
+void CanvasItem::dropUndoneStrokes(size_t undone) {
+    if (undone < m_strokeLog->strokeCount()) m_strokeLog->truncate(undone);
+}
+
+void CanvasItem::finishUndoStroke() {
+    if (!m_undoStack->isRecording()) return;
+    auto canvasLock = m_paintThread->lockCanvas();
+    Layer* layer = m_layerManager->findLayerById(m_undoStack->strokeLayerId());
+    if (layer) m_undoStack->endStroke(*layer->buffer);
+    else m_undoStack->cancelStroke();
+}
+
 void CanvasItem::setLayerPrivate(int index, bool isPrivate) {
     Layer* l = m_layerManager->getLayer(index);
     if (l) {
@@ -663,41 +1307,93 @@ QString CanvasItem::get_brush_preview(const QString &brushName) {
     return "data:image/png;base64," + ba.toBase64();
 }
 
-void CanvasItem::capture_timelapse_frame() {
-    if (!m_layerManager) return;
-    
-    static int frameCount = 0;
+// Each session records into its own container; frames have a fixed size,
+// so a resized canvas starts a new one. A loaded project's recording is
+// copied out and continued.
+void CanvasItem::startTimelapse(artflow::ProjectReader *project) {
+    delete m_timelapse;
+    m_timelapse = new TimelapseRecorder(m_canvasWidth, m_canvasHeight);
+
     QString path = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation) + "/ArtFlow/Timelapse";
     QDir().mkpath(path);
-    
-    QString fileName = QString("%1/frame_%2.jpg").arg(path).arg(frameCount++, 6, 10, QChar('0'));
-    
-    ImageBuffer composite(m_canvasWidth, m_canvasHeight);
-    m_layerManager->compositeAll(composite, true); // skipPrivate = true
-    
-    QImage img(composite.data(), m_canvasWidth, m_canvasHeight, QImage::Format_RGBA8888);
-    img.save(fileName, "JPG", 85);
+    QString fileName = QString("%1/session_%2.aftl").arg(path, QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz"));
+    const std::string file = fileName.toStdString();
+    if (project) {
+        const std::vector<std::string> members = project->timelapseMembers();
+        if (std::find(members.begin(), members.end(), artflow::kProjectTimelapseMember) != members.end()) {
+            project->extract(artflow::kProjectTimelapseMember, file);
+        }
+    }
+    if (!m_timelapse->open(file)) {
+        // A recording of another frame size cannot be continued
+        QFile::remove(fileName);
+        if (!m_timelapse->open(file)) {
+            qWarning() << "Timelapse: cannot write" << fileName;
+        }
+    }
+    m_timelapsePath = fileName;
+}
+
+// Pen-up only snapshots tile handles; compositing, downscaling and
+// encoding happen on the recorder's worker
+void CanvasItem::capture_timelapse_frame() {
+    if (!m_layerManager || !m_timelapse) return;
+    auto canvasLock = m_paintThread->lockCanvas();
+    m_timelapse->capture(*m_layerManager);
+}
+
+// Like timelapse capture, only takes tile handles under the lock; the
+// journal compresses and writes on its own low-priority thread
+void CanvasItem::autosaveCheckpoint() {
+    if (!m_layerManager || !m_autosave->isActive() || m_isDrawing) return;
+    auto canvasLock = m_paintThread->lockCanvas();
+    m_autosave->checkpoint(*m_layerManager);
+}
+
+void CanvasItem::exportTimelapse(const QString &outputPath, int durationSec, int aspectMode, int qualityMode) {
+    if (m_timelapseExport.isRunning()) {
+        emit timelapseExportFinished(false, "An export is already running");
+        return;
+    }
+    if (!m_timelapse || m_timelapse->frameCount() == 0) {
+        emit timelapseExportFinished(false, "No frames found in project");
+        return;
+    }
+    m_timelapse->flush();   // The file then holds every frame captured so far
+
+    TimelapseExportOptions options;
+    options.aspect = aspectMode == 1 ? TimelapseExportOptions::Aspect::Square
+                   : aspectMode == 2 ? TimelapseExportOptions::Aspect::Portrait
+                                     : TimelapseExportOptions::Aspect::Original;
+    options.maxSize = qualityMode == 0 ? 1080 : 0;
+    options.durationSec = durationSec;
+
+    // The recorder keeps appending to the file; the export reads the frames
+    // that were there when it started
+    const std::string source = m_timelapsePath.toStdString();
+    const QString output = QUrl(outputPath).isLocalFile() ? QUrl(outputPath).toLocalFile() : outputPath;
+    m_cancelTimelapseExport = false;
+    m_timelapseExport = QtConcurrent::run([this, source, output, options]() {
+        std::string error;
+        const bool ok = artflow::exportTimelapse(source, output.toStdString(), options,
+            [this](int written, int total) {
+                QMetaObject::invokeMethod(this, [this, written, total]() {
+                    emit timelapseExportProgress(written, total);
+                }, Qt::QueuedConnection);
+                return !m_cancelTimelapseExport.load();
+            }, &error);
+        const QString message = ok ? output : QString::fromStdString(error);
+        QMetaObject::invokeMethod(this, [this, ok, message]() {
+            emit timelapseExportFinished(ok, message);
+        }, Qt::QueuedConnection);
+    });
 }
 
 void CanvasItem::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton) {
-        m_isDrawing = true;
         QPointF p = (event->position() - m_viewOffset * m_zoomLevel) / m_zoomLevel;
-        m_lastPos = p; // FIX: Initialize last point
-        m_brushEngine->beginStroke(StrokePoint(p.x(), p.y(), 1.0f));
-        
-        // Render first dab
-        Layer* layer = m_layerManager->getActiveLayer();
-        if (layer) {
-            ImageBuffer* mask = nullptr;
-            if (layer->clipped && m_activeLayerIndex > 0) {
-                Layer* parent = m_layerManager->getLayer(m_activeLayerIndex - 1);
-                if (parent) mask = parent->buffer.get();
-            }
-            m_brushEngine->renderDab(*(layer->buffer), p.x(), p.y(), 1.0f, layer->alphaLock, mask);
-            update();
-        }
+        beginDrawing(p, 1.0f);
     }
 }
 
@@ -718,57 +1414,128 @@ bool CanvasItem::event(QEvent *event) {
         float pressure = tablet->pressure();
 
         if (event->type() == QEvent::TabletPress) {
-            m_isDrawing = true;
-            m_lastPos = p; // FIX: Initialize last point
-            m_brushEngine->beginStroke(StrokePoint(p.x(), p.y(), pressure));
-            
-            Layer* layer = m_layerManager->getActiveLayer();
-            if (layer) {
-                ImageBuffer* mask = nullptr;
-                if (layer->clipped && m_activeLayerIndex > 0) {
-                    Layer* parent = m_layerManager->getLayer(m_activeLayerIndex - 1);
-                    if (parent) mask = parent->buffer.get();
-                }
-                m_brushEngine->renderDab(*(layer->buffer), p.x(), p.y(), pressure, layer->alphaLock, mask);
-                update();
-            }
+            beginDrawing(p, pressure);
         } else if (event->type() == QEvent::TabletMove && m_isDrawing) {
             processDrawing(p, pressure);
         } else if (event->type() == QEvent::TabletRelease) {
-            m_isDrawing = false;
-            m_brushEngine->endStroke();
-            capture_timelapse_frame();
+            endDrawing();
         }
         return true;
     }
     return QQuickPaintedItem::event(event);
 }
 
-void CanvasItem::processDrawing(const QPointF &pos, float pressure) {
+// Input only queues work for the paint thread; presentPaintUpdates() picks
+// up what it rendered.
+void CanvasItem::beginDrawing(const QPointF &pos, float pressure) {
+    if (m_isTransforming) return;    // Layer is held by the transform
+    if (m_isDrawing) endDrawing();   // Release never arrived
+    // The previous stroke may still be rendering; close its history first
+    if (m_undoStack->isRecording()) {
+        m_paintThread->waitIdle();
+        presentPaintUpdates();
+    }
+    settleUndoStep();
+
+    m_isDrawing = true;
     Layer* layer = m_layerManager->getActiveLayer();
     if (!layer) return;
 
-    ImageBuffer* mask = nullptr;
+    PaintThread::Stroke stroke;
+    stroke.layerId = layer->id;
+    stroke.alphaLock = layer->alphaLock;
+    stroke.brush = m_brushEngine->getBrush();
+    stroke.color = m_brushEngine->getColor();
+    stroke.seed = BrushEngine::newStrokeSeed();
+    stroke.selection = m_selection;
     if (layer->clipped && m_activeLayerIndex > 0) {
         Layer* parent = m_layerManager->getLayer(m_activeLayerIndex - 1);
-        if (parent) mask = parent->buffer.get();
+        if (parent) stroke.maskLayerId = parent->id;
     }
 
-    m_brushEngine->renderStrokeSegment(*(layer->buffer), 
-        StrokePoint(m_lastPos.x(), m_lastPos.y(), 1.0f), // Simplified last pressure
-        StrokePoint(pos.x(), pos.y(), pressure),
-        layer->alphaLock, mask);
-    
-    m_lastPos = pos;
-    update();
+    // The stroke drops the steps that could be redone once it is recorded;
+    // their strokes go now, before this one joins the log
+    dropUndoneStrokes(m_undoStack->redoLogPosition());
+    {
+        auto canvasLock = m_paintThread->lockCanvas();
+        m_undoStack->beginStroke(layer->id, *layer->buffer, m_strokeLog->strokeCount());
+    }
+    StrokePoint point = strokePoint(pos, pressure);
+    m_strokeLog->beginStroke(stroke.layerId, stroke.maskLayerId, stroke.alphaLock,
+                             stroke.brush, stroke.color, stroke.seed, point);
+    m_paintThread->beginStroke(stroke, point);
+}
+
+void CanvasItem::processDrawing(const QPointF &pos, float pressure) {
+    // Dropped points were never painted, so they stay out of the log too
+    StrokePoint point = strokePoint(pos, pressure);
+    if (m_paintThread->addPoint(point)) m_strokeLog->addPoint(point);
+}
+
+void CanvasItem::endDrawing() {
+    if (!m_isDrawing) return;
+    m_isDrawing = false;
+    m_paintThread->endStroke();
+    m_strokeLog->endStroke();
+}
+
+// Input is painted exactly as the stroke log stores it, so replay matches
+StrokePoint CanvasItem::strokePoint(const QPointF &pos, float pressure) const {
+    StrokePoint point = StrokeLog::quantize(StrokePoint(pos.x(), pos.y(), pressure));
+    point.timestamp = m_strokeLog->elapsedMs();
+    return point;
+}
+
+bool CanvasItem::saveStrokeLog(const QString &path) const {
+    QString localPath = path;
+    if (localPath.startsWith("file:///")) {
+        localPath = QUrl(path).toLocalFile();
+    }
+    return m_strokeLog->saveToFile(localPath.toStdString());
+}
+
+void CanvasItem::presentPaintUpdates() {
+    DirtyRect dirty = m_paintThread->takeDirty();
+    updateCanvasRect(dirty);
+
+    quint64 finished = m_paintThread->finishedStrokes();
+    if (finished != m_finishedStrokes) {
+        m_finishedStrokes = finished;
+        finishUndoStroke();
+        capture_timelapse_frame();
+    }
+}
+
+QVariantMap CanvasItem::paintStats() const {
+    PaintThread::Stats stats = m_paintThread->stats();
+    QVariantMap map;
+    map["eventsQueued"] = static_cast<qulonglong>(stats.eventsQueued);
+    map["eventsDropped"] = static_cast<qulonglong>(stats.eventsDropped);
+    map["eventsRendered"] = static_cast<qulonglong>(stats.eventsRendered);
+    map["dropRate"] = stats.eventsQueued + stats.eventsDropped > 0
+        ? static_cast<double>(stats.eventsDropped) / (stats.eventsQueued + stats.eventsDropped) : 0.0;
+    map["meanLatencyMs"] = stats.meanLatencyMs;
+    map["maxLatencyMs"] = stats.maxLatencyMs;
+    return map;
+}
+
+void CanvasItem::resetPaintStats() {
+    m_paintThread->resetStats();
+}
+
+// Schedules a repaint of a canvas-space rectangle only
+void CanvasItem::updateCanvasRect(const DirtyRect &dirty) {
+    if (dirty.isEmpty()) return;
+    QRectF area((dirty.x + m_viewOffset.x()) * m_zoomLevel, (dirty.y + m_viewOffset.y()) * m_zoomLevel,
+                dirty.w * m_zoomLevel, dirty.h * m_zoomLevel);
+    // Pad for smooth-scaling bleed at the edges
+    update(area.toAlignedRect().adjusted(-2, -2, 2, 2));
 }
 
 void CanvasItem::mouseReleaseEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton) {
-        m_isDrawing = false;
-        m_brushEngine->endStroke();
-        capture_timelapse_frame();
+        endDrawing();
     }
 }
 
@@ -5,9 +5,22 @@
 #include <QColor>
 #include <QPointF>
 #include <QImage>
+#include <QFuture>
+#include <QTimer>
+#include <atomic>
+#include <mutex>
 #include <QVariantList>
+#include "autosave.h"
 #include "brush_engine.h"
 #include "layer_manager.h"
+#include "paint_thread.h"
+#include "project_file.h"
+#include "selection_mask.h"
+#include "stroke_log.h"
+#include "tile_store.h"
+#include "timelapse.h"
+#include "transform.h"
+#include "undo_stack.h"
 
 class CanvasItem : public QQuickPaintedItem
 {
@@ -40,6 +53,10 @@ class CanvasItem : public QQuickPaintedItem
     Q_PROPERTY(QString brushTip READ brushTip NOTIFY brushTipChanged)
     Q_PROPERTY(QVariantList availableBrushes READ availableBrushes NOTIFY availableBrushesChanged)
     Q_PROPERTY(QString activeBrushName READ activeBrushName NOTIFY activeBrushNameChanged)
+    Q_PROPERTY(int fillTolerance READ fillTolerance WRITE setFillTolerance NOTIFY fillToleranceChanged)
+    Q_PROPERTY(int fillExpand READ fillExpand WRITE setFillExpand NOTIFY fillExpandChanged)
+    Q_PROPERTY(bool fillSampleAll READ fillSampleAll WRITE setFillSampleAll NOTIFY fillSampleAllChanged)
+    Q_PROPERTY(bool hasSelection READ hasSelection NOTIFY selectionChanged)
 
 public:
     explicit CanvasItem(QQuickItem *parent = nullptr);
@@ -74,6 +91,10 @@ public:
     QString brushTip() const { return m_brushTip; }
     QVariantList availableBrushes() const { return m_availableBrushes; }
     QString activeBrushName() const { return m_activeBrushName; }
+    int fillTolerance() const { return m_fillTolerance; }
+    int fillExpand() const { return m_fillExpand; }
+    bool fillSampleAll() const { return m_fillSampleAll; }
+    bool hasSelection() const { return m_selection != nullptr; }
 
     // Setters
     void setBrushSize(int size);
@@ -91,6 +112,9 @@ public:
     void setCursorRotation(float value);
     void setZoomLevel(float zoom);
     void setCurrentTool(const QString &tool);
+    void setFillTolerance(int tolerance);
+    void setFillExpand(int pixels);
+    void setFillSampleAll(bool sampleAll);
     Q_INVOKABLE void setBackgroundColor(const QString &color);
     Q_INVOKABLE void usePreset(const QString &name);
     Q_INVOKABLE bool loadProject(const QString &path);
@@ -98,7 +122,15 @@ public:
     Q_INVOKABLE bool saveProjectAs(const QString &path);
     Q_INVOKABLE bool exportImage(const QString &path, const QString &format);
     Q_INVOKABLE bool importABR(const QString &path);
+
+    // Free transform of the selection (or the active layer). The preview is
+    // resampled at about screen resolution while the matrix changes; apply
+    // renders full resolution on a worker ("bilinear", "bicubic" or
+    // "lanczos") and lands as one undo step.
+    Q_INVOKABLE void startTransform();
     Q_INVOKABLE void updateTransformProperties(float x, float y, float scale, float rotation, float w, float h);
+    Q_INVOKABLE void applyTransform(const QString &quality = "bicubic");
+    Q_INVOKABLE void cancelTransform();
     
     Q_INVOKABLE void resizeCanvas(int w, int h);
     Q_INVOKABLE void setProjectDpi(int dpi);
@@ -112,6 +144,26 @@ public:
     Q_INVOKABLE void setLayerBlendMode(int index, const QString &mode);
     Q_INVOKABLE void setLayerPrivate(int index, bool isPrivate);
     Q_INVOKABLE void setActiveLayer(int index);
+    Q_INVOKABLE qint64 layerMemoryUsage(int index) const;
+    Q_INVOKABLE void undo();
+    Q_INVOKABLE void redo();
+    Q_INVOKABLE bool canUndo() const;
+    Q_INVOKABLE bool canRedo() const;
+    Q_INVOKABLE void setUndoMemoryLimit(int megabytes);
+    // Keep layer tiles in a memory-mapped scratch file in `directory`
+    // (empty = the temp folder), at most `residentMegabytes` of them in
+    // RAM, for canvases larger than memory. Off by default; false if the
+    // file cannot be created.
+    Q_INVOKABLE bool setScratchStorage(bool enabled, const QString &directory = QString(),
+                                       int residentMegabytes = 2048);
+
+    // Stroke input latency and dropped input since the last reset
+    Q_INVOKABLE QVariantMap paintStats() const;
+    Q_INVOKABLE void resetPaintStats();
+
+    // Binary log of the strokes painted since the canvas was created
+    // (artflow::StrokeLog), for replay and benchmarks
+    Q_INVOKABLE bool saveStrokeLog(const QString &path) const;
 
     // Color Utilities (HCL support for Pro Sliders)
     Q_INVOKABLE QString hclToHex(float h, float c, float l);
@@ -132,6 +184,21 @@ public:
     Q_INVOKABLE void renameLayer(int index, const QString &name);
     Q_INVOKABLE void applyEffect(int index, const QString &effect, const QVariantMap &params);
     Q_INVOKABLE QString get_brush_preview(const QString &brushName);
+    Q_INVOKABLE void apply_color_drop(float x, float y, const QColor &color);
+
+    // Selection in canvas pixels; strokes and fills stay inside it. Modes
+    // are "replace", "add", "subtract" and "intersect". Lasso points are
+    // QPointF.
+    Q_INVOKABLE void selectRect(int x, int y, int w, int h, const QString &mode = "replace");
+    Q_INVOKABLE void selectLasso(const QVariantList &points, const QString &mode = "replace");
+    Q_INVOKABLE void selectAll();
+    Q_INVOKABLE void invertSelection();
+    Q_INVOKABLE void clearSelection();
+
+    // Encode this session's timelapse to `outputPath` (MP4) on a worker;
+    // aspect 0 = original, 1 = square, 2 = 9:16, quality 0 caps at 1080 px.
+    // Reports through timelapseExportProgress/Finished.
+    Q_INVOKABLE void exportTimelapse(const QString &outputPath, int durationSec = 0, int aspectMode = 0, int qualityMode = 1);
 
 signals:
     void brushSizeChanged();
@@ -163,6 +230,12 @@ signals:
     void layersChanged(const QVariantList &layers);
     void availableBrushesChanged();
     void activeBrushNameChanged();
+    void fillToleranceChanged();
+    void fillExpandChanged();
+    void fillSampleAllChanged();
+    void selectionChanged();
+    void timelapseExportProgress(int written, int total);
+    void timelapseExportFinished(bool success, const QString &message);
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
@@ -174,6 +247,21 @@ protected:
 private:
     artflow::BrushEngine *m_brushEngine;
     artflow::LayerManager *m_layerManager;
+    artflow::UndoStack *m_undoStack;
+    std::mutex m_undoPatchMutex;
+    std::shared_ptr<artflow::UndoStack::Patch> m_undoPatch;   // Delivered, not applied yet
+    artflow::PaintThread *m_paintThread;
+    artflow::StrokeLog *m_strokeLog;
+    artflow::TimelapseRecorder *m_timelapse = nullptr;
+    QString m_timelapsePath;
+    QFuture<void> m_timelapseExport;
+    std::atomic<bool> m_cancelTimelapseExport{false};
+    quint64 m_finishedStrokes = 0;   // Paint thread strokes already closed in history
+    // Journal of the changes since the project was last saved or opened;
+    // idle while the canvas has no project file
+    artflow::AutosaveJournal *m_autosave = nullptr;
+    QTimer m_autosaveTimer;
+    std::shared_ptr<artflow::TileStore> m_tileStore;   // nullptr = layer tiles on the heap
 
     int m_brushSize;
     QColor m_brushColor;
@@ -198,17 +286,51 @@ private:
     float m_cursorRotation;
     QString m_currentProjectPath;
     QString m_currentProjectName;
+    QString m_loadedProjectPath;   // Project the layers were loaded from
     QString m_brushTip;
     QVariantList m_availableBrushes;
     QString m_activeBrushName;
+    int m_fillTolerance = 30;
+    int m_fillExpand = 0;
+    bool m_fillSampleAll = false;
+    // Never modified once published: edits build a new mask (tiles are
+    // shared copy-on-write), so strokes in flight keep the one they began
+    // with. nullptr = no selection.
+    std::shared_ptr<const artflow::SelectionMask> m_selection;
+
+    // Free transform state: the lifted pixels, the layer as it was (for
+    // cancel) and the reduced-resolution preview, m_transformPreviewScale
+    // preview pixels per canvas pixel
+    std::shared_ptr<const artflow::TransformSource> m_transformSource;
+    std::unique_ptr<artflow::ImageBuffer> m_transformOriginal;
+    std::unique_ptr<artflow::ImageBuffer> m_transformPreview;
+    artflow::Affine m_transformMatrix;
+    float m_transformPreviewScale = 1.0f;
+    int m_transformLayerId = -1;
+    bool m_transformApplying = false;
+    QFuture<void> m_transformJob;
     
-    QPointF m_lastPos;
     bool m_isDrawing;
 
     QVariantList _scanSync();
     void updateLayersList();
+    template <typename Edit> void editSelection(Edit edit);
+    void renderTransformPreview();
+    void finishTransform(const std::shared_ptr<artflow::ImageBuffer> &result);
+    void resetTransform();
     void capture_timelapse_frame();
+    void startTimelapse(artflow::ProjectReader *project = nullptr);
+    void autosaveCheckpoint();
+    void beginDrawing(const QPointF &pos, float pressure);
     void processDrawing(const QPointF &pos, float pressure);
+    void endDrawing();
+    artflow::StrokePoint strokePoint(const QPointF &pos, float pressure) const;
+    void presentPaintUpdates();
+    void updateCanvasRect(const artflow::DirtyRect &dirty);
+    void finishUndoStroke();
+    void dropUndoneStrokes(size_t undone);
+    void applyUndoPatch();
+    void settleUndoStep();
 };
 
 #endif // CANVASITEM_H
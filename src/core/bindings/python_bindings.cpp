@@ -4,11 +4,20 @@
  */
 
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include "brush_engine.h"
 #include "image_buffer.h"
 #include "layer_manager.h"
 #include "color_utils.h"
+#include "stroke_log.h"
+#include "timelapse.h"
+#include "timelapse_export.h"
+#include "project_file.h"
+#include "flood_fill.h"
+#include "selection_mask.h"
+#include "tile_store.h"
+#include "transform.h"
 #include "stroke_renderer.h"
 #include "../canvas/renderer.h"
 #include "../brushes/abr_parser.h"
@@ -16,6 +25,59 @@
 namespace py = pybind11;
 using namespace artflow;
 
+namespace {
+
+// (h, w, 4) uint8 view of premultiplied RGBA rows `stride` bytes apart.
+// `base` keeps the memory alive for as long as the array exists.
+py::array_t<uint8_t> pixelView(const uint8_t* pixels, int w, int h, size_t stride, py::handle base, bool writable) {
+    py::array_t<uint8_t> view({h, w, 4},
+                              {static_cast<py::ssize_t>(stride), py::ssize_t(4), py::ssize_t(1)},
+                              pixels, base);
+    if (!writable) {
+        py::detail::array_proxy(view.ptr())->flags &= ~py::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+    }
+    return view;
+}
+
+// (h, w) uint8 array with contiguous pixels; rows may be padded (e.g. a
+// QImage view)
+bool isMaskArray(const py::array& a, int w, int h) {
+    return a.dtype().is(py::dtype::of<uint8_t>()) && a.ndim() == 2 &&
+           a.shape(0) == h && a.shape(1) == w && a.strides(1) == 1;
+}
+
+// (h, w, 4) uint8 array with packed pixels, in any channel order (e.g. a
+// view of QImage bits); rows may be padded
+bool isPixelArray(const py::array& a) {
+    return a.dtype().is(py::dtype::of<uint8_t>()) && a.ndim() == 3 && a.shape(2) == 4 &&
+           a.strides(2) == 1 && a.strides(1) == 4;
+}
+
+// Fill options with an optional selection: a SelectionMask or an (h, w)
+// uint8 array (see isMaskArray())
+FillOptions fillOptions(int tolerance, int expand, const py::object& selection, int w, int h) {
+    FillOptions options;
+    options.tolerance = tolerance;
+    options.expand = expand;
+    if (py::isinstance<SelectionMask>(selection)) {
+        const SelectionMask& mask = selection.cast<const SelectionMask&>();
+        if (mask.width() != w || mask.height() != h) {
+            throw py::value_error("selection must have the size of the target");
+        }
+        options.selectionMask = &mask;
+    } else if (!selection.is_none()) {
+        py::array mask = py::reinterpret_borrow<py::array>(selection);
+        if (!py::isinstance<py::array>(selection) || !isMaskArray(mask, w, h)) {
+            throw py::value_error("selection must be a SelectionMask or a uint8 array of shape (height, width)");
+        }
+        options.selection = static_cast<const uint8_t*>(mask.data());
+        options.selectionStride = static_cast<size_t>(mask.strides(0));
+    }
+    return options;
+}
+
+} // namespace
+
 PYBIND11_MODULE(artflow_native, m) {
     m.doc() = "ArtFlow Studio Native Core - High-performance drawing engine";
 
@@ -70,26 +132,93 @@ PYBIND11_MODULE(artflow_native, m) {
         .value("Eraser", BrushSettings::Type::Eraser)
         .value("Custom", BrushSettings::Type::Custom);
 
+    // DirtyRect
+    py::class_<DirtyRect>(m, "DirtyRect")
+        .def(py::init<>())
+        .def_readwrite("x", &DirtyRect::x)
+        .def_readwrite("y", &DirtyRect::y)
+        .def_readwrite("w", &DirtyRect::w)
+        .def_readwrite("h", &DirtyRect::h)
+        .def("isEmpty", &DirtyRect::isEmpty)
+        .def("unite", &DirtyRect::unite);
+
     // ImageBuffer
-    py::class_<ImageBuffer>(m, "ImageBuffer")
-        .def(py::init<int, int>())
+    py::class_<ImageBuffer> imageBuffer(m, "ImageBuffer", py::buffer_protocol());
+
+    py::enum_<ImageBuffer::Storage>(imageBuffer, "Storage")
+        .value("Linear", ImageBuffer::Storage::Linear)
+        .value("Tiled", ImageBuffer::Storage::Tiled);
+
+    imageBuffer
+        .def(py::init<int, int, ImageBuffer::Storage>(),
+             py::arg("width"), py::arg("height"),
+             py::arg("storage") = ImageBuffer::Storage::Linear)
         .def("width", &ImageBuffer::width)
         .def("height", &ImageBuffer::height)
+        .def("isTiled", &ImageBuffer::isTiled)
+        .def("memoryUsage", [](const ImageBuffer& self) { return self.memoryUsage(); })
         .def("setPixel", &ImageBuffer::setPixel)
-        .def("fill", &ImageBuffer::fill)
-        .def("clear", &ImageBuffer::clear)
+        // Pixel-heavy calls run without the GIL so other Python threads
+        // (UI, autosave) keep going
+        .def("fill", &ImageBuffer::fill, py::call_guard<py::gil_scoped_release>())
+        .def("clear", &ImageBuffer::clear, py::call_guard<py::gil_scoped_release>())
         .def("blendPixel", &ImageBuffer::blendPixel)
         .def("drawCircle", &ImageBuffer::drawCircle,
              py::arg("cx"), py::arg("cy"), py::arg("radius"),
              py::arg("r"), py::arg("g"), py::arg("b"), py::arg("a"),
-             py::arg("hardness") = 1.0f, py::arg("grain") = 0.0f)
+             py::arg("hardness") = 1.0f, py::arg("grain") = 0.0f,
+             py::arg("alphaLock") = false, py::arg("isEraser") = false,
+             py::arg("mask") = nullptr, py::arg("selection") = nullptr,
+             py::call_guard<py::gil_scoped_release>())
         .def("drawStrokeTextured", &ImageBuffer::drawStrokeTextured,
              py::arg("x1"), py::arg("y1"), py::arg("x2"), py::arg("y2"),
              py::arg("stamp"), py::arg("spacing"), py::arg("opacity"),
              py::arg("rotate") = true, py::arg("angle_jitter") = 0.0f,
              py::arg("is_watercolor") = false,
-             py::arg("paper_texture") = nullptr)
-        .def("getBytes", &ImageBuffer::getBytes);
+             py::arg("paper_texture") = nullptr,
+             py::call_guard<py::gil_scoped_release>())
+        .def("getBytes", &ImageBuffer::getBytes, py::call_guard<py::gil_scoped_release>())
+        // Zero-copy access. Pixels are premultiplied RGBA8, e.g. for
+        // QImage.Format_RGBA8888_Premultiplied; getBytes() is the
+        // straight-alpha copy.
+        .def_buffer([](ImageBuffer& self) -> py::buffer_info {
+            if (self.isTiled()) {
+                throw py::buffer_error("Tiled ImageBuffer has no contiguous pixels; use regionView() or tileView()");
+            }
+            return py::buffer_info(self.data(), sizeof(uint8_t), py::format_descriptor<uint8_t>::format(), 3,
+                                   {self.height(), self.width(), 4},
+                                   {self.width() * 4, 4, 1});
+        })
+        .def("regionView", [](py::object selfObj, const DirtyRect& rect) {
+            // Changed region only: a strided view into linear storage, or a
+            // single copy of the region for tiled storage
+            ImageBuffer& self = selfObj.cast<ImageBuffer&>();
+            DirtyRect r = rect.intersected(self.width(), self.height());
+            if (!self.isTiled()) {
+                const size_t stride = static_cast<size_t>(self.width()) * 4;
+                return pixelView(self.data() + r.y * stride + r.x * 4, r.w, r.h, stride, selfObj, true);
+            }
+            py::array_t<uint8_t> copy({r.h, r.w, 4});
+            self.readRegion(r.x, r.y, r.w, r.h, copy.mutable_data(), static_cast<size_t>(r.w) * 4);
+            return copy;
+        }, py::arg("rect"))
+        .def("regionView", [](py::object selfObj, int x, int y, int w, int h) {
+            return selfObj.attr("regionView")(DirtyRect{x, y, w, h});
+        }, py::arg("x"), py::arg("y"), py::arg("w"), py::arg("h"))
+        .def("tileView", [](const ImageBuffer& self, int tx, int ty) -> py::object {
+            // Read-only snapshot of one tile; the view holds the tile, and
+            // copy-on-write keeps later strokes out of it. None if empty.
+            ImageBuffer::TileHandle tile = self.tileHandle(tx, ty);
+            if (!tile) return py::none();
+            const int w = std::min(ImageBuffer::kTileSize, self.width() - tx * ImageBuffer::kTileSize);
+            const int h = std::min(ImageBuffer::kTileSize, self.height() - ty * ImageBuffer::kTileSize);
+            auto* holder = new ImageBuffer::TileHandle(tile);
+            py::capsule owner(holder, [](void* p) { delete static_cast<ImageBuffer::TileHandle*>(p); });
+            return pixelView(tile->data(), w, h, ImageBuffer::kTileStride, owner, false);
+        }, py::arg("tx"), py::arg("ty"))
+        .def("tileCountX", &ImageBuffer::tileCountX)
+        .def("tileCountY", &ImageBuffer::tileCountY)
+        .def_property_readonly_static("kTileSize", [](py::object) { return ImageBuffer::kTileSize; });
 
     // BrushEngine
     py::class_<BrushEngine>(m, "BrushEngine")
@@ -98,11 +227,43 @@ PYBIND11_MODULE(artflow_native, m) {
         .def("getBrush", &BrushEngine::getBrush, py::return_value_policy::reference)
         .def("setColor", &BrushEngine::setColor)
         .def("getColor", &BrushEngine::getColor, py::return_value_policy::reference)
-        .def("beginStroke", &BrushEngine::beginStroke)
+        .def("beginStroke", py::overload_cast<const StrokePoint&>(&BrushEngine::beginStroke))
+        .def("beginStroke", py::overload_cast<const StrokePoint&, uint64_t>(&BrushEngine::beginStroke),
+             py::arg("point"), py::arg("seed"))
+        .def("strokeSeed", &BrushEngine::strokeSeed)
+        .def_static("newStrokeSeed", &BrushEngine::newStrokeSeed)
         .def("continueStroke", &BrushEngine::continueStroke)
         .def("endStroke", &BrushEngine::endStroke)
-        .def("renderDab", &BrushEngine::renderDab)
-        .def("renderStrokeSegment", &BrushEngine::renderStrokeSegment);
+        .def("renderDab", &BrushEngine::renderDab,
+             py::arg("target"), py::arg("x"), py::arg("y"), py::arg("pressure"),
+             py::arg("alphaLock") = false, py::arg("mask") = nullptr, py::arg("selection") = nullptr,
+             py::call_guard<py::gil_scoped_release>())
+        .def("renderStrokeSegment", &BrushEngine::renderStrokeSegment,
+             py::arg("target"), py::arg("from"), py::arg("to"),
+             py::arg("alphaLock") = false, py::arg("mask") = nullptr, py::arg("selection") = nullptr,
+             py::call_guard<py::gil_scoped_release>())
+        .def("renderStroke", [](BrushEngine& self, ImageBuffer& target,
+                                py::array_t<float, py::array::c_style | py::array::forcecast> points,
+                                bool alphaLock, const ImageBuffer* mask, const SelectionMask* selection) {
+            // Rows of (x, y, pressure, tiltX, tiltY); one call per batch of
+            // input events instead of one per segment
+            if (points.ndim() != 2 || points.shape(1) != 5) {
+                throw py::value_error("renderStroke expects a float array of shape (N, 5): x, y, pressure, tiltX, tiltY");
+            }
+            auto rows = points.unchecked<2>();
+            std::vector<StrokePoint> stroke(static_cast<size_t>(rows.shape(0)));
+            for (py::ssize_t i = 0; i < rows.shape(0); ++i) {
+                StrokePoint& p = stroke[i];
+                p.x = rows(i, 0);
+                p.y = rows(i, 1);
+                p.pressure = rows(i, 2);
+                p.tiltX = rows(i, 3);
+                p.tiltY = rows(i, 4);
+            }
+            py::gil_scoped_release release;
+            return self.renderStroke(target, stroke.data(), stroke.size(), alphaLock, mask, selection);
+        }, py::arg("target"), py::arg("points"), py::arg("alphaLock") = false, py::arg("mask") = nullptr,
+           py::arg("selection") = nullptr);
 
     // BlendMode enum
     py::enum_<BlendMode>(m, "BlendMode")
@@ -120,10 +281,13 @@ PYBIND11_MODULE(artflow_native, m) {
     // Layer
     py::class_<Layer>(m, "Layer")
         .def_readwrite("name", &Layer::name)
+        .def_readonly("id", &Layer::id)
         .def_readwrite("opacity", &Layer::opacity)
         .def_readwrite("blendMode", &Layer::blendMode)
         .def_readwrite("visible", &Layer::visible)
-        .def_readwrite("locked", &Layer::locked);
+        .def_readwrite("locked", &Layer::locked)
+        .def("hasWetMaps", &Layer::hasWetMaps)
+        .def("memoryUsage", [](const Layer& self) { return self.memoryUsage(); });
 
     // LayerManager
     py::class_<LayerManager>(m, "LayerManager")
@@ -135,12 +299,388 @@ PYBIND11_MODULE(artflow_native, m) {
         .def("mergeDown", &LayerManager::mergeDown)
         .def("getLayer", static_cast<Layer* (LayerManager::*)(int)>(&LayerManager::getLayer),
              py::return_value_policy::reference)
+        .def("findLayerById", &LayerManager::findLayerById, py::return_value_policy::reference)
         .def("getLayerCount", &LayerManager::getLayerCount)
         .def("setActiveLayer", &LayerManager::setActiveLayer)
         .def("getActiveLayerIndex", &LayerManager::getActiveLayerIndex)
-        .def("compositeAll", &LayerManager::compositeAll)
+        .def("getLayerMemoryUsage", &LayerManager::getLayerMemoryUsage)
+        .def("getMemoryUsage", &LayerManager::getMemoryUsage)
+        .def("compositeAll", &LayerManager::compositeAll,
+             py::arg("output"), py::arg("skipPrivate") = false,
+             py::call_guard<py::gil_scoped_release>())
+        .def("compositeBelowActive", &LayerManager::compositeBelowActive, py::return_value_policy::reference_internal)
+        .def("compositeAboveActive", &LayerManager::compositeAboveActive, py::return_value_policy::reference_internal)
+        .def("invalidateComposite", &LayerManager::invalidateComposite)
+        .def("floodFill", [](LayerManager& self, int index, int x, int y, const Color& color,
+                             int tolerance, int expand, bool sampleAllLayers, const py::object& selection) {
+            FillOptions options = fillOptions(tolerance, expand, selection, self.width(), self.height());
+            py::gil_scoped_release release;
+            return self.floodFill(index, x, y, color.r, color.g, color.b, color.a, options, sampleAllLayers);
+        }, py::arg("index"), py::arg("x"), py::arg("y"), py::arg("color"), py::arg("tolerance") = 0,
+           py::arg("expand") = 0, py::arg("sampleAllLayers") = false, py::arg("selection") = py::none())
         .def("width", &LayerManager::width)
-        .def("height", &LayerManager::height);
+        .def("height", &LayerManager::height)
+        .def("setTileStore", &LayerManager::setTileStore, py::arg("store"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("tileStore", &LayerManager::tileStore);
+
+    // Memory-mapped tile storage with a resident budget (tile_store.h)
+    py::class_<TileStore, std::shared_ptr<TileStore>>(m, "TileStore")
+        .def(py::init([](const std::string& directory, size_t residentBudget) {
+            std::string error;
+            std::shared_ptr<TileStore> store = TileStore::create(directory, residentBudget, &error);
+            if (!store) throw std::runtime_error(error);
+            return store;
+        }), py::arg("directory") = "", py::arg("residentBudget") = size_t(2) << 30)
+        .def("setResidentBudget", &TileStore::setResidentBudget)
+        .def("residentBudget", &TileStore::residentBudget)
+        .def("residentBytes", &TileStore::residentBytes)
+        .def("allocatedBytes", &TileStore::allocatedBytes)
+        .def("fileBytes", &TileStore::fileBytes)
+        .def("trim", &TileStore::trim, py::call_guard<py::gil_scoped_release>());
+
+    // StrokeLog (recorded strokes, replay)
+    py::class_<StrokeLog::Stroke>(m, "LoggedStroke")
+        .def_readonly("layerId", &StrokeLog::Stroke::layerId)
+        .def_readonly("maskLayerId", &StrokeLog::Stroke::maskLayerId)
+        .def_readonly("alphaLock", &StrokeLog::Stroke::alphaLock)
+        .def_readonly("brushHash", &StrokeLog::Stroke::brushHash)
+        .def_readonly("color", &StrokeLog::Stroke::color)
+        .def_readonly("seed", &StrokeLog::Stroke::seed)
+        .def_readonly("points", &StrokeLog::Stroke::points);
+
+    py::class_<StrokeLog>(m, "StrokeLog")
+        .def(py::init<>())
+        .def_static("quantize", &StrokeLog::quantize)
+        .def("elapsedMs", &StrokeLog::elapsedMs)
+        .def("beginStroke", &StrokeLog::beginStroke,
+             py::arg("layerId"), py::arg("maskLayerId"), py::arg("alphaLock"), py::arg("brush"),
+             py::arg("color"), py::arg("seed"), py::arg("point"))
+        .def("addPoint", &StrokeLog::addPoint)
+        .def("endStroke", &StrokeLog::endStroke)
+        .def("cancelStroke", &StrokeLog::cancelStroke)
+        .def("strokeCount", &StrokeLog::strokeCount)
+        .def("stroke", &StrokeLog::stroke)
+        .def("brush", &StrokeLog::brush, py::return_value_policy::copy)
+        .def("truncate", &StrokeLog::truncate)
+        .def("clear", &StrokeLog::clear)
+        .def("byteSize", &StrokeLog::byteSize)
+        .def("replay", &StrokeLog::replay,
+             py::arg("layers"), py::arg("first") = 0, py::arg("count") = SIZE_MAX,
+             py::call_guard<py::gil_scoped_release>())
+        .def("serialize", [](const StrokeLog& self) {
+            std::vector<uint8_t> bytes = self.serialize();
+            return py::bytes(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        })
+        .def("deserialize", [](StrokeLog& self, py::bytes data) {
+            std::string s = data;
+            return self.deserialize(reinterpret_cast<const uint8_t*>(s.data()), s.size());
+        })
+        .def("saveToFile", &StrokeLog::saveToFile)
+        .def("loadFromFile", &StrokeLog::loadFromFile);
+
+    // SelectionMask (0 = unselected, 255 = selected)
+    py::class_<SelectionMask> selectionMask(m, "SelectionMask");
+
+    py::enum_<SelectionMask::Op>(selectionMask, "Op")
+        .value("Replace", SelectionMask::Op::Replace)
+        .value("Add", SelectionMask::Op::Add)
+        .value("Subtract", SelectionMask::Op::Subtract)
+        .value("Intersect", SelectionMask::Op::Intersect);
+
+    selectionMask
+        .def(py::init<int, int>(), py::arg("width"), py::arg("height"))
+        .def("width", &SelectionMask::width)
+        .def("height", &SelectionMask::height)
+        .def("bounds", &SelectionMask::bounds)
+        .def("isEmpty", &SelectionMask::isEmpty)
+        .def("clear", &SelectionMask::clear)
+        .def("selectAll", &SelectionMask::selectAll)
+        .def("invert", &SelectionMask::invert, py::call_guard<py::gil_scoped_release>())
+        .def("selectRect", &SelectionMask::selectRect,
+             py::arg("x"), py::arg("y"), py::arg("w"), py::arg("h"), py::arg("op") = SelectionMask::Op::Replace,
+             py::call_guard<py::gil_scoped_release>())
+        .def("selectPolygon", [](SelectionMask& self,
+                                 py::array_t<float, py::array::c_style | py::array::forcecast> points,
+                                 SelectionMask::Op op) {
+            // Rows of (x, y), e.g. a lasso path in canvas pixels
+            if (points.ndim() != 2 || points.shape(1) != 2) {
+                throw py::value_error("selectPolygon expects a float array of shape (N, 2)");
+            }
+            const float* xy = points.data();
+            const size_t count = static_cast<size_t>(points.shape(0));
+            py::gil_scoped_release release;
+            self.selectPolygon(xy, count, op);
+        }, py::arg("points"), py::arg("op") = SelectionMask::Op::Replace)
+        .def("valueAt", &SelectionMask::valueAt)
+        .def("memoryUsage", &SelectionMask::memoryUsage)
+        // Copy into an (h, w) uint8 array, e.g. a view of Grayscale8
+        // QImage bits. Only `rect` (default: all) is written.
+        .def("readInto", [](const SelectionMask& self, py::array out, const py::object& rect) {
+            if (!isMaskArray(out, self.width(), self.height()) || !out.writeable()) {
+                throw py::value_error("readInto expects a writable uint8 array of shape (height, width)");
+            }
+            DirtyRect r = rect.is_none() ? DirtyRect{0, 0, self.width(), self.height()} : rect.cast<DirtyRect>();
+            r = r.intersected(self.width(), self.height());
+            const size_t stride = static_cast<size_t>(out.strides(0));
+            uint8_t* data = static_cast<uint8_t*>(out.mutable_data()) + r.y * stride + r.x;
+            py::gil_scoped_release release;
+            self.readRegion(r.x, r.y, r.w, r.h, data, stride);
+        }, py::arg("out"), py::arg("rect") = py::none())
+        .def("toArray", [](const SelectionMask& self) {
+            py::array_t<uint8_t> out({self.height(), self.width()});
+            self.readRegion(0, 0, self.width(), self.height(), out.mutable_data(), static_cast<size_t>(self.width()));
+            return out;
+        })
+        // Replace the whole mask with an (h, w) uint8 array
+        .def("fromArray", [](SelectionMask& self, py::array in) {
+            if (!isMaskArray(in, self.width(), self.height())) {
+                throw py::value_error("fromArray expects a uint8 array of shape (height, width)");
+            }
+            const uint8_t* data = static_cast<const uint8_t*>(in.data());
+            const size_t stride = static_cast<size_t>(in.strides(0));
+            py::gil_scoped_release release;
+            self.writeRegion(0, 0, self.width(), self.height(), data, stride);
+        }, py::arg("array"))
+        .def_property_readonly_static("kTileSize", [](py::object) { return SelectionMask::kTileSize; });
+
+    // Flood fill. The caller's arrays stay referenced for the whole call.
+    m.def("floodFill", [](ImageBuffer& target, int x, int y, const Color& color, int tolerance, int expand,
+                          const ImageBuffer* sample, const py::object& selection) {
+        FillOptions options = fillOptions(tolerance, expand, selection, target.width(), target.height());
+        py::gil_scoped_release release;
+        return floodFill(target, x, y, color.r, color.g, color.b, color.a, options, sample);
+    }, py::arg("target"), py::arg("x"), py::arg("y"), py::arg("color"), py::arg("tolerance") = 0,
+       py::arg("expand") = 0, py::arg("sample") = nullptr, py::arg("selection") = py::none());
+
+    // In place on a writable (h, w, 4) uint8 array in any channel order,
+    // e.g. a view of QImage bits; `color` is 4 values in that order
+    // `sample` is an optional array of the same shape to find the region on
+    m.def("floodFillPixels", [](py::array pixels, int x, int y, const std::array<uint8_t, 4>& color,
+                                int tolerance, int expand, const py::object& selection, const py::object& sample) {
+        if (!isPixelArray(pixels)) {
+            throw py::value_error("floodFillPixels expects a uint8 array of shape (height, width, 4)");
+        }
+        const int w = static_cast<int>(pixels.shape(1));
+        const int h = static_cast<int>(pixels.shape(0));
+        FillOptions options = fillOptions(tolerance, expand, selection, w, h);
+
+        const uint8_t* sampleData = nullptr;
+        size_t sampleStride = 0;
+        if (!sample.is_none()) {
+            py::array s = py::reinterpret_borrow<py::array>(sample);
+            if (!py::isinstance<py::array>(sample) || !isPixelArray(s) || s.shape(0) != h || s.shape(1) != w) {
+                throw py::value_error("sample must be a uint8 array with the shape of pixels");
+            }
+            sampleData = static_cast<const uint8_t*>(s.data());
+            sampleStride = static_cast<size_t>(s.strides(0));
+        }
+
+        uint8_t* data = static_cast<uint8_t*>(pixels.mutable_data());
+        py::gil_scoped_release release;
+        return floodFill(data, w, h, static_cast<size_t>(pixels.strides(0)), x, y, color.data(), options,
+                         sampleData, sampleStride);
+    }, py::arg("pixels"), py::arg("x"), py::arg("y"), py::arg("color"), py::arg("tolerance") = 0,
+       py::arg("expand") = 0, py::arg("selection") = py::none(), py::arg("sample") = py::none());
+
+    // Affine transform with resampling (transform.h)
+    py::enum_<Resampling>(m, "Resampling")
+        .value("Bilinear", Resampling::Bilinear)
+        .value("Bicubic", Resampling::Bicubic)
+        .value("Lanczos3", Resampling::Lanczos3);
+
+    py::class_<Affine>(m, "Affine")
+        .def(py::init<>())
+        .def(py::init([](double m11, double m12, double m21, double m22, double dx, double dy) {
+            return Affine{m11, m12, m21, m22, dx, dy};
+        }), py::arg("m11"), py::arg("m12"), py::arg("m21"), py::arg("m22"), py::arg("dx"), py::arg("dy"))
+        .def_readwrite("m11", &Affine::m11)
+        .def_readwrite("m12", &Affine::m12)
+        .def_readwrite("m21", &Affine::m21)
+        .def_readwrite("m22", &Affine::m22)
+        .def_readwrite("dx", &Affine::dx)
+        .def_readwrite("dy", &Affine::dy)
+        .def_static("translation", &Affine::translation)
+        .def_static("scaling", &Affine::scaling)
+        .def_static("rotation", &Affine::rotation)
+        .def("then", &Affine::then)
+        .def("determinant", &Affine::determinant)
+        .def("isInvertible", &Affine::isInvertible)
+        .def("inverted", &Affine::inverted)
+        .def("map", [](const Affine& self, double x, double y) {
+            double ox, oy;
+            self.map(x, y, &ox, &oy);
+            return py::make_tuple(ox, oy);
+        })
+        .def("mapRect", &Affine::mapRect);
+
+    // Shared so a preview and the final pass can read one source at once
+    py::class_<TransformSource, std::shared_ptr<TransformSource>>(m, "TransformSource")
+        .def(py::init([](const ImageBuffer& image, const py::object& rect, const SelectionMask* selection) {
+            DirtyRect r = rect.is_none() ? DirtyRect{0, 0, image.width(), image.height()} : rect.cast<DirtyRect>();
+            if (selection && (selection->width() != image.width() || selection->height() != image.height())) {
+                throw py::value_error("selection must have the size of the image");
+            }
+            py::gil_scoped_release release;
+            return std::make_shared<TransformSource>(image, r, selection);
+        }), py::arg("image"), py::arg("rect") = py::none(), py::arg("selection") = nullptr)
+        // Premultiplied (h, w, 4) array (see isPixelArray()), copied
+        .def(py::init([](py::array pixels) {
+            if (!isPixelArray(pixels)) {
+                throw py::value_error("TransformSource expects a uint8 array of shape (height, width, 4)");
+            }
+            const uint8_t* data = static_cast<const uint8_t*>(pixels.data());
+            const int w = static_cast<int>(pixels.shape(1));
+            const int h = static_cast<int>(pixels.shape(0));
+            const size_t stride = static_cast<size_t>(pixels.strides(0));
+            py::gil_scoped_release release;
+            return std::make_shared<TransformSource>(data, w, h, stride);
+        }), py::arg("pixels"))
+        .def("rect", &TransformSource::rect)
+        .def("isEmpty", &TransformSource::isEmpty)
+        .def("maxLevel", &TransformSource::maxLevel);
+
+    m.def("transformImage", [](const TransformSource& source, const Affine& matrix, ImageBuffer& target,
+                               Resampling quality) {
+        return transformImage(source, matrix, target, quality);
+    }, py::arg("source"), py::arg("matrix"), py::arg("target"), py::arg("quality") = Resampling::Bicubic,
+       py::call_guard<py::gil_scoped_release>());
+
+    // Into a writable (h, w, 4) array with the channel order of the source;
+    // the covered area should be transparent
+    m.def("transformPixels", [](const TransformSource& source, const Affine& matrix, py::array pixels,
+                                Resampling quality) {
+        if (!isPixelArray(pixels) || !pixels.writeable()) {
+            throw py::value_error("transformPixels expects a writable uint8 array of shape (height, width, 4)");
+        }
+        uint8_t* data = static_cast<uint8_t*>(pixels.mutable_data());
+        const int w = static_cast<int>(pixels.shape(1));
+        const int h = static_cast<int>(pixels.shape(0));
+        const size_t stride = static_cast<size_t>(pixels.strides(0));
+        py::gil_scoped_release release;
+        return transformImage(source, matrix, data, w, h, stride, quality);
+    }, py::arg("source"), py::arg("matrix"), py::arg("pixels"), py::arg("quality") = Resampling::Bicubic);
+
+    m.def("eraseRegion", &eraseRegion, py::arg("image"), py::arg("rect"), py::arg("selection") = nullptr,
+          py::call_guard<py::gil_scoped_release>());
+
+    // Timelapse capture and container access (timelapse.h)
+    py::class_<TimelapseRecorder>(m, "TimelapseRecorder")
+        .def(py::init<int, int, int>(), py::arg("canvasWidth"), py::arg("canvasHeight"),
+             py::arg("maxSize") = TimelapseRecorder::kDefaultMaxSize)
+        .def("open", &TimelapseRecorder::open, py::call_guard<py::gil_scoped_release>())
+        .def("frameWidth", &TimelapseRecorder::frameWidth)
+        .def("frameHeight", &TimelapseRecorder::frameHeight)
+        .def("frameCount", &TimelapseRecorder::frameCount)
+        .def("capture", &TimelapseRecorder::capture, py::arg("layers"))
+        .def("flush", &TimelapseRecorder::flush, py::call_guard<py::gil_scoped_release>());
+
+    py::class_<TimelapseReader>(m, "TimelapseReader")
+        .def(py::init<>())
+        .def("open", &TimelapseReader::open, py::arg("path"), py::arg("offset") = 0,
+             py::arg("size") = UINT64_MAX, py::call_guard<py::gil_scoped_release>())
+        .def("width", &TimelapseReader::width)
+        .def("height", &TimelapseReader::height)
+        .def("frameCount", &TimelapseReader::frameCount)
+        .def("timestampMs", &TimelapseReader::timestampMs)
+        .def("isKeyFrame", &TimelapseReader::isKeyFrame)
+        // Premultiplied (h, w, 4) array of frame `index`
+        .def("readFrame", [](TimelapseReader& self, size_t index) {
+            if (index >= self.frameCount()) throw py::index_error("frame index out of range");
+            py::array_t<uint8_t> out({self.height(), self.width(), 4});
+            uint8_t* data = out.mutable_data();
+            bool ok;
+            {
+                py::gil_scoped_release release;
+                ok = self.readFrame(index, data, static_cast<size_t>(self.width()) * 4);
+            }
+            if (!ok) throw std::runtime_error("corrupt timelapse frame");
+            return out;
+        }, py::arg("index"));
+
+    // Video export (timelapse_export.h)
+    py::class_<TimelapseExportOptions> exportOptions(m, "TimelapseExportOptions");
+    py::enum_<TimelapseExportOptions::Aspect>(exportOptions, "Aspect")
+        .value("Original", TimelapseExportOptions::Aspect::Original)
+        .value("Square", TimelapseExportOptions::Aspect::Square)
+        .value("Portrait", TimelapseExportOptions::Aspect::Portrait);
+    exportOptions
+        .def(py::init<>())
+        .def_readwrite("aspect", &TimelapseExportOptions::aspect)
+        .def_readwrite("letterbox", &TimelapseExportOptions::letterbox)
+        .def_readwrite("maxSize", &TimelapseExportOptions::maxSize)
+        .def_readwrite("durationSec", &TimelapseExportOptions::durationSec)
+        .def_readwrite("holdSec", &TimelapseExportOptions::holdSec)
+        .def_readwrite("background", &TimelapseExportOptions::background)
+        .def_readwrite("encoder", &TimelapseExportOptions::encoder)
+        .def_readwrite("crf", &TimelapseExportOptions::crf);
+
+    // (ok, error message); `progress(written, total)` returning False cancels
+    m.def("exportTimelapse", [](const std::string& source, const std::string& output,
+                                const TimelapseExportOptions& options, py::object progress) {
+        TimelapseExportProgress callback;
+        std::unique_ptr<py::error_already_set> raised;
+        if (!progress.is_none()) {
+            callback = [&](int written, int total) {
+                py::gil_scoped_acquire acquire;
+                try {
+                    py::object result = progress(written, total);
+                    return result.is_none() || result.cast<bool>();
+                } catch (py::error_already_set& e) {
+                    raised = std::make_unique<py::error_already_set>(std::move(e));
+                    return false;
+                }
+            };
+        }
+        std::string error;
+        bool ok;
+        {
+            py::gil_scoped_release release;
+            ok = exportTimelapse(source, output, options, callback, &error);
+        }
+        if (raised) throw std::move(*raised);
+        return py::make_tuple(ok, error);
+    }, py::arg("source"), py::arg("output"), py::arg("options") = TimelapseExportOptions(),
+       py::arg("progress") = py::none());
+
+    // Native project files (project_file.h); (ok, error message)
+    m.def("saveProject", [](const std::string& path, const LayerManager& layers, const std::string& created,
+                            py::bytes preview, const std::vector<std::pair<std::string, std::string>>& files,
+                            const std::string& carryTimelapseFrom, int compressionLevel,
+                            const std::string& loadedFrom) {
+        ProjectSnapshot project = snapshotProject(layers);
+        project.info.created = created;
+        ProjectSaveOptions options;
+        const std::string previewBytes = preview;
+        options.previewPng.assign(previewBytes.begin(), previewBytes.end());
+        options.files = files;
+        options.carryTimelapseFrom = carryTimelapseFrom;
+        options.compressionLevel = compressionLevel;
+        options.loadedFrom = loadedFrom;
+        std::string error;
+        bool ok;
+        {
+            py::gil_scoped_release release;
+            ok = saveProject(path, project, options, &error);
+        }
+        return py::make_tuple(ok, error);
+    }, py::arg("path"), py::arg("layers"), py::arg("created") = "", py::arg("preview") = py::bytes(),
+       py::arg("files") = std::vector<std::pair<std::string, std::string>>(),
+       py::arg("carryTimelapseFrom") = "", py::arg("compressionLevel") = 6, py::arg("loadedFrom") = "");
+
+    // (LayerManager or None, error message); layers decode lazily
+    m.def("loadProject", [](const std::string& path) {
+        std::unique_ptr<LayerManager> stack;
+        std::string error;
+        {
+            py::gil_scoped_release release;
+            ProjectReader reader;
+            if (reader.open(path, &error)) {
+                stack = buildLayerStack(reader.info(), reader.loadLayers(&error));
+            }
+        }
+        return py::make_tuple(py::cast(std::move(stack)), error);
+    }, py::arg("path"));
 
     // Color utilities
     m.def("rgbToHsv", &color::rgbToHsv, "Convert RGB to HSV");
@@ -5,6 +5,7 @@
 #include "brush_engine.h"
 #include "../canvas/canvas.h"
 #include "../layers/layer.h"
+#include "color_utils.h"
 #include <cmath>
 #include <algorithm>
 
@@ -162,17 +163,13 @@ void BrushEngine::dabAt(Layer& layer, float x, float y, float pressure, float si
             
             size_t idx = (py * layerWidth + px) * 4;
             
-            // Alpha blend
-            float srcA = alpha;
-            float dstA = data[idx + 3] / 255.0f;
-            float outA = srcA + dstA * (1.0f - srcA);
-            
-            if (outA > 0.001f) {
-                data[idx] = static_cast<uint8_t>((brushR * srcA + data[idx] * dstA * (1 - srcA)) / outA);
-                data[idx + 1] = static_cast<uint8_t>((brushG * srcA + data[idx + 1] * dstA * (1 - srcA)) / outA);
-                data[idx + 2] = static_cast<uint8_t>((brushB * srcA + data[idx + 2] * dstA * (1 - srcA)) / outA);
-                data[idx + 3] = static_cast<uint8_t>(outA * 255);
-            }
+            // Premultiplied source-over in 8-bit fixed point
+            uint32_t srcA = static_cast<uint32_t>(std::min(alpha, 1.0f) * 255.0f + 0.5f);
+            uint32_t inv = 255 - srcA;
+            data[idx] = static_cast<uint8_t>(color::div255(brushR * srcA) + color::div255(data[idx] * inv));
+            data[idx + 1] = static_cast<uint8_t>(color::div255(brushG * srcA) + color::div255(data[idx + 1] * inv));
+            data[idx + 2] = static_cast<uint8_t>(color::div255(brushB * srcA) + color::div255(data[idx + 2] * inv));
+            data[idx + 3] = static_cast<uint8_t>(srcA + color::div255(data[idx + 3] * inv));
         }
     }
 }
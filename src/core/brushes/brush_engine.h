@@ -4,15 +4,15 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include "../canvas/canvas.h"
 
 namespace artflow {
 
-struct Point;
-struct Color;
 class Layer;
 
 struct BrushSettings {
@@ -46,6 +46,12 @@ public:
     void setTip(const BrushTip& tip);
     void setRoundTip(float hardness = 0.8f);
     
+    // Farthest a dab reaches from its center: half the tip at full
+    // pressure (the round tip is size * 2 across), plus a pixel of rounding
+    float maxDabRadius() const {
+        return std::max({m_settings.size, m_tip.width * 0.5f, m_tip.height * 0.5f}) + 1.0f;
+    }
+    
     void beginStroke(Layer& layer, const Point& point);
     void continueStroke(Layer& layer, const Point& point);
     void endStroke(Layer& layer);
@@ -5,6 +5,7 @@
 #include "brush_stroke.h"
 #include "brush_engine.h"
 #include "../layers/layer.h"
+#include <algorithm>
 
 namespace artflow {
 
@@ -29,6 +30,24 @@ void BrushStroke::renderTo(Layer& layer) {
     m_renderedUpTo = m_points.size();
 }
 
+Rect BrushStroke::pendingBounds() const {
+    if (m_points.empty()) return Rect();
+    
+    size_t first = m_renderedUpTo > 0 ? m_renderedUpTo - 1 : 0;
+    float minX = m_points[first].x, maxX = minX;
+    float minY = m_points[first].y, maxY = minY;
+    for (size_t i = first + 1; i < m_points.size(); ++i) {
+        minX = std::min(minX, m_points[i].x);
+        maxX = std::max(maxX, m_points[i].x);
+        minY = std::min(minY, m_points[i].y);
+        maxY = std::max(maxY, m_points[i].y);
+    }
+    
+    // Without an engine nothing is painted; stay safe with the default brush
+    float pad = m_engine ? m_engine->maxDabRadius() : BrushSettings().size + 1.0f;
+    return Rect(minX - pad, minY - pad, (maxX - minX) + pad * 2.0f, (maxY - minY) + pad * 2.0f);
+}
+
 void BrushStroke::finalizeTo(Layer& layer) {
     if (m_engine) {
         m_engine->endStroke(layer);
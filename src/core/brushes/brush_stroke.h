@@ -23,6 +23,10 @@ public:
     void finalizeTo(Layer& layer);
     void clear();
     
+    // Canvas area the next renderTo() call can touch: the unrendered points
+    // plus the last rendered one, padded by the brush radius.
+    Rect pendingBounds() const;
+    
     const std::vector<Point>& getPoints() const { return m_points; }
     bool isEmpty() const { return m_points.empty(); }
 
@@ -5,125 +5,20 @@
 #include "canvas.h"
 #include "../layers/layer.h"
 #include "renderer.h"
+#include "tile_history.h"
 #include "../brushes/brush_stroke.h"
+#include "color_utils.h"
+#include "project_file.h"
 #include <cmath>
 #include <algorithm>
-#include <sstream>
-#include <iomanip>
+#include <utility>
 
 namespace artflow {
 
-// ============================================================================
-// Color Implementation
-// ============================================================================
-
-Color Color::fromHex(const std::string& hex) {
-    std::string cleanHex = hex;
-    if (!cleanHex.empty() && cleanHex[0] == '#') {
-        cleanHex = cleanHex.substr(1);
-    }
-    
-    if (cleanHex.length() < 6) {
-        return Color(0, 0, 0, 1);
-    }
-    
-    int r, g, b, a = 255;
-    std::stringstream ss;
-    
-    ss << std::hex << cleanHex.substr(0, 2);
-    ss >> r;
-    ss.clear();
-    
-    ss << std::hex << cleanHex.substr(2, 2);
-    ss >> g;
-    ss.clear();
-    
-    ss << std::hex << cleanHex.substr(4, 2);
-    ss >> b;
-    
-    if (cleanHex.length() >= 8) {
-        ss.clear();
-        ss << std::hex << cleanHex.substr(6, 2);
-        ss >> a;
-    }
-    
-    return Color(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
-}
-
-std::string Color::toHex() const {
-    std::stringstream ss;
-    ss << "#";
-    ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(r * 255);
-    ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(g * 255);
-    ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(b * 255);
-    if (a < 1.0f) {
-        ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(a * 255);
-    }
-    return ss.str();
-}
-
-Color Color::blend(const Color& other, float amount) const {
-    return Color(
-        r + (other.r - r) * amount,
-        g + (other.g - g) * amount,
-        b + (other.b - b) * amount,
-        a + (other.a - a) * amount
-    );
-}
-
-Color Color::withAlpha(float alpha) const {
-    return Color(r, g, b, alpha);
-}
-
-// ============================================================================
-// Point Implementation
-// ============================================================================
-
-float Point::distanceTo(const Point& other) const {
-    float dx = other.x - x;
-    float dy = other.y - y;
-    return std::sqrt(dx * dx + dy * dy);
-}
-
-Point Point::lerp(const Point& other, float t) const {
-    return Point(
-        x + (other.x - x) * t,
-        y + (other.y - y) * t,
-        pressure + (other.pressure - pressure) * t
-    );
-}
-
-// ============================================================================
-// Rect Implementation
-// ============================================================================
-
-bool Rect::contains(const Point& p) const {
-    return p.x >= x && p.x <= x + width &&
-           p.y >= y && p.y <= y + height;
-}
-
-bool Rect::intersects(const Rect& other) const {
-    return !(x + width < other.x || other.x + other.width < x ||
-             y + height < other.y || other.y + other.height < y);
-}
-
-Rect Rect::united(const Rect& other) const {
-    float minX = std::min(x, other.x);
-    float minY = std::min(y, other.y);
-    float maxX = std::max(x + width, other.x + other.width);
-    float maxY = std::max(y + height, other.y + other.height);
-    return Rect(minX, minY, maxX - minX, maxY - minY);
-}
-
 // ============================================================================
 // Canvas Implementation
 // ============================================================================
 
-struct Canvas::HistoryState {
-    std::vector<std::vector<uint8_t>> layerData;
-    int activeLayerIndex;
-};
-
 Canvas::Canvas()
     : Canvas(CanvasConfig())
 {
@@ -139,7 +34,7 @@ Canvas::Canvas(int width, int height)
     , m_viewportX(0)
     , m_viewportY(0)
     , m_zoom(1.0f)
-    , m_maxHistorySize(50)
+    , m_history(std::make_unique<TileHistory>())
 {
     m_renderer = std::make_unique<Renderer>(width, height);
     initializeDefaultLayer();
@@ -155,7 +50,7 @@ Canvas::Canvas(const CanvasConfig& config)
     , m_viewportX(0)
     , m_viewportY(0)
     , m_zoom(1.0f)
-    , m_maxHistorySize(50)
+    , m_history(std::make_unique<TileHistory>())
 {
     m_renderer = std::make_unique<Renderer>(m_width, m_height);
     initializeDefaultLayer();
@@ -329,8 +224,13 @@ int Canvas::getLayerCount() const {
 // Drawing operations
 void Canvas::beginStroke(const Point& point) {
     m_currentStroke = std::make_unique<BrushStroke>();
+    m_currentStroke->setBrushEngine(m_brushEngine);
     m_currentStroke->addPoint(point);
-    pushHistoryState();
+    
+    Layer* activeLayer = getActiveLayer();
+    if (activeLayer) {
+        m_history->beginStroke(*activeLayer, m_activeLayerIndex);
+    }
 }
 
 void Canvas::continueStroke(const Point& point) {
@@ -340,6 +240,7 @@ void Canvas::continueStroke(const Point& point) {
     // Render stroke to active layer
     Layer* activeLayer = getActiveLayer();
     if (activeLayer) {
+        captureStrokeArea();
         m_currentStroke->renderTo(*activeLayer);
     }
     
@@ -351,7 +252,9 @@ void Canvas::endStroke() {
     
     Layer* activeLayer = getActiveLayer();
     if (activeLayer) {
+        captureStrokeArea();
         m_currentStroke->finalizeTo(*activeLayer);
+        m_history->commitStroke(*activeLayer);
     }
     
     m_currentStroke.reset();
@@ -360,7 +263,26 @@ void Canvas::endStroke() {
 void Canvas::cancelStroke() {
     if (!m_currentStroke) return;
     m_currentStroke.reset();
-    undo(); // Restore previous state
+    
+    // Restore the tiles the stroke touched
+    Layer* activeLayer = getActiveLayer();
+    if (activeLayer) {
+        m_history->cancelStroke(*activeLayer);
+    }
+    notifyEvent(CanvasEventType::ContentModified);
+}
+
+void Canvas::captureStrokeArea() {
+    Layer* activeLayer = getActiveLayer();
+    if (!activeLayer || !m_currentStroke) return;
+    
+    // Save before-images of the tiles the next render step can touch
+    Rect bounds = m_currentStroke->pendingBounds();
+    int x0 = static_cast<int>(std::floor(bounds.x));
+    int y0 = static_cast<int>(std::floor(bounds.y));
+    int x1 = static_cast<int>(std::ceil(bounds.x + bounds.width));
+    int y1 = static_cast<int>(std::ceil(bounds.y + bounds.height));
+    m_history->captureRect(*activeLayer, x0, y0, x1 - x0 + 1, y1 - y0 + 1);
 }
 
 // Rendering
@@ -386,101 +308,54 @@ const uint8_t* Canvas::getPixelData() const {
 
 void Canvas::getPixelData(uint8_t* buffer, size_t bufferSize) const {
     m_renderer->getFramebufferData(buffer, bufferSize);
+    color::unpremultiplyRow(buffer, (std::min)(bufferSize, static_cast<size_t>(m_width) * m_height * 4) / 4);
 }
 
 // Undo/Redo
 void Canvas::pushHistoryState() {
-    auto state = std::make_unique<HistoryState>();
-    state->activeLayerIndex = m_activeLayerIndex;
-    
-    for (const auto& layer : m_layers) {
-        state->layerData.push_back(layer->getData());
-    }
-    
-    m_undoStack.push_back(std::move(state));
-    
-    // Limit history size
-    while (m_undoStack.size() > m_maxHistorySize) {
-        m_undoStack.erase(m_undoStack.begin());
-    }
-    
-    // Clear redo stack on new action
-    m_redoStack.clear();
+    // Structural edits snapshot the layer stack; strokes record tile deltas
+    m_history->pushSnapshot(m_layers, m_activeLayerIndex);
 }
 
 void Canvas::undo() {
-    if (m_undoStack.empty()) return;
-    
-    // Save current state to redo stack
-    auto currentState = std::make_unique<HistoryState>();
-    currentState->activeLayerIndex = m_activeLayerIndex;
-    for (const auto& layer : m_layers) {
-        currentState->layerData.push_back(layer->getData());
-    }
-    m_redoStack.push_back(std::move(currentState));
-    
-    // Restore previous state
-    auto& state = m_undoStack.back();
-    m_activeLayerIndex = state->activeLayerIndex;
-    
-    // Resize layers vector if needed
-    while (m_layers.size() < state->layerData.size()) {
-        addLayer();
-    }
-    while (m_layers.size() > state->layerData.size()) {
-        m_layers.pop_back();
-    }
-    
-    // Restore layer data
-    for (size_t i = 0; i < state->layerData.size(); ++i) {
-        m_layers[i]->setData(state->layerData[i]);
-    }
-    
-    m_undoStack.pop_back();
+    if (!m_history->undo(m_layers, m_activeLayerIndex)) return;
+    syncSizeFromLayers();
     notifyEvent(CanvasEventType::ContentModified);
 }
 
 void Canvas::redo() {
-    if (m_redoStack.empty()) return;
-    
-    // Save current state to undo stack
-    auto currentState = std::make_unique<HistoryState>();
-    currentState->activeLayerIndex = m_activeLayerIndex;
-    for (const auto& layer : m_layers) {
-        currentState->layerData.push_back(layer->getData());
-    }
-    m_undoStack.push_back(std::move(currentState));
-    
-    // Restore redo state
-    auto& state = m_redoStack.back();
-    m_activeLayerIndex = state->activeLayerIndex;
-    
-    while (m_layers.size() < state->layerData.size()) {
-        addLayer();
-    }
-    while (m_layers.size() > state->layerData.size()) {
-        m_layers.pop_back();
-    }
-    
-    for (size_t i = 0; i < state->layerData.size(); ++i) {
-        m_layers[i]->setData(state->layerData[i]);
-    }
-    
-    m_redoStack.pop_back();
+    if (!m_history->redo(m_layers, m_activeLayerIndex)) return;
+    syncSizeFromLayers();
     notifyEvent(CanvasEventType::ContentModified);
 }
 
 bool Canvas::canUndo() const {
-    return !m_undoStack.empty();
+    return m_history->canUndo();
 }
 
 bool Canvas::canRedo() const {
-    return !m_redoStack.empty();
+    return m_history->canRedo();
 }
 
 void Canvas::clearHistory() {
-    m_undoStack.clear();
-    m_redoStack.clear();
+    m_history->clear();
+}
+
+void Canvas::setHistoryBudget(size_t bytes) {
+    m_history->setByteBudget(bytes);
+}
+
+void Canvas::syncSizeFromLayers() {
+    // Undoing a resize swaps in layers of the previous size
+    if (m_layers.empty()) return;
+    int width = m_layers[0]->getWidth();
+    int height = m_layers[0]->getHeight();
+    if (width == m_width && height == m_height) return;
+    
+    m_width = width;
+    m_height = height;
+    m_renderer->resize(width, height);
+    notifyEvent(CanvasEventType::CanvasResized);
 }
 
 // Viewport
@@ -505,15 +380,99 @@ void Canvas::notifyEvent(CanvasEventType type, int data) {
     }
 }
 
-// File operations - stubs for now
+// ============================================================================
+// File operations
+// ============================================================================
+
+namespace {
+
+// Layer blend modes by their counterpart in the project format
+constexpr std::pair<LayerBlendMode, BlendMode> kProjectBlendModes[] = {
+    {LayerBlendMode::Normal, BlendMode::Normal},
+    {LayerBlendMode::Multiply, BlendMode::Multiply},
+    {LayerBlendMode::Screen, BlendMode::Screen},
+    {LayerBlendMode::Overlay, BlendMode::Overlay},
+    {LayerBlendMode::SoftLight, BlendMode::SoftLight},
+    {LayerBlendMode::HardLight, BlendMode::HardLight},
+    {LayerBlendMode::ColorDodge, BlendMode::ColorDodge},
+    {LayerBlendMode::ColorBurn, BlendMode::ColorBurn},
+    {LayerBlendMode::Darken, BlendMode::Darken},
+    {LayerBlendMode::Lighten, BlendMode::Lighten},
+    {LayerBlendMode::Difference, BlendMode::Difference},
+};
+
+const char* projectBlendName(LayerBlendMode mode) {
+    for (const auto& entry : kProjectBlendModes) {
+        if (entry.first == mode) return blendModeName(entry.second);
+    }
+    return "Normal";
+}
+
+LayerBlendMode layerBlendMode(const std::string& name) {
+    const BlendMode mode = blendModeFromName(name);
+    for (const auto& entry : kProjectBlendModes) {
+        if (entry.second == mode) return entry.first;
+    }
+    return LayerBlendMode::Normal;
+}
+
+} // anonymous namespace
+
+// Same format as the app (see project_file.h); layer pixels are premultiplied
+// on both sides, so they are copied as they are
 bool Canvas::save(const std::string& path) {
-    // TODO: Implement project file saving
-    return false;
+    ProjectSnapshot project;
+    project.info.width = m_width;
+    project.info.height = m_height;
+    for (const auto& layer : m_layers) {
+        ProjectLayer meta;
+        meta.name = layer->getName();
+        meta.visible = layer->isVisible();
+        meta.opacity = layer->getOpacity();
+        meta.blendMode = projectBlendName(layer->getBlendMode());
+        project.info.layers.push_back(std::move(meta));
+
+        auto buffer = std::make_unique<ImageBuffer>(m_width, m_height);
+        const std::vector<uint8_t>& data = layer->getData();
+        if (data.size() == static_cast<size_t>(m_width) * m_height * 4) {
+            std::copy(data.begin(), data.end(), buffer->data());
+        }
+        project.layers.push_back(std::move(buffer));
+    }
+    return saveProject(path, project);
 }
 
 bool Canvas::load(const std::string& path) {
-    // TODO: Implement project file loading
-    return false;
+    ProjectReader reader;
+    if (!reader.open(path)) return false;
+    std::vector<std::unique_ptr<ImageBuffer>> buffers = reader.loadLayers();
+    const ProjectInfo& info = reader.info();
+    if (info.layers.empty()) return false;
+
+    std::vector<std::unique_ptr<Layer>> layers;
+    for (size_t i = 0; i < info.layers.size(); ++i) {
+        const ProjectLayer& meta = info.layers[i];
+        auto layer = std::make_unique<Layer>(info.width, info.height, meta.name);
+        layer->setVisible(meta.visible);
+        layer->setOpacity(meta.opacity);
+        layer->setBlendMode(layerBlendMode(meta.blendMode));
+        if (buffers[i]) {
+            std::vector<uint8_t> data(static_cast<size_t>(info.width) * info.height * 4);
+            buffers[i]->readRegion(0, 0, info.width, info.height, data.data(), static_cast<size_t>(info.width) * 4);
+            if (buffers[i]->hasUnreadableTiles()) return false;   // Parts of it would come back empty
+            layer->setData(data);
+        }
+        layers.push_back(std::move(layer));
+    }
+
+    m_width = info.width;
+    m_height = info.height;
+    m_layers = std::move(layers);
+    m_activeLayerIndex = static_cast<int>(m_layers.size()) - 1;
+    m_history->clear();
+    m_renderer->resize(m_width, m_height);
+    notifyEvent(CanvasEventType::CanvasResized);
+    return true;
 }
 
 bool Canvas::exportImage(const std::string& path, const std::string& format) {
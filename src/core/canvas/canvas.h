@@ -17,6 +17,8 @@ namespace artflow {
 class Layer;
 class Renderer;
 class BrushStroke;
+class BrushEngine;
+class TileHistory;
 
 /**
  * RGBA Color structure
@@ -139,7 +141,10 @@ public:
     void setActiveLayer(int index);
     int getLayerCount() const;
     
-    // Drawing operations
+    // Drawing operations. Strokes are painted with the brush engine set
+    // here (not owned); without one they only record their points.
+    void setBrushEngine(BrushEngine* engine) { m_brushEngine = engine; }
+    BrushEngine* getBrushEngine() const { return m_brushEngine; }
     void beginStroke(const Point& point);
     void continueStroke(const Point& point);
     void endStroke();
@@ -147,8 +152,8 @@ public:
     
     // Rendering
     void render();
-    const uint8_t* getPixelData() const;
-    void getPixelData(uint8_t* buffer, size_t bufferSize) const;
+    const uint8_t* getPixelData() const;                          // Premultiplied framebuffer
+    void getPixelData(uint8_t* buffer, size_t bufferSize) const;  // Straight-alpha copy
     
     // Undo/Redo
     void undo();
@@ -156,6 +161,7 @@ public:
     bool canUndo() const;
     bool canRedo() const;
     void clearHistory();
+    void setHistoryBudget(size_t bytes);
     
     // File operations
     bool save(const std::string& path);
@@ -183,22 +189,22 @@ private:
     
     std::unique_ptr<Renderer> m_renderer;
     std::unique_ptr<BrushStroke> m_currentStroke;
+    BrushEngine* m_brushEngine = nullptr;
     
     // Viewport
     float m_viewportX, m_viewportY;
     float m_zoom;
     
     // Undo/Redo
-    struct HistoryState;
-    std::vector<std::unique_ptr<HistoryState>> m_undoStack;
-    std::vector<std::unique_ptr<HistoryState>> m_redoStack;
-    size_t m_maxHistorySize;
+    std::unique_ptr<TileHistory> m_history;
     
     // Event handling
     CanvasEventCallback m_eventCallback;
     
     void notifyEvent(CanvasEventType type, int data = 0);
     void pushHistoryState();
+    void captureStrokeArea();
+    void syncSizeFromLayers();
     void initializeDefaultLayer();
 };
 
@@ -0,0 +1,116 @@
+/**
+ * ArtFlow Studio - Canvas Value Types
+ * Color, Point and Rect, shared by the canvas, layers and brushes
+ */
+
+#include "canvas.h"
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace artflow {
+
+// ============================================================================
+// Color Implementation
+// ============================================================================
+
+Color Color::fromHex(const std::string& hex) {
+    std::string cleanHex = hex;
+    if (!cleanHex.empty() && cleanHex[0] == '#') {
+        cleanHex = cleanHex.substr(1);
+    }
+    
+    if (cleanHex.length() < 6) {
+        return Color(0, 0, 0, 1);
+    }
+    
+    int r, g, b, a = 255;
+    std::stringstream ss;
+    
+    ss << std::hex << cleanHex.substr(0, 2);
+    ss >> r;
+    ss.clear();
+    
+    ss << std::hex << cleanHex.substr(2, 2);
+    ss >> g;
+    ss.clear();
+    
+    ss << std::hex << cleanHex.substr(4, 2);
+    ss >> b;
+    
+    if (cleanHex.length() >= 8) {
+        ss.clear();
+        ss << std::hex << cleanHex.substr(6, 2);
+        ss >> a;
+    }
+    
+    return Color(r / 255.0f, g / 255.0f, b / 255.0f, a / 255.0f);
+}
+
+std::string Color::toHex() const {
+    std::stringstream ss;
+    ss << "#";
+    ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(r * 255);
+    ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(g * 255);
+    ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(b * 255);
+    if (a < 1.0f) {
+        ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<int>(a * 255);
+    }
+    return ss.str();
+}
+
+Color Color::blend(const Color& other, float amount) const {
+    return Color(
+        r + (other.r - r) * amount,
+        g + (other.g - g) * amount,
+        b + (other.b - b) * amount,
+        a + (other.a - a) * amount
+    );
+}
+
+Color Color::withAlpha(float alpha) const {
+    return Color(r, g, b, alpha);
+}
+
+// ============================================================================
+// Point Implementation
+// ============================================================================
+
+float Point::distanceTo(const Point& other) const {
+    float dx = other.x - x;
+    float dy = other.y - y;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+Point Point::lerp(const Point& other, float t) const {
+    return Point(
+        x + (other.x - x) * t,
+        y + (other.y - y) * t,
+        pressure + (other.pressure - pressure) * t
+    );
+}
+
+// ============================================================================
+// Rect Implementation
+// ============================================================================
+
+bool Rect::contains(const Point& p) const {
+    return p.x >= x && p.x <= x + width &&
+           p.y >= y && p.y <= y + height;
+}
+
+bool Rect::intersects(const Rect& other) const {
+    return !(x + width < other.x || other.x + other.width < x ||
+             y + height < other.y || other.y + other.height < y);
+}
+
+Rect Rect::united(const Rect& other) const {
+    float minX = std::min(x, other.x);
+    float minY = std::min(y, other.y);
+    float maxX = std::max(x + width, other.x + other.width);
+    float maxY = std::max(y + height, other.y + other.height);
+    return Rect(minX, minY, maxX - minX, maxY - minY);
+}
+
+} // namespace artflow
@@ -6,6 +6,8 @@
 #include "renderer.h"
 #include "../layers/layer.h"
 #include "canvas.h"
+#include "blend_kernels.h"
+#include "color_utils.h"
 
 #include <algorithm>
 #include <stdexcept>
@@ -301,12 +303,16 @@ void Renderer::drawBackground(const Color& color) {
     // glClearColor(color.r, color.g, color.b, color.a);
     // glClear(GL_COLOR_BUFFER_BIT);
     
-    // For software rendering fallback
+    // For software rendering fallback (premultiplied like the layers)
+    uint8_t px[4] = {
+        static_cast<uint8_t>(color.r * 255),
+        static_cast<uint8_t>(color.g * 255),
+        static_cast<uint8_t>(color.b * 255),
+        static_cast<uint8_t>(color.a * 255)
+    };
+    color::premultiplyAlpha(px);
     for (int i = 0; i < m_width * m_height; ++i) {
-        m_framebufferData[i * 4 + 0] = static_cast<uint8_t>(color.r * 255);
-        m_framebufferData[i * 4 + 1] = static_cast<uint8_t>(color.g * 255);
-        m_framebufferData[i * 4 + 2] = static_cast<uint8_t>(color.b * 255);
-        m_framebufferData[i * 4 + 3] = static_cast<uint8_t>(color.a * 255);
+        std::memcpy(&m_framebufferData[i * 4], px, 4);
     }
 }
 
@@ -322,39 +328,14 @@ void Renderer::drawLayerWithBlendMode(const Layer& layer, int blendMode) {
     // 2. Use blend shader with appropriate blend mode
     // 3. Render quad to framebuffer
     
-    // For now, we'll do simple alpha compositing in software
+    // For now, composite in software with the premultiplied row kernels.
+    // LayerBlendMode lists the same modes as BlendMode in the same order.
     const auto& layerData = layer.getData();
-    float opacity = layer.getOpacity();
+    size_t pixels = (std::min)(layerData.size(), m_framebufferData.size()) / 4;
+    BlendMode mode = (blendMode >= 0 && blendMode <= static_cast<int>(BlendMode::Difference))
+                         ? static_cast<BlendMode>(blendMode) : BlendMode::Normal;
     
-    for (int y = 0; y < m_height; ++y) {
-        for (int x = 0; x < m_width; ++x) {
-            int i = (y * m_width + x) * 4;
-            
-            if (i + 3 >= static_cast<int>(layerData.size())) continue;
-            
-            float srcA = (layerData[i + 3] / 255.0f) * opacity;
-            if (srcA < 0.001f) continue;
-            
-            float srcR = layerData[i + 0] / 255.0f;
-            float srcG = layerData[i + 1] / 255.0f;
-            float srcB = layerData[i + 2] / 255.0f;
-            
-            float dstR = m_framebufferData[i + 0] / 255.0f;
-            float dstG = m_framebufferData[i + 1] / 255.0f;
-            float dstB = m_framebufferData[i + 2] / 255.0f;
-            float dstA = m_framebufferData[i + 3] / 255.0f;
-            
-            float outA = srcA + dstA * (1.0f - srcA);
-            float outR = (srcR * srcA + dstR * dstA * (1.0f - srcA)) / (outA + 0.001f);
-            float outG = (srcG * srcA + dstG * dstA * (1.0f - srcA)) / (outA + 0.001f);
-            float outB = (srcB * srcA + dstB * dstA * (1.0f - srcA)) / (outA + 0.001f);
-            
-            m_framebufferData[i + 0] = static_cast<uint8_t>(outR * 255);
-            m_framebufferData[i + 1] = static_cast<uint8_t>(outG * 255);
-            m_framebufferData[i + 2] = static_cast<uint8_t>(outB * 255);
-            m_framebufferData[i + 3] = static_cast<uint8_t>(outA * 255);
-        }
-    }
+    blend::rowKernel(mode)(m_framebufferData.data(), layerData.data(), static_cast<int>(pixels), layer.getOpacity());
 }
 
 const uint8_t* Renderer::getFramebufferData() const {
@@ -0,0 +1,212 @@
+/**
+ * ArtFlow Studio - Tile History Implementation
+ */
+
+#include "tile_history.h"
+#include "../layers/layer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace artflow {
+
+struct TileHistory::TileDelta {
+    int x, y, w, h;
+    std::vector<uint8_t> pixels;  // Before-image until undone, then after-image
+};
+
+struct TileHistory::Entry {
+    enum class Kind { Stroke, Snapshot } kind = Kind::Stroke;
+    int layerIndex = -1;
+    int activeLayerIndex = 0;
+    std::vector<TileDelta> tiles;  // Stroke
+    LayerStack layers;             // Snapshot
+    size_t bytes = 0;
+
+    void updateBytes() {
+        bytes = 0;
+        for (const auto& tile : tiles) bytes += tile.pixels.size();
+        for (const auto& layer : layers) bytes += layer->getData().size();
+    }
+};
+
+TileHistory::TileHistory(size_t byteBudget)
+    : m_byteBudget(byteBudget)
+{
+}
+
+TileHistory::~TileHistory() = default;
+
+void TileHistory::setByteBudget(size_t bytes) {
+    m_byteBudget = bytes;
+    enforceBudget();
+}
+
+// ============================================================================
+// Stroke transactions
+// ============================================================================
+
+void TileHistory::beginStroke(const Layer& layer, int layerIndex) {
+    m_pending = std::make_unique<Entry>();
+    m_pending->kind = Entry::Kind::Stroke;
+    m_pending->layerIndex = layerIndex;
+    m_pending->activeLayerIndex = layerIndex;
+
+    m_pendingTilesX = (layer.getWidth() + kTileSize - 1) / kTileSize;
+    int tilesY = (layer.getHeight() + kTileSize - 1) / kTileSize;
+    m_pendingCaptured.assign(static_cast<size_t>(m_pendingTilesX) * tilesY, false);
+}
+
+void TileHistory::captureRect(const Layer& layer, int x, int y, int w, int h) {
+    if (!m_pending) return;
+
+    int x0 = std::max(0, x);
+    int y0 = std::max(0, y);
+    int x1 = std::min(layer.getWidth(), x + w);
+    int y1 = std::min(layer.getHeight(), y + h);
+    if (x0 >= x1 || y0 >= y1) return;
+
+    for (int ty = y0 / kTileSize; ty <= (y1 - 1) / kTileSize; ++ty) {
+        for (int tx = x0 / kTileSize; tx <= (x1 - 1) / kTileSize; ++tx) {
+            size_t slot = static_cast<size_t>(ty) * m_pendingTilesX + tx;
+            if (m_pendingCaptured[slot]) continue;
+            m_pendingCaptured[slot] = true;
+
+            TileDelta tile;
+            tile.x = tx * kTileSize;
+            tile.y = ty * kTileSize;
+            tile.w = std::min(kTileSize, layer.getWidth() - tile.x);
+            tile.h = std::min(kTileSize, layer.getHeight() - tile.y);
+            tile.pixels.resize(static_cast<size_t>(tile.w) * tile.h * 4);
+            layer.readRect(tile.x, tile.y, tile.w, tile.h, tile.pixels.data());
+            m_pending->tiles.push_back(std::move(tile));
+        }
+    }
+}
+
+void TileHistory::commitStroke(const Layer& layer) {
+    if (!m_pending) return;
+
+    // Keep only the tiles the stroke really changed
+    auto& tiles = m_pending->tiles;
+    std::vector<uint8_t> current;
+    tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [&](const TileDelta& tile) {
+        current.resize(tile.pixels.size());
+        layer.readRect(tile.x, tile.y, tile.w, tile.h, current.data());
+        return std::memcmp(current.data(), tile.pixels.data(), current.size()) == 0;
+    }), tiles.end());
+
+    std::unique_ptr<Entry> entry = std::move(m_pending);
+    m_pendingCaptured.clear();
+    if (entry->tiles.empty()) return;
+
+    entry->tiles.shrink_to_fit();
+    entry->updateBytes();
+    push(std::move(entry));
+}
+
+void TileHistory::cancelStroke(Layer& layer) {
+    if (!m_pending) return;
+
+    for (const auto& tile : m_pending->tiles) {
+        layer.writeRect(tile.x, tile.y, tile.w, tile.h, tile.pixels.data());
+    }
+    m_pending.reset();
+    m_pendingCaptured.clear();
+}
+
+// ============================================================================
+// Structural snapshots
+// ============================================================================
+
+void TileHistory::pushSnapshot(const LayerStack& layers, int activeLayerIndex) {
+    auto entry = std::make_unique<Entry>();
+    entry->kind = Entry::Kind::Snapshot;
+    entry->activeLayerIndex = activeLayerIndex;
+
+    for (const auto& layer : layers) {
+        auto copy = std::make_unique<Layer>(layer->getWidth(), layer->getHeight(), layer->getName());
+        copy->copyFrom(*layer);
+        copy->setVisible(layer->isVisible());
+        entry->layers.push_back(std::move(copy));
+    }
+
+    entry->updateBytes();
+    push(std::move(entry));
+}
+
+// ============================================================================
+// Undo / Redo
+// ============================================================================
+
+bool TileHistory::undo(LayerStack& layers, int& activeLayerIndex) {
+    if (m_undoStack.empty()) return false;
+
+    std::unique_ptr<Entry> entry = std::move(m_undoStack.back());
+    m_undoStack.pop_back();
+    swapEntry(*entry, layers, activeLayerIndex);
+    m_redoStack.push_back(std::move(entry));
+    return true;
+}
+
+bool TileHistory::redo(LayerStack& layers, int& activeLayerIndex) {
+    if (m_redoStack.empty()) return false;
+
+    std::unique_ptr<Entry> entry = std::move(m_redoStack.back());
+    m_redoStack.pop_back();
+    swapEntry(*entry, layers, activeLayerIndex);
+    m_undoStack.push_back(std::move(entry));
+    return true;
+}
+
+void TileHistory::clear() {
+    m_undoStack.clear();
+    m_redoStack.clear();
+    m_pending.reset();
+    m_pendingCaptured.clear();
+    m_byteUsage = 0;
+}
+
+void TileHistory::swapEntry(Entry& entry, LayerStack& layers, int& activeLayerIndex) {
+    m_byteUsage -= entry.bytes;
+
+    if (entry.kind == Entry::Kind::Snapshot) {
+        std::swap(layers, entry.layers);
+    } else if (entry.layerIndex >= 0 && entry.layerIndex < static_cast<int>(layers.size())) {
+        Layer& layer = *layers[entry.layerIndex];
+        std::vector<uint8_t> current;
+        for (auto& tile : entry.tiles) {
+            if (tile.x + tile.w > layer.getWidth() || tile.y + tile.h > layer.getHeight()) continue;
+            current.resize(tile.pixels.size());
+            layer.readRect(tile.x, tile.y, tile.w, tile.h, current.data());
+            layer.writeRect(tile.x, tile.y, tile.w, tile.h, tile.pixels.data());
+            tile.pixels.swap(current);
+        }
+    }
+    std::swap(activeLayerIndex, entry.activeLayerIndex);
+
+    entry.updateBytes();
+    m_byteUsage += entry.bytes;
+}
+
+void TileHistory::push(std::unique_ptr<Entry> entry) {
+    for (const auto& redo : m_redoStack) m_byteUsage -= redo->bytes;
+    m_redoStack.clear();
+
+    m_byteUsage += entry->bytes;
+    m_undoStack.push_back(std::move(entry));
+    enforceBudget();
+}
+
+void TileHistory::enforceBudget() {
+    // The most recent entry is always kept, even if it alone exceeds the budget
+    size_t drop = 0;
+    while (m_byteUsage > m_byteBudget && drop + 1 < m_undoStack.size()) {
+        m_byteUsage -= m_undoStack[drop]->bytes;
+        ++drop;
+    }
+    if (drop > 0) {
+        m_undoStack.erase(m_undoStack.begin(), m_undoStack.begin() + drop);
+    }
+}
+
+} // namespace artflow
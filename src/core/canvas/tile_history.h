@@ -0,0 +1,86 @@
+/**
+ * ArtFlow Studio - Tile History
+ * Undo/redo engine that records only the tiles an edit touched
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace artflow {
+
+class Layer;
+
+/**
+ * TileHistory - Byte-budgeted undo/redo stack
+ *
+ * Strokes are recorded as tile deltas: before a region of the active layer
+ * is painted, the tiles it covers are saved once (before-images). When the
+ * stroke is committed, tiles whose pixels did not actually change are
+ * dropped. Undo and redo swap the stored tiles with the layer's current
+ * pixels, so their cost is proportional to the size of the change and a
+ * single copy per tile serves both directions.
+ *
+ * Structural edits (removing, reordering or merging layers, resizing) are
+ * recorded as snapshots of the layer stack; undoing one swaps the stacks.
+ *
+ * The history is limited by a byte budget rather than a state count: the
+ * oldest entries are discarded until the total fits.
+ */
+class TileHistory {
+public:
+    using LayerStack = std::vector<std::unique_ptr<Layer>>;
+
+    static constexpr int kTileSize = 64;
+    static constexpr size_t kDefaultByteBudget = size_t(512) * 1024 * 1024;
+
+    explicit TileHistory(size_t byteBudget = kDefaultByteBudget);
+    ~TileHistory();
+
+    // Budget
+    void setByteBudget(size_t bytes);
+    size_t byteBudget() const { return m_byteBudget; }
+    size_t byteUsage() const { return m_byteUsage; }
+
+    // Stroke transactions
+    void beginStroke(const Layer& layer, int layerIndex);
+    void captureRect(const Layer& layer, int x, int y, int w, int h);
+    void commitStroke(const Layer& layer);
+    void cancelStroke(Layer& layer);
+    bool isRecordingStroke() const { return m_pending != nullptr; }
+
+    // Structural edits: call before modifying the stack
+    void pushSnapshot(const LayerStack& layers, int activeLayerIndex);
+
+    // Apply history to the stack. Return false when there is nothing to do.
+    bool undo(LayerStack& layers, int& activeLayerIndex);
+    bool redo(LayerStack& layers, int& activeLayerIndex);
+
+    bool canUndo() const { return !m_undoStack.empty(); }
+    bool canRedo() const { return !m_redoStack.empty(); }
+    void clear();
+
+private:
+    struct TileDelta;
+    struct Entry;
+
+    size_t m_byteBudget;
+    size_t m_byteUsage = 0;
+
+    std::vector<std::unique_ptr<Entry>> m_undoStack;
+    std::vector<std::unique_ptr<Entry>> m_redoStack;
+
+    // Stroke being recorded and which tiles it already saved
+    std::unique_ptr<Entry> m_pending;
+    std::vector<bool> m_pendingCaptured;
+    int m_pendingTilesX = 0;
+
+    void push(std::unique_ptr<Entry> entry);
+    void swapEntry(Entry& entry, LayerStack& layers, int& activeLayerIndex);
+    void enforceBudget();
+};
+
+} // namespace artflow
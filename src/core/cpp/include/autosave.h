@@ -0,0 +1,176 @@
+/**
+ * ArtFlow Studio - Autosave
+ * Incremental journal of changed tiles next to a saved project
+ */
+
+#pragma once
+
+#include "background_worker.h"
+#include "image_buffer.h"
+#include "project_file.h"
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace artflow {
+
+class LayerManager;
+
+/*
+ * Journal layout (`<project>.journal`, little-endian):
+ *   header: "AFJL", u32 version, u32 width, u32 height, u32 stampBytes,
+ *           stamp (project.json "created" of the save it applies to)
+ *   then records: u32 type, u32 payloadBytes, u32 crc32(payload), payload
+ *     Stack (1):  u32 count, per layer (bottom to top): i32 key, i32 origin,
+ *                 then its ProjectLayer fields
+ *     Tiles (2):  i32 key, u32 count, per tile: u32 index (row-major),
+ *                 u32 bytes, zlib-compressed tile (0 bytes = empty tile)
+ *     Commit (3): no payload; ends a consistent state
+ *
+ * A key names a layer for the life of the journal (its LayerManager id
+ * when it was written). A layer's pixels start from layer `origin` of the
+ * saved project (-1 = empty) and the latest Tiles entry of a tile replaces
+ * that tile. Replay stops at the last Commit, so records cut short by a
+ * crash are ignored.
+ */
+
+// The journal of the project at `projectPath` (file or folder)
+std::string autosaveJournalPath(const std::string& projectPath);
+
+// What a replayed journal changed on one layer of the saved project
+struct AutosaveLayerState {
+    int origin = -1;                      // Project layer its pixels start from; -1 = empty
+    std::vector<uint32_t> changedTiles;   // Row-major tiles that differ from it
+};
+
+/**
+ * Replay the journal of `projectPath` onto the project as ProjectReader
+ * loaded it (`info`, `layers`). On success they hold the recovered stack
+ * and `recovered` (parallel to it) what to hand to AutosaveJournal::start(),
+ * so the recovered changes stay journaled until the next full save. False,
+ * leaving everything untouched, when there is no journal or it was written
+ * against another save of the project.
+ */
+bool replayAutosave(const std::string& projectPath, ProjectInfo& info,
+                    std::vector<std::unique_ptr<ImageBuffer>>& layers,
+                    std::vector<AutosaveLayerState>* recovered = nullptr, std::string* error = nullptr);
+
+/**
+ * AutosaveJournal - Incremental autosave off the UI thread
+ *
+ * checkpoint() finds the tiles changed since the previous checkpoint the
+ * way undo does: it keeps the handles it saw last, and layers write their
+ * tiles copy-on-write, so a changed tile is one whose handle differs. Only
+ * handles are taken while the canvas is locked; a low-priority worker
+ * compresses the tiles and appends them to the journal. A checkpoint that
+ * finds nothing counts as idle time: the worker then rewrites the journal
+ * without superseded tiles once they make up most of it.
+ *
+ * Rows of a lazily loaded layer that are still pending equal the save and
+ * are not looked at. Rows loaded after start() are journaled whole once,
+ * since a load cannot be told from an edit.
+ *
+ * As with timelapse snapshots, holding the last handles means a tile
+ * written after a checkpoint is copied once before the write.
+ */
+class AutosaveJournal {
+public:
+    AutosaveJournal();
+    ~AutosaveJournal();   // Writes the changes still queued; keeps the journal
+
+    AutosaveJournal(const AutosaveJournal&) = delete;
+    AutosaveJournal& operator=(const AutosaveJournal&) = delete;
+
+    // Journal `layers` as changes to the project saved at `projectPath`,
+    // whose project.json "created" stamp is `savedStamp`. A journal already
+    // there is replaced (atomically); the one being kept so far is left as
+    // it is. `recovered` (from replayAutosave(), parallel to the layers)
+    // marks tiles that already differ from the save. Call with the layers
+    // locked against painting.
+    void start(const std::string& projectPath, const std::string& savedStamp, const LayerManager& layers,
+               const std::vector<AutosaveLayerState>& recovered = {});
+
+    // Stop journaling; `discard` deletes the journal (its changes are saved)
+    void stop(bool discard);
+
+    bool isActive() const { return !m_journalPath.empty(); }
+
+    // Queue the changes since the last checkpoint. Call with the layers
+    // locked against painting; returns without waiting for I/O.
+    void checkpoint(const LayerManager& layers);
+
+    // Block until everything queued is in the journal
+    void flush();
+
+private:
+    struct StackEntry {
+        int key = 0;
+        int origin = -1;
+        ProjectLayer meta;
+    };
+    struct TileChange {
+        int key;
+        uint32_t index;
+        ImageBuffer::TileHandle tile;
+    };
+    struct Batch {
+        std::vector<StackEntry> stack;   // Empty = unchanged
+        std::vector<TileChange> tiles;   // Grouped by key
+    };
+    struct TrackedLayer {
+        StackEntry entry;
+        std::vector<ImageBuffer::TileHandle> tiles;   // As of the last checkpoint
+        std::vector<bool> pendingRows;                // Rows not loaded then
+        std::shared_ptr<ImageBuffer::TileLoader> loader;   // Makes the pending rows' saved tiles
+    };
+    struct TileEntry {
+        uint64_t offset;   // Of the compressed bytes in the journal
+        uint32_t bytes;
+    };
+    class TilesPayload;
+
+    // UI thread
+    std::string m_journalPath;
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<TrackedLayer> m_layers;   // Stack order at the last checkpoint
+
+    std::mutex m_mutex;
+    std::shared_ptr<Batch> m_pending;   // Checkpoints not taken by the worker yet, merged
+
+    // Worker
+    std::string m_path;                 // Journal being written
+    std::vector<uint8_t> m_header;
+    std::ofstream m_file;
+    uint64_t m_fileBytes = 0;
+    uint64_t m_liveBytes = 0;                               // Tile bytes replay still uses
+    std::vector<StackEntry> m_stack;
+    std::map<int, std::map<uint32_t, TileEntry>> m_index;   // Latest bytes of each tile, by key
+
+    BackgroundWorker m_worker{BackgroundWorker::Priority::Low};   // Last: joined first
+
+    TrackedLayer track(const LayerManager& layers, int index, int origin) const;
+    void post(std::shared_ptr<Batch> batch);
+    void postQueued();
+
+    void begin(const std::string& path, std::vector<uint8_t> header, const Batch& batch);
+    void appendPending();
+    void append(const Batch& batch);
+    bool writeHeader();
+    bool writeRecord(uint32_t type, const std::vector<uint8_t>& payload);
+    bool writeStack(const std::vector<StackEntry>& stack);
+    bool writeTiles(int key, const TilesPayload& payload);
+    bool writeBatch(const Batch& batch);
+    bool reopen();
+    void compactIfWorthwhile();
+    void close(bool discard);
+
+    friend bool replayAutosave(const std::string&, ProjectInfo&, std::vector<std::unique_ptr<ImageBuffer>>&,
+                               std::vector<AutosaveLayerState>*, std::string*);
+};
+
+} // namespace artflow
@@ -0,0 +1,56 @@
+/**
+ * ArtFlow Studio - Background Worker
+ * Single thread that runs queued jobs in FIFO order
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace artflow {
+
+/**
+ * BackgroundWorker - Serial job queue for work that must stay off the UI
+ * thread (history compression, encoding, autosave). Jobs run in the order
+ * they were posted. The destructor finishes queued jobs before joining.
+ *
+ * A Low priority worker asks the OS to schedule its thread behind
+ * interactive ones (below-normal priority on Windows, nice 10 on Linux,
+ * the utility QoS class on macOS), for housekeeping the user should never
+ * feel.
+ */
+class BackgroundWorker {
+public:
+    enum class Priority { Normal, Low };
+
+    explicit BackgroundWorker(Priority priority = Priority::Normal);
+    ~BackgroundWorker();
+
+    BackgroundWorker(const BackgroundWorker&) = delete;
+    BackgroundWorker& operator=(const BackgroundWorker&) = delete;
+
+    void post(std::function<void()> job);
+
+    // Block until every job posted so far has finished
+    void waitIdle();
+
+    bool isIdle() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::deque<std::function<void()>> m_jobs;
+    bool m_running = false;   // A job is executing
+    bool m_stopping = false;
+    Priority m_priority;
+    std::thread m_thread;   // Last: starts once the state above is set
+
+    void run();
+};
+
+} // namespace artflow
@@ -0,0 +1,43 @@
+/**
+ * ArtFlow Studio - Blend Kernels
+ * Per-mode row compositing on premultiplied RGBA8 (SIMD with scalar fallback)
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace artflow {
+
+// Blend modes (like Photoshop)
+enum class BlendMode {
+    Normal,
+    Multiply,
+    Screen,
+    Overlay,
+    SoftLight,
+    HardLight,
+    ColorDodge,
+    ColorBurn,
+    Darken,
+    Lighten,
+    Difference,
+    Exclusion
+};
+
+namespace blend {
+
+// Composites `count` premultiplied RGBA pixels of `src` onto `dst` with the
+// W3C separable blend formula of one mode. Source pixels with zero alpha
+// leave the destination untouched.
+using RowKernel = void (*)(uint8_t* dst, const uint8_t* src, int count, float opacity);
+
+// Kernel for a mode. Resolve once per row or tile, not per pixel.
+RowKernel rowKernel(BlendMode mode);
+
+// Instruction set the kernels were built for ("avx2", "sse4.1", "scalar")
+const char* simdLevel();
+
+} // namespace blend
+
+} // namespace artflow
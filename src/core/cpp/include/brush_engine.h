@@ -11,6 +11,7 @@
 #include <string>
 
 #include "image_buffer.h"
+#include "random.h"
 
 namespace artflow {
 
@@ -76,6 +77,9 @@ struct BrushSettings {
         Eraser,
         Custom
     } type = Type::Round;
+
+    // Wet media read and write the layer's wetness/pigment maps
+    bool usesWetMedia() const { return type == Type::Watercolor || type == Type::Oil; }
 };
 
 
@@ -95,20 +99,49 @@ public:
     void setColor(const Color& color);
     const Color& getColor() const { return m_color; }
     
-    // Stroke operations
+    // Stroke operations. Jitter comes from a PRNG seeded per stroke and
+    // advanced per dab: the same seed, brush and points reproduce the same
+    // pixels (replay, tests, any thread). Without a seed a fresh one is
+    // drawn; strokeSeed() reports it for recording.
     void beginStroke(const StrokePoint& point);
+    void beginStroke(const StrokePoint& point, uint64_t seed);
+    uint64_t strokeSeed() const { return m_strokeSeed; }
+    static uint64_t newStrokeSeed();
     void continueStroke(const StrokePoint& point);
     void endStroke();
     
-    // Render a single dab at position. Mask is used for Clipping Masks.
-    void renderDab(ImageBuffer& target, float x, float y, float pressure, 
-                   bool alphaLock = false, const ImageBuffer* mask = nullptr);
+    // Render a single dab at position. Mask is used for Clipping Masks;
+    // `selection` confines paint to the selected pixels (every render call
+    // takes both). Returns the area of the target that was touched.
+    DirtyRect renderDab(ImageBuffer& target, float x, float y, float pressure, 
+                   bool alphaLock = false, const ImageBuffer* mask = nullptr,
+                   const SelectionMask* selection = nullptr);
     
-    // Render stroke segment between two points
-    void renderStrokeSegment(ImageBuffer& target, 
+    // Render stroke segment between two points as one dab batch. Returns the
+    // union of the dab areas.
+    DirtyRect renderStrokeSegment(ImageBuffer& target, 
                               const StrokePoint& from, 
                               const StrokePoint& to,
-                              bool alphaLock = false, const ImageBuffer* mask = nullptr);
+                              bool alphaLock = false, const ImageBuffer* mask = nullptr,
+                              const SelectionMask* selection = nullptr);
+    
+    // Continue the stroke through `count` points in one call: a segment from
+    // the last point to each point in turn (the first point begins the
+    // stroke with a single dab if none is in progress). All dabs go to the
+    // target as one batch. Returns the union of the dab areas.
+    DirtyRect renderStroke(ImageBuffer& target, const StrokePoint* points, size_t count,
+                           bool alphaLock = false, const ImageBuffer* mask = nullptr,
+                           const SelectionMask* selection = nullptr);
+    
+    // Dab for a stroke point with the current brush (size/opacity dynamics,
+    // jitter, per-type hardness) painted in `color`
+    Dab makeDab(float x, float y, float pressure, const Color& color);
+    
+    // Render a batch of dabs in one pass over the tiles they cover
+    // (ImageBuffer::drawDabs). Erases with an Eraser brush.
+    DirtyRect renderDabs(ImageBuffer& target, const Dab* dabs, size_t count,
+                         bool alphaLock = false, const ImageBuffer* mask = nullptr,
+                         const SelectionMask* selection = nullptr);
     
     // Get interpolated stroke points for smooth rendering
     std::vector<StrokePoint> interpolatePoints(const StrokePoint& from, 
@@ -122,11 +155,23 @@ private:
     bool m_isStroking = false;
     StrokePoint m_lastPoint;
     float m_strokeDistance = 0.0f;
+    uint64_t m_strokeSeed = 0;
+    Pcg32 m_random;
+    
+    // Per-segment scratch, reused across segments
+    std::vector<StrokePoint> m_segmentPoints;
+    std::vector<Dab> m_segmentDabs;
     
     // Internal rendering
     void applyBrushTexture(ImageBuffer& target, float x, float y, float size, float opacity);
     float calculateDabSize(float pressure) const;
     float calculateDabOpacity(float pressure) const;
+    Color pickupColor(const ImageBuffer& target, float x, float y) const;
+    void interpolateInto(const StrokePoint& from, const StrokePoint& to,
+                         std::vector<StrokePoint>& points) const;
+    bool usesStamp() const;
+    DirtyRect renderStamp(ImageBuffer& target, float x, float y, float pressure,
+                          const SelectionMask* selection);
 };
 
 } // namespace artflow
@@ -0,0 +1,47 @@
+/**
+ * ArtFlow Studio - Channel Buffer
+ * Single-channel 8-bit map for per-pixel media state
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace artflow {
+
+/**
+ * ChannelBuffer - One byte per pixel (wetness, pigment density, ...)
+ */
+class ChannelBuffer {
+public:
+    ChannelBuffer(int width, int height);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    uint8_t* data() { return m_data.data(); }
+    const uint8_t* data() const { return m_data.data(); }
+
+    // Returns 0 outside the buffer
+    uint8_t valueAt(int x, int y) const;
+    void setValue(int x, int y, uint8_t value);
+
+    void fill(uint8_t value);
+    void clear() { fill(0); }
+    void copyFrom(const ChannelBuffer& other);
+
+    size_t memoryUsage() const { return m_data.size(); }
+
+private:
+    int m_width;
+    int m_height;
+    std::vector<uint8_t> m_data;
+
+    bool isValidCoord(int x, int y) const {
+        return x >= 0 && x < m_width && y >= 0 && y < m_height;
+    }
+};
+
+} // namespace artflow
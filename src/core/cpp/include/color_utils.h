@@ -6,6 +6,7 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 #include <array>
 
 namespace artflow {
@@ -24,7 +25,21 @@ std::array<float, 3> rgbToHsl(uint8_t r, uint8_t g, uint8_t b);
 // HSL to RGB conversion
 std::array<uint8_t, 3> hslToRgb(float h, float s, float l);
 
-// Blend two colors with alpha
+// ============================================================================
+// Premultiplied RGBA8
+//
+// Pixel buffers store premultiplied alpha (channel <= alpha). Compositing is
+// then integer source-over, d = s + d * (255 - sa) / 255, with no per-pixel
+// division. Straight alpha only exists at import/export boundaries.
+// ============================================================================
+
+// round(x / 255) for x in [0, 255 * 255], without a division
+inline uint32_t div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+// Source-over of a premultiplied pixel onto a premultiplied pixel
 void alphaBlend(uint8_t* dst, const uint8_t* src, float srcOpacity = 1.0f);
 
 // Premultiply alpha
@@ -33,6 +48,10 @@ void premultiplyAlpha(uint8_t* pixel);
 // Unpremultiply alpha
 void unpremultiplyAlpha(uint8_t* pixel);
 
+// Convert `count` pixels in place (import / export boundaries)
+void premultiplyRow(uint8_t* pixels, size_t count);
+void unpremultiplyRow(uint8_t* pixels, size_t count);
+
 // Linear interpolation between colors
 void lerpColor(uint8_t* result, const uint8_t* a, const uint8_t* b, float t);
 
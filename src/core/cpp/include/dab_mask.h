@@ -0,0 +1,78 @@
+/**
+ * ArtFlow Studio - Dab Masks
+ * Cached coverage masks for round brush dabs and a tileable grain texture
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace artflow {
+
+/**
+ * DabMask - 8-bit coverage of one round dab (hardness falloff included).
+ * Mask pixel (i, j) lands on canvas pixel (baseX + originX + i,
+ * baseY + originY + j), where (baseX, baseY) is the dab center rounded
+ * down to whole pixels.
+ */
+struct DabMask {
+    int originX = 0;
+    int originY = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> coverage;              // width * height, row-major
+    std::vector<std::pair<int, int>> rowSpans;  // [begin, end) of non-zero coverage per row
+
+    const uint8_t* row(int j) const { return coverage.data() + static_cast<size_t>(j) * width; }
+    size_t bytes() const { return coverage.size() + rowSpans.size() * sizeof(rowSpans[0]); }
+};
+
+/**
+ * DabMaskCache - Dab masks keyed by quantized radius (1/4 px), hardness
+ * (1/64) and subpixel center offset (1/4 px). A stroke repeats the same few
+ * dabs thousands of times, so each is rasterized once instead of running
+ * sqrt and the falloff per pixel per dab.
+ *
+ * Thread-safe. Masks are shared: one stays valid while held even if the
+ * cache is dropped for exceeding its memory budget.
+ */
+class DabMaskCache {
+public:
+    static constexpr int kRadiusSteps = 4;     // Per pixel
+    static constexpr int kHardnessSteps = 64;
+    static constexpr int kOffsetSteps = 4;     // Per pixel
+    static constexpr size_t kDefaultBudget = size_t(32) * 1024 * 1024;
+
+    // Process-wide cache used by ImageBuffer::drawCircle
+    static DabMaskCache& shared();
+
+    explicit DabMaskCache(size_t budget = kDefaultBudget);
+
+    // Mask for a dab centered at (cx, cy). *baseX / *baseY receive the whole
+    // pixel position the mask origin is relative to.
+    std::shared_ptr<const DabMask> get(float cx, float cy, float radius, float hardness,
+                                       int* baseX, int* baseY);
+
+    void clear();
+    size_t memoryUsage() const;
+    size_t size() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<const DabMask>> m_masks;
+    size_t m_bytes = 0;
+    size_t m_budget;
+};
+
+// Tileable paper grain, kGrainTextureSize^2 values in [0, 255]. Sample at
+// (x & (kGrainTextureSize - 1), y & (kGrainTextureSize - 1)).
+constexpr int kGrainTextureSize = 256;
+const uint8_t* grainTexture();
+
+} // namespace artflow
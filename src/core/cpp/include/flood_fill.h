@@ -0,0 +1,56 @@
+/**
+ * ArtFlow Studio - Flood Fill
+ * Scanline bucket fill on image buffers and raw pixel memory
+ */
+
+#pragma once
+
+#include "image_buffer.h"
+#include "selection_mask.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace artflow {
+
+struct FillOptions {
+    int tolerance = 0;     // Max per-channel difference from the seed pixel (0-255)
+    int expand = 0;        // Grow (> 0) or shrink (< 0) the region by this many pixels
+
+    // Optional 8-bit selection the size of the target, `selectionStride`
+    // bytes per row: the fill neither spreads through nor paints pixels
+    // where it is 0
+    const uint8_t* selection = nullptr;
+    size_t selectionStride = 0;
+
+    // Or a SelectionMask of the target's size; used instead of `selection`
+    // when both are set
+    const SelectionMask* selectionMask = nullptr;
+};
+
+/**
+ * Fill the 4-connected region around (x, y) whose pixels lie within
+ * `tolerance` of the seed pixel on every channel, in place.
+ *
+ * Spans are filled row by row from a stack holding one entry per run still
+ * to visit; the region is tracked in a byte mask allocated per 64x64 tile it
+ * reaches, so memory follows the filled area rather than the canvas. Only
+ * expand/contract needs a distance map, over the region's bounds.
+ *
+ * `sample` is the image the region is found on (e.g. a composite of all
+ * layers); by default the target itself. It must have the target's size.
+ * The color is straight alpha, and filled pixels are replaced with it.
+ * Returns the bounds of the filled area.
+ */
+DirtyRect floodFill(ImageBuffer& target, int x, int y,
+                    uint8_t r, uint8_t g, uint8_t b, uint8_t a,
+                    const FillOptions& options = FillOptions(), const ImageBuffer* sample = nullptr);
+
+// Same on caller memory with 4 bytes per pixel in any channel order (e.g. a
+// QImage). `color` is in that order and is written as is. `sample`, if
+// given, is an image of the same size and layout, `sampleStride` bytes per
+// row.
+DirtyRect floodFill(uint8_t* pixels, int width, int height, size_t stride, int x, int y,
+                    const uint8_t color[4], const FillOptions& options = FillOptions(),
+                    const uint8_t* sample = nullptr, size_t sampleStride = 0);
+
+} // namespace artflow
@@ -5,82 +5,308 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <unordered_set>
 #include <vector>
 #include <memory>
 
+#include "blend_kernels.h"
+
 namespace artflow {
 
+class SelectionMask;
+class TileStore;
+
+/**
+ * DirtyRect - Pixel rectangle [x, x + w) x [y, y + h) touched by a drawing
+ * call. Accumulated through the brush pipeline so the view repaints only
+ * what changed.
+ */
+struct DirtyRect {
+    int x = 0;
+    int y = 0;
+    int w = 0;
+    int h = 0;
+
+    bool isEmpty() const { return w <= 0 || h <= 0; }
+
+    void unite(const DirtyRect& other) {
+        if (other.isEmpty()) return;
+        if (isEmpty()) { *this = other; return; }
+        int x1 = std::max(x + w, other.x + other.w);
+        int y1 = std::max(y + h, other.y + other.h);
+        x = std::min(x, other.x);
+        y = std::min(y, other.y);
+        w = x1 - x;
+        h = y1 - y;
+    }
+
+    // Clip to a width x height buffer
+    DirtyRect intersected(int width, int height) const {
+        return intersected(DirtyRect{0, 0, width, height});
+    }
+
+    DirtyRect intersected(const DirtyRect& other) const {
+        DirtyRect r;
+        r.x = std::max(x, other.x);
+        r.y = std::max(y, other.y);
+        r.w = std::min(x + w, other.x + other.w) - r.x;
+        r.h = std::min(y + h, other.y + other.h) - r.y;
+        if (r.isEmpty()) return DirtyRect();
+        return r;
+    }
+
+    bool intersects(const DirtyRect& other) const { return !intersected(other).isEmpty(); }
+};
+
+/**
+ * Dab - One round brush dab (straight-alpha color) for ImageBuffer::drawDabs
+ */
+struct Dab {
+    float x = 0.0f;
+    float y = 0.0f;
+    float radius = 1.0f;
+    float hardness = 1.0f;
+    float grain = 0.0f;
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    uint8_t a = 255;
+};
+
 /**
  * ImageBuffer - RGBA pixel buffer for layer/canvas data
+ *
+ * Pixels are stored as premultiplied RGBA8 (see color_utils.h). Methods that
+ * take a color (setPixel, fill, blendPixel, drawCircle) take straight alpha;
+ * getBytes() and fromBytes() convert at the boundary. Raw access (data(),
+ * pixelAt(), tile data, readRegion()) is premultiplied.
+ *
+ * Two storage modes share the same pixel API:
+ *  - Linear: one contiguous width*height*4 allocation (data() is valid).
+ *  - Tiled:  kTileSize x kTileSize tiles allocated on first write. Unwritten
+ *            tiles point at a shared read-only empty tile, so memory grows
+ *            with the painted area instead of the canvas size. Tiles are
+ *            reference counted and copied on write, which makes copyFrom()
+ *            between tiled buffers O(tile count).
+ *
+ * A tiled buffer can also be filled lazily from a TileLoader (e.g. a layer
+ * still in its project file): each row of tiles is loaded by the first
+ * access that reaches it, so untouched rows cost nothing.
+ *
+ * Tiles come from the heap, or from a TileStore (memory-mapped scratch
+ * file with a resident budget) once setTileStore() is called.
  */
 class ImageBuffer {
 public:
-    ImageBuffer(int width, int height);
+    enum class Storage { Linear, Tiled };
+
+    static constexpr int kTileSize = 64;
+    static constexpr size_t kTileStride = kTileSize * 4;            // Bytes per tile row
+    static constexpr size_t kTileBytes = kTileStride * kTileSize;   // Bytes per tile
+
+    // Dabs at least this large (radius, px) render their tiles in parallel
+    // on ThreadPool::shared(); output is identical to serial rendering.
+    static constexpr float kParallelDabRadius = 24.0f;
+
+    using Tile = std::array<uint8_t, kTileBytes>;
+    using TileHandle = std::shared_ptr<const Tile>;  // nullptr = empty tile
+
+    // Source of tiles for setTileLoader(). The buffer calls it at most once
+    // per tile row, from whichever thread first needs the row; snapshots of
+    // rows still pending (TileSnapshot) may call it again, concurrently.
+    class TileLoader {
+    public:
+        virtual ~TileLoader() = default;
+        // Fill `tiles` (tileCountX() entries) with tile row `ty`; nullptr
+        // for empty tiles. False if the row cannot be read: it stays empty
+        // and the buffer reports hasUnreadableTiles().
+        virtual bool loadTileRow(int ty, TileHandle* tiles) = 0;
+    };
+
+    // Tile handles taken without loading pending rows (see tileSnapshot()).
+    // A pending row's entries are nullptr; its pixels are what `loader`
+    // makes of it, as nothing has touched the row yet.
+    struct TileSnapshot {
+        std::vector<TileHandle> tiles;          // Row-major
+        std::vector<bool> pendingRows;          // Per tile row; empty if none was
+        std::shared_ptr<TileLoader> loader;     // Set if a row was pending
+
+        bool isRowPending(int ty) const { return !pendingRows.empty() && pendingRows[ty]; }
+        // Decode pending row `ty` into `row` (tileCountX() entries)
+        bool loadRow(int ty, TileHandle* row) const { return loader && loader->loadTileRow(ty, row); }
+    };
+
+    ImageBuffer(int width, int height, Storage storage = Storage::Linear);
     ~ImageBuffer();
-    
+
     // Dimensions
     int width() const { return m_width; }
     int height() const { return m_height; }
-    
-    // Pixel access
-    uint8_t* data() { return m_data.data(); }
-    const uint8_t* data() const { return m_data.data(); }
-    
-    // Get pixel at position (returns nullptr if out of bounds)
+    Storage storage() const { return m_storage; }
+    bool isTiled() const { return m_storage == Storage::Tiled; }
+
+    // Pixel access (contiguous memory, Linear storage only; nullptr when tiled)
+    uint8_t* data() { return isTiled() ? nullptr : m_data.data(); }
+    const uint8_t* data() const { return isTiled() ? nullptr : m_data.data(); }
+
+    // Get pixel at position (returns nullptr if out of bounds).
+    // The non-const overload is a write access and allocates the tile.
     uint8_t* pixelAt(int x, int y);
     const uint8_t* pixelAt(int x, int y) const;
-    
+
     // Set pixel color
     void setPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255);
-    
+
     // Fill entire buffer
     void fill(uint8_t r, uint8_t g, uint8_t b, uint8_t a = 255);
     void clear();
-    
+
     // Blend a color onto pixel with alpha blending. Optional alphaLock restricts
     // painting to areas that already have some alpha.
     void blendPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool alphaLock = false, bool isEraser = false);
-    
-    // Draw a filled circle (for brush dabs)
-    void drawCircle(int cx, int cy, float radius, 
+
+    // Draw a filled circle (for brush dabs) centered at a subpixel position.
+    // Coverage comes from the shared DabMaskCache and grain from the tileable
+    // grain texture (dab_mask.h). `selection`, if given, scales coverage by
+    // its value (same size as this buffer). Returns the area it covered.
+    DirtyRect drawCircle(float cx, float cy, float radius,
                     uint8_t r, uint8_t g, uint8_t b, uint8_t a,
-                    float hardness = 1.0f, float grain = 0.0f, 
-                    bool alphaLock = false, bool isEraser = false, const ImageBuffer* mask = nullptr);
-    
+                    float hardness = 1.0f, float grain = 0.0f,
+                    bool alphaLock = false, bool isEraser = false, const ImageBuffer* mask = nullptr,
+                    const SelectionMask* selection = nullptr);
+
+    // Draw `count` dabs in stroke order in one pass over the tiles their
+    // footprints cover: each tile is resolved once and takes every dab that
+    // overlaps it. Runs of same-color dabs accumulate coverage and blend
+    // once per pixel. Matches calling drawCircle per dab up to rounding.
+    // Tiles render in parallel for brushes of kParallelDabRadius and up.
+    // Tiles outside `selection` are skipped outright. Returns the union of
+    // the footprints.
+    DirtyRect drawDabs(const Dab* dabs, size_t count,
+                       bool alphaLock = false, bool isEraser = false, const ImageBuffer* mask = nullptr,
+                       const SelectionMask* selection = nullptr);
+
     // Copy from another buffer
     void copyFrom(const ImageBuffer& other);
-    
-    // Composite another buffer on top
-    void composite(const ImageBuffer& other, int offsetX = 0, int offsetY = 0, float opacity = 1.0f);
-    
-    // Get raw bytes for Python/QML interop
+
+    // Composite another buffer on top using a blend mode. `clip` (in this
+    // buffer's coordinates) limits it to the selection: fully selected runs
+    // go to the row kernel whole, partly selected runs with the source
+    // scaled by selection and opacity first.
+    void composite(const ImageBuffer& other, int offsetX = 0, int offsetY = 0, float opacity = 1.0f,
+                   BlendMode mode = BlendMode::Normal, const SelectionMask* clip = nullptr);
+
+    // Copy a rectangle into caller memory (any storage mode). Pixels outside
+    // the buffer are written as transparent.
+    void readRegion(int x, int y, int w, int h, uint8_t* dst, size_t dstStride) const;
+
+    // Get straight-alpha bytes for Python/QML interop
     std::vector<uint8_t> getBytes() const;
-    
+
     // Draw a textured stroke (High Performance C++ Splatting)
     // Moves the heavy loop from Python to C++ for lag-free painting
-    void drawStrokeTextured(float x1, float y1, float x2, float y2, 
-                           const ImageBuffer& stamp, 
-                           float spacing, float opacity, 
+    void drawStrokeTextured(float x1, float y1, float x2, float y2,
+                           const ImageBuffer& stamp,
+                           float spacing, float opacity,
                            bool rotate, float angle_jitter,
                            bool is_watercolor,
                            const ImageBuffer* paper_texture = nullptr);
-                           
-    // Create from raw bytes
+
+    // Create from straight-alpha bytes
     static std::unique_ptr<ImageBuffer> fromBytes(const std::vector<uint8_t>& bytes, int width, int height);
 
+    // Tile access (Tiled storage). Tile rows are kTileStride bytes apart;
+    // edge tiles are padded to the full tile size.
+    int tileCountX() const { return m_tilesX; }
+    int tileCountY() const { return m_tilesY; }
+    bool isTileAllocated(int tx, int ty) const;
+    const uint8_t* tileData(int tx, int ty) const;   // Shared empty tile if unallocated
+    uint8_t* mutableTileData(int tx, int ty);        // Allocates or detaches the tile
+
+    // Shared, immutable references to tiles. Holding a handle is a zero-copy
+    // snapshot: the buffer detaches the tile before its next write.
+    TileHandle tileHandle(int tx, int ty) const;
+    std::vector<TileHandle> tileHandles() const;     // Row-major, all tiles; loads pending rows
+    TileSnapshot tileSnapshot() const;               // Leaves pending rows to the loader
+    void setTileHandle(int tx, int ty, TileHandle tile);
+    static bool samePixels(const TileHandle& a, const TileHandle& b);   // nullptr is transparent
+
+    // Bytes of pixel storage currently held (shared tiles counted once).
+    // The second form skips tiles already in `counted` and adds the rest,
+    // so a sum over buffers that share tiles (e.g. a duplicated layer)
+    // counts each of them once.
+    size_t memoryUsage() const;
+    size_t memoryUsage(std::unordered_set<const Tile*>& counted) const;
+
+    // Allocate tiles from `store` (nullptr = the heap) from now on. Loaded
+    // tiles held elsewhere move into it; rows still pending go there as
+    // they load. Tiles shared with other holders (undo, snapshots) are
+    // copied, so call it before those exist where possible.
+    void setTileStore(std::shared_ptr<TileStore> store);
+    const std::shared_ptr<TileStore>& tileStore() const { return m_store; }
+
+    // Lazy loading (Tiled storage). setTileLoader() replaces the pixels with
+    // rows pending in `loader`; any tile access loads its row first, under a
+    // lock, so concurrent readers of different rows load in parallel.
+    // fill(), clear() and copyFrom() drop rows still pending.
+    void setTileLoader(std::shared_ptr<TileLoader> loader);
+    bool hasPendingTiles() const { return m_pendingRows.load(std::memory_order_acquire) > 0; }
+    bool isTileRowPending(int ty) const;   // Not loaded yet, so untouched since setTileLoader()
+    void loadPendingTiles() const;   // Every pending row now, on ThreadPool::shared()
+    // A row the loader could not read came back empty, so the pixels are
+    // not all the source's. Carried over by copyFrom(); cleared when the
+    // pixels are replaced (setTileLoader(), fill(), clear()).
+    bool hasUnreadableTiles() const { return m_unreadable.load(std::memory_order_acquire); }
+
 private:
     int m_width;
     int m_height;
-    std::vector<uint8_t> m_data;  // RGBA format (4 bytes per pixel)
-    
+    Storage m_storage;
+    std::vector<uint8_t> m_data;  // RGBA format (4 bytes per pixel), Linear storage
+
+    int m_tilesX = 0;
+    int m_tilesY = 0;
+    // Row-major, nullptr = empty tile. Mutable so const reads can resolve
+    // pending rows (see loadRow()).
+    mutable std::vector<std::shared_ptr<Tile>> m_tiles;
+
+    struct PendingRows;
+    std::unique_ptr<PendingRows> m_pending;      // Set by setTileLoader()
+    mutable std::atomic<int> m_pendingRows{0};   // Rows not loaded yet
+    mutable std::atomic<bool> m_unreadable{false};
+
+    std::shared_ptr<TileStore> m_store;          // nullptr = heap tiles
+
+    static const Tile& emptyTile();
+    std::shared_ptr<Tile> newTile() const;       // Zeroed, from m_store if set
+    void touch(const std::shared_ptr<Tile>& tile) const;
+
+    void ensureRow(int ty) const {
+        if (m_pendingRows.load(std::memory_order_acquire) > 0) loadRow(ty);
+    }
+    void loadRow(int ty) const;
+    void dropPending();
+
     size_t pixelIndex(int x, int y) const {
         return static_cast<size_t>((y * m_width + x) * 4);
     }
-    
+
     bool isValidCoord(int x, int y) const {
         return x >= 0 && x < m_width && y >= 0 && y < m_height;
     }
+
+    // Resolve the contiguous run of row storage holding (x, y). *runEnd receives
+    // the first x past the run (tile edge or row end). The writable variant
+    // returns nullptr without allocating when `allocate` is false and the
+    // tile is still empty.
+    uint8_t* rowRun(int x, int y, bool allocate, int* runEnd);
+    const uint8_t* rowRun(int x, int y, int* runEnd) const;
+    bool isEmptyAt(int x, int y) const;
 };
 
 } // namespace artflow
@@ -6,28 +6,16 @@
 #pragma once
 
 #include "image_buffer.h"
+#include "channel_buffer.h"
+#include "flood_fill.h"
+#include <cstddef>
 #include <vector>
 #include <memory>
 #include <string>
+#include <unordered_set>
 
 namespace artflow {
 
-// Blend modes (like Photoshop)
-enum class BlendMode {
-    Normal,
-    Multiply,
-    Screen,
-    Overlay,
-    SoftLight,
-    HardLight,
-    ColorDodge,
-    ColorBurn,
-    Darken,
-    Lighten,
-    Difference,
-    Exclusion
-};
-
 /**
  * Layer - Single layer with buffer and properties
  */
@@ -35,9 +23,10 @@ struct Layer {
     enum class Type { Drawing, Group, Background };
 
     std::string name;
+    int id = 0;                                 // Stable identity assigned by LayerManager
     std::unique_ptr<ImageBuffer> buffer;       // Main RGBA display buffer
-    std::unique_ptr<ImageBuffer> wetnessMap;    // 0-255 map of surface wetness
-    std::unique_ptr<ImageBuffer> pigmentMap;    // Detailed pigment density map
+    std::unique_ptr<ChannelBuffer> wetnessMap;  // 0-255 map of surface wetness (lazy)
+    std::unique_ptr<ChannelBuffer> pigmentMap;  // Detailed pigment density map (lazy)
     
     float opacity = 1.0f;
     BlendMode blendMode = BlendMode::Normal;
@@ -47,8 +36,24 @@ struct Layer {
     bool clipped = false;
     bool isPrivate = false;
     Type type = Type::Drawing;
+
+    // Project metadata this build only carries, so saving writes it back:
+    // a blend mode name it lacks (e.g. the Python app's "Add"), rendered as
+    // Normal and dropped once blendMode changes, and group nesting
+    std::string savedBlendMode;
+    int depth = 0;
+    bool expanded = true;
     
     Layer(const std::string& name, int width, int height, Type type = Type::Drawing);
+
+    // Wet-media maps are only allocated once a wet-media stroke touches the layer
+    bool hasWetMaps() const { return wetnessMap != nullptr; }
+    void ensureWetMaps();
+
+    // Bytes of pixel storage held by this layer, counting tiles it shares
+    // with other layers in full; see ImageBuffer::memoryUsage()
+    size_t memoryUsage() const;
+    size_t memoryUsage(std::unordered_set<const ImageBuffer::Tile*>& counted) const;
 };
 
 /**
@@ -69,9 +74,16 @@ public:
     // Color Sampling
     void sampleColor(int x, int y, uint8_t* r, uint8_t* g, uint8_t* b, uint8_t* a, int mode = 0) const;
     
+    // Bucket fill on layer `index` (see floodFill()). With sampleAllLayers
+    // the region is found on the composite of the visible layers. Returns
+    // the filled area; nothing is filled on a missing or locked layer.
+    DirtyRect floodFill(int index, int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a,
+                        const FillOptions& options = FillOptions(), bool sampleAllLayers = false);
+    
     // Access layers
     Layer* getLayer(int index);
     const Layer* getLayer(int index) const;
+    Layer* findLayerById(int id);                // nullptr if the layer was removed
     int getLayerCount() const { return static_cast<int>(m_layers.size()); }
     
     // Active layer
@@ -79,20 +91,58 @@ public:
     int getActiveLayerIndex() const { return m_activeIndex; }
     Layer* getActiveLayer();
     
-    // Composite all visible layers
+    // Memory accounting (bytes of pixel storage). A layer's figure counts
+    // tiles shared with other layers (copy-on-write after duplicateLayer())
+    // in full; the total counts each tile once.
+    size_t getLayerMemoryUsage(int index) const;
+    size_t getMemoryUsage() const;
+    
+    // Composite all visible layers. Canvas-sized outputs are composited
+    // tile by tile in parallel, skipping tiles no layer covers.
     void compositeAll(ImageBuffer& output, bool skipPrivate = false) const;
     
+    // Cached composites of the visible layers below and above the active
+    // layer. A stroke only changes the active layer, so a view draws these
+    // two plus the active layer instead of every layer. Structural edits
+    // through this class invalidate the caches; code that changes a layer's
+    // pixels (other than the active layer's), visibility or opacity directly
+    // must call invalidateComposite().
+    // The above-active composite is isolated from what lies beneath it, so it
+    // is only equivalent when those layers all blend Normal
+    // (canCacheAboveActive); otherwise draw them one by one.
+    const ImageBuffer& compositeBelowActive();
+    const ImageBuffer& compositeAboveActive();
+    bool canCacheAboveActive() const;
+    void invalidateComposite();
+    
     // Canvas dimensions
     int width() const { return m_width; }
     int height() const { return m_height; }
 
+    // Back every layer (and the composite caches) with `store`, including
+    // layers added later; nullptr returns new tiles to the heap. See
+    // ImageBuffer::setTileStore().
+    void setTileStore(std::shared_ptr<TileStore> store);
+    const std::shared_ptr<TileStore>& tileStore() const { return m_tileStore; }
+
 private:
     int m_width;
     int m_height;
+    std::shared_ptr<TileStore> m_tileStore;
     std::vector<std::unique_ptr<Layer>> m_layers;
     int m_activeIndex = 0;
+    int m_nextLayerId = 1;
+    
+    std::unique_ptr<ImageBuffer> m_belowCache;
+    std::unique_ptr<ImageBuffer> m_aboveCache;
+    bool m_belowValid = false;
+    bool m_aboveValid = false;
+    
+    // Composite visible layers [begin, end) into output
+    void compositeRange(ImageBuffer& output, int begin, int end) const;
+    void compositeLayers(ImageBuffer& output, const std::vector<const Layer*>& layers) const;
     
-    // Apply blend mode between two colors
+    // Apply blend mode between two premultiplied pixels
     static void blendColors(uint8_t* dst, const uint8_t* src, BlendMode mode, float opacity);
 };
 
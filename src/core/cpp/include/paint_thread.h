@@ -0,0 +1,150 @@
+/**
+ * ArtFlow Studio - Paint Thread
+ * Rasterizes stroke input off the UI thread
+ */
+
+#pragma once
+
+#include "brush_engine.h"
+#include "image_buffer.h"
+#include "selection_mask.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace artflow {
+
+class LayerManager;
+
+/**
+ * PaintThread - Dedicated stroke rasterizer
+ *
+ * The UI thread (the only producer) pushes stroke input into a lock-free
+ * SPSC queue and returns at once; the paint thread renders it into the
+ * layer with its own BrushEngine. Each stroke snapshots the brush and
+ * color at beginStroke(), so settings may change while it is drawn.
+ *
+ * Layer pixels are shared with the UI: anything that reads or changes
+ * layers while a stroke may be in flight (drawing the canvas, layer edits,
+ * undo, export) must hold lockCanvas(). The paint thread holds it only
+ * while rendering one input event.
+ *
+ * Dirty areas are double-buffered: the paint thread unites into the back
+ * rect and the UI swaps it out with takeDirty(). `notify` runs on the paint
+ * thread when the back rect becomes non-empty or a stroke finishes; the UI
+ * should queue itself a call to takeDirty() / finishedStrokes() from it.
+ */
+class PaintThread {
+public:
+    static constexpr size_t kQueueCapacity = 1024;
+
+    // What a stroke draws into and with, fixed at beginStroke()
+    struct Stroke {
+        int layerId = -1;
+        int maskLayerId = -1;   // Clipping mask source, -1 for none
+        bool alphaLock = false;
+        BrushSettings brush;
+        Color color;
+        uint64_t seed = 0;      // Jitter seed, see BrushEngine::beginStroke()
+        // Selection the stroke is confined to, or none. A copy taken at
+        // beginStroke() (copy-on-write, so cheap): selecting while a
+        // stroke is in flight does not change it.
+        std::shared_ptr<const SelectionMask> selection;
+    };
+
+    // Input latency (queued -> rendered) and queue pressure since the last
+    // resetStats(). Points are dropped only when the queue is full.
+    struct Stats {
+        uint64_t eventsQueued = 0;
+        uint64_t eventsDropped = 0;
+        uint64_t eventsRendered = 0;
+        double meanLatencyMs = 0.0;
+        double maxLatencyMs = 0.0;
+    };
+
+    PaintThread(LayerManager* layers, std::function<void()> notify);
+    ~PaintThread();
+
+    PaintThread(const PaintThread&) = delete;
+    PaintThread& operator=(const PaintThread&) = delete;
+
+    // Canvas lock shared with the paint thread
+    std::unique_lock<std::mutex> lockCanvas() { return std::unique_lock<std::mutex>(m_canvasMutex); }
+
+    // Swap in a new layer stack (e.g. after a resize). Takes the canvas lock.
+    void setLayerManager(LayerManager* layers);
+
+    // Stroke input (UI thread). addPoint() returns false when the point was
+    // dropped because the paint thread is too far behind; begin and end
+    // are never dropped.
+    void beginStroke(const Stroke& stroke, const StrokePoint& point);
+    bool addPoint(const StrokePoint& point);
+    void endStroke();
+
+    // Swap out the area rendered since the last call
+    DirtyRect takeDirty();
+
+    // Number of strokes whose end has been rendered
+    uint64_t finishedStrokes() const { return m_finishedStrokes.load(std::memory_order_acquire); }
+
+    // Block until everything pushed so far has been rendered
+    void waitIdle();
+
+    Stats stats() const;
+    void resetStats();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        enum class Type { Begin, Move, End } type = Type::Move;
+        StrokePoint point;
+        std::shared_ptr<const Stroke> stroke;   // Begin only
+        Clock::time_point queued;
+    };
+
+    LayerManager* m_layers;
+    std::function<void()> m_notify;
+    std::mutex m_canvasMutex;
+
+    SpscQueue<Event> m_queue;
+
+    // Paint thread state
+    BrushEngine m_engine;
+    std::shared_ptr<const Stroke> m_stroke;
+    StrokePoint m_lastPoint;
+
+    // Sleep / wake. m_sleeping lets push skip the mutex while the thread runs.
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    std::atomic<bool> m_sleeping{false};
+    bool m_stopping = false;
+
+    // Results
+    mutable std::mutex m_resultMutex;
+    DirtyRect m_dirty[2];
+    int m_backDirty = 0;
+    uint64_t m_rendered = 0;
+    double m_latencySumMs = 0.0;
+    double m_latencyMaxMs = 0.0;
+    std::atomic<uint64_t> m_queued{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_finishedStrokes{0};
+
+    std::thread m_thread;
+
+    void push(Event&& event);
+    void wake();
+    void run();
+    void render(const Event& event);
+    void publish(const DirtyRect& dirty, Clock::time_point queued, bool finished);
+};
+
+} // namespace artflow
@@ -0,0 +1,88 @@
+/**
+ * ArtFlow Studio - PNG Codec
+ * Band-parallel PNG encoding and tile-row decoding for project layers
+ */
+
+#pragma once
+
+#include "image_buffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace artflow {
+namespace png {
+
+// Rows per independently compressed band: one tile row of an ImageBuffer
+constexpr int kBandRows = ImageBuffer::kTileSize;
+
+/**
+ * Encode `image` as an 8-bit RGBA PNG (straight alpha, like QImage writes).
+ *
+ * The image is cut into bands of kBandRows rows that are filtered and
+ * deflated as separate tasks on ThreadPool::shared(). The first row of a
+ * band only uses filters that do not look at the row above, and each band
+ * starts a fresh deflate stream on a byte boundary, so the bands join into
+ * one ordinary IDAT stream that any PNG reader accepts. A private "afIX"
+ * chunk (ancillary, unsafe to copy, so editors that rewrite the pixels drop
+ * it) records where each band starts, which lets BandedPng decode any band
+ * on its own.
+ *
+ * afIX payload (big-endian): u8 version (1), u32 bandRows, u32 bandCount,
+ * then bandCount + 1 u64 offsets into the zlib stream; band i is the
+ * deflate data in [offset[i], offset[i + 1]).
+ */
+std::vector<uint8_t> encode(const ImageBuffer& image, int level = 6);
+
+/**
+ * Decode a whole PNG into a new tiled buffer (premultiplied). Every
+ * non-interlaced format is read: gray, gray+alpha, RGB, RGBA and palette
+ * at any bit depth, with tRNS transparency. 16-bit channels keep their
+ * high byte. Rows are inflated a band at a time straight into tiles, and
+ * fully transparent tiles stay unallocated. nullptr on error.
+ */
+std::unique_ptr<ImageBuffer> decode(const uint8_t* data, size_t size, std::string* error = nullptr);
+
+/**
+ * BandedPng - Per-band access to a PNG written by encode()
+ *
+ * open() reads only the chunk headers and the band index; the pixels stay
+ * in the file. decodeBand() opens the file for each call, so bands can be
+ * decoded from any number of threads at once.
+ */
+class BandedPng {
+public:
+    // Parse the PNG occupying [offset, offset + size) of `path` (e.g. a
+    // stored zip member). False unless it is an 8-bit RGBA PNG with a valid
+    // band index of kBandRows rows per band.
+    bool open(const std::string& path, uint64_t offset = 0, uint64_t size = UINT64_MAX);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    int bandCount() const { return static_cast<int>(m_offsets.size()) - 1; }
+
+    // Decode band `index` into tileCountX tiles, premultiplied, edge tiles
+    // padded with transparent pixels; fully transparent tiles are nullptr.
+    // False on an I/O error or corrupt data.
+    bool decodeBand(int index, ImageBuffer::TileHandle* tiles) const;
+
+private:
+    struct Segment {
+        uint64_t fileOffset;   // Of the IDAT payload
+        uint64_t streamOffset; // Of its first byte in the zlib stream
+        uint64_t bytes;
+    };
+
+    std::string m_path;
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<uint64_t> m_offsets;   // Band starts in the zlib stream, plus the end
+    std::vector<Segment> m_segments;   // IDAT chunks in order
+
+    bool readStream(uint64_t begin, uint64_t end, std::vector<uint8_t>& out) const;
+};
+
+} // namespace png
+} // namespace artflow
@@ -0,0 +1,166 @@
+/**
+ * ArtFlow Studio - Project File
+ * Native .aflow save and load in the layout the Python app reads and writes
+ */
+
+#pragma once
+
+#include "blend_kernels.h"
+#include "image_buffer.h"
+#include "zip_archive.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace artflow {
+
+class LayerManager;
+
+/*
+ * Project layout (shared with src/ui/canvas_item.py), as members of a zip
+ * archive (.aflow) or as files in a folder:
+ *   project.json      ProjectInfo; meta.json is accepted when loading
+ *   preview.png       flattened thumbnail
+ *   layer_<i>.png     pixels of layer i (0 = bottom), straight-alpha RGBA
+ *   timelapse/        session.aftl (TimelapseWriter) or the Python app's
+ *                     frame_XXXXX.jpg
+ */
+
+// Member holding the session's TimelapseWriter recording
+constexpr char kProjectTimelapseMember[] = "timelapse/session.aftl";
+
+// One entry of project.json's "layers"
+struct ProjectLayer {
+    std::string name = "Layer";
+    std::string type = "normal";        // "normal", "background" or "group"
+    bool visible = true;
+    float opacity = 1.0f;
+    std::string blendMode = "Normal";   // Display name, e.g. "Soft Light"
+    int depth = 0;                      // Group nesting
+    bool expanded = true;
+    bool locked = false;
+    bool alphaLock = false;
+    bool clipped = false;
+    bool isPrivate = false;
+    std::string filename;               // Member holding the pixels
+};
+
+struct ProjectInfo {
+    int width = 0;
+    int height = 0;
+    std::string name;                   // Display name; empty = file name
+    std::string created;                // ISO 8601
+    std::vector<ProjectLayer> layers;   // Bottom to top
+};
+
+// Metadata plus pixels, as saved. Layer buffers may use either storage.
+struct ProjectSnapshot {
+    ProjectInfo info;
+    std::vector<std::unique_ptr<ImageBuffer>> layers;   // Parallel to info.layers
+};
+
+struct ProjectSaveOptions {
+    std::vector<uint8_t> previewPng;    // preview.png; left out when empty
+    // Files copied in as stored members: (member name, path), e.g.
+    // ("timelapse/session.aftl", recorder file)
+    std::vector<std::pair<std::string, std::string>> files;
+    // Project whose legacy timelapse/ JPEG frames are carried over (e.g.
+    // the file being overwritten), so saving does not drop them
+    std::string carryTimelapseFrom;
+    // Project the layers were loaded from. Saving over it fails while a
+    // layer has rows that could not be read from it (they loaded empty,
+    // see ImageBuffer::hasUnreadableTiles()), so they are not lost for good.
+    std::string loadedFrom;
+    int compressionLevel = 6;           // zlib level of the layer PNGs
+};
+
+/**
+ * Write `project` to `path`: a zip archive if it ends in .aflow, else a
+ * folder.
+ *
+ * Layers go through png::encode(), which filters and deflates each one as
+ * bands on ThreadPool::shared(); while a layer is being compressed the one
+ * before it is written out on a worker thread, so encoding and I/O overlap
+ * and one finished PNG is held in memory at a time. Layer PNGs and copied
+ * files are stored (they are compressed already), which keeps them
+ * readable in place: layers load lazily (ProjectReader) and timelapse
+ * containers export without extraction (exportTimelapse()).
+ *
+ * An archive is written to `path + ".tmp"` and renamed over `path` once
+ * complete, so a failed save leaves the previous file intact.
+ * Saving over options.loadedFrom is refused while any layer is damaged.
+ */
+bool saveProject(const std::string& path, const ProjectSnapshot& project,
+                 const ProjectSaveOptions& options = {}, std::string* error = nullptr);
+
+/**
+ * ProjectReader - Opens a project archive or folder
+ *
+ * open() reads the metadata only. loadLayers() hands back buffers that
+ * decode on first access where it can: a stored layer PNG written by
+ * saveProject() carries a band index (png::BandedPng), and each tile row
+ * is inflated from the file the first time it is touched (see
+ * ImageBuffer::setTileLoader()). Other PNGs (the Python app deflates its
+ * members) are decoded up front, in parallel across layers.
+ *
+ * Lazy layers read the file for as long as rows are pending; replacing it
+ * meanwhile is safe only through saveProject(), which loads every row of
+ * what it saves first.
+ */
+class ProjectReader {
+public:
+    bool open(const std::string& path, std::string* error = nullptr);
+
+    const std::string& path() const { return m_path; }
+    const ProjectInfo& info() const { return m_info; }
+
+    // One buffer per info().layers entry, tiled, project-sized. Layers
+    // whose pixels are missing or unreadable come back nullptr, and
+    // `error` names the last of them. A lazy layer's rows that turn out
+    // unreadable when touched load empty and mark the buffer
+    // (ImageBuffer::hasUnreadableTiles()).
+    std::vector<std::unique_ptr<ImageBuffer>> loadLayers(std::string* error = nullptr);
+
+    // The bytes of member `name` (a path relative to a project folder)
+    bool read(const std::string& name, std::vector<uint8_t>& out);
+
+    // Names of the members under timelapse/, sorted
+    std::vector<std::string> timelapseMembers() const;
+
+    // Copy member `name` to the file `target`, streamed
+    bool extract(const std::string& name, const std::string& target, std::string* error = nullptr);
+
+private:
+    std::string m_path;
+    bool m_isFolder = false;
+    ZipReader m_zip;
+    ProjectInfo m_info;
+};
+
+// ============================================================================
+// LayerManager glue
+// ============================================================================
+
+// Display names of blend modes as project.json stores them
+const char* blendModeName(BlendMode mode);
+BlendMode blendModeFromName(const std::string& name);   // Normal if unknown
+
+// project.json entry of layer `index`, and the reverse. Blend mode names
+// this build lacks and the group fields round-trip through the Layer.
+ProjectLayer projectLayer(const LayerManager& layers, int index);
+void applyProjectLayer(const ProjectLayer& meta, LayerManager& layers, int index);
+
+// Copy of the layer stack for saveProject(): metadata, and buffers that
+// share tiles with the layers (copy-on-write), so taking it is O(tiles)
+// and the layers can be painted on while it is saved
+ProjectSnapshot snapshotProject(const LayerManager& layers);
+
+// A layer stack of the project's size with `layers[i]` in the place of
+// layer i (nullptr = empty layer). A buffer of another size is placed at
+// the origin, as loadLayers() does with such PNGs.
+std::unique_ptr<LayerManager> buildLayerStack(const ProjectInfo& info,
+                                              std::vector<std::unique_ptr<ImageBuffer>> layers);
+
+} // namespace artflow
@@ -0,0 +1,48 @@
+/**
+ * ArtFlow Studio - Random
+ * Small deterministic PRNG for brush dynamics
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace artflow {
+
+/**
+ * Pcg32 - PCG-XSH-RR generator (32-bit output, 64-bit state). One multiply
+ * and a rotate per value, no shared state: every owner advances its own
+ * sequence, and the same seed yields the same sequence on every platform,
+ * unlike rand().
+ */
+class Pcg32 {
+public:
+    static constexpr uint64_t kDefaultStream = 0xda3e39cb94b95bdbULL;
+
+    explicit Pcg32(uint64_t seed = 0, uint64_t stream = kDefaultStream) { reseed(seed, stream); }
+
+    void reseed(uint64_t seed, uint64_t stream = kDefaultStream) {
+        m_state = 0;
+        m_increment = (stream << 1) | 1u;
+        next();
+        m_state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        const uint64_t old = m_state;
+        m_state = old * 6364136223846793005ULL + m_increment;
+        const uint32_t xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        const uint32_t rot = static_cast<uint32_t>(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // Uniform in [0, 1)
+    float nextFloat() { return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f); }
+
+private:
+    uint64_t m_state = 0;
+    uint64_t m_increment = 1;
+};
+
+} // namespace artflow
@@ -0,0 +1,26 @@
+/**
+ * ArtFlow Studio - RLE Codec
+ * Run-length coding of RGBA pixel data (tiles, history deltas)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace artflow {
+
+namespace rle {
+
+// Encode `pixelCount` RGBA pixels. Runs of identical pixels (transparent
+// areas, flat fills) collapse to 5 bytes; other pixels are stored as
+// literal blocks with a 1-byte header.
+std::vector<uint8_t> encodePixels(const uint8_t* rgba, size_t pixelCount);
+
+// Decode into `out` (pixelCount * 4 bytes). Returns false on malformed input.
+bool decodePixels(const uint8_t* data, size_t size, uint8_t* out, size_t pixelCount);
+
+} // namespace rle
+
+} // namespace artflow
@@ -0,0 +1,107 @@
+/**
+ * ArtFlow Studio - Selection Mask
+ * Tiled 8-bit selection with rect and polygon operations
+ */
+
+#pragma once
+
+#include "image_buffer.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace artflow {
+
+/**
+ * SelectionMask - Per-pixel selection, 0 = unselected, 255 = selected
+ *
+ * Stored as kTileSize x kTileSize byte tiles on the same grid as tiled
+ * ImageBuffers, so a layer tile and its selection tile line up. Unselected
+ * tiles hold no memory and fully selected tiles share one read-only tile;
+ * only tiles crossed by a selection edge own storage. Tiles are copied on
+ * write, so copying a mask (e.g. for undo or a stroke in flight) is
+ * O(tile count).
+ *
+ * Shapes are hard-edged: a pixel is inside when its center is. bounds() is
+ * kept exact (the box of the non-zero pixels) so clients can skip
+ * everything outside it.
+ */
+class SelectionMask {
+public:
+    enum class Op { Replace, Add, Subtract, Intersect };
+
+    static constexpr int kTileSize = ImageBuffer::kTileSize;
+    static constexpr size_t kTileBytes = kTileSize * kTileSize;   // Rows are kTileSize bytes apart
+
+    using Tile = std::array<uint8_t, kTileBytes>;
+
+    SelectionMask(int width, int height);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+
+    const DirtyRect& bounds() const { return m_bounds; }
+    bool isEmpty() const { return m_bounds.isEmpty(); }
+
+    void clear();
+    void selectAll();
+    void invert();
+
+    // Shape operations, clipped to the mask. Replace drops the previous
+    // selection; Intersect keeps it only inside the shape.
+    void selectRect(int x, int y, int w, int h, Op op = Op::Replace);
+
+    // Closed polygon of `count` points, x/y interleaved, filled with the
+    // even-odd rule (self-intersecting lassos leave holes like QPainter's
+    // default fill)
+    void selectPolygon(const float* xy, size_t count, Op op = Op::Replace);
+
+    uint8_t valueAt(int x, int y) const;
+
+    // Tile access. tileData() never returns null inside the grid: an
+    // unselected tile reads as the shared zero tile, a fully selected one
+    // as the shared full tile, so callers can index it unconditionally.
+    int tileCountX() const { return m_tilesX; }
+    int tileCountY() const { return m_tilesY; }
+    const uint8_t* tileData(int tx, int ty) const;
+    bool isTileEmpty(int tx, int ty) const { return !m_tiles[ty * m_tilesX + tx]; }
+    bool isTileFull(int tx, int ty) const { return m_tiles[ty * m_tilesX + tx] == fullTile(); }
+
+    // Values from (x, y) to the end of its tile row, i.e. up to the next
+    // multiple of kTileSize. Clip loops fetch one pointer per tile run.
+    const uint8_t* rowData(int x, int y) const {
+        return tileData(x / kTileSize, y / kTileSize) + (y % kTileSize) * kTileSize + x % kTileSize;
+    }
+
+    // Copy a rectangle to/from caller memory, one byte per pixel (e.g. a
+    // Grayscale8 QImage). Pixels outside the mask read as 0; writeRegion()
+    // replaces the rectangle and ignores what lies outside the mask.
+    void readRegion(int x, int y, int w, int h, uint8_t* dst, size_t dstStride) const;
+    void writeRegion(int x, int y, int w, int h, const uint8_t* src, size_t srcStride);
+
+    // Bytes of tile storage held (shared tiles not counted)
+    size_t memoryUsage() const;
+
+private:
+    using TilePtr = std::shared_ptr<Tile>;   // nullptr = unselected tile
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    std::vector<TilePtr> m_tiles;
+    DirtyRect m_bounds;
+
+    static const TilePtr& fullTile();
+    static const Tile& zeroTile();
+
+    uint8_t* mutableTile(int tx, int ty);
+    void fillSpan(int y, int x0, int x1, uint8_t value);
+    void fillRect(const DirtyRect& rect, uint8_t value);
+    void compactTile(int tx, int ty);
+    void updateBounds();
+};
+
+} // namespace artflow
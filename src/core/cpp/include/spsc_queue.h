@@ -0,0 +1,76 @@
+/**
+ * ArtFlow Studio - SPSC Queue
+ * Bounded lock-free ring for one producer thread and one consumer thread
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace artflow {
+
+/**
+ * SpscQueue - Fixed-capacity ring buffer. Exactly one thread may push and
+ * exactly one (other) thread may pop; neither side ever blocks or locks.
+ * Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer. Returns false (and leaves `value` untouched) when full.
+    bool tryPush(T&& value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead > m_mask) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead > m_mask) return false;
+        }
+        m_slots[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. Returns false when empty.
+    bool tryPop(T& out) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) return false;
+        }
+        out = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Either side; exact only when the other side is idle
+    bool empty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask = 0;
+
+    // Producer and consumer indices on separate cache lines, each with the
+    // owner's last view of the other index so most calls touch one line
+    alignas(64) std::atomic<size_t> m_head{0};   // Next slot to pop
+    size_t m_cachedTail = 0;                      // Consumer's copy of m_tail
+    alignas(64) std::atomic<size_t> m_tail{0};   // Next slot to push
+    size_t m_cachedHead = 0;                      // Producer's copy of m_head
+};
+
+} // namespace artflow
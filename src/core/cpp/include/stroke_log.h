@@ -0,0 +1,120 @@
+/**
+ * ArtFlow Studio - Stroke Log
+ * Compact binary record of painted strokes and deterministic replay
+ */
+
+#pragma once
+
+#include "brush_engine.h"
+#include "image_buffer.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace artflow {
+
+class LayerManager;
+struct Layer;
+
+// One input step of a stroke, rendered the way the paint thread does it:
+// the first point (`previous` null) as a single dab, every later point as a
+// segment from the previous one. Live painting and replay share this so a
+// replayed stroke lands on the same pixels.
+DirtyRect renderStrokeStep(BrushEngine& engine, Layer& layer, const ImageBuffer* mask,
+                           bool alphaLock, const StrokePoint* previous, const StrokePoint& point,
+                           const SelectionMask* selection = nullptr);
+
+/**
+ * StrokeLog - Append-only record of strokes
+ *
+ * Each stroke stores its target layer, color, jitter seed, a hash into the
+ * log's brush table and its points, quantized (1/16 px, 1/1024 pressure,
+ * milliseconds) and delta-coded as varints: a typical point takes 3-5
+ * bytes. Feed the log the same quantized points that are painted (see
+ * quantize()) and replay() reproduces the strokes exactly.
+ *
+ * Only strokes are recorded; fills, clears, layer edits and the selection
+ * a stroke was confined to are not, so replay starts from whatever the
+ * layers hold (e.g. the state a range of strokes was recorded on). Pen tilt is not kept; the engine ignores it.
+ * Brush tip and paper images stay in the in-memory brush table but are not
+ * written by serialize(); a loaded log replays such brushes untextured.
+ */
+class StrokeLog {
+public:
+    static constexpr float kPositionScale = 16.0f;     // Steps per pixel
+    static constexpr float kPressureScale = 1024.0f;   // Steps per unit
+
+    // A decoded stroke
+    struct Stroke {
+        int layerId = -1;
+        int maskLayerId = -1;   // Clipping mask source, -1 for none
+        bool alphaLock = false;
+        uint64_t brushHash = 0;
+        Color color;
+        uint64_t seed = 0;
+        std::vector<StrokePoint> points;
+    };
+
+    StrokeLog();
+
+    // Round a point to what the log can store
+    static StrokePoint quantize(const StrokePoint& point);
+
+    // Milliseconds since the log was created or cleared, for timestamps
+    uint64_t elapsedMs() const;
+
+    // Recording. Points are quantized on the way in; a stroke becomes
+    // visible to stroke()/replay() once it ends.
+    void beginStroke(int layerId, int maskLayerId, bool alphaLock, const BrushSettings& brush,
+                     const Color& color, uint64_t seed, const StrokePoint& point);
+    void addPoint(const StrokePoint& point);
+    void endStroke();
+    void cancelStroke();
+    bool isRecording() const { return m_recording; }
+
+    size_t strokeCount() const { return m_offsets.size(); }
+    Stroke stroke(size_t index) const;
+    const BrushSettings* brush(uint64_t hash) const;
+
+    // Drop strokes from `count` on (e.g. ones that were undone)
+    void truncate(size_t count);
+    void clear();
+
+    // Encoded size of the recorded strokes
+    size_t byteSize() const { return m_data.size(); }
+
+    // Re-render strokes [first, first + count) into `layers`. Strokes whose
+    // layer no longer exists are skipped. Returns the area touched.
+    DirtyRect replay(LayerManager& layers, size_t first = 0, size_t count = SIZE_MAX) const;
+
+    // Binary form. deserialize() returns false on malformed input and
+    // leaves the log unchanged.
+    std::vector<uint8_t> serialize() const;
+    bool deserialize(const uint8_t* data, size_t size);
+    bool saveToFile(const std::string& path) const;
+    bool loadFromFile(const std::string& path);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::unordered_map<uint64_t, BrushSettings> m_brushes;
+    std::vector<uint8_t> m_data;     // Encoded strokes, back to back
+    std::vector<size_t> m_offsets;   // Start of each stroke in m_data
+    Clock::time_point m_origin;
+
+    // Stroke being recorded
+    bool m_recording = false;
+    std::vector<uint8_t> m_header;
+    std::vector<uint8_t> m_points;
+    uint32_t m_pointCount = 0;
+    int32_t m_lastX = 0, m_lastY = 0, m_lastPressure = 0;
+    uint64_t m_lastTime = 0;
+
+    uint64_t internBrush(const BrushSettings& brush);
+    void appendPoint(const StrokePoint& point);
+};
+
+} // namespace artflow
@@ -0,0 +1,74 @@
+/**
+ * ArtFlow Studio - Thread Pool
+ * Work-stealing pool for data-parallel loops (tiles, rows)
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace artflow {
+
+/**
+ * ThreadPool - Fixed set of workers running parallelFor() loops
+ *
+ * parallelFor() deals the indices out to per-worker deques. A worker
+ * takes from the back of its own deque and, once that is empty, steals
+ * from the front of the others, so uneven items (a tile full of dabs next
+ * to an almost empty one) even out. The calling thread works too and
+ * returns when every index has run.
+ *
+ * A parallelFor() issued from inside a pool task runs serially on that
+ * thread rather than waiting on workers that may all be busy.
+ */
+class ThreadPool {
+public:
+    // Process-wide pool with one worker per hardware thread beyond the caller
+    static ThreadPool& shared();
+
+    explicit ThreadPool(unsigned workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned workerCount() const { return static_cast<unsigned>(m_threads.size()); }
+
+    // Run body(i) for every i in [0, count). Indices may run in any order
+    // and concurrently with each other.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    struct Batch;
+    struct Task {
+        Batch* batch = nullptr;
+        size_t index = 0;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;   // One per worker
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::atomic<size_t> m_queued{0};   // Tasks sitting in any deque
+    bool m_stopping = false;
+
+    void workerLoop(unsigned self);
+    bool popOwn(unsigned self, Task& task);
+    bool steal(unsigned self, Task& task);
+    static void runTask(const Task& task);
+};
+
+} // namespace artflow
@@ -0,0 +1,126 @@
+/**
+ * ArtFlow Studio - Tile Store
+ * Memory-mapped scratch file backing layer tiles of huge canvases
+ */
+
+#pragma once
+
+#include "background_worker.h"
+#include "image_buffer.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace artflow {
+
+/**
+ * TileStore - Tile memory carved out of a memory-mapped scratch file
+ *
+ * ImageBuffers given a store (ImageBuffer::setTileStore()) allocate their
+ * tiles from it instead of the heap. Tiles stay ordinary TileHandles, so
+ * brushes, compositing, undo and copy-on-write see no difference; only
+ * where the bytes live changes. Because that is a shared file mapping, the
+ * OS can write untouched tiles back to the file and drop them from memory
+ * instead of swapping, and the canvas may be larger than RAM.
+ *
+ * A budget bounds what stays resident. Buffers touch() a tile when they
+ * resolve it for reading or writing; once more tiles are resident than the
+ * budget allows, a low-priority worker walks the tiles with a clock (an LRU
+ * approximation: a tile touched since the hand last passed gets another
+ * round) and hands the cold ones back to the OS, down to 7/8 of the
+ * budget. Their contents stay in the file and page back in on the next
+ * access. Handles taken for snapshots (tileHandle()) do not count as uses.
+ *
+ * The file lives in the given directory under a temporary name and is
+ * deleted when the store is (or, on POSIX, as soon as it is created). It
+ * grows in fixed chunks, each its own mapping, so tile addresses never
+ * move. Freed tiles are reused; the file does not shrink.
+ *
+ * Tiles keep their store alive, so it may be dropped while buffers, undo
+ * history or snapshots still hold its tiles.
+ */
+class TileStore : public std::enable_shared_from_this<TileStore> {
+public:
+    using Tile = ImageBuffer::Tile;
+
+    static constexpr size_t kChunkTiles = 4096;   // 64 MB of file per mapping
+
+    // nullptr (and `error`) if the scratch file cannot be created
+    static std::shared_ptr<TileStore> create(const std::string& directory, size_t residentBudgetBytes,
+                                             std::string* error = nullptr);
+    ~TileStore();
+
+    TileStore(const TileStore&) = delete;
+    TileStore& operator=(const TileStore&) = delete;
+
+    // A zeroed tile; nullptr when the file cannot grow (disk full)
+    std::shared_ptr<Tile> allocate();
+
+    // True if `tile` lives in this store
+    bool owns(const ImageBuffer::TileHandle& tile) const;
+
+    // Mark a tile of any store as just used; no-op for heap tiles
+    static void touch(const ImageBuffer::TileHandle& tile) {
+        if (Release* release = std::get_deleter<Release>(tile)) release->store->touch(*release->flags);
+    }
+
+    void setResidentBudget(size_t bytes);
+    size_t residentBudget() const { return m_budgetTiles.load(std::memory_order_relaxed) * ImageBuffer::kTileBytes; }
+
+    size_t residentBytes() const { return m_residentTiles.load(std::memory_order_relaxed) * ImageBuffer::kTileBytes; }
+    size_t allocatedBytes() const;   // Tiles in use
+    size_t fileBytes() const;
+
+    // Hand cold tiles back to the OS now, down to the budget
+    void trim();
+
+private:
+    // Per-tile state bits
+    static constexpr uint8_t kAllocated = 1 << 0;
+    static constexpr uint8_t kResident = 1 << 1;    // Used since last handed back
+    static constexpr uint8_t kReferenced = 1 << 2;  // Used since the clock hand passed
+
+    // Deleter of store tiles: returns the slot; identifies them in touch()
+    struct Release {
+        std::shared_ptr<TileStore> store;
+        size_t slot;
+        std::atomic<uint8_t>* flags;
+        void operator()(Tile*) const { store->release(slot); }
+    };
+
+    struct Chunk;
+
+    TileStore() = default;
+
+    void touch(std::atomic<uint8_t>& flags);
+    void release(size_t slot);
+    bool grow(std::string* error);   // Under m_mutex
+    uint8_t* address(size_t slot) const;
+    std::atomic<uint8_t>& flags(size_t slot) const;
+    std::vector<uint8_t*> sweep();   // Under m_mutex
+
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    std::vector<size_t> m_free;   // Slots to reuse
+    size_t m_used = 0;            // Slots ever handed out (high-water mark)
+    size_t m_allocated = 0;
+    size_t m_hand = 0;            // Clock hand
+
+#if defined(_WIN32)
+    void* m_file = nullptr;       // HANDLE
+#else
+    int m_file = -1;
+#endif
+
+    std::atomic<size_t> m_budgetTiles{0};
+    std::atomic<size_t> m_residentTiles{0};
+    std::atomic<bool> m_trimQueued{false};
+
+    BackgroundWorker m_worker{BackgroundWorker::Priority::Low};   // Last: joined first
+};
+
+} // namespace artflow
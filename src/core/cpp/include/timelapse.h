@@ -0,0 +1,200 @@
+/**
+ * ArtFlow Studio - Timelapse
+ * Background frame capture into an append-only container file
+ */
+
+#pragma once
+
+#include "background_worker.h"
+#include "blend_kernels.h"
+#include "image_buffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace artflow {
+
+class LayerManager;
+
+/**
+ * TimelapseWriter - Appends frames to a timelapse container
+ *
+ * File layout (integers little-endian):
+ *   "AFTL" u32 version, u32 width, u32 height
+ *   then per frame: u32 payloadBytes, u32 frameIndex, u64 timestampMs,
+ *   u8 type (0 = key, 1 = delta), payload
+ *
+ * Frames are premultiplied RGBA cut into kBlockSize blocks. A key frame
+ * stores every block, a delta frame only the blocks that differ from the
+ * previous frame, so a stroke costs about the area it changed. Payload:
+ * u32 blockCount, then per block u16 bx, u16 by, u32 bytes and the block's
+ * pixels (row-major, edge blocks cropped) coded with rle::encodePixels().
+ *
+ * A frame is written with one write and flushed. A frame cut short at the
+ * end of the file (crash mid-write) is ignored by TimelapseReader and cut
+ * off when a writer reopens the file.
+ */
+class TimelapseWriter {
+public:
+    static constexpr int kBlockSize = 64;
+    static constexpr uint32_t kKeyFrameInterval = 240;   // Frames between key frames (seek cost)
+
+    TimelapseWriter() = default;
+    TimelapseWriter(const TimelapseWriter&) = delete;
+    TimelapseWriter& operator=(const TimelapseWriter&) = delete;
+
+    // Create `path`, or continue it if it already holds frames of this
+    // size (the next frame is then a key frame). False on I/O error or a
+    // size mismatch.
+    bool open(const std::string& path, int width, int height);
+    void close();
+    bool isOpen() const { return m_file.is_open(); }
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    uint32_t frameCount() const { return m_frameCount; }
+
+    // Append a width x height frame, `stride` bytes per row
+    bool append(const uint8_t* pixels, size_t stride, uint64_t timestampMs);
+
+private:
+    std::ofstream m_file;
+    int m_width = 0;
+    int m_height = 0;
+    uint32_t m_frameCount = 0;
+    uint32_t m_sinceKeyFrame = 0;
+    bool m_hasPrevious = false;
+    std::vector<uint8_t> m_previous;   // Last frame written, packed rows
+};
+
+/**
+ * TimelapseReader - Random access to the frames of a container
+ *
+ * open() only indexes the frame headers; pixels are read and decoded on
+ * demand. Reading frames in order applies one delta per frame; any other
+ * frame decodes forward from the key frame before it. One reader is not
+ * thread safe, but any number can read the same file (e.g. one per key
+ * frame range to decode in parallel).
+ */
+class TimelapseReader {
+public:
+    // `offset`/`size` select the container inside a larger file, e.g. an
+    // uncompressed member of a project archive
+    bool open(const std::string& path, uint64_t offset = 0, uint64_t size = UINT64_MAX);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    size_t frameCount() const { return m_frames.size(); }
+    uint64_t timestampMs(size_t index) const { return m_frames[index].timestampMs; }
+    bool isKeyFrame(size_t index) const { return m_frames[index].keyFrame; }
+
+    // Key frame at or before `index`: where a decoder for `index` starts
+    size_t keyFrameBefore(size_t index) const;
+
+    // Decode frame `index` into `out` (premultiplied RGBA, `stride` bytes
+    // per row). False on a read or decode error.
+    bool readFrame(size_t index, uint8_t* out, size_t stride);
+
+private:
+    struct Frame {
+        uint64_t offset = 0;    // Of the payload in the file
+        uint32_t bytes = 0;
+        uint64_t timestampMs = 0;
+        bool keyFrame = false;
+    };
+
+    std::ifstream m_file;
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<Frame> m_frames;
+    std::vector<uint8_t> m_frame;     // Decoded m_current
+    std::vector<uint8_t> m_payload;
+    size_t m_current = SIZE_MAX;      // Frame held by m_frame
+
+    bool applyFrame(size_t index);
+};
+
+/**
+ * TimelapseRecorder - Off-thread timelapse capture
+ *
+ * capture() only copies tile handles of the visible, non-private layers
+ * (zero-copy snapshots, see ImageBuffer::tileHandle()), so it costs the
+ * same on any canvas size. A worker then recomposites the tiles that
+ * changed since the last frame into a retained composite, box-filters
+ * that area down to the frame size and appends the frame to a
+ * TimelapseWriter. Captures arriving while one is still queued replace it:
+ * under load the recorder keeps the latest state instead of falling
+ * behind.
+ *
+ * Holding the previous snapshot means a layer tile written after a
+ * capture is copied once before the write, as with undo snapshots.
+ */
+class TimelapseRecorder {
+public:
+    static constexpr int kDefaultMaxSize = 1920;   // Long side of frames, px
+
+    TimelapseRecorder(int canvasWidth, int canvasHeight, int maxSize = kDefaultMaxSize);
+    ~TimelapseRecorder();   // Writes the frames still queued
+
+    TimelapseRecorder(const TimelapseRecorder&) = delete;
+    TimelapseRecorder& operator=(const TimelapseRecorder&) = delete;
+
+    // Frames go to `path` (see TimelapseWriter::open()); nothing is
+    // recorded until a file is open
+    bool open(const std::string& path);
+
+    int frameWidth() const { return m_frameWidth; }
+    int frameHeight() const { return m_frameHeight; }
+    uint32_t frameCount() const { return m_frameCount.load(); }
+
+    // Queue a frame of the current layer state. Call with the layers
+    // locked against painting; returns without waiting for the frame.
+    void capture(const LayerManager& layers);
+
+    // Block until every captured frame is written
+    void flush();
+
+private:
+    struct LayerSnapshot {
+        int id = 0;
+        float opacity = 1.0f;
+        BlendMode blendMode = BlendMode::Normal;
+        ImageBuffer::TileSnapshot buffer;   // Pending rows are decoded by the worker
+    };
+    struct Snapshot {
+        std::vector<LayerSnapshot> layers;
+        uint64_t timestampMs = 0;
+    };
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    int m_frameWidth;
+    int m_frameHeight;
+    std::chrono::steady_clock::time_point m_start;
+
+    mutable std::mutex m_mutex;
+    std::unique_ptr<Snapshot> m_pending;   // Latest capture not yet taken by the worker
+
+    // Worker state
+    TimelapseWriter m_writer;
+    std::unique_ptr<Snapshot> m_previous;  // Snapshot of the last frame
+    ImageBuffer m_composite;               // Full resolution, tiled
+    std::vector<uint8_t> m_frame;          // Frame size, packed rows
+    std::atomic<uint32_t> m_frameCount{0};
+
+    BackgroundWorker m_worker;             // Last: joined before the state above goes away
+
+    void processPending();
+    void compositeTile(const Snapshot& snapshot, int tx, int ty);
+    void downscale(const DirtyRect& area);
+};
+
+} // namespace artflow
@@ -0,0 +1,61 @@
+/**
+ * ArtFlow Studio - Timelapse Export
+ * Streams timelapse frames from a project into a video encoder process
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace artflow {
+
+struct TimelapseExportOptions {
+    enum class Aspect {
+        Original,
+        Square,     // 1:1
+        Portrait    // 9:16
+    };
+
+    Aspect aspect = Aspect::Original;
+    bool letterbox = false;          // Fit the whole frame with bars instead of cropping to the aspect
+    int maxSize = 0;                 // Cap on the long side of the video, px (0 = frame size)
+    double durationSec = 0.0;        // Target length without the hold; 0 picks a rate from the frame count
+    double holdSec = 2.0;            // Last frame shown this long at the end
+    uint32_t background = 0xFFFFFFFF;   // Under transparent pixels and in the bars, 0xRRGGBBAA (alpha ignored)
+    std::string encoder = "ffmpeg";  // Executable, found on PATH unless a path is given
+    int crf = 18;                    // libx264 quality (lower is better)
+};
+
+// Called between batches of frames handed to the encoder; return false to cancel
+using TimelapseExportProgress = std::function<bool(int framesWritten, int framesTotal)>;
+
+/**
+ * Export the timelapse of `source` as an H.264 video at `output`.
+ *
+ * `source` is a project archive (.aflow), a project folder, or a bare
+ * timelapse container (.aftl). Projects are searched for .aftl
+ * containers under `timelapse/`, which play in name order, or else the
+ * legacy JPEG frames there.
+ *
+ * Frames are streamed, never extracted: a fixed number of them is in
+ * flight whatever the length, and nothing is written but `output`.
+ * Containers are decoded by ThreadPool::shared() (one reader per task, see
+ * TimelapseReader) and cropped/letterboxed to the output size with the
+ * transform and blend kernels, and the finished frames go to a pipe into
+ * `options.encoder` on a worker thread while the next batch is prepared.
+ * JPEG frames are passed to the encoder as they are stored and scaled
+ * there.
+ *
+ * The frame rate follows the Python exporter: with a duration, the rate
+ * that fits every frame (at least 10 fps, frames skipped above 60 fps);
+ * otherwise 10 to 30 fps by frame count. Blocks until the encoder has
+ * finished. On failure or cancel `output` is removed, and `error` (if
+ * given) says why.
+ */
+bool exportTimelapse(const std::string& source, const std::string& output,
+                     const TimelapseExportOptions& options = {},
+                     const TimelapseExportProgress& progress = nullptr, std::string* error = nullptr);
+
+} // namespace artflow
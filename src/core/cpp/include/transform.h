@@ -0,0 +1,123 @@
+/**
+ * ArtFlow Studio - Transform
+ * Affine resampling of layer content (move, scale, rotate)
+ */
+
+#pragma once
+
+#include "image_buffer.h"
+#include "selection_mask.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace artflow {
+
+enum class Resampling {
+    Bilinear,   // 2x2 taps; previews
+    Bicubic,    // 4x4 Catmull-Rom
+    Lanczos3    // 6x6, sharpest
+};
+
+/**
+ * Affine - 2D affine map with QTransform's layout:
+ *   x' = m11 x + m21 y + dx
+ *   y' = m12 x + m22 y + dy
+ */
+struct Affine {
+    double m11 = 1.0, m12 = 0.0;
+    double m21 = 0.0, m22 = 1.0;
+    double dx = 0.0, dy = 0.0;
+
+    static Affine translation(double x, double y) { return {1.0, 0.0, 0.0, 1.0, x, y}; }
+    static Affine scaling(double sx, double sy) { return {sx, 0.0, 0.0, sy, 0.0, 0.0}; }
+    static Affine rotation(double degrees);
+
+    // This map followed by `next`
+    Affine then(const Affine& next) const;
+
+    double determinant() const { return m11 * m22 - m12 * m21; }
+    bool isInvertible() const;
+    Affine inverted() const;   // Identity if not invertible
+
+    void map(double x, double y, double* outX, double* outY) const {
+        *outX = m11 * x + m21 * y + dx;
+        *outY = m12 * x + m22 * y + dy;
+    }
+
+    // Bounding box of the mapped rectangle, rounded out to whole pixels
+    DirtyRect mapRect(const DirtyRect& rect) const;
+};
+
+/**
+ * TransformSource - Snapshot of the pixels being transformed
+ *
+ * Holds a region of an image (premultiplied, linear) together with
+ * box-filtered half-size levels built on first use. Shrinking reads from
+ * the level closest to the output scale, so the resampling kernel keeps a
+ * small footprint however far the content is scaled down (and a preview
+ * proxy reads a small level).
+ *
+ * One source serves any number of transformImage() calls, including
+ * concurrent ones (e.g. a preview on the UI thread while the final pass
+ * runs on a worker).
+ */
+class TransformSource {
+public:
+    // `rect` of `image` (clipped to it). With a selection the pixels are
+    // scaled by its value, so only the selected part is transformed.
+    TransformSource(const ImageBuffer& image, const DirtyRect& rect, const SelectionMask* selection = nullptr);
+
+    // Caller memory, 4 bytes per premultiplied pixel, `stride` bytes per
+    // row; positioned at (0, 0)
+    TransformSource(const uint8_t* pixels, int width, int height, size_t stride);
+
+    // Where the snapshot sits in source coordinates
+    const DirtyRect& rect() const { return m_rect; }
+    bool isEmpty() const { return m_rect.isEmpty(); }
+
+    struct Level {
+        int width = 0;
+        int height = 0;
+        std::vector<uint8_t> pixels;   // width * 4 bytes per row
+    };
+
+    // Level `index` (0 = full resolution, each next one half the size);
+    // clamped to the smallest level there is
+    const Level& level(int index) const;
+    int maxLevel() const;
+
+private:
+    DirtyRect m_rect;
+    mutable std::mutex m_mutex;
+    mutable std::vector<std::unique_ptr<Level>> m_levels;
+};
+
+/**
+ * Resample `source` through `matrix` (source coordinates -> target
+ * coordinates) into `target`, one task per band of tile rows on
+ * ThreadPool::shared().
+ *
+ * Pixels are filtered premultiplied, with the kernel widened when
+ * shrinking; outside the source counts as transparent, so edges come out
+ * antialiased. Samples are stored, not blended: the covered area of
+ * `target` should be transparent (e.g. a new buffer, then composite()).
+ * Transparent samples are skipped, so empty tiles stay unallocated.
+ * Returns the bounds written.
+ */
+DirtyRect transformImage(const TransformSource& source, const Affine& matrix, ImageBuffer& target,
+                         Resampling quality = Resampling::Bicubic);
+
+// Same into caller memory (4 bytes per pixel, `stride` bytes per row)
+DirtyRect transformImage(const TransformSource& source, const Affine& matrix,
+                         uint8_t* pixels, int width, int height, size_t stride,
+                         Resampling quality = Resampling::Bicubic);
+
+// Remove from `image` what a TransformSource built with the same arguments
+// took from it: `rect` becomes transparent, or with a selection each pixel
+// fades by its selection value
+void eraseRegion(ImageBuffer& image, const DirtyRect& rect, const SelectionMask* selection = nullptr);
+
+} // namespace artflow
@@ -0,0 +1,120 @@
+/**
+ * ArtFlow Studio - Undo Stack
+ * Stroke history for LayerManager layers with compressed tile deltas
+ */
+
+#pragma once
+
+#include "image_buffer.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace artflow {
+
+class BackgroundWorker;
+class LayerManager;
+
+/**
+ * UndoStack - Per-stroke undo/redo for tiled layer buffers
+ *
+ * beginStroke() keeps handles to the layer's tiles (no pixels are copied).
+ * Copy-on-write makes every tile the stroke writes detach from its handle,
+ * so endStroke() finds the dirty tiles by comparing handles, and the old
+ * handles are the before-images. A worker thread then RLE-compresses them.
+ * Rows of a lazily loaded layer that are still pending are left alone;
+ * if the stroke loaded one, endStroke() decodes it again and compares
+ * pixels instead.
+ *
+ * Undo and redo decode on the worker as well: undo()/redo() return at once
+ * and the `ready` callback receives a Patch from the worker thread. The
+ * caller hands the patch back to its UI thread and installs it with
+ * apply(), which only swaps tile pointers. A step requested while another
+ * is still in flight is ignored. Recording a stroke while a step is in
+ * flight cancels the step: its entry goes back where it was and the patch
+ * no longer applies, so the stroke's before-image is the layer as it is.
+ * Callers that want the step to happen first wait for it and apply it
+ * before beginStroke().
+ *
+ * Memory is capped: the oldest steps are dropped once compressed history
+ * exceeds the limit.
+ */
+class UndoStack {
+public:
+    static constexpr size_t kDefaultMemoryLimit = size_t(256) * 1024 * 1024;
+
+    struct Patch;
+    using PatchCallback = std::function<void(std::shared_ptr<Patch>)>;
+
+    explicit UndoStack(size_t memoryLimit = kDefaultMemoryLimit);
+    ~UndoStack();
+
+    UndoStack(const UndoStack&) = delete;
+    UndoStack& operator=(const UndoStack&) = delete;
+
+    // Memory cap (bytes of stored tiles, compressed or not)
+    void setMemoryLimit(size_t bytes);
+    size_t memoryLimit() const;
+    size_t memoryUsage() const;
+
+    // Stroke recording (UI thread). `logPosition` tags the step with where
+    // an outside record of the edits stood when it began, e.g.
+    // StrokeLog::strokeCount(); see redoLogPosition().
+    void beginStroke(int layerId, const ImageBuffer& buffer, size_t logPosition = 0);
+    void endStroke(const ImageBuffer& buffer);
+    void cancelStroke();
+    bool isRecording() const { return m_recording; }
+    int strokeLayerId() const { return m_strokeLayerId; }
+
+    // Request a step. Returns false if there is nothing to do or a step is
+    // already in flight.
+    bool undo(PatchCallback ready);
+    bool redo(PatchCallback ready);
+
+    // Install a patch (UI thread). Returns the id of the modified layer, or
+    // -1 if the layer no longer exists.
+    int apply(const std::shared_ptr<Patch>& patch, LayerManager& layers);
+
+    bool canUndo() const;
+    bool canRedo() const;
+
+    // logPosition of the earliest step that can be redone; SIZE_MAX if
+    // none. Recording a step drops every redo step, so the record should
+    // drop what it holds from there on (StrokeLog::truncate()).
+    size_t redoLogPosition() const;
+    bool isBusy() const;
+    void clear();
+
+    // Block until queued compression/decoding has finished
+    void waitIdle();
+
+private:
+    struct Entry;
+
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<Entry>> m_undoStack;
+    std::vector<std::shared_ptr<Entry>> m_redoStack;
+    size_t m_memoryLimit;
+    bool m_inFlight = false;
+    bool m_inFlightUndo = false;
+    std::shared_ptr<Entry> m_inFlightEntry;
+    unsigned m_generation = 0;  // Bumped to invalidate pending patches
+
+    // Stroke being recorded
+    bool m_recording = false;
+    int m_strokeLayerId = -1;
+    size_t m_strokeLogPosition = 0;
+    ImageBuffer::TileSnapshot m_strokeBase;
+
+    std::unique_ptr<BackgroundWorker> m_worker;
+
+    bool requestStep(bool isUndo, PatchCallback ready);
+    void cancelStepLocked();
+    void compress(const std::shared_ptr<Entry>& entry);
+    size_t usageLocked() const;
+    void enforceLimitLocked();
+};
+
+} // namespace artflow
@@ -0,0 +1,120 @@
+/**
+ * ArtFlow Studio - Zip Archive
+ * Reading and writing .aflow project archives (stored and deflated entries)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace artflow {
+
+/**
+ * ZipReader - Reads the members of a zip archive
+ *
+ * open() parses only the central directory (zip64 included); members are
+ * read on demand, one at a time, so walking thousands of timelapse frames
+ * holds one of them in memory. A stored member can also be used in place
+ * through dataOffset() (e.g. a timelapse container read by offset).
+ *
+ * One reader is not thread safe; open one per thread.
+ */
+class ZipReader {
+public:
+    static constexpr uint16_t kStored = 0;
+    static constexpr uint16_t kDeflated = 8;
+
+    struct Entry {
+        std::string name;
+        uint16_t method = kStored;
+        uint16_t flags = 0;
+        uint32_t crc = 0;
+        uint64_t compressedSize = 0;
+        uint64_t size = 0;
+        uint64_t headerOffset = 0;   // Of the local file header
+    };
+
+    ZipReader() = default;
+    ZipReader(const ZipReader&) = delete;
+    ZipReader& operator=(const ZipReader&) = delete;
+
+    // False if `path` is not a readable zip archive, or its directory puts
+    // member data outside the file
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return m_file.is_open(); }
+
+    const std::string& path() const { return m_path; }
+    const std::vector<Entry>& entries() const { return m_entries; }
+    const Entry* find(const std::string& name) const;
+
+    // Where the member's (possibly compressed) bytes start in the file
+    bool dataOffset(const Entry& entry, uint64_t* offset);
+
+    // The member's uncompressed bytes, CRC checked. False on an I/O error,
+    // corrupt data or an unsupported method (only stored and deflate).
+    // Memory follows the data read, not the sizes the archive declares.
+    bool read(const Entry& entry, std::vector<uint8_t>& out);
+
+    // True if `path` starts like a zip archive
+    static bool isZipFile(const std::string& path);
+
+private:
+    std::ifstream m_file;
+    std::string m_path;
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, size_t> m_index;   // Name -> m_entries
+    std::vector<uint8_t> m_compressed;                  // Scratch for read()
+    uint64_t m_dataEnd = 0;                             // Member data ends here (the directory)
+
+    bool readAt(uint64_t offset, void* out, size_t bytes);
+    bool readDirectory(uint64_t fileSize);
+};
+
+/**
+ * ZipWriter - Writes a zip archive one member at a time
+ *
+ * Each member goes out whole with its sizes and CRC in the local header
+ * (no data descriptors), so a stored member can be read in place by
+ * offset; the central directory is written by close(). Zip64 records are
+ * added for members and offsets past 4 GiB. Names are flagged UTF-8.
+ */
+class ZipWriter {
+public:
+    ZipWriter() = default;
+    ~ZipWriter();   // close()s an archive still open
+    ZipWriter(const ZipWriter&) = delete;
+    ZipWriter& operator=(const ZipWriter&) = delete;
+
+    // Create (or truncate) `path`
+    bool open(const std::string& path);
+    bool isOpen() const { return m_file.is_open(); }
+
+    // Add a member from memory, deflated if `compress`
+    bool add(const std::string& name, const void* data, size_t size, bool compress = false);
+
+    // Add the file at `path` as a stored member, streamed in chunks. A file
+    // that grows meanwhile is cut at the size it had when the copy began.
+    bool addFile(const std::string& name, const std::string& path);
+
+    // Write the central directory and close; false if any write failed
+    bool close();
+
+private:
+    std::ofstream m_file;
+    uint64_t m_offset = 0;        // Bytes written so far
+    bool m_ok = true;
+    uint16_t m_dosTime = 0;
+    uint16_t m_dosDate = 0;
+    std::vector<ZipReader::Entry> m_entries;
+
+    bool write(const void* data, size_t bytes);
+    bool writeLocalHeader(const ZipReader::Entry& entry);
+};
+
+} // namespace artflow
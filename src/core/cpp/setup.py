@@ -1,6 +1,7 @@
 from setuptools import setup, Extension
 import sys
 import os
+import platform
 
 # Intenta localizar pybind11
 try:
@@ -24,10 +25,47 @@ sources = [
     os.path.join(cpp_src_dir, "gl_utils.cpp"),
     os.path.join(cpp_src_dir, "layer_manager.cpp"),
     os.path.join(cpp_src_dir, "image_buffer.cpp"),
+    os.path.join(cpp_src_dir, "channel_buffer.cpp"),
+    os.path.join(cpp_src_dir, "rle_codec.cpp"),
+    os.path.join(cpp_src_dir, "background_worker.cpp"),
+    os.path.join(cpp_src_dir, "undo_stack.cpp"),
+    os.path.join(cpp_src_dir, "dab_mask.cpp"),
+    os.path.join(cpp_src_dir, "paint_thread.cpp"),
+    os.path.join(cpp_src_dir, "thread_pool.cpp"),
+    os.path.join(cpp_src_dir, "stroke_log.cpp"),
+    os.path.join(cpp_src_dir, "flood_fill.cpp"),
+    os.path.join(cpp_src_dir, "selection_mask.cpp"),
+    os.path.join(cpp_src_dir, "timelapse.cpp"),
+    os.path.join(cpp_src_dir, "zip_archive.cpp"),
+    os.path.join(cpp_src_dir, "timelapse_export.cpp"),
+    os.path.join(cpp_src_dir, "png_codec.cpp"),
+    os.path.join(cpp_src_dir, "project_file.cpp"),
+    os.path.join(cpp_src_dir, "autosave.cpp"),
+    os.path.join(cpp_src_dir, "tile_store.cpp"),
     os.path.join(cpp_src_dir, "color_utils.cpp"),
     os.path.join(canvas_dir, "renderer.cpp"),
 ]
 
+# Blend kernels and transform taps use SSE4.1 on x86 (GCC/Clang need the flag
+# to expose it). As in the CMake build only they get it, built as a static
+# library of their own, so the compiler cannot put SSE4.1 code in the rest
+# of the module.
+simd_sources = [
+    os.path.join(cpp_src_dir, "blend_kernels.cpp"),
+    os.path.join(cpp_src_dir, "transform.cpp"),
+]
+std_args = ["/std:c++17", "/DNOMINMAX"] if sys.platform == "win32" else ["-std=c++17"]
+simd_args = [] if sys.platform == "win32" or platform.machine().lower() not in ("x86_64", "amd64", "i686") else ["-msse4.1"]
+
+simd_library = (
+    "artflow_simd",
+    {
+        "sources": simd_sources,
+        "include_dirs": [cpp_include_dir],
+        "cflags": std_args + simd_args,
+    },
+)
+
 # Verificar que los archivos existen (filtro preventivo)
 existing_sources = [f for f in sources if os.path.exists(f)]
 
@@ -41,8 +79,8 @@ ext_modules = [
             pybind_include,
         ],
         language="c++",
-        extra_compile_args=["/std:c++17", "/DNOMINMAX"] if sys.platform == "win32" else ["-std=c++17"],
-        libraries=["user32", "gdi32", "opengl32"] if sys.platform == "win32" else ["GL"],
+        extra_compile_args=std_args,
+        libraries=["user32", "gdi32", "opengl32", "zlib"] if sys.platform == "win32" else ["GL", "pthread", "z"],
     ),
 ]
 
@@ -51,6 +89,7 @@ setup(
     version="1.0.0",
     author="Antigravity",
     description="Native C++ Engine for ArtFlow Watercolor Physics",
+    libraries=[simd_library],
     ext_modules=ext_modules,
     zip_safe=False,
 )
@@ -0,0 +1,726 @@
+/**
+ * ArtFlow Studio - Autosave Implementation
+ */
+
+#include "autosave.h"
+#include "layer_manager.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <zlib.h>
+
+namespace artflow {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kMagic[4] = {'A', 'F', 'J', 'L'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderBytes = 20;          // Magic, version, width, height, stamp size
+constexpr size_t kRecordHeaderBytes = 12;    // Type, payload size, CRC
+constexpr uint32_t kStackRecord = 1;
+constexpr uint32_t kTilesRecord = 2;
+constexpr uint32_t kCommitRecord = 3;
+constexpr uint32_t kMaxStampBytes = 4096;
+constexpr uint32_t kMaxRecordBytes = 1u << 30;
+constexpr uint64_t kCompactMinBytes = 8ull << 20;   // Smaller journals are left alone
+constexpr size_t kTileBytes = ImageBuffer::kTileBytes;
+
+// Layer flags in a Stack record
+constexpr uint8_t kVisible = 1 << 0;
+constexpr uint8_t kExpanded = 1 << 1;
+constexpr uint8_t kLocked = 1 << 2;
+constexpr uint8_t kAlphaLock = 1 << 3;
+constexpr uint8_t kClipped = 1 << 4;
+constexpr uint8_t kPrivate = 1 << 5;
+
+bool fail(std::string* error, const std::string& message) {
+    if (error) *error = message;
+    return false;
+}
+
+void putFixed(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void setFixed(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint64_t getFixed(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return value;
+}
+
+void putString(std::vector<uint8_t>& out, const std::string& text) {
+    putFixed(out, text.size(), 4);
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+// Bounds-checked reads from a record payload; `ok` turns false past the end
+struct PayloadReader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    bool has(size_t bytes) {
+        ok = ok && bytes <= size - pos;
+        return ok;
+    }
+    uint64_t fixed(int bytes) {
+        if (!has(static_cast<size_t>(bytes))) return 0;
+        const uint64_t value = getFixed(data + pos, bytes);
+        pos += static_cast<size_t>(bytes);
+        return value;
+    }
+    std::string string() {
+        const size_t bytes = static_cast<size_t>(fixed(4));
+        if (!has(bytes)) return std::string();
+        std::string text(reinterpret_cast<const char*>(data + pos), bytes);
+        pos += bytes;
+        return text;
+    }
+};
+
+uint32_t payloadCrc(const std::vector<uint8_t>& payload) {
+    return static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0), payload.data(), static_cast<uInt>(payload.size())));
+}
+
+std::vector<uint8_t> fileHeader(int width, int height, const std::string& stamp) {
+    std::vector<uint8_t> header(kMagic, kMagic + 4);
+    putFixed(header, kVersion, 4);
+    putFixed(header, static_cast<uint32_t>(width), 4);
+    putFixed(header, static_cast<uint32_t>(height), 4);
+    putFixed(header, stamp.size(), 4);
+    header.insert(header.end(), stamp.begin(), stamp.end());
+    return header;
+}
+
+bool sameLayer(const ProjectLayer& a, const ProjectLayer& b) {
+    return a.name == b.name && a.type == b.type && a.visible == b.visible && a.opacity == b.opacity &&
+           a.blendMode == b.blendMode && a.depth == b.depth && a.expanded == b.expanded && a.locked == b.locked &&
+           a.alphaLock == b.alphaLock && a.clipped == b.clipped && a.isPrivate == b.isPrivate;
+}
+
+void putLayer(std::vector<uint8_t>& out, const ProjectLayer& meta) {
+    putString(out, meta.name);
+    putString(out, meta.type);
+    putString(out, meta.blendMode);
+    uint32_t opacity;
+    std::memcpy(&opacity, &meta.opacity, sizeof(opacity));
+    putFixed(out, opacity, 4);
+    putFixed(out, static_cast<uint32_t>(meta.depth), 4);
+    putFixed(out, (meta.visible ? kVisible : 0) | (meta.expanded ? kExpanded : 0) | (meta.locked ? kLocked : 0) |
+                  (meta.alphaLock ? kAlphaLock : 0) | (meta.clipped ? kClipped : 0) | (meta.isPrivate ? kPrivate : 0), 1);
+}
+
+ProjectLayer readLayer(PayloadReader& in) {
+    ProjectLayer meta;
+    meta.name = in.string();
+    meta.type = in.string();
+    meta.blendMode = in.string();
+    const uint32_t opacity = static_cast<uint32_t>(in.fixed(4));
+    std::memcpy(&meta.opacity, &opacity, sizeof(opacity));
+    meta.depth = static_cast<int32_t>(in.fixed(4));
+    const uint8_t flags = static_cast<uint8_t>(in.fixed(1));
+    meta.visible = flags & kVisible;
+    meta.expanded = flags & kExpanded;
+    meta.locked = flags & kLocked;
+    meta.alphaLock = flags & kAlphaLock;
+    meta.clipped = flags & kClipped;
+    meta.isPrivate = flags & kPrivate;
+    return meta;
+}
+
+} // anonymous namespace
+
+// Payload of a Tiles record being built: i32 key, u32 count, then per tile
+// u32 index, u32 bytes and the data
+class AutosaveJournal::TilesPayload {
+public:
+    explicit TilesPayload(int key) {
+        putFixed(m_bytes, static_cast<uint32_t>(key), 4);
+        putFixed(m_bytes, 0, 4);
+    }
+
+    // Room for up to `maxBytes` of tile `index`; commit() the size used
+    uint8_t* add(uint32_t index, size_t maxBytes) {
+        putFixed(m_bytes, index, 4);
+        m_sizeAt = m_bytes.size();
+        putFixed(m_bytes, 0, 4);
+        m_dataAt = m_bytes.size();
+        m_bytes.resize(m_dataAt + maxBytes);
+        return m_bytes.data() + m_dataAt;
+    }
+    void commit(uint32_t index, size_t bytes) {
+        m_bytes.resize(m_dataAt + bytes);
+        setFixed(m_bytes.data() + m_sizeAt, bytes, 4);
+        m_tiles.push_back({index, m_dataAt, static_cast<uint32_t>(bytes)});
+        setFixed(m_bytes.data() + 4, m_tiles.size(), 4);
+    }
+
+    struct Tile {
+        uint32_t index;
+        size_t offset;   // Of the data in the payload
+        uint32_t bytes;
+    };
+    const std::vector<uint8_t>& bytes() const { return m_bytes; }
+    const std::vector<Tile>& tiles() const { return m_tiles; }
+
+private:
+    std::vector<uint8_t> m_bytes;
+    std::vector<Tile> m_tiles;
+    size_t m_sizeAt = 0;
+    size_t m_dataAt = 0;
+};
+
+std::string autosaveJournalPath(const std::string& projectPath) {
+    std::string path = projectPath;
+    while (path.size() > 1 && (path.back() == '/' || path.back() == '\\')) path.pop_back();
+    return path + ".journal";
+}
+
+// ============================================================================
+// Recording (UI thread)
+// ============================================================================
+
+AutosaveJournal::AutosaveJournal() = default;
+
+AutosaveJournal::~AutosaveJournal() {
+    postQueued();
+    m_worker.waitIdle();
+}
+
+AutosaveJournal::TrackedLayer AutosaveJournal::track(const LayerManager& layers, int index, int origin) const {
+    const Layer& layer = *layers.getLayer(index);
+    const ImageBuffer& buffer = *layer.buffer;
+
+    TrackedLayer tracked;
+    tracked.entry.key = layer.id;
+    tracked.entry.origin = origin;
+    tracked.entry.meta = projectLayer(layers, index);
+    // Pending rows are left so: their tiles are the saved ones until
+    // something loads them
+    ImageBuffer::TileSnapshot snapshot = buffer.tileSnapshot();
+    tracked.tiles = std::move(snapshot.tiles);
+    tracked.pendingRows = std::move(snapshot.pendingRows);
+    tracked.pendingRows.resize(static_cast<size_t>(buffer.tileCountY()));
+    tracked.loader = std::move(snapshot.loader);
+    return tracked;
+}
+
+void AutosaveJournal::start(const std::string& projectPath, const std::string& savedStamp, const LayerManager& layers,
+                            const std::vector<AutosaveLayerState>& recovered) {
+    postQueued();
+    m_journalPath = autosaveJournalPath(projectPath);
+    m_width = layers.width();
+    m_height = layers.height();
+    m_layers.clear();
+
+    // The new journal starts out with what an earlier one recovered, so a
+    // second crash before the next save does not lose it
+    auto batch = std::make_shared<Batch>();
+    for (int i = 0; i < layers.getLayerCount(); ++i) {
+        const bool wasRecovered = static_cast<size_t>(i) < recovered.size();
+        TrackedLayer tracked = track(layers, i, wasRecovered ? recovered[i].origin : i);
+        batch->stack.push_back(tracked.entry);
+        if (wasRecovered) {
+            const int tilesX = layers.getLayer(i)->buffer->tileCountX();
+            for (uint32_t index : recovered[i].changedTiles) {
+                if (index >= tracked.tiles.size() || tracked.pendingRows[index / tilesX]) continue;
+                batch->tiles.push_back({tracked.entry.key, index, tracked.tiles[index]});
+            }
+        }
+        m_layers.push_back(std::move(tracked));
+    }
+
+    std::vector<uint8_t> header = fileHeader(m_width, m_height, savedStamp);
+    m_worker.post([this, path = m_journalPath, header, batch]() { begin(path, header, *batch); });
+}
+
+void AutosaveJournal::stop(bool discard) {
+    postQueued();
+    m_journalPath.clear();
+    m_layers.clear();
+    m_worker.post([this, discard]() { close(discard); });
+}
+
+void AutosaveJournal::flush() {
+    postQueued();
+    m_worker.waitIdle();
+}
+
+void AutosaveJournal::checkpoint(const LayerManager& layers) {
+    if (!isActive() || layers.width() != m_width || layers.height() != m_height) return;
+
+    auto batch = std::make_shared<Batch>();
+    std::vector<TrackedLayer> next;
+    next.reserve(static_cast<size_t>(layers.getLayerCount()));
+    bool stackChanged = static_cast<size_t>(layers.getLayerCount()) != m_layers.size();
+
+    for (int i = 0; i < layers.getLayerCount(); ++i) {
+        const Layer& layer = *layers.getLayer(i);
+        const ImageBuffer& buffer = *layer.buffer;
+        const size_t tileCount = static_cast<size_t>(buffer.tileCountX()) * buffer.tileCountY();
+
+        auto known = std::find_if(m_layers.begin(), m_layers.end(),
+                                  [&](const TrackedLayer& tracked) { return tracked.entry.key == layer.id; });
+        if (known != m_layers.end()) {
+            stackChanged |= known - m_layers.begin() != i;
+            next.push_back(std::move(*known));
+        } else {
+            // A new layer starts out empty; everything on it is a change
+            TrackedLayer added;
+            added.entry.key = layer.id;
+            added.tiles.resize(tileCount);
+            added.pendingRows.resize(static_cast<size_t>(buffer.tileCountY()));
+            next.push_back(std::move(added));
+            stackChanged = true;
+        }
+        TrackedLayer& tracked = next.back();
+
+        ProjectLayer meta = projectLayer(layers, i);
+        if (!sameLayer(meta, tracked.entry.meta)) {
+            tracked.entry.meta = std::move(meta);
+            stackChanged = true;
+        }
+        if (tracked.tiles.size() != tileCount) continue;
+
+        // A row loaded since it was tracked holds new handles: only tiles
+        // that differ from what the loader makes of the saved row are changes
+        std::vector<ImageBuffer::TileHandle> saved;
+        for (int ty = 0; ty < buffer.tileCountY(); ++ty) {
+            if (buffer.isTileRowPending(ty)) continue;
+            const bool wasPending = tracked.pendingRows[ty];
+            tracked.pendingRows[ty] = false;
+            if (wasPending) {
+                saved.assign(static_cast<size_t>(buffer.tileCountX()), nullptr);
+                if (tracked.loader) tracked.loader->loadTileRow(ty, saved.data());
+            }
+            for (int tx = 0; tx < buffer.tileCountX(); ++tx) {
+                const size_t index = static_cast<size_t>(ty) * buffer.tileCountX() + tx;
+                ImageBuffer::TileHandle tile = buffer.tileHandle(tx, ty);
+                const bool same = wasPending ? ImageBuffer::samePixels(tile, saved[tx]) : tile == tracked.tiles[index];
+                tracked.tiles[index] = tile;
+                if (same) continue;
+                batch->tiles.push_back({tracked.entry.key, static_cast<uint32_t>(index), std::move(tile)});
+            }
+        }
+        if (std::find(tracked.pendingRows.begin(), tracked.pendingRows.end(), true) == tracked.pendingRows.end()) {
+            tracked.loader.reset();
+        }
+    }
+    m_layers = std::move(next);
+
+    if (stackChanged) {
+        for (const TrackedLayer& tracked : m_layers) batch->stack.push_back(tracked.entry);
+    }
+    if (batch->stack.empty() && batch->tiles.empty()) {
+        // Nothing changed since the last checkpoint: idle time
+        m_worker.post([this]() { compactIfWorthwhile(); });
+        return;
+    }
+    post(std::move(batch));
+}
+
+// Checkpoints the worker has not started on fold into one: the final stack
+// plus every tile (later entries of a tile win on replay)
+void AutosaveJournal::post(std::shared_ptr<Batch> batch) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending) {
+        if (!batch->stack.empty()) m_pending->stack = std::move(batch->stack);
+        m_pending->tiles.insert(m_pending->tiles.end(), std::make_move_iterator(batch->tiles.begin()),
+                                std::make_move_iterator(batch->tiles.end()));
+        return;
+    }
+    m_pending = std::move(batch);
+    m_worker.post([this]() { appendPending(); });
+}
+
+// Queue what is pending as a job of its own, so nothing merges into it
+// after a start() or stop() posted behind it
+void AutosaveJournal::postQueued() {
+    std::shared_ptr<Batch> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        batch = std::move(m_pending);
+    }
+    if (batch) m_worker.post([this, batch]() { append(*batch); });
+}
+
+// ============================================================================
+// Writing (worker)
+// ============================================================================
+
+void AutosaveJournal::begin(const std::string& path, std::vector<uint8_t> header, const Batch& batch) {
+    close(false);
+    m_path = path;
+    m_header = std::move(header);
+
+    // Written aside and renamed over the old journal, which stays
+    // replayable until then
+    const std::string temp = path + ".tmp";
+    m_file.open(temp, std::ios::binary | std::ios::trunc);
+    bool ok = m_file.is_open() && writeHeader() && writeBatch(batch);
+    m_file.close();
+    std::error_code ec;
+    if (ok) fs::rename(fs::path(temp), fs::path(path), ec);
+    if (!ok || ec || !reopen()) {
+        std::cerr << "Autosave: cannot write " << path << std::endl;
+        fs::remove(fs::path(temp), ec);
+        close(false);
+    }
+}
+
+void AutosaveJournal::appendPending() {
+    std::shared_ptr<Batch> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        batch = std::move(m_pending);
+    }
+    if (batch) append(*batch);
+}
+
+void AutosaveJournal::append(const Batch& batch) {
+    if (!m_file.is_open()) return;
+    if (!writeBatch(batch)) {
+        // A torn record is dropped on replay; later appends would follow it
+        std::cerr << "Autosave: cannot write " << m_path << std::endl;
+        m_file.close();
+    }
+}
+
+bool AutosaveJournal::writeHeader() {
+    m_fileBytes = 0;
+    m_liveBytes = 0;
+    m_stack.clear();
+    m_index.clear();
+    m_file.write(reinterpret_cast<const char*>(m_header.data()), static_cast<std::streamsize>(m_header.size()));
+    m_fileBytes = m_header.size();
+    return static_cast<bool>(m_file);
+}
+
+bool AutosaveJournal::writeRecord(uint32_t type, const std::vector<uint8_t>& payload) {
+    uint8_t header[kRecordHeaderBytes];
+    setFixed(header, type, 4);
+    setFixed(header + 4, payload.size(), 4);
+    setFixed(header + 8, payloadCrc(payload), 4);
+    m_file.write(reinterpret_cast<const char*>(header), kRecordHeaderBytes);
+    m_file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    m_fileBytes += kRecordHeaderBytes + payload.size();
+    return static_cast<bool>(m_file);
+}
+
+bool AutosaveJournal::writeStack(const std::vector<StackEntry>& stack) {
+    std::vector<uint8_t> payload;
+    putFixed(payload, stack.size(), 4);
+    for (const StackEntry& entry : stack) {
+        putFixed(payload, static_cast<uint32_t>(entry.key), 4);
+        putFixed(payload, static_cast<uint32_t>(entry.origin), 4);
+        putLayer(payload, entry.meta);
+    }
+    if (!writeRecord(kStackRecord, payload)) return false;
+
+    m_stack = stack;
+    // Tiles of layers no longer in the stack are dead weight
+    for (auto it = m_index.begin(); it != m_index.end();) {
+        const int key = it->first;
+        if (std::any_of(stack.begin(), stack.end(), [key](const StackEntry& entry) { return entry.key == key; })) {
+            ++it;
+            continue;
+        }
+        for (const auto& tile : it->second) m_liveBytes -= tile.second.bytes;
+        it = m_index.erase(it);
+    }
+    return true;
+}
+
+bool AutosaveJournal::writeTiles(int key, const TilesPayload& payload) {
+    const uint64_t payloadOffset = m_fileBytes + kRecordHeaderBytes;
+    if (!writeRecord(kTilesRecord, payload.bytes())) return false;
+
+    std::map<uint32_t, TileEntry>& tiles = m_index[key];
+    for (const TilesPayload::Tile& tile : payload.tiles()) {
+        TileEntry& entry = tiles[tile.index];   // Zero-initialized when new
+        m_liveBytes += tile.bytes;
+        m_liveBytes -= entry.bytes;
+        entry = TileEntry{payloadOffset + tile.offset, tile.bytes};
+    }
+    return true;
+}
+
+bool AutosaveJournal::writeBatch(const Batch& batch) {
+    if (!batch.stack.empty() && !writeStack(batch.stack)) return false;
+
+    // One Tiles record per run of a layer's tiles
+    const uLong bound = compressBound(static_cast<uLong>(kTileBytes));
+    for (size_t begin = 0; begin < batch.tiles.size();) {
+        const int key = batch.tiles[begin].key;
+        size_t end = begin;
+        while (end < batch.tiles.size() && batch.tiles[end].key == key) ++end;
+        const bool live = std::any_of(m_stack.begin(), m_stack.end(),
+                                      [key](const StackEntry& entry) { return entry.key == key; });
+        if (live) {
+            TilesPayload payload(key);
+            for (size_t i = begin; i < end; ++i) {
+                const TileChange& change = batch.tiles[i];
+                uint8_t* out = payload.add(change.index, change.tile ? bound : 0);
+                uLongf bytes = 0;
+                if (change.tile) {
+                    bytes = bound;
+                    if (compress2(out, &bytes, change.tile->data(), static_cast<uLong>(kTileBytes), Z_BEST_SPEED) != Z_OK) {
+                        return false;
+                    }
+                }
+                payload.commit(change.index, bytes);
+            }
+            if (!writeTiles(key, payload)) return false;
+        }
+        begin = end;
+    }
+    if (!writeRecord(kCommitRecord, {})) return false;
+    return static_cast<bool>(m_file.flush());
+}
+
+bool AutosaveJournal::reopen() {
+    m_file.clear();
+    m_file.open(m_path, std::ios::binary | std::ios::app);
+    return m_file.is_open();
+}
+
+// Rewrite the journal with only the tiles replay uses, copying their
+// compressed bytes over
+void AutosaveJournal::compactIfWorthwhile() {
+    if (!m_file.is_open() || m_fileBytes < kCompactMinBytes || m_fileBytes < 2 * m_liveBytes) return;
+
+    m_file.close();
+    std::ifstream source(m_path, std::ios::binary);
+    const std::vector<StackEntry> stack = m_stack;
+    const auto index = m_index;
+    const uint64_t fileBytes = m_fileBytes;
+    const uint64_t liveBytes = m_liveBytes;
+
+    const std::string temp = m_path + ".tmp";
+    m_file.open(temp, std::ios::binary | std::ios::trunc);
+    bool ok = source && m_file.is_open() && writeHeader() && writeStack(stack);
+    for (const StackEntry& entry : stack) {
+        auto tiles = index.find(entry.key);
+        if (!ok || tiles == index.end()) continue;
+        TilesPayload payload(entry.key);
+        for (const auto& tile : tiles->second) {
+            uint8_t* out = payload.add(tile.first, tile.second.bytes);
+            if (tile.second.bytes > 0) {
+                source.seekg(static_cast<std::streamoff>(tile.second.offset));
+                ok = ok && source.read(reinterpret_cast<char*>(out), tile.second.bytes);
+            }
+            payload.commit(tile.first, tile.second.bytes);
+        }
+        ok = ok && writeTiles(entry.key, payload);
+    }
+    ok = ok && writeRecord(kCommitRecord, {}) && m_file.flush();
+    m_file.close();
+    source.close();
+
+    std::error_code ec;
+    if (ok) fs::rename(fs::path(temp), fs::path(m_path), ec);
+    if (!ok || ec) {
+        // Keep appending to the journal as it was
+        fs::remove(fs::path(temp), ec);
+        m_stack = stack;
+        m_index = index;
+        m_fileBytes = fileBytes;
+        m_liveBytes = liveBytes;
+    }
+    if (!reopen()) {
+        std::cerr << "Autosave: cannot write " << m_path << std::endl;
+        close(false);
+    }
+}
+
+void AutosaveJournal::close(bool discard) {
+    m_file.close();
+    m_file.clear();
+    if (discard && !m_path.empty()) {
+        std::error_code ec;
+        fs::remove(fs::path(m_path), ec);
+    }
+    m_path.clear();
+    m_header.clear();
+    m_stack.clear();
+    m_index.clear();
+    m_fileBytes = 0;
+    m_liveBytes = 0;
+}
+
+// ============================================================================
+// Replay
+// ============================================================================
+
+bool replayAutosave(const std::string& projectPath, ProjectInfo& info, std::vector<std::unique_ptr<ImageBuffer>>& layers,
+                    std::vector<AutosaveLayerState>* recovered, std::string* error) {
+    using StackEntry = AutosaveJournal::StackEntry;
+    using TileEntry = AutosaveJournal::TileEntry;
+
+    const std::string path = autosaveJournalPath(projectPath);
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    uint8_t header[kHeaderBytes];
+    if (!in.read(reinterpret_cast<char*>(header), kHeaderBytes) || std::memcmp(header, kMagic, 4) != 0 ||
+        getFixed(header + 4, 4) != kVersion) {
+        return fail(error, "Not an autosave journal: " + path);
+    }
+    const int width = static_cast<int>(getFixed(header + 8, 4));
+    const int height = static_cast<int>(getFixed(header + 12, 4));
+    const uint32_t stampBytes = static_cast<uint32_t>(getFixed(header + 16, 4));
+    std::string stamp(std::min(stampBytes, kMaxStampBytes), '\0');
+    if (stampBytes > kMaxStampBytes || !in.read(&stamp[0], static_cast<std::streamsize>(stampBytes))) {
+        return fail(error, "Not an autosave journal: " + path);
+    }
+    if (stamp != info.created || width != info.width || height != info.height) {
+        return fail(error, "Autosave journal belongs to another save: " + path);
+    }
+
+    const int tilesX = (width + ImageBuffer::kTileSize - 1) / ImageBuffer::kTileSize;
+    const int tilesY = (height + ImageBuffer::kTileSize - 1) / ImageBuffer::kTileSize;
+    const uint32_t tileCount = static_cast<uint32_t>(tilesX) * static_cast<uint32_t>(tilesY);
+
+    // State as of the last Commit, and what the records since change
+    std::vector<StackEntry> stack;
+    bool hasStack = false;
+    std::map<int, std::map<uint32_t, TileEntry>> tiles;
+    std::vector<StackEntry> nextStack;
+    bool stackChanged = false;
+    std::vector<std::pair<int, std::pair<uint32_t, TileEntry>>> nextTiles;
+
+    uint64_t offset = kHeaderBytes + stampBytes;
+    std::vector<uint8_t> payload;
+    for (;;) {
+        uint8_t record[kRecordHeaderBytes];
+        if (!in.read(reinterpret_cast<char*>(record), kRecordHeaderBytes)) break;
+        const uint32_t type = static_cast<uint32_t>(getFixed(record, 4));
+        const uint32_t bytes = static_cast<uint32_t>(getFixed(record + 4, 4));
+        if (bytes > kMaxRecordBytes) break;
+        payload.resize(bytes);
+        if (bytes > 0 && !in.read(reinterpret_cast<char*>(payload.data()), bytes)) break;
+        if (payloadCrc(payload) != getFixed(record + 8, 4)) break;
+        const uint64_t payloadOffset = offset + kRecordHeaderBytes;
+        offset = payloadOffset + bytes;
+
+        PayloadReader reader{payload.data(), payload.size()};
+        if (type == kStackRecord) {
+            nextStack.clear();
+            const uint32_t count = static_cast<uint32_t>(reader.fixed(4));
+            for (uint32_t i = 0; i < count && reader.ok; ++i) {
+                StackEntry entry;
+                entry.key = static_cast<int32_t>(reader.fixed(4));
+                entry.origin = static_cast<int32_t>(reader.fixed(4));
+                entry.meta = readLayer(reader);
+                nextStack.push_back(std::move(entry));
+            }
+            if (!reader.ok) break;
+            stackChanged = true;
+        } else if (type == kTilesRecord) {
+            const int key = static_cast<int32_t>(reader.fixed(4));
+            const uint32_t count = static_cast<uint32_t>(reader.fixed(4));
+            for (uint32_t i = 0; i < count && reader.ok; ++i) {
+                const uint32_t index = static_cast<uint32_t>(reader.fixed(4));
+                const uint32_t tileBytes = static_cast<uint32_t>(reader.fixed(4));
+                if (!reader.has(tileBytes)) break;
+                if (index < tileCount) nextTiles.push_back({key, {index, TileEntry{payloadOffset + reader.pos, tileBytes}}});
+                reader.pos += tileBytes;
+            }
+            if (!reader.ok) break;
+        } else if (type == kCommitRecord) {
+            if (stackChanged) {
+                stack = std::move(nextStack);
+                hasStack = true;
+                stackChanged = false;
+                for (auto it = tiles.begin(); it != tiles.end();) {
+                    const int key = it->first;
+                    const bool live = std::any_of(stack.begin(), stack.end(),
+                                                  [key](const StackEntry& entry) { return entry.key == key; });
+                    it = live ? std::next(it) : tiles.erase(it);
+                }
+            }
+            for (auto& tile : nextTiles) {
+                const int key = tile.first;
+                if (std::any_of(stack.begin(), stack.end(), [key](const StackEntry& entry) { return entry.key == key; })) {
+                    tiles[key][tile.second.first] = tile.second.second;
+                }
+            }
+            nextTiles.clear();
+        } else {
+            break;
+        }
+    }
+    in.close();
+    if (!hasStack) return fail(error, "Autosave journal holds no complete checkpoint: " + path);
+
+    // Each layer starts from its layer of the save (each is used once), or empty
+    std::vector<std::unique_ptr<ImageBuffer>> result;
+    std::vector<bool> taken(layers.size(), false);
+    for (const StackEntry& entry : stack) {
+        const size_t origin = static_cast<size_t>(entry.origin);
+        if (entry.origin >= 0 && origin < layers.size() && layers[origin] && !taken[origin]) {
+            taken[origin] = true;
+            result.push_back(std::move(layers[origin]));
+        } else {
+            result.push_back(std::make_unique<ImageBuffer>(width, height, ImageBuffer::Storage::Tiled));
+        }
+    }
+
+    // Decode the journaled tiles over them, a layer per task
+    std::vector<uint8_t> damaged(stack.size(), 0);   // Not vector<bool>: written concurrently
+    ThreadPool::shared().parallelFor(stack.size(), [&](size_t i) {
+        auto found = tiles.find(stack[i].key);
+        if (found == tiles.end()) return;
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uint8_t> compressed;
+        for (const auto& tile : found->second) {
+            const int tx = static_cast<int>(tile.first % static_cast<uint32_t>(tilesX));
+            const int ty = static_cast<int>(tile.first / static_cast<uint32_t>(tilesX));
+            if (tile.second.bytes == 0) {
+                result[i]->setTileHandle(tx, ty, nullptr);
+                continue;
+            }
+            compressed.resize(tile.second.bytes);
+            auto pixels = std::make_shared<ImageBuffer::Tile>();
+            uLongf size = static_cast<uLongf>(kTileBytes);
+            file.seekg(static_cast<std::streamoff>(tile.second.offset));
+            if (!file.read(reinterpret_cast<char*>(compressed.data()), tile.second.bytes) ||
+                uncompress(pixels->data(), &size, compressed.data(), tile.second.bytes) != Z_OK || size != kTileBytes) {
+                damaged[i] = 1;   // The saved tile stays
+                file.clear();
+                continue;
+            }
+            result[i]->setTileHandle(tx, ty, std::move(pixels));
+        }
+    });
+
+    std::vector<ProjectLayer> metas;
+    std::vector<AutosaveLayerState> states;
+    for (size_t i = 0; i < stack.size(); ++i) {
+        if (damaged[i]) std::cerr << "Autosave: damaged tiles in " << path << " for layer " << stack[i].meta.name << std::endl;
+        metas.push_back(stack[i].meta);
+        AutosaveLayerState state;
+        state.origin = stack[i].origin;
+        auto found = tiles.find(stack[i].key);
+        if (found != tiles.end()) {
+            for (const auto& tile : found->second) state.changedTiles.push_back(tile.first);
+        }
+        states.push_back(std::move(state));
+    }
+    info.layers = std::move(metas);
+    layers = std::move(result);
+    if (recovered) *recovered = std::move(states);
+    return true;
+}
+
+} // namespace artflow
@@ -0,0 +1,94 @@
+/**
+ * ArtFlow Studio - Background Worker Implementation
+ */
+
+#include "background_worker.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace artflow {
+
+namespace {
+
+// Lower the calling thread's scheduling priority; best effort
+void lowerCurrentThreadPriority() {
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#elif defined(__linux__)
+    // Linux applies a thread id's nice value to that thread alone
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+} // anonymous namespace
+
+BackgroundWorker::BackgroundWorker(Priority priority)
+    : m_priority(priority)
+    , m_thread(&BackgroundWorker::run, this) {
+}
+
+BackgroundWorker::~BackgroundWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+void BackgroundWorker::post(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+    }
+    m_wake.notify_one();
+}
+
+void BackgroundWorker::waitIdle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_jobs.empty() && !m_running; });
+}
+
+bool BackgroundWorker::isIdle() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_jobs.empty() && !m_running;
+}
+
+void BackgroundWorker::run() {
+    if (m_priority == Priority::Low) lowerCurrentThreadPriority();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+        if (m_jobs.empty()) break;  // Stopping and drained
+
+        std::function<void()> job = std::move(m_jobs.front());
+        m_jobs.pop_front();
+        m_running = true;
+        lock.unlock();
+
+        job();
+
+        lock.lock();
+        m_running = false;
+        if (m_jobs.empty()) m_idle.notify_all();
+    }
+}
+
+} // namespace artflow
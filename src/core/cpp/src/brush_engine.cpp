@@ -4,6 +4,9 @@
 
 #include "brush_engine.h"
 #include "image_buffer.h"
+#include "color_utils.h"
+#include <atomic>
+#include <chrono>
 #include <cmath>
 #include <algorithm>
 
@@ -37,9 +40,25 @@ void BrushEngine::setColor(const Color& color) {
 }
 
 void BrushEngine::beginStroke(const StrokePoint& point) {
+    beginStroke(point, newStrokeSeed());
+}
+
+void BrushEngine::beginStroke(const StrokePoint& point, uint64_t seed) {
     m_isStroking = true;
     m_lastPoint = point;
     m_strokeDistance = 0.0f;
+    m_strokeSeed = seed;
+    m_random.reseed(seed);
+}
+
+uint64_t BrushEngine::newStrokeSeed() {
+    // SplitMix64 over a counter started from the clock: distinct per call
+    static std::atomic<uint64_t> counter{static_cast<uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count())};
+    uint64_t z = counter.fetch_add(0x9e3779b97f4a7c15ULL, std::memory_order_relaxed);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
 }
 
 void BrushEngine::continueStroke(const StrokePoint& point) {
@@ -81,85 +100,133 @@ float BrushEngine::calculateDabOpacity(float pressure) const {
     return std::clamp(opacity, 0.0f, 1.0f);
 }
 
-void BrushEngine::renderDab(ImageBuffer& target, float x, float y, float pressure, bool alphaLock, const ImageBuffer* mask) {
+Color BrushEngine::pickupColor(const ImageBuffer& target, float x, float y) const {
+    // 3. COLOR MIXING ENGINE (Kubelka-Munk / RMS Simplified for C++)
+    // We sample the destination color to "dirty" the brush (Color Pickup)
+    Color finalColor = m_color;
+    if (m_brush.type != BrushSettings::Type::Watercolor && m_brush.type != BrushSettings::Type::Oil) {
+        return finalColor;
+    }
+
+    // Read through the const overload so sampling never allocates a tile
+    const uint8_t* dst = target.pixelAt(static_cast<int>(x), static_cast<int>(y));
+    if (dst && dst[3] > 0) {
+        uint8_t picked[4] = {dst[0], dst[1], dst[2], dst[3]};
+        color::unpremultiplyAlpha(picked);
+
+        // Simple Pickup Mix: 20% canvas color, 80% brush color
+        float pickup = 0.2f;
+        finalColor.r = static_cast<uint8_t>(m_color.r * 0.8f + picked[0] * pickup);
+        finalColor.g = static_cast<uint8_t>(m_color.g * 0.8f + picked[1] * pickup);
+        finalColor.b = static_cast<uint8_t>(m_color.b * 0.8f + picked[2] * pickup);
+    }
+    return finalColor;
+}
+
+Dab BrushEngine::makeDab(float x, float y, float pressure, const Color& color) {
     float size = calculateDabSize(pressure);
     float opacity = calculateDabOpacity(pressure);
     
     // 1. POSITION JITTER
     if (m_brush.jitter > 0.001f) {
         float offset = size * m_brush.jitter * 2.0f;
-        x += (static_cast<float>(rand()) / RAND_MAX - 0.5f) * offset;
-        y += (static_cast<float>(rand()) / RAND_MAX - 0.5f) * offset;
+        x += (m_random.nextFloat() - 0.5f) * offset;
+        y += (m_random.nextFloat() - 0.5f) * offset;
     }
+
+    Dab dab;
+    dab.radius = size / 2.0f;
+    dab.a = static_cast<uint8_t>(opacity * 255);
     
     // 2. ERASER MODE
     if (m_brush.type == BrushSettings::Type::Eraser) {
-        target.drawCircle(static_cast<int>(x), static_cast<int>(y), size / 2.0f,
-                         0, 0, 0, static_cast<uint8_t>(opacity * 255), 
-                         m_brush.hardness, 0.0f, alphaLock, true, mask);
-        return;
+        dab.x = x;
+        dab.y = y;
+        dab.hardness = m_brush.hardness;
+        dab.r = dab.g = dab.b = 0;
+        return dab;
     }
 
-    // 3. COLOR MIXING ENGINE (Kubelka-Munk / RMS Simplified for C++)
-    // We sample the destination color to "dirty" the brush (Color Pickup)
-    uint8_t* dst = target.pixelAt(static_cast<int>(x), static_cast<int>(y));
-    Color finalColor = m_color;
-    
-    if (dst && dst[3] > 0 && (m_brush.type == BrushSettings::Type::Watercolor || m_brush.type == BrushSettings::Type::Oil)) {
-        // Simple Pickup Mix: 20% canvas color, 80% brush color
-        float pickup = 0.2f;
-        finalColor.r = static_cast<uint8_t>(m_color.r * 0.8f + dst[0] * pickup);
-        finalColor.g = static_cast<uint8_t>(m_color.g * 0.8f + dst[1] * pickup);
-        finalColor.b = static_cast<uint8_t>(m_color.b * 0.8f + dst[2] * pickup);
+    // PER-TYPE DYNAMICS
+    float hardness = m_brush.hardness;
+    float jitter = 0.0f;
+
+    if (m_brush.type == BrushSettings::Type::Pencil) {
+        // Pencils have more jitter and sharp grain
+        jitter = 0.15f;
+        hardness = std::min(hardness, 0.4f);
+    } else if (m_brush.type == BrushSettings::Type::Watercolor) {
+        jitter = 0.05f;
+        hardness = 0.1f;
     }
 
-    // 4. RENDER MODES
-    if (m_brush.tipImage) {
-        // Note: For stamps, we'd need to add mask support to composite() too.
-        // For now, only circle dabs support clipping in this version.
-        target.composite(*m_brush.tipImage, 
-                        static_cast<int>(x - m_brush.tipImage->width()/2), 
-                        static_cast<int>(y - m_brush.tipImage->height()/2), 
-                        opacity);
-    }
-    else {
-        // PER-TYPE DYNAMICS
-        float hardness = m_brush.hardness;
-        float grain = m_brush.grain;
-        float jitter = 0.0f;
-
-        if (m_brush.type == BrushSettings::Type::Pencil) {
-            // Pencils have more jitter and sharp grain
-            jitter = 0.15f;
-            hardness = std::min(hardness, 0.4f);
-        } else if (m_brush.type == BrushSettings::Type::Watercolor) {
-            jitter = 0.05f;
-            hardness = 0.1f;
-        }
+    if (jitter > 0.001f) {
+        float offset = size * jitter;
+        x += (m_random.nextFloat() - 0.5f) * offset;
+        y += (m_random.nextFloat() - 0.5f) * offset;
+    }
 
-        if (jitter > 0.001f) {
-            float offset = size * jitter;
-            x += (static_cast<float>(rand()) / RAND_MAX - 0.5f) * offset;
-            y += (static_cast<float>(rand()) / RAND_MAX - 0.5f) * offset;
-        }
+    // Professional Shader-like Dab with grain and hardness
+    dab.x = x;
+    dab.y = y;
+    dab.hardness = hardness;
+    dab.grain = m_brush.grain;
+    dab.r = color.r;
+    dab.g = color.g;
+    dab.b = color.b;
+    return dab;
+}
 
-        // Professional Shader-like Dab with grain and hardness
-        target.drawCircle(
-            static_cast<int>(x), static_cast<int>(y), size / 2.0f,
-            finalColor.r, finalColor.g, finalColor.b, 
-            static_cast<uint8_t>(opacity * 255),
-            hardness,
-            grain,
-            alphaLock,
-            false, // isEraser
-            mask
-        );
+bool BrushEngine::usesStamp() const {
+    return m_brush.tipImage && m_brush.type != BrushSettings::Type::Eraser;
+}
+
+DirtyRect BrushEngine::renderStamp(ImageBuffer& target, float x, float y, float pressure,
+                                   const SelectionMask* selection) {
+    float size = calculateDabSize(pressure);
+    float opacity = calculateDabOpacity(pressure);
+
+    if (m_brush.jitter > 0.001f) {
+        float offset = size * m_brush.jitter * 2.0f;
+        x += (m_random.nextFloat() - 0.5f) * offset;
+        y += (m_random.nextFloat() - 0.5f) * offset;
+    }
+
+    // Note: clipping masks only apply to circle dabs; the selection clips
+    // stamps too.
+    DirtyRect stamp{static_cast<int>(x - m_brush.tipImage->width()/2),
+                    static_cast<int>(y - m_brush.tipImage->height()/2),
+                    m_brush.tipImage->width(), m_brush.tipImage->height()};
+    target.composite(*m_brush.tipImage, stamp.x, stamp.y, opacity, BlendMode::Normal, selection);
+    return stamp.intersected(target.width(), target.height());
+}
+
+DirtyRect BrushEngine::renderDab(ImageBuffer& target, float x, float y, float pressure, bool alphaLock, const ImageBuffer* mask,
+                                 const SelectionMask* selection) {
+    // 4. RENDER MODES
+    if (usesStamp()) {
+        return renderStamp(target, x, y, pressure, selection);
     }
+    Dab dab = makeDab(x, y, pressure, pickupColor(target, x, y));
+    return renderDabs(target, &dab, 1, alphaLock, mask, selection);
+}
+
+DirtyRect BrushEngine::renderDabs(ImageBuffer& target, const Dab* dabs, size_t count,
+                                  bool alphaLock, const ImageBuffer* mask, const SelectionMask* selection) {
+    bool isEraser = m_brush.type == BrushSettings::Type::Eraser;
+    return target.drawDabs(dabs, count, alphaLock, isEraser, mask, selection);
 }
 
 std::vector<StrokePoint> BrushEngine::interpolatePoints(const StrokePoint& from, 
                                                           const StrokePoint& to) const {
     std::vector<StrokePoint> points;
+    interpolateInto(from, to, points);
+    return points;
+}
+
+void BrushEngine::interpolateInto(const StrokePoint& from, const StrokePoint& to,
+                                  std::vector<StrokePoint>& points) const {
+    points.clear();
     
     // 1. ADVANCED STABILIZATION
     StrokePoint pTo = to;
@@ -189,7 +256,7 @@ std::vector<StrokePoint> BrushEngine::interpolatePoints(const StrokePoint& from,
     if (steps < 1) {
         // If distance is too small but we moved, at least one point if far enough
         if (distance > 0.1f) steps = 1;
-        else return points;
+        else return;
     }
     
     for (int i = 1; i <= steps; ++i) {
@@ -204,18 +271,71 @@ std::vector<StrokePoint> BrushEngine::interpolatePoints(const StrokePoint& from,
         
         points.push_back(p);
     }
-    
-    return points;
 }
 
-void BrushEngine::renderStrokeSegment(ImageBuffer& target, 
-                                       const StrokePoint& from, 
-                                       const StrokePoint& to,
-                                       bool alphaLock, const ImageBuffer* mask) {
-    auto points = interpolatePoints(from, to);
-    for (const auto& p : points) {
-        renderDab(target, p.x, p.y, p.pressure, alphaLock, mask);
+DirtyRect BrushEngine::renderStrokeSegment(ImageBuffer& target, 
+                                            const StrokePoint& from, 
+                                            const StrokePoint& to,
+                                            bool alphaLock, const ImageBuffer* mask,
+                                            const SelectionMask* selection) {
+    interpolateInto(from, to, m_segmentPoints);
+    if (m_segmentPoints.empty()) return DirtyRect();
+
+    if (usesStamp()) {
+        DirtyRect dirty;
+        for (const auto& p : m_segmentPoints) {
+            dirty.unite(renderStamp(target, p.x, p.y, p.pressure, selection));
+        }
+        return dirty;
+    }
+
+    // One batch per segment. Pickup is sampled once, where the segment
+    // starts, instead of before every dab.
+    const StrokePoint& first = m_segmentPoints.front();
+    Color color = pickupColor(target, first.x, first.y);
+    m_segmentDabs.clear();
+    for (const auto& p : m_segmentPoints) {
+        m_segmentDabs.push_back(makeDab(p.x, p.y, p.pressure, color));
+    }
+    return renderDabs(target, m_segmentDabs.data(), m_segmentDabs.size(), alphaLock, mask, selection);
+}
+
+DirtyRect BrushEngine::renderStroke(ImageBuffer& target, const StrokePoint* points, size_t count,
+                                    bool alphaLock, const ImageBuffer* mask, const SelectionMask* selection) {
+    if (count == 0) return DirtyRect();
+
+    // Pickup is sampled once per call, like once per segment
+    Color color = usesStamp() ? m_color : pickupColor(target, points[0].x, points[0].y);
+    DirtyRect dirty;
+    m_segmentDabs.clear();
+
+    size_t first = 0;
+    if (!m_isStroking) {
+        beginStroke(points[0]);
+        if (usesStamp()) {
+            dirty.unite(renderStamp(target, points[0].x, points[0].y, points[0].pressure, selection));
+        } else {
+            m_segmentDabs.push_back(makeDab(points[0].x, points[0].y, points[0].pressure, color));
+        }
+        first = 1;
+    }
+
+    for (size_t i = first; i < count; ++i) {
+        interpolateInto(m_lastPoint, points[i], m_segmentPoints);
+        for (const auto& p : m_segmentPoints) {
+            if (usesStamp()) {
+                dirty.unite(renderStamp(target, p.x, p.y, p.pressure, selection));
+            } else {
+                m_segmentDabs.push_back(makeDab(p.x, p.y, p.pressure, color));
+            }
+        }
+        continueStroke(points[i]);
+    }
+
+    if (!m_segmentDabs.empty()) {
+        dirty.unite(renderDabs(target, m_segmentDabs.data(), m_segmentDabs.size(), alphaLock, mask, selection));
     }
+    return dirty;
 }
 
 } // namespace artflow
@@ -0,0 +1,34 @@
+/**
+ * ArtFlow Studio - Channel Buffer Implementation
+ */
+
+#include "channel_buffer.h"
+#include <cstring>
+
+namespace artflow {
+
+ChannelBuffer::ChannelBuffer(int width, int height)
+    : m_width(width), m_height(height) {
+    m_data.resize(static_cast<size_t>(width) * height, 0);
+}
+
+uint8_t ChannelBuffer::valueAt(int x, int y) const {
+    if (!isValidCoord(x, y)) return 0;
+    return m_data[static_cast<size_t>(y) * m_width + x];
+}
+
+void ChannelBuffer::setValue(int x, int y, uint8_t value) {
+    if (!isValidCoord(x, y)) return;
+    m_data[static_cast<size_t>(y) * m_width + x] = value;
+}
+
+void ChannelBuffer::fill(uint8_t value) {
+    std::memset(m_data.data(), value, m_data.size());
+}
+
+void ChannelBuffer::copyFrom(const ChannelBuffer& other) {
+    if (m_width != other.m_width || m_height != other.m_height) return;
+    std::memcpy(m_data.data(), other.m_data.data(), m_data.size());
+}
+
+} // namespace artflow
@@ -113,16 +113,46 @@ std::array<uint8_t, 3> hslToRgb(float h, float s, float l) {
 }
 
 void alphaBlend(uint8_t* dst, const uint8_t* src, float srcOpacity) {
-    float srcA = (src[3] / 255.0f) * srcOpacity;
-    float dstA = dst[3] / 255.0f;
-    float outA = srcA + dstA * (1.0f - srcA);
-    
-    if (outA > 0.0f) {
-        dst[0] = static_cast<uint8_t>((src[0] * srcA + dst[0] * dstA * (1.0f - srcA)) / outA);
-        dst[1] = static_cast<uint8_t>((src[1] * srcA + dst[1] * dstA * (1.0f - srcA)) / outA);
-        dst[2] = static_cast<uint8_t>((src[2] * srcA + dst[2] * dstA * (1.0f - srcA)) / outA);
+    uint32_t opacity = static_cast<uint32_t>(std::clamp(srcOpacity, 0.0f, 1.0f) * 255.0f + 0.5f);
+    uint32_t srcA = div255(src[3] * opacity);
+    if (srcA == 0) return;
+
+    uint32_t inv = 255 - srcA;
+    for (int i = 0; i < 4; ++i) {
+        dst[i] = static_cast<uint8_t>(div255(src[i] * opacity) + div255(dst[i] * inv));
+    }
+}
+
+void premultiplyAlpha(uint8_t* pixel) {
+    uint32_t a = pixel[3];
+    pixel[0] = static_cast<uint8_t>(div255(pixel[0] * a));
+    pixel[1] = static_cast<uint8_t>(div255(pixel[1] * a));
+    pixel[2] = static_cast<uint8_t>(div255(pixel[2] * a));
+}
+
+void unpremultiplyAlpha(uint8_t* pixel) {
+    uint32_t a = pixel[3];
+    if (a == 255) return;
+    if (a == 0) {
+        pixel[0] = pixel[1] = pixel[2] = 0;
+        return;
+    }
+    uint32_t half = a / 2;
+    pixel[0] = static_cast<uint8_t>(std::min<uint32_t>(255, (pixel[0] * 255 + half) / a));
+    pixel[1] = static_cast<uint8_t>(std::min<uint32_t>(255, (pixel[1] * 255 + half) / a));
+    pixel[2] = static_cast<uint8_t>(std::min<uint32_t>(255, (pixel[2] * 255 + half) / a));
+}
+
+void premultiplyRow(uint8_t* pixels, size_t count) {
+    for (size_t i = 0; i < count; ++i, pixels += 4) {
+        if (pixels[3] != 255) premultiplyAlpha(pixels);
+    }
+}
+
+void unpremultiplyRow(uint8_t* pixels, size_t count) {
+    for (size_t i = 0; i < count; ++i, pixels += 4) {
+        unpremultiplyAlpha(pixels);
     }
-    dst[3] = static_cast<uint8_t>(outA * 255);
 }
 
 void lerpColor(uint8_t* result, const uint8_t* a, const uint8_t* b, float t) {
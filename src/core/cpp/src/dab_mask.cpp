@@ -0,0 +1,154 @@
+/**
+ * ArtFlow Studio - Dab Masks Implementation
+ */
+
+#include "dab_mask.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace artflow {
+
+namespace {
+
+// Coverage of a dab of `radius` whose center sits (offsetX, offsetY) past
+// the base pixel. Same falloff drawCircle has always used: full inside
+// `hardness * radius`, then linear to zero at the rim.
+std::shared_ptr<const DabMask> rasterize(float radius, float hardness, float offsetX, float offsetY) {
+    auto mask = std::make_shared<DabMask>();
+    int x0 = static_cast<int>(std::floor(offsetX - radius - 1.0f));
+    int x1 = static_cast<int>(std::floor(offsetX + radius + 1.0f));
+    int y0 = static_cast<int>(std::floor(offsetY - radius - 1.0f));
+    int y1 = static_cast<int>(std::floor(offsetY + radius + 1.0f));
+    mask->originX = x0;
+    mask->originY = y0;
+    mask->width = x1 - x0 + 1;
+    mask->height = y1 - y0 + 1;
+    mask->coverage.assign(static_cast<size_t>(mask->width) * mask->height, 0);
+    mask->rowSpans.assign(mask->height, {0, 0});
+
+    const float radiusSq = radius * radius;
+    for (int j = 0; j < mask->height; ++j) {
+        float dy = (y0 + j) - offsetY;
+        if (dy * dy > radiusSq) continue;
+
+        uint8_t* row = mask->coverage.data() + static_cast<size_t>(j) * mask->width;
+        int first = mask->width;
+        int last = -1;
+        for (int i = 0; i < mask->width; ++i) {
+            float dx = (x0 + i) - offsetX;
+            float distSq = dx * dx + dy * dy;
+            if (distSq > radiusSq) continue;
+
+            float normalizedDist = std::sqrt(distSq) / radius;
+            float falloff = 1.0f;
+            if (normalizedDist > hardness) {
+                falloff = std::clamp(1.0f - (normalizedDist - hardness) / (1.0f - hardness), 0.0f, 1.0f);
+            }
+            row[i] = static_cast<uint8_t>(falloff * 255.0f + 0.5f);
+            if (row[i] != 0) {
+                first = std::min(first, i);
+                last = i;
+            }
+        }
+        if (last >= first) mask->rowSpans[j] = {first, last + 1};
+    }
+    return mask;
+}
+
+} // anonymous namespace
+
+DabMaskCache& DabMaskCache::shared() {
+    static DabMaskCache cache;
+    return cache;
+}
+
+DabMaskCache::DabMaskCache(size_t budget)
+    : m_budget(budget)
+{
+}
+
+std::shared_ptr<const DabMask> DabMaskCache::get(float cx, float cy, float radius, float hardness,
+                                                 int* baseX, int* baseY) {
+    float floorX = std::floor(cx);
+    float floorY = std::floor(cy);
+    int stepX = static_cast<int>(std::lround((cx - floorX) * kOffsetSteps));
+    int stepY = static_cast<int>(std::lround((cy - floorY) * kOffsetSteps));
+    *baseX = static_cast<int>(floorX) + stepX / kOffsetSteps;   // An offset of 4/4 is the next pixel
+    *baseY = static_cast<int>(floorY) + stepY / kOffsetSteps;
+    stepX %= kOffsetSteps;
+    stepY %= kOffsetSteps;
+
+    uint64_t radiusStep = static_cast<uint64_t>(std::max(1L, std::lround(radius * kRadiusSteps)));
+    uint64_t hardnessStep = static_cast<uint64_t>(std::lround(std::clamp(hardness, 0.0f, 1.0f) * kHardnessSteps));
+    uint64_t key = (radiusStep << 16) | (hardnessStep << 4) | (static_cast<uint64_t>(stepX) << 2) | stepY;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_masks.find(key);
+        if (it != m_masks.end()) return it->second;
+    }
+
+    auto mask = rasterize(static_cast<float>(radiusStep) / kRadiusSteps,
+                          static_cast<float>(hardnessStep) / kHardnessSteps,
+                          static_cast<float>(stepX) / kOffsetSteps,
+                          static_cast<float>(stepY) / kOffsetSteps);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_bytes + mask->bytes() > m_budget) {
+        m_masks.clear();   // Brush changes are rare; start over
+        m_bytes = 0;
+    }
+    auto inserted = m_masks.emplace(key, mask);
+    if (inserted.second) m_bytes += mask->bytes();
+    return inserted.first->second;
+}
+
+void DabMaskCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_masks.clear();
+    m_bytes = 0;
+}
+
+size_t DabMaskCache::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+size_t DabMaskCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_masks.size();
+}
+
+// ============================================================================
+// Grain
+// ============================================================================
+
+const uint8_t* grainTexture() {
+    // Same two-octave hash noise drawCircle used to evaluate per pixel. The
+    // coarse octave's 4 px cells divide the texture size, so it tiles.
+    static const auto texture = [] {
+        std::array<uint8_t, kGrainTextureSize * kGrainTextureSize> values{};
+        auto getHash = [](float x, float y) {
+            uint32_t h = (static_cast<uint32_t>(x) * 1597334677U) ^ (static_cast<uint32_t>(y) * 3812015801U);
+            h *= 0x85ebca6b; h ^= h >> 13; h *= 0xc2b2ae35;
+            return static_cast<float>(h & 0xFFFF) / 65535.0f;
+        };
+        for (int y = 0; y < kGrainTextureSize; ++y) {
+            for (int x = 0; x < kGrainTextureSize; ++x) {
+                // Octave 1: Coarse (Paper grain), Octave 2: Fine (Pigment/Graphite detail)
+                float n1 = getHash(x / 4.0f, y / 4.0f);
+                float n2 = getHash(x / 1.5f, y / 1.5f);
+                float randVal = n1 * 0.7f + n2 * 0.3f;
+
+                // High-contrast curve for "tooth" feeling
+                float grainVal = std::clamp((randVal - 0.45f) * 3.0f + 0.5f, 0.0f, 1.0f);
+                values[y * kGrainTextureSize + x] = static_cast<uint8_t>(grainVal * 255.0f + 0.5f);
+            }
+        }
+        return values;
+    }();
+    return texture.data();
+}
+
+} // namespace artflow
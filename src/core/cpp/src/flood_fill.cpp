@@ -0,0 +1,402 @@
+/**
+ * ArtFlow Studio - Flood Fill Implementation
+ */
+
+#include "flood_fill.h"
+#include "color_utils.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace artflow {
+
+namespace {
+
+constexpr int kTile = ImageBuffer::kTileSize;
+
+// ============================================================================
+// Pixel sources
+// ============================================================================
+
+// Contiguous rows (linear ImageBuffer, caller memory)
+struct RawSurface {
+    const uint8_t* pixels;
+    size_t stride;
+
+    const uint8_t* at(int x, int y) const { return pixels + y * stride + x * 4; }
+};
+
+// Tiled ImageBuffer; remembers the last tile since scans run along rows
+struct TiledSurface {
+    const ImageBuffer& image;
+    mutable int tileX = -1;
+    mutable int tileY = -1;
+    mutable const uint8_t* tile = nullptr;
+
+    explicit TiledSurface(const ImageBuffer& image) : image(image) {}
+
+    const uint8_t* at(int x, int y) const {
+        const int tx = x / kTile;
+        const int ty = y / kTile;
+        if (tx != tileX || ty != tileY) {
+            tileX = tx;
+            tileY = ty;
+            tile = image.tileData(tx, ty);
+        }
+        return tile + (y % kTile) * ImageBuffer::kTileStride + (x % kTile) * 4;
+    }
+};
+
+// ============================================================================
+// Region mask: one byte per pixel, tiles allocated on first write
+// ============================================================================
+
+class RegionMask {
+public:
+    RegionMask(int width, int height)
+        : m_tilesX((width + kTile - 1) / kTile)
+        , m_tiles(static_cast<size_t>(m_tilesX) * ((height + kTile - 1) / kTile)) {
+    }
+
+    bool test(int x, int y) const {
+        const uint8_t* t = m_tiles[index(x, y)].get();
+        return t && t[(y % kTile) * kTile + x % kTile];
+    }
+
+    void set(int x, int y, uint8_t value) {
+        tileFor(index(x, y))[(y % kTile) * kTile + x % kTile] = value;
+    }
+
+    // Mark [x0, x1] on row y
+    void setSpan(int y, int x0, int x1) {
+        while (x0 <= x1) {
+            const int end = std::min(x1, (x0 / kTile + 1) * kTile - 1);
+            std::memset(tileFor(index(x0, y)) + (y % kTile) * kTile + x0 % kTile, 1,
+                        static_cast<size_t>(end - x0 + 1));
+            x0 = end + 1;
+        }
+    }
+
+    const uint8_t* tile(int tx, int ty) const { return m_tiles[static_cast<size_t>(ty) * m_tilesX + tx].get(); }
+
+    // Row of the tile holding (x, y), indexed by x % kTileSize; nullptr if
+    // the tile is unallocated
+    const uint8_t* row(int x, int y) const {
+        const uint8_t* t = m_tiles[index(x, y)].get();
+        return t ? t + (y % kTile) * kTile : nullptr;
+    }
+
+private:
+    int m_tilesX;
+    std::vector<std::unique_ptr<uint8_t[]>> m_tiles;
+
+    size_t index(int x, int y) const { return static_cast<size_t>(y / kTile) * m_tilesX + x / kTile; }
+
+    uint8_t* tileFor(size_t i) {
+        if (!m_tiles[i]) m_tiles[i].reset(new uint8_t[kTile * kTile]());
+        return m_tiles[i].get();
+    }
+};
+
+inline bool selected(const FillOptions& options, int x, int y) {
+    if (options.selectionMask) return options.selectionMask->valueAt(x, y) != 0;
+    return !options.selection || options.selection[y * options.selectionStride + x] != 0;
+}
+
+// Selection values from (x, y) on, valid to the end of x's tile; nullptr
+// without a selection
+inline const uint8_t* selectionRowAt(const FillOptions& options, int x, int y) {
+    if (options.selectionMask) return options.selectionMask->rowData(x, y);
+    return options.selection ? options.selection + y * options.selectionStride + x : nullptr;
+}
+
+// ============================================================================
+// Region search
+// ============================================================================
+
+struct Span {
+    int x0;
+    int x1;
+    int y;
+    int dy;
+};
+
+// Walks rows in runs that stay within one mask tile, so the per-pixel test
+// is a few compares on plain pointers
+template <typename Surface>
+class RegionFinder {
+public:
+    RegionFinder(const Surface& surface, const FillOptions& options, const uint8_t seed[4], RegionMask& mask)
+        : m_surface(surface), m_options(options), m_mask(mask)
+        , m_tolerance(static_cast<unsigned>(std::clamp(options.tolerance, 0, 255)))
+        , m_selectionStep(options.selection || options.selectionMask ? 1 : 0) {
+        std::memcpy(m_seed, seed, 4);
+    }
+
+    // First x in [x, end) whose openness differs from `open`, else end
+    int forward(int x, int end, int y, bool open) const {
+        while (x < end) {
+            const int chunkEnd = std::min(end, (x / kTile + 1) * kTile);
+            const uint8_t* mask = maskRow(x, y);
+            const uint8_t* sel = selectionRow(x, y);
+            const uint8_t* p = m_surface.at(x, y);
+            for (; x < chunkEnd; ++x, p += 4, ++mask, sel += m_selectionStep) {
+                if (isOpen(p, *mask, *sel) != open) return x;
+            }
+        }
+        return end;
+    }
+
+    // Last x in [begin, x] going left whose openness differs, else begin - 1
+    int backward(int x, int begin, int y, bool open) const {
+        while (x >= begin) {
+            const int chunkBegin = std::max(begin, (x / kTile) * kTile);
+            const uint8_t* mask = maskRow(x, y);
+            const uint8_t* sel = selectionRow(x, y);
+            const uint8_t* p = m_surface.at(x, y);
+            for (; x >= chunkBegin; --x, p -= 4, --mask, sel -= m_selectionStep) {
+                if (isOpen(p, *mask, *sel) != open) return x;
+            }
+        }
+        return begin - 1;
+    }
+
+private:
+    const Surface& m_surface;
+    const FillOptions& m_options;
+    RegionMask& m_mask;
+    unsigned m_tolerance;
+    uint8_t m_seed[4];
+    const size_t m_selectionStep;   // 0 without a selection: reads kOpen
+
+    // Stand-ins for an unallocated mask tile and a missing selection
+    static constexpr uint8_t kClear[kTile] = {};
+    static constexpr uint8_t kOpen = 0xff;
+
+    // Pointers at x, stepped along with it
+    const uint8_t* maskRow(int x, int y) const {
+        const uint8_t* row = m_mask.row(x, y);
+        return (row ? row : kClear) + x % kTile;
+    }
+    const uint8_t* selectionRow(int x, int y) const {
+        const uint8_t* row = selectionRowAt(m_options, x, y);
+        return row ? row : &kOpen;
+    }
+
+    bool near(uint8_t value, uint8_t seed) const {
+        return static_cast<unsigned>(value - seed + static_cast<int>(m_tolerance)) <= 2 * m_tolerance;
+    }
+
+    bool isOpen(const uint8_t* p, uint8_t mask, uint8_t sel) const {
+        return (mask == 0) & (sel != 0) & near(p[0], m_seed[0]) & near(p[1], m_seed[1]) &
+               near(p[2], m_seed[2]) & near(p[3], m_seed[3]);
+    }
+};
+
+// Span fill (Heckbert): each stack entry is a filled span [x0, x1] on row
+// y with the direction dy to continue in. Only the next row is scanned; a
+// run that overhangs the parent span queues the overhang back towards the
+// parent row, so pixels are tested about once.
+template <typename Surface>
+DirtyRect findRegion(const Surface& surface, int width, int height, int seedX, int seedY,
+                     const FillOptions& options, RegionMask& mask) {
+    if (!selected(options, seedX, seedY)) return DirtyRect();
+
+    const RegionFinder<Surface> finder(surface, options, surface.at(seedX, seedY), mask);
+    int minX = seedX, maxX = seedX, minY = seedY, maxY = seedY;
+
+    std::vector<Span> stack;
+    auto push = [&](int x0, int x1, int y, int dy) {
+        if (y + dy >= 0 && y + dy < height) stack.push_back({x0, x1, y, dy});
+    };
+    auto fill = [&](int x0, int x1, int y) {
+        mask.setSpan(y, x0, x1);
+        minX = std::min(minX, x0);
+        maxX = std::max(maxX, x1);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    };
+
+    const int left = finder.backward(seedX, 0, seedY, true) + 1;
+    const int right = finder.forward(seedX, width, seedY, true) - 1;
+    fill(left, right, seedY);
+    push(left, right, seedY, 1);
+    push(left, right, seedY, -1);
+
+    while (!stack.empty()) {
+        const Span parent = stack.back();
+        stack.pop_back();
+        const int y = parent.y + parent.dy;
+
+        // First open run touching [x0, x1]; it may start left of x0
+        int x = parent.x0;
+        if (finder.forward(x, x + 1, y, true) != x) {
+            x = finder.backward(x, 0, y, true) + 1;
+        } else {
+            x = finder.forward(x, parent.x1 + 1, y, false);
+            if (x > parent.x1) continue;
+        }
+
+        for (;;) {
+            const int runEnd = finder.forward(x, width, y, true) - 1;
+            fill(x, runEnd, y);
+            push(x, runEnd, y, parent.dy);
+            if (x < parent.x0) push(x, parent.x0 - 1, y, -parent.dy);
+            if (runEnd > parent.x1) push(parent.x1 + 1, runEnd, y, -parent.dy);
+
+            // runEnd + 1 is closed; find the next open run under the parent
+            x = runEnd + 2;
+            if (x > parent.x1) break;
+            x = finder.forward(x, parent.x1 + 1, y, false);
+            if (x > parent.x1) break;
+        }
+    }
+    return DirtyRect{minX, minY, maxX - minX + 1, maxY - minY + 1};
+}
+
+// Grow (amount > 0) or shrink the region with a 3-4 chamfer distance map
+// over its bounds. Canvas edges do not count as outside when shrinking.
+void morph(RegionMask& mask, DirtyRect& bounds, int amount, int width, int height) {
+    const bool grow = amount > 0;
+    const int n = std::abs(amount);
+    const int pad = grow ? n : 1;
+    const DirtyRect area = DirtyRect{bounds.x - pad, bounds.y - pad, bounds.w + 2 * pad, bounds.h + 2 * pad}
+        .intersected(width, height);
+    const int w = area.w;
+    const int h = area.h;
+
+    // Distance to the nearest pixel on the other side of the region edge
+    constexpr int kFar = 0xffff;
+    std::vector<uint16_t> dist(static_cast<size_t>(w) * h);
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            dist[y * w + x] = mask.test(area.x + x, area.y + y) == grow ? 0 : kFar;
+        }
+    }
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            int d = dist[y * w + x];
+            if (x > 0) d = std::min(d, dist[y * w + x - 1] + 3);
+            if (y > 0) {
+                d = std::min(d, dist[(y - 1) * w + x] + 3);
+                if (x > 0) d = std::min(d, dist[(y - 1) * w + x - 1] + 4);
+                if (x + 1 < w) d = std::min(d, dist[(y - 1) * w + x + 1] + 4);
+            }
+            dist[y * w + x] = static_cast<uint16_t>(d);
+        }
+    }
+    for (int y = h - 1; y >= 0; --y) {
+        for (int x = w - 1; x >= 0; --x) {
+            int d = dist[y * w + x];
+            if (x + 1 < w) d = std::min(d, dist[y * w + x + 1] + 3);
+            if (y + 1 < h) {
+                d = std::min(d, dist[(y + 1) * w + x] + 3);
+                if (x + 1 < w) d = std::min(d, dist[(y + 1) * w + x + 1] + 4);
+                if (x > 0) d = std::min(d, dist[(y + 1) * w + x - 1] + 4);
+            }
+            dist[y * w + x] = static_cast<uint16_t>(d);
+        }
+    }
+
+    const int limit = 3 * n;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            const int d = dist[y * w + x];
+            if (d > 0 && d <= limit) mask.set(area.x + x, area.y + y, grow ? 1 : 0);
+        }
+    }
+    if (grow) bounds = area;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+// Store `pixel` wherever the mask is set, one tile per task. `origin(tx, ty,
+// stride)` returns where the tile's top-left pixel lives in the target.
+template <typename Origin>
+void writeRegion(const RegionMask& mask, const DirtyRect& bounds, int width, int height,
+                 const uint8_t pixel[4], const FillOptions& options, Origin origin) {
+    struct TileRef {
+        int x;
+        int y;
+    };
+    std::vector<TileRef> tiles;
+    for (int ty = bounds.y / kTile; ty <= (bounds.y + bounds.h - 1) / kTile; ++ty) {
+        for (int tx = bounds.x / kTile; tx <= (bounds.x + bounds.w - 1) / kTile; ++tx) {
+            if (mask.tile(tx, ty)) tiles.push_back({tx, ty});
+        }
+    }
+
+    ThreadPool::shared().parallelFor(tiles.size(), [&](size_t i) {
+        const int tx = tiles[i].x;
+        const int ty = tiles[i].y;
+        const int w = std::min(kTile, width - tx * kTile);
+        const int h = std::min(kTile, height - ty * kTile);
+        const uint8_t* m = mask.tile(tx, ty);
+        size_t stride;
+        uint8_t* dst = origin(tx, ty, stride);
+        for (int y = 0; y < h; ++y) {
+            uint8_t* row = dst + y * stride;
+            const uint8_t* mrow = m + y * kTile;
+            const uint8_t* srow = selectionRowAt(options, tx * kTile, ty * kTile + y);
+            for (int x = 0; x < w; ++x) {
+                if (mrow[x] && (!srow || srow[x])) std::memcpy(row + x * 4, pixel, 4);
+            }
+        }
+    });
+}
+
+} // anonymous namespace
+
+DirtyRect floodFill(ImageBuffer& target, int x, int y,
+                    uint8_t r, uint8_t g, uint8_t b, uint8_t a,
+                    const FillOptions& options, const ImageBuffer* sample) {
+    const int width = target.width();
+    const int height = target.height();
+    if (x < 0 || x >= width || y < 0 || y >= height) return DirtyRect();
+    if (!sample) sample = &target;
+    if (sample->width() != width || sample->height() != height) return DirtyRect();
+
+    RegionMask mask(width, height);
+    DirtyRect bounds = sample->isTiled()
+        ? findRegion(TiledSurface(*sample), width, height, x, y, options, mask)
+        : findRegion(RawSurface{sample->data(), static_cast<size_t>(width) * 4}, width, height, x, y, options, mask);
+    if (bounds.isEmpty()) return bounds;
+    if (options.expand != 0) morph(mask, bounds, options.expand, width, height);
+
+    uint8_t pixel[4] = {r, g, b, a};
+    color::premultiplyAlpha(pixel);
+    writeRegion(mask, bounds, width, height, pixel, options, [&](int tx, int ty, size_t& stride) {
+        if (target.isTiled()) {
+            stride = ImageBuffer::kTileStride;
+            return target.mutableTileData(tx, ty);
+        }
+        stride = static_cast<size_t>(width) * 4;
+        return target.data() + ty * kTile * stride + tx * kTile * 4;
+    });
+    return bounds;
+}
+
+DirtyRect floodFill(uint8_t* pixels, int width, int height, size_t stride, int x, int y,
+                    const uint8_t color[4], const FillOptions& options,
+                    const uint8_t* sample, size_t sampleStride) {
+    if (!pixels || x < 0 || x >= width || y < 0 || y >= height) return DirtyRect();
+    const RawSurface surface = sample ? RawSurface{sample, sampleStride} : RawSurface{pixels, stride};
+
+    RegionMask mask(width, height);
+    DirtyRect bounds = findRegion(surface, width, height, x, y, options, mask);
+    if (bounds.isEmpty()) return bounds;
+    if (options.expand != 0) morph(mask, bounds, options.expand, width, height);
+
+    writeRegion(mask, bounds, width, height, color, options, [&](int tx, int ty, size_t& rowStride) {
+        rowStride = stride;
+        return pixels + ty * kTile * stride + tx * kTile * 4;
+    });
+    return bounds;
+}
+
+} // namespace artflow
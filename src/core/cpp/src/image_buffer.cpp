@@ -3,177 +3,830 @@
  */
 
 #include "image_buffer.h"
+#include "color_utils.h"
+#include "dab_mask.h"
+#include "selection_mask.h"
+#include "thread_pool.h"
+#include "tile_store.h"
 #include <cstring>
 #include <cmath>
 #include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace artflow {
 
-ImageBuffer::ImageBuffer(int width, int height)
-    : m_width(width), m_height(height) {
-    m_data.resize(static_cast<size_t>(width * height * 4), 0);
+namespace {
+
+using color::div255;
+
+// Source-over blend of a straight-alpha color into one premultiplied pixel
+// (8-bit fixed point, no division).
+inline void blendInto(uint8_t* px, uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool alphaLock, bool isEraser) {
+    uint32_t dstA = px[3];
+    if (alphaLock && dstA == 0) return;
+
+    if (isEraser) {
+        // Subtractive alpha: premultiplied channels scale with it
+        uint32_t keep = 255u - a;
+        px[0] = static_cast<uint8_t>(div255(px[0] * keep));
+        px[1] = static_cast<uint8_t>(div255(px[1] * keep));
+        px[2] = static_cast<uint8_t>(div255(px[2] * keep));
+        px[3] = static_cast<uint8_t>(div255(dstA * keep));
+        return;
+    }
+
+    if (alphaLock) {
+        // Alpha stays put; color is capped to it to stay premultiplied
+        uint32_t srcA = std::min<uint32_t>(a, dstA);
+        uint32_t inv = 255u - srcA;
+        px[0] = static_cast<uint8_t>(std::min(dstA, div255(r * srcA) + div255(px[0] * inv)));
+        px[1] = static_cast<uint8_t>(std::min(dstA, div255(g * srcA) + div255(px[1] * inv)));
+        px[2] = static_cast<uint8_t>(std::min(dstA, div255(b * srcA) + div255(px[2] * inv)));
+        return;
+    }
+
+    uint32_t inv = 255u - a;
+    px[0] = static_cast<uint8_t>(div255(r * a) + div255(px[0] * inv));
+    px[1] = static_cast<uint8_t>(div255(g * a) + div255(px[1] * inv));
+    px[2] = static_cast<uint8_t>(div255(b * a) + div255(px[2] * inv));
+    px[3] = static_cast<uint8_t>(a + div255(dstA * inv));
+}
+
+} // namespace
+
+ImageBuffer::ImageBuffer(int width, int height, Storage storage)
+    : m_width(width), m_height(height), m_storage(storage) {
+    if (storage == Storage::Tiled) {
+        m_tilesX = (width + kTileSize - 1) / kTileSize;
+        m_tilesY = (height + kTileSize - 1) / kTileSize;
+        m_tiles.resize(static_cast<size_t>(m_tilesX) * m_tilesY);
+    } else {
+        m_data.resize(static_cast<size_t>(width * height * 4), 0);
+    }
 }
 
+// Rows of tiles still in a TileLoader. A row is loaded under one of a few
+// striped locks, so different rows can load at the same time.
+struct ImageBuffer::PendingRows {
+    static constexpr int kLockStripes = 16;
+
+    std::shared_ptr<TileLoader> loader;           // Released after the last row
+    std::unique_ptr<std::atomic<bool>[]> rows;    // Per tile row: still pending
+    std::mutex locks[kLockStripes];
+};
+
 ImageBuffer::~ImageBuffer() = default;
 
+const ImageBuffer::Tile& ImageBuffer::emptyTile() {
+    static const Tile empty{};
+    return empty;
+}
+
+std::shared_ptr<ImageBuffer::Tile> ImageBuffer::newTile() const {
+    if (m_store) {
+        if (auto tile = m_store->allocate()) return tile;   // Else the heap: the file cannot grow
+    }
+    return std::make_shared<Tile>();
+}
+
+// Only store tiles keep track of use
+void ImageBuffer::touch(const std::shared_ptr<Tile>& tile) const {
+    if (m_store && tile) TileStore::touch(tile);
+}
+
+bool ImageBuffer::isTileAllocated(int tx, int ty) const {
+    if (!isTiled() || tx < 0 || tx >= m_tilesX || ty < 0 || ty >= m_tilesY) return false;
+    ensureRow(ty);
+    return m_tiles[ty * m_tilesX + tx] != nullptr;
+}
+
+const uint8_t* ImageBuffer::tileData(int tx, int ty) const {
+    if (!isTiled() || tx < 0 || tx >= m_tilesX || ty < 0 || ty >= m_tilesY) return nullptr;
+    ensureRow(ty);
+    const auto& tile = m_tiles[ty * m_tilesX + tx];
+    touch(tile);
+    return tile ? tile->data() : emptyTile().data();
+}
+
+uint8_t* ImageBuffer::mutableTileData(int tx, int ty) {
+    if (!isTiled() || tx < 0 || tx >= m_tilesX || ty < 0 || ty >= m_tilesY) return nullptr;
+    ensureRow(ty);
+    auto& tile = m_tiles[ty * m_tilesX + tx];
+    if (!tile) {
+        tile = newTile();
+    } else if (tile.use_count() > 1) {
+        auto copy = newTile();  // Copy on write
+        *copy = *tile;
+        tile = std::move(copy);
+    } else {
+        touch(tile);
+    }
+    return tile->data();
+}
+
+ImageBuffer::TileHandle ImageBuffer::tileHandle(int tx, int ty) const {
+    if (!isTiled() || tx < 0 || tx >= m_tilesX || ty < 0 || ty >= m_tilesY) return nullptr;
+    ensureRow(ty);
+    return m_tiles[ty * m_tilesX + tx];
+}
+
+std::vector<ImageBuffer::TileHandle> ImageBuffer::tileHandles() const {
+    loadPendingTiles();
+    return std::vector<TileHandle>(m_tiles.begin(), m_tiles.end());
+}
+
+bool ImageBuffer::samePixels(const TileHandle& a, const TileHandle& b) {
+    if (a == b) return true;
+    const Tile& empty = emptyTile();
+    return std::memcmp(a ? a->data() : empty.data(), b ? b->data() : empty.data(), kTileBytes) == 0;
+}
+
+ImageBuffer::TileSnapshot ImageBuffer::tileSnapshot() const {
+    TileSnapshot snapshot;
+    if (!hasPendingTiles()) {
+        snapshot.tiles.assign(m_tiles.begin(), m_tiles.end());
+        return snapshot;
+    }
+
+    snapshot.tiles.resize(m_tiles.size());
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        if (isTileRowPending(ty)) {
+            // Holding the row's lock keeps it pending, and with it the
+            // loader, which goes only once the last row is in
+            std::lock_guard<std::mutex> lock(m_pending->locks[ty % PendingRows::kLockStripes]);
+            if (m_pending->rows[ty].load(std::memory_order_relaxed)) {
+                if (!snapshot.loader) {
+                    snapshot.pendingRows.resize(static_cast<size_t>(m_tilesY));
+                    snapshot.loader = m_pending->loader;
+                }
+                snapshot.pendingRows[ty] = true;
+                continue;
+            }
+        }
+        const auto row = m_tiles.begin() + static_cast<std::ptrdiff_t>(ty) * m_tilesX;
+        std::copy(row, row + m_tilesX, snapshot.tiles.begin() + static_cast<std::ptrdiff_t>(ty) * m_tilesX);
+    }
+    return snapshot;
+}
+
+void ImageBuffer::setTileHandle(int tx, int ty, TileHandle tile) {
+    if (!isTiled() || tx < 0 || tx >= m_tilesX || ty < 0 || ty >= m_tilesY) return;
+    ensureRow(ty);   // The rest of the row must not be loaded over it later
+    // Tiles are never written while shared (copy-on-write), so the handle can
+    // be adopted as mutable storage.
+    m_tiles[ty * m_tilesX + tx] = std::const_pointer_cast<Tile>(std::move(tile));
+}
+
+void ImageBuffer::setTileStore(std::shared_ptr<TileStore> store) {
+    m_store = std::move(store);
+    if (!isTiled() || !m_store) return;
+
+    // Loaded rows only; a tile repeated in the buffer (fill()) moves once
+    std::unordered_map<const Tile*, std::shared_ptr<Tile>> moved;
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        if (isTileRowPending(ty)) continue;
+        for (int tx = 0; tx < m_tilesX; ++tx) {
+            auto& tile = m_tiles[ty * m_tilesX + tx];
+            if (!tile || m_store->owns(tile)) continue;
+            auto& copy = moved[tile.get()];
+            if (!copy) {
+                copy = m_store->allocate();
+                if (!copy) return;   // The file cannot grow: the rest stays on the heap
+                *copy = *tile;
+            }
+            tile = copy;
+        }
+    }
+}
+
+size_t ImageBuffer::memoryUsage() const {
+    std::unordered_set<const Tile*> counted;
+    return memoryUsage(counted);
+}
+
+size_t ImageBuffer::memoryUsage(std::unordered_set<const Tile*>& counted) const {
+    if (!isTiled()) return m_data.size();
+
+    size_t tiles = 0;
+    for (const auto& tile : m_tiles) {
+        if (tile && counted.insert(tile.get()).second) ++tiles;
+    }
+    return tiles * kTileBytes;
+}
+
+void ImageBuffer::setTileLoader(std::shared_ptr<TileLoader> loader) {
+    if (!isTiled()) return;
+    dropPending();
+    std::fill(m_tiles.begin(), m_tiles.end(), nullptr);
+    if (!loader || m_tilesY == 0) return;
+
+    m_pending = std::make_unique<PendingRows>();
+    m_pending->loader = std::move(loader);
+    m_pending->rows.reset(new std::atomic<bool>[m_tilesY]);
+    for (int ty = 0; ty < m_tilesY; ++ty) m_pending->rows[ty].store(true, std::memory_order_relaxed);
+    m_pendingRows.store(m_tilesY, std::memory_order_release);
+}
+
+bool ImageBuffer::isTileRowPending(int ty) const {
+    if (!hasPendingTiles() || ty < 0 || ty >= m_tilesY) return false;
+    return m_pending->rows[ty].load(std::memory_order_acquire);
+}
+
+void ImageBuffer::loadPendingTiles() const {
+    if (!hasPendingTiles()) return;
+    ThreadPool::shared().parallelFor(static_cast<size_t>(m_tilesY), [this](size_t ty) {
+        loadRow(static_cast<int>(ty));
+    });
+}
+
+void ImageBuffer::loadRow(int ty) const {
+    PendingRows& pending = *m_pending;
+    if (!pending.rows[ty].load(std::memory_order_acquire)) return;
+
+    std::lock_guard<std::mutex> lock(pending.locks[ty % PendingRows::kLockStripes]);
+    if (!pending.rows[ty].load(std::memory_order_relaxed)) return;   // Loaded while we waited
+
+    std::vector<TileHandle> row(static_cast<size_t>(m_tilesX));
+    if (!pending.loader->loadTileRow(ty, row.data())) m_unreadable.store(true, std::memory_order_release);
+    for (int tx = 0; tx < m_tilesX; ++tx) {
+        auto tile = std::const_pointer_cast<Tile>(std::move(row[tx]));
+        if (tile && m_store && !m_store->owns(tile)) {
+            // Loaders decode to the heap; the row moves into the store
+            if (auto stored = m_store->allocate()) {
+                *stored = *tile;
+                tile = std::move(stored);
+            }
+        }
+        m_tiles[ty * m_tilesX + tx] = std::move(tile);
+    }
+    pending.rows[ty].store(false, std::memory_order_release);
+    // Nobody calls the loader once every row is in
+    if (m_pendingRows.fetch_sub(1, std::memory_order_acq_rel) == 1) pending.loader.reset();
+}
+
+void ImageBuffer::dropPending() {
+    m_unreadable.store(false, std::memory_order_release);
+    if (!m_pending) return;
+    m_pendingRows.store(0, std::memory_order_release);
+    m_pending.reset();
+}
+
+bool ImageBuffer::isEmptyAt(int x, int y) const {
+    if (!isTiled()) return false;
+    ensureRow(y / kTileSize);
+    return !m_tiles[(y / kTileSize) * m_tilesX + (x / kTileSize)];
+}
+
+uint8_t* ImageBuffer::rowRun(int x, int y, bool allocate, int* runEnd) {
+    if (!isTiled()) {
+        *runEnd = m_width;
+        return &m_data[pixelIndex(x, y)];
+    }
+    int tx = x / kTileSize;
+    int ty = y / kTileSize;
+    *runEnd = std::min(m_width, (tx + 1) * kTileSize);
+    ensureRow(ty);
+    if (!allocate && !m_tiles[ty * m_tilesX + tx]) return nullptr;
+    uint8_t* tile = mutableTileData(tx, ty);
+    return tile + (y - ty * kTileSize) * kTileStride + (x - tx * kTileSize) * 4;
+}
+
+const uint8_t* ImageBuffer::rowRun(int x, int y, int* runEnd) const {
+    if (!isTiled()) {
+        *runEnd = m_width;
+        return &m_data[pixelIndex(x, y)];
+    }
+    int tx = x / kTileSize;
+    int ty = y / kTileSize;
+    *runEnd = std::min(m_width, (tx + 1) * kTileSize);
+    return tileData(tx, ty) + (y - ty * kTileSize) * kTileStride + (x - tx * kTileSize) * 4;
+}
+
 uint8_t* ImageBuffer::pixelAt(int x, int y) {
     if (!isValidCoord(x, y)) return nullptr;
-    return &m_data[pixelIndex(x, y)];
+    int runEnd;
+    return rowRun(x, y, true, &runEnd);
 }
 
 const uint8_t* ImageBuffer::pixelAt(int x, int y) const {
     if (!isValidCoord(x, y)) return nullptr;
-    return &m_data[pixelIndex(x, y)];
+    int runEnd;
+    return rowRun(x, y, &runEnd);
 }
 
 void ImageBuffer::setPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-    if (!isValidCoord(x, y)) return;
-    size_t idx = pixelIndex(x, y);
-    m_data[idx + 0] = r;
-    m_data[idx + 1] = g;
-    m_data[idx + 2] = b;
-    m_data[idx + 3] = a;
+    uint8_t* px = pixelAt(x, y);
+    if (!px) return;
+    px[0] = r;
+    px[1] = g;
+    px[2] = b;
+    px[3] = a;
+    color::premultiplyAlpha(px);
 }
 
 void ImageBuffer::fill(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
-    for (int y = 0; y < m_height; ++y) {
-        for (int x = 0; x < m_width; ++x) {
-            setPixel(x, y, r, g, b, a);
+    uint8_t px[4] = {r, g, b, a};
+    color::premultiplyAlpha(px);
+    r = px[0];
+    g = px[1];
+    b = px[2];
+
+    if (isTiled()) {
+        if (a == 0) {
+            clear();
+            return;
+        }
+        // Every tile shares one filled tile; the first write to any of them
+        // detaches it through copy-on-write.
+        auto filled = newTile();
+        for (size_t i = 0; i < kTileBytes; i += 4) {
+            (*filled)[i + 0] = r;
+            (*filled)[i + 1] = g;
+            (*filled)[i + 2] = b;
+            (*filled)[i + 3] = a;
         }
+        dropPending();
+        std::fill(m_tiles.begin(), m_tiles.end(), filled);
+        return;
+    }
+
+    for (size_t i = 0; i < m_data.size(); i += 4) {
+        m_data[i + 0] = r;
+        m_data[i + 1] = g;
+        m_data[i + 2] = b;
+        m_data[i + 3] = a;
     }
 }
 
 void ImageBuffer::clear() {
+    if (isTiled()) {
+        dropPending();
+        std::fill(m_tiles.begin(), m_tiles.end(), nullptr);
+        return;
+    }
     std::memset(m_data.data(), 0, m_data.size());
 }
 
 void ImageBuffer::blendPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a, bool alphaLock, bool isEraser) {
     if (!isValidCoord(x, y)) return;
-    
-    size_t idx = pixelIndex(x, y);
-    uint8_t dstAlphaRaw = m_data[idx + 3];
-    if (alphaLock && dstAlphaRaw == 0) return;
+    // Locked or erased pixels of an empty tile can never change
+    if ((alphaLock || isEraser) && isEmptyAt(x, y)) return;
 
-    float srcA = a / 255.0f;
-    float dstA = dstAlphaRaw / 255.0f;
+    int runEnd;
+    blendInto(rowRun(x, y, true, &runEnd), r, g, b, a, alphaLock, isEraser);
+}
 
-    if (isEraser) {
-        // Subtractive Alpha
-        float outA = std::max(0.0f, dstA * (1.0f - srcA));
-        m_data[idx + 3] = static_cast<uint8_t>(std::clamp(outA * 255.0f, 0.0f, 255.0f));
-        return;
+DirtyRect ImageBuffer::drawCircle(float cx, float cy, float radius, 
+                              uint8_t r, uint8_t g, uint8_t b, uint8_t a,
+                              float hardness, float grain, bool alphaLock, bool isEraser, const ImageBuffer* mask,
+                              const SelectionMask* selection) {
+    // Big dabs span several tiles; those render tile-parallel
+    if (radius >= kParallelDabRadius) {
+        Dab dab;
+        dab.x = cx;
+        dab.y = cy;
+        dab.radius = radius;
+        dab.hardness = hardness;
+        dab.grain = grain;
+        dab.r = r;
+        dab.g = g;
+        dab.b = b;
+        dab.a = a;
+        return drawDabs(&dab, 1, alphaLock, isEraser, mask, selection);
     }
 
-    float outA = srcA + dstA * (1.0f - srcA);
+    int baseX, baseY;
+    const auto dab = DabMaskCache::shared().get(cx, cy, radius, hardness, &baseX, &baseY);
+    const int x0 = baseX + dab->originX;
+    const int y0 = baseY + dab->originY;
 
-    if (alphaLock) {
-        outA = dstA; 
-        if (outA <= 0.001f) return;
-        srcA = std::min(srcA, outA); 
+    DirtyRect covered = DirtyRect{x0, y0, dab->width, dab->height}.intersected(m_width, m_height);
+    if (covered.isEmpty() || a == 0) return covered;
+    if (selection && !covered.intersects(selection->bounds())) return covered;
+
+    // Grain scales alpha by (1 - grain) + texture * grain; one table per dab
+    const uint8_t* grainTex = nullptr;
+    uint8_t grainScale[256];
+    if (grain > 0.001f) {
+        grainTex = grainTexture();
+        for (int v = 0; v < 256; ++v) {
+            grainScale[v] = static_cast<uint8_t>(((1.0f - grain) + (v / 255.0f) * grain) * 255.0f + 0.5f);
+        }
     }
-    
-    if (outA > 0.0f) {
-        float invSrcA = 1.0f - srcA;
-        m_data[idx + 0] = static_cast<uint8_t>(std::clamp((r * srcA + m_data[idx + 0] * dstA * invSrcA) / outA, 0.0f, 255.0f));
-        m_data[idx + 1] = static_cast<uint8_t>(std::clamp((g * srcA + m_data[idx + 1] * dstA * invSrcA) / outA, 0.0f, 255.0f));
-        m_data[idx + 2] = static_cast<uint8_t>(std::clamp((b * srcA + m_data[idx + 2] * dstA * invSrcA) / outA, 0.0f, 255.0f));
+
+    // Empty tiles stay empty under alpha lock or the eraser
+    const bool skipEmpty = alphaLock || isEraser;
+    constexpr int kGrainMask = kGrainTextureSize - 1;
+
+    for (int py = covered.y; py < covered.y + covered.h; ++py) {
+        const int j = py - y0;
+        const int xBegin = std::max(x0 + dab->rowSpans[j].first, 0);
+        const int xEnd = std::min(x0 + dab->rowSpans[j].second, m_width);
+        const uint8_t* coverage = dab->row(j);
+        const uint8_t* grainRow = grainTex ? grainTex + (py & kGrainMask) * kGrainTextureSize : nullptr;
+
+        // Current row run; resolved lazily so tiles are only allocated
+        // once a pixel with non-zero coverage lands in them.
+        uint8_t* run = nullptr;
+        int runStart = 0;
+        int runEnd = xBegin;
+
+        // Selection row, indexed by px; refetched per selection tile
+        const uint8_t* selectionRow = nullptr;
+        int selectionEnd = xBegin;
+
+        for (int px = xBegin; px < xEnd; ++px) {
+            uint32_t pixelA = color::div255(a * static_cast<uint32_t>(coverage[px - x0]));
+            if (grainRow) pixelA = color::div255(pixelA * grainScale[grainRow[px & kGrainMask]]);
+
+            // Clipping Mask support
+            if (mask) {
+                const uint8_t* mP = mask->pixelAt(px, py);
+                pixelA = mP ? color::div255(pixelA * mP[3]) : 0;
+            }
+            if (selection) {
+                if (px >= selectionEnd) {
+                    selectionRow = selection->rowData(px, py) - px;
+                    selectionEnd = (px / kTileSize + 1) * kTileSize;
+                }
+                pixelA = color::div255(pixelA * selectionRow[px]);
+            }
+            if (pixelA == 0) continue;
+
+            if (px >= runEnd) {
+                runStart = px;
+                run = rowRun(px, py, !skipEmpty, &runEnd);
+            }
+            if (run) {
+                blendInto(run + (px - runStart) * 4, r, g, b, static_cast<uint8_t>(pixelA), alphaLock, isEraser);
+            }
+        }
     }
-    m_data[idx + 3] = static_cast<uint8_t>(std::clamp(outA * 255.0f, 0.0f, 255.0f));
+    return covered;
 }
 
-void ImageBuffer::drawCircle(int cx, int cy, float radius, 
-                              uint8_t r, uint8_t g, uint8_t b, uint8_t a,
-                              float hardness, float grain, bool alphaLock, bool isEraser, const ImageBuffer* mask) {
-    int minX = std::max(0, static_cast<int>(cx - radius - 1));
-    int maxX = std::min(m_width - 1, static_cast<int>(cx + radius + 1));
-    int minY = std::max(0, static_cast<int>(cy - radius - 1));
-    int maxY = std::min(m_height - 1, static_cast<int>(cy + radius + 1));
-    
-    float radiusSq = radius * radius;
-    
-    for (int py = minY; py <= maxY; ++py) {
-        for (int px = minX; px <= maxX; ++px) {
-            float dx = px - cx;
-            float dy = py - cy;
-            float distSq = dx * dx + dy * dy;
-            
-            if (distSq <= radiusSq) {
-                float dist = std::sqrt(distSq);
-                float normalizedDist = dist / radius;
-                
-                // Hardness affects falloff
-                float falloff = 1.0f;
-                if (normalizedDist > hardness) {
-                    falloff = 1.0f - (normalizedDist - hardness) / (1.0f - hardness);
-                    falloff = std::clamp(falloff, 0.0f, 1.0f);
-                }
+DirtyRect ImageBuffer::drawDabs(const Dab* dabs, size_t count, bool alphaLock, bool isEraser, const ImageBuffer* mask,
+                                const SelectionMask* selection) {
+    // Nothing to batch; skip the tile bookkeeping
+    if (count == 1 && dabs[0].radius < kParallelDabRadius) {
+        const Dab& dab = dabs[0];
+        return drawCircle(dab.x, dab.y, dab.radius, dab.r, dab.g, dab.b, dab.a,
+                          dab.hardness, dab.grain, alphaLock, isEraser, mask, selection);
+    }
 
-                // Grain (Noise) logic - Multi-octave organic texture
-                float noise = 1.0f;
-                if (grain > 0.001f) {
-                    auto getHash = [](float x, float y) {
-                        uint32_t h = (static_cast<uint32_t>(x) * 1597334677U) ^ (static_cast<uint32_t>(y) * 3812015801U);
-                        h *= 0x85ebca6b; h ^= h >> 13; h *= 0xc2b2ae35;
-                        return static_cast<float>(h & 0xFFFF) / 65535.0f;
-                    };
-
-                    // Octave 1: Coarse (Paper grain)
-                    float n1 = getHash(px / 4.0f, py / 4.0f);
-                    // Octave 2: Fine (Pigment/Graphite detail)
-                    float n2 = getHash(px / 1.5f, py / 1.5f);
-                    
-                    float randVal = n1 * 0.7f + n2 * 0.3f;
-                    
-                    // High-contrast curve for "tooth" feeling
-                    float grainVal = (randVal - 0.45f) * 3.0f + 0.5f;
-                    grainVal = std::clamp(grainVal, 0.0f, 1.0f);
-                    
-                    noise = (1.0f - grain) + (grainVal * grain);
+    // Resolve every dab's coverage mask and footprint up front
+    struct PreparedDab {
+        const Dab* dab;
+        std::shared_ptr<const DabMask> coverage;
+        int x0, y0;            // Canvas position of mask pixel (0, 0)
+        DirtyRect rect;        // Footprint clipped to the buffer
+        const uint8_t* grainScale;
+    };
+    std::vector<PreparedDab> prepared;
+    prepared.reserve(count);
+    // Grain scales alpha by (1 - grain) + texture * grain; one table per
+    // distinct grain value (reserved so pointers stay valid)
+    std::vector<std::array<uint8_t, 256>> grainTables;
+    float lastGrain = -1.0f;
+
+    DirtyRect covered;
+    float maxRadius = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        const Dab& dab = dabs[i];
+        maxRadius = std::max(maxRadius, dab.radius);
+        int baseX, baseY;
+        auto coverage = DabMaskCache::shared().get(dab.x, dab.y, dab.radius, dab.hardness, &baseX, &baseY);
+        int x0 = baseX + coverage->originX;
+        int y0 = baseY + coverage->originY;
+        DirtyRect rect = DirtyRect{x0, y0, coverage->width, coverage->height}.intersected(m_width, m_height);
+        covered.unite(rect);
+        if (rect.isEmpty() || dab.a == 0) continue;
+
+        const uint8_t* grainScale = nullptr;
+        if (dab.grain > 0.001f) {
+            if (dab.grain != lastGrain) {
+                if (grainTables.empty()) grainTables.reserve(count);
+                grainTables.emplace_back();
+                for (int v = 0; v < 256; ++v) {
+                    grainTables.back()[v] = static_cast<uint8_t>(((1.0f - dab.grain) + (v / 255.0f) * dab.grain) * 255.0f + 0.5f);
                 }
-                
-                uint8_t pixelA = static_cast<uint8_t>(a * falloff * noise);
-                
-                // Clipping Mask support
-                if (mask) {
-                    const uint8_t* mP = mask->pixelAt(px, py);
-                    if (mP) {
-                        pixelA = static_cast<uint8_t>(pixelA * (mP[3] / 255.0f));
-                    } else {
-                        pixelA = 0;
-                    }
+                lastGrain = dab.grain;
+            }
+            grainScale = grainTables.back().data();
+        }
+        prepared.push_back({&dab, std::move(coverage), x0, y0, rect, grainScale});
+    }
+    if (prepared.empty()) return covered;
+
+    const uint8_t* grainTex = grainTables.empty() ? nullptr : grainTexture();
+    constexpr int kGrainMask = kGrainTextureSize - 1;
+    // Empty tiles stay empty under alpha lock or the eraser
+    const bool skipEmpty = alphaLock || isEraser;
+
+    // The tiles of the union (kTileSize blocks in linear storage too) that
+    // some dab overlaps. Each is resolved once and receives its dabs in
+    // stroke order.
+    struct TileJob {
+        int tx, ty;
+        DirtyRect rect;
+        size_t firstHit, hitCount;   // Range of tileHits
+    };
+    std::vector<TileJob> jobs;
+    std::vector<const PreparedDab*> tileHits;
+    const int tx0 = covered.x / kTileSize;
+    const int tx1 = (covered.x + covered.w - 1) / kTileSize;
+    const int ty0 = covered.y / kTileSize;
+    const int ty1 = (covered.y + covered.h - 1) / kTileSize;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            if (skipEmpty && isTiled() && !isTileAllocated(tx, ty)) continue;
+            if (selection && selection->isTileEmpty(tx, ty)) continue;
+            DirtyRect tileRect = DirtyRect{tx * kTileSize, ty * kTileSize, kTileSize, kTileSize}.intersected(m_width, m_height);
+            const size_t firstHit = tileHits.size();
+            for (const auto& p : prepared) {
+                if (p.rect.intersects(tileRect)) tileHits.push_back(&p);
+            }
+            if (tileHits.size() > firstHit) jobs.push_back({tx, ty, tileRect, firstHit, tileHits.size() - firstHit});
+        }
+    }
+
+    // Tiles touch disjoint pixels (and distinct tile slots), so they can
+    // render concurrently; per tile the order is the serial order.
+    auto renderTile = [&](const TileJob& job) {
+        const int tx = job.tx;
+        const int ty = job.ty;
+        const DirtyRect& tileRect = job.rect;
+
+        const PreparedDab* const* hits = tileHits.data() + job.firstHit;
+        const size_t hitCount = job.hitCount;
+
+        // Selection tile on the same grid; none to apply when fully selected
+        const uint8_t* selectionTile = selection && !selection->isTileFull(tx, ty) ? selection->tileData(tx, ty) : nullptr;
+
+        // Tile storage is resolved (allocated / detached) on the first
+        // pixel that actually changes
+        uint8_t* base = nullptr;
+        const size_t stride = isTiled() ? kTileStride : static_cast<size_t>(m_width) * 4;
+        auto pixel = [&](int px, int py) {
+            if (!base) {
+                base = isTiled() ? mutableTileData(tx, ty) : &m_data[pixelIndex(tileRect.x, tileRect.y)];
+            }
+            return base + (py - tileRect.y) * stride + (px - tileRect.x) * 4;
+        };
+
+        // Consecutive dabs of one color add up their coverage first
+        // (source-over of a color onto itself composes), then blend once per
+        // pixel. `pending` is the part of the accumulator in use; flushing
+        // leaves it zeroed again, so it is cleared only once.
+        uint8_t accumulated[kTileSize * kTileSize];
+        bool accumulatorReady = false;
+        DirtyRect pending;
+
+        // Blend the accumulated coverage of a same-color run and reset it
+        auto flush = [&](const Dab& dab) {
+            for (int py = pending.y; py < pending.y + pending.h; ++py) {
+                uint8_t* row = accumulated + (py - tileRect.y) * kTileSize;
+                for (int px = pending.x; px < pending.x + pending.w; ++px) {
+                    uint8_t& alpha = row[px - tileRect.x];
+                    if (alpha == 0) continue;
+                    blendInto(pixel(px, py), dab.r, dab.g, dab.b, alpha, false, isEraser);
+                    alpha = 0;
                 }
+            }
+            pending = DirtyRect();
+        };
 
-                if (pixelA > 0) {
-                    blendPixel(px, py, r, g, b, pixelA, alphaLock, isEraser);
+        for (size_t h = 0; h < hitCount;) {
+            // Run of consecutive same-color dabs in this tile
+            const Dab& runDab = *hits[h]->dab;
+            size_t runEnd = h + 1;
+            while (runEnd < hitCount && hits[runEnd]->dab->r == runDab.r &&
+                   hits[runEnd]->dab->g == runDab.g && hits[runEnd]->dab->b == runDab.b) {
+                ++runEnd;
+            }
+            // Single dabs and locked alpha (which caps every dab
+            // separately) blend directly
+            const bool direct = alphaLock || runEnd - h == 1;
+            if (!direct && !accumulatorReady) {
+                std::memset(accumulated, 0, sizeof(accumulated));
+                accumulatorReady = true;
+            }
+
+            for (; h < runEnd; ++h) {
+                const PreparedDab* p = hits[h];
+                const Dab& dab = *p->dab;
+                const DirtyRect area = p->rect.intersected(tileRect);
+                if (!direct) pending.unite(area);
+
+                for (int py = area.y; py < area.y + area.h; ++py) {
+                    const int j = py - p->y0;
+                    const int xBegin = std::max(area.x, p->x0 + p->coverage->rowSpans[j].first);
+                    const int xEnd = std::min(area.x + area.w, p->x0 + p->coverage->rowSpans[j].second);
+                    const uint8_t* coverage = p->coverage->row(j);
+                    const uint8_t* grainRow = p->grainScale ? grainTex + (py & kGrainMask) * kGrainTextureSize : nullptr;
+                    uint8_t* accRow = accumulated + (py - tileRect.y) * kTileSize - tileRect.x;
+                    const uint8_t* selectionRow = selectionTile ? selectionTile + (py - tileRect.y) * kTileSize - tileRect.x : nullptr;
+
+                    for (int px = xBegin; px < xEnd; ++px) {
+                        uint32_t pixelA = color::div255(dab.a * static_cast<uint32_t>(coverage[px - p->x0]));
+                        if (grainRow) pixelA = color::div255(pixelA * p->grainScale[grainRow[px & kGrainMask]]);
+
+                        // Clipping Mask support
+                        if (mask) {
+                            const uint8_t* mP = mask->pixelAt(px, py);
+                            pixelA = mP ? color::div255(pixelA * mP[3]) : 0;
+                        }
+                        if (selectionRow) pixelA = color::div255(pixelA * selectionRow[px]);
+                        if (pixelA == 0) continue;
+
+                        if (direct) {
+                            blendInto(pixel(px, py), dab.r, dab.g, dab.b, static_cast<uint8_t>(pixelA), alphaLock, isEraser);
+                        } else {
+                            // Same-color source-over composes: a = a1 + a2 (1 - a1)
+                            uint32_t acc = accRow[px];
+                            accRow[px] = static_cast<uint8_t>(acc + color::div255(pixelA * (255 - acc)));
+                        }
+                    }
                 }
             }
+            if (!direct) flush(runDab);
         }
+    };
+
+    if (jobs.size() > 1 && maxRadius >= kParallelDabRadius) {
+        ThreadPool::shared().parallelFor(jobs.size(), [&](size_t i) { renderTile(jobs[i]); });
+    } else {
+        for (const TileJob& job : jobs) renderTile(job);
     }
+    return covered;
 }
 
 void ImageBuffer::copyFrom(const ImageBuffer& other) {
     if (m_width != other.m_width || m_height != other.m_height) return;
-    std::memcpy(m_data.data(), other.m_data.data(), m_data.size());
+
+    if (isTiled() && other.isTiled()) {
+        other.loadPendingTiles();
+        dropPending();
+        m_tiles = other.m_tiles;  // Shared until either side writes
+        m_unreadable.store(other.hasUnreadableTiles(), std::memory_order_release);
+        return;
+    }
+    if (!isTiled() && !other.isTiled()) {
+        std::memcpy(m_data.data(), other.m_data.data(), m_data.size());
+        return;
+    }
+    if (!isTiled()) {
+        other.readRegion(0, 0, m_width, m_height, m_data.data(), static_cast<size_t>(m_width) * 4);
+        m_unreadable.store(other.hasUnreadableTiles(), std::memory_order_release);
+        return;
+    }
+
+    // Linear -> tiled: only tiles holding visible pixels are allocated
+    clear();
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        for (int tx = 0; tx < m_tilesX; ++tx) {
+            int x0 = tx * kTileSize;
+            int y0 = ty * kTileSize;
+            int w = std::min(kTileSize, m_width - x0);
+            int h = std::min(kTileSize, m_height - y0);
+
+            bool hasContent = false;
+            for (int y = 0; y < h && !hasContent; ++y) {
+                const uint8_t* src = other.m_data.data() + other.pixelIndex(x0, y0 + y);
+                for (int x = 0; x < w; ++x) {
+                    if (src[x * 4 + 3] != 0) { hasContent = true; break; }
+                }
+            }
+            if (!hasContent) continue;
+
+            uint8_t* tile = mutableTileData(tx, ty);
+            for (int y = 0; y < h; ++y) {
+                std::memcpy(tile + y * kTileStride, other.m_data.data() + other.pixelIndex(x0, y0 + y),
+                            static_cast<size_t>(w) * 4);
+            }
+        }
+    }
 }
 
-void ImageBuffer::composite(const ImageBuffer& other, int offsetX, int offsetY, float opacity) {
-    for (int sy = 0; sy < other.height(); ++sy) {
+void ImageBuffer::composite(const ImageBuffer& other, int offsetX, int offsetY, float opacity, BlendMode mode,
+                            const SelectionMask* clip) {
+    int sxBegin = std::max(0, -offsetX);
+    int sxEnd = std::min(other.width(), m_width - offsetX);
+    if (sxBegin >= sxEnd) return;
+
+    // Only rows and columns inside the clip's bounds can change
+    int syBegin = 0;
+    int syEnd = other.height();
+    if (clip) {
+        const DirtyRect& b = clip->bounds();
+        if (b.isEmpty()) return;
+        sxBegin = std::max(sxBegin, b.x - offsetX);
+        sxEnd = std::min(sxEnd, b.x + b.w - offsetX);
+        syBegin = std::max(syBegin, b.y - offsetY);
+        syEnd = std::min(syEnd, b.y + b.h - offsetY);
+        if (sxBegin >= sxEnd) return;
+    }
+
+    // Resolve the mode once; the kernel handles whole row runs
+    const blend::RowKernel kernel = blend::rowKernel(mode);
+
+    for (int sy = syBegin; sy < syEnd; ++sy) {
         int dy = sy + offsetY;
         if (dy < 0 || dy >= m_height) continue;
         
-        for (int sx = 0; sx < other.width(); ++sx) {
-            int dx = sx + offsetX;
-            if (dx < 0 || dx >= m_width) continue;
-            
-            const uint8_t* srcPixel = other.pixelAt(sx, sy);
-            if (srcPixel && srcPixel[3] > 0) {
-                uint8_t effA = static_cast<uint8_t>(srcPixel[3] * opacity);
-                blendPixel(dx, dy, srcPixel[0], srcPixel[1], srcPixel[2], effA);
+        int sx = sxBegin;
+        while (sx < sxEnd) {
+            int srcRunEnd;
+            const uint8_t* src = other.rowRun(sx, sy, &srcRunEnd);
+            srcRunEnd = std::min(srcRunEnd, sxEnd);
+
+            // Nothing to composite from an empty source tile
+            if (other.isEmptyAt(sx, sy)) {
+                sx = srcRunEnd;
+                continue;
+            }
+
+            while (sx < srcRunEnd) {
+                // Skip transparent source pixels first so destination tiles
+                // are only allocated under visible pixels
+                while (sx < srcRunEnd && src[3] == 0) { ++sx; src += 4; }
+                if (sx >= srcRunEnd) break;
+
+                int dstRunEnd;
+                uint8_t* dst = rowRun(sx + offsetX, dy, true, &dstRunEnd);
+                int count = std::min(srcRunEnd, dstRunEnd - offsetX) - sx;
+                if (!clip) {
+                    kernel(dst, src, count, opacity);
+                    sx += count;
+                    src += count * 4;
+                    continue;
+                }
+
+                // Within one selection tile row: runs of 255 blend whole,
+                // runs of 0 are skipped, partly selected runs (anti-aliased
+                // edges) blend whole from a copy of the source scaled by
+                // selection and opacity together
+                const int dx = sx + offsetX;
+                count = std::min(count, (dx / kTileSize + 1) * kTileSize - dx);
+                const uint8_t* sel = clip->rowData(dx, dy);
+                uint8_t scaled[kTileSize * 4];
+                int i = 0;
+                while (i < count) {
+                    const uint8_t v = sel[i];
+                    int j = i + 1;
+                    if (v == 0 || v == 255) {
+                        while (j < count && sel[j] == v) ++j;
+                        if (v == 255) kernel(dst + i * 4, src + i * 4, j - i, opacity);
+                    } else {
+                        while (j < count && sel[j] != 0 && sel[j] != 255) ++j;
+                        for (int k = i; k < j; ++k) {
+                            const uint32_t weight = static_cast<uint32_t>(std::clamp(opacity, 0.0f, 1.0f) * sel[k] + 0.5f);
+                            for (int c = 0; c < 4; ++c) {
+                                scaled[(k - i) * 4 + c] = static_cast<uint8_t>(color::div255(src[k * 4 + c] * weight));
+                            }
+                        }
+                        kernel(dst + i * 4, scaled, j - i, 1.0f);
+                    }
+                    i = j;
+                }
+                sx += count;
+                src += count * 4;
             }
         }
     }
 }
 
+void ImageBuffer::readRegion(int x, int y, int w, int h, uint8_t* dst, size_t dstStride) const {
+    for (int row = 0; row < h; ++row) {
+        uint8_t* out = dst + row * dstStride;
+        int py = y + row;
+        if (py < 0 || py >= m_height) {
+            std::memset(out, 0, static_cast<size_t>(w) * 4);
+            continue;
+        }
+
+        int px = x;
+        int xEnd = x + w;
+        while (px < xEnd) {
+            if (px < 0 || px >= m_width) {
+                int stop = px < 0 ? std::min(0, xEnd) : xEnd;
+                std::memset(out, 0, static_cast<size_t>(stop - px) * 4);
+                out += (stop - px) * 4;
+                px = stop;
+                continue;
+            }
+            int runEnd;
+            const uint8_t* src = rowRun(px, py, &runEnd);
+            int count = std::min(runEnd, xEnd) - px;
+            std::memcpy(out, src, static_cast<size_t>(count) * 4);
+            out += count * 4;
+            px += count;
+        }
+    }
+}
+
 void ImageBuffer::drawStrokeTextured(float x1, float y1, float x2, float y2, 
                                     const ImageBuffer& stamp, 
                                     float spacing, float opacity, 
@@ -248,35 +901,41 @@ void ImageBuffer::drawStrokeTextured(float x1, float y1, float x2, float y2,
                 }
                 
                 // 4. Blend
-                // Simple alpha blend for now (replace reading destination for speed if needed, but read is required for mix)
                 uint8_t* dPixel = this->pixelAt(destX, destY);
                 
-                // Source Alpha with modifications
-                float finalAlpha = (sA / 255.0f) * opacity * paperMod;
-                if (finalAlpha > 1.0f) finalAlpha = 1.0f;
-                
-                // Standard Source-Over Blending
-                // out = src * alpha + dst * (1 - alpha)
-                float a = finalAlpha;
-                float invA = 1.0f - a;
+                // Source alpha with modifications, capped at opaque
+                float scale = std::min(opacity * paperMod, 255.0f / sA);
+                uint32_t a = std::min<uint32_t>(255, static_cast<uint32_t>(sA * scale + 0.5f));
+                uint32_t invA = 255 - a;
                 
-                dPixel[0] = static_cast<uint8_t>(sPixel[0] * a + dPixel[0] * invA);
-                dPixel[1] = static_cast<uint8_t>(sPixel[1] * a + dPixel[1] * invA);
-                dPixel[2] = static_cast<uint8_t>(sPixel[2] * a + dPixel[2] * invA);
-                dPixel[3] = static_cast<uint8_t>(255 * a + dPixel[3] * invA); // Simplified alpha addition
+                // Premultiplied source-over: out = src + dst * (1 - alpha)
+                for (int c = 0; c < 3; ++c) {
+                    uint32_t s = std::min<uint32_t>(a, static_cast<uint32_t>(sPixel[c] * scale + 0.5f));
+                    dPixel[c] = static_cast<uint8_t>(s + div255(dPixel[c] * invA));
+                }
+                dPixel[3] = static_cast<uint8_t>(a + div255(dPixel[3] * invA));
             }
         }
     }
 }
 
 std::vector<uint8_t> ImageBuffer::getBytes() const {
-    return m_data;
+    std::vector<uint8_t> bytes;
+    if (isTiled()) {
+        bytes.resize(static_cast<size_t>(m_width) * m_height * 4);
+        readRegion(0, 0, m_width, m_height, bytes.data(), static_cast<size_t>(m_width) * 4);
+    } else {
+        bytes = m_data;
+    }
+    color::unpremultiplyRow(bytes.data(), bytes.size() / 4);
+    return bytes;
 }
 
 std::unique_ptr<ImageBuffer> ImageBuffer::fromBytes(const std::vector<uint8_t>& bytes, int width, int height) {
     auto buffer = std::make_unique<ImageBuffer>(width, height);
     if (bytes.size() == buffer->m_data.size()) {
         std::memcpy(buffer->m_data.data(), bytes.data(), bytes.size());
+        color::premultiplyRow(buffer->m_data.data(), buffer->m_data.size() / 4);
     }
     return buffer;
 }
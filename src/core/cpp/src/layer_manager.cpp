@@ -3,19 +3,52 @@
  */
 
 #include "layer_manager.h"
+#include "color_utils.h"
+#include "thread_pool.h"
 #include <algorithm>
+#include <cstring>
 
 namespace artflow {
 
+namespace {
+
+// True if any pixel of the w x h block has non-zero alpha
+bool hasCoverage(const uint8_t* pixels, int w, int h, size_t stride) {
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* row = pixels + y * stride;
+        for (int x = 0; x < w; ++x) {
+            if (row[x * 4 + 3]) return true;
+        }
+    }
+    return false;
+}
+
+} // anonymous namespace
+
 Layer::Layer(const std::string& name, int width, int height, Type type)
     : name(name)
-    , buffer(std::make_unique<ImageBuffer>(width, height))
-    , wetnessMap(std::make_unique<ImageBuffer>(width, height))
-    , pigmentMap(std::make_unique<ImageBuffer>(width, height)) 
+    , buffer(std::make_unique<ImageBuffer>(width, height, ImageBuffer::Storage::Tiled))
     , type(type)
 {
 }
 
+void Layer::ensureWetMaps() {
+    if (!wetnessMap) wetnessMap = std::make_unique<ChannelBuffer>(buffer->width(), buffer->height());
+    if (!pigmentMap) pigmentMap = std::make_unique<ChannelBuffer>(buffer->width(), buffer->height());
+}
+
+size_t Layer::memoryUsage() const {
+    std::unordered_set<const ImageBuffer::Tile*> counted;
+    return memoryUsage(counted);
+}
+
+size_t Layer::memoryUsage(std::unordered_set<const ImageBuffer::Tile*>& counted) const {
+    size_t bytes = buffer->memoryUsage(counted);
+    if (wetnessMap) bytes += wetnessMap->memoryUsage();
+    if (pigmentMap) bytes += pigmentMap->memoryUsage();
+    return bytes;
+}
+
 LayerManager::LayerManager(int width, int height)
     : m_width(width), m_height(height) {
     // Create default background layer
@@ -27,8 +60,11 @@ LayerManager::~LayerManager() = default;
 
 int LayerManager::addLayer(const std::string& name, Layer::Type type) {
     auto layer = std::make_unique<Layer>(name, m_width, m_height, type);
+    layer->id = m_nextLayerId++;
+    layer->buffer->setTileStore(m_tileStore);
     m_layers.push_back(std::move(layer));
     m_activeIndex = static_cast<int>(m_layers.size()) - 1;
+    invalidateComposite();
     return m_activeIndex;
 }
 
@@ -38,6 +74,7 @@ void LayerManager::removeLayer(int index) {
     
     m_layers.erase(m_layers.begin() + index);
     m_activeIndex = std::clamp(m_activeIndex, 0, static_cast<int>(m_layers.size()) - 1);
+    invalidateComposite();
 }
 
 void LayerManager::moveLayer(int fromIndex, int toIndex) {
@@ -47,6 +84,7 @@ void LayerManager::moveLayer(int fromIndex, int toIndex) {
     auto layer = std::move(m_layers[fromIndex]);
     m_layers.erase(m_layers.begin() + fromIndex);
     m_layers.insert(m_layers.begin() + toIndex, std::move(layer));
+    invalidateComposite();
 }
 
 void LayerManager::duplicateLayer(int index) {
@@ -54,9 +92,14 @@ void LayerManager::duplicateLayer(int index) {
     
     const Layer* src = m_layers[index].get();
     auto newLayer = std::make_unique<Layer>(src->name + " Copy", m_width, m_height);
+    newLayer->id = m_nextLayerId++;
+    newLayer->buffer->setTileStore(m_tileStore);
     newLayer->buffer->copyFrom(*src->buffer);
-    newLayer->wetnessMap->copyFrom(*src->wetnessMap);
-    newLayer->pigmentMap->copyFrom(*src->pigmentMap);
+    if (src->hasWetMaps()) {
+        newLayer->ensureWetMaps();
+        newLayer->wetnessMap->copyFrom(*src->wetnessMap);
+        newLayer->pigmentMap->copyFrom(*src->pigmentMap);
+    }
     newLayer->opacity = src->opacity;
     newLayer->blendMode = src->blendMode;
     newLayer->visible = src->visible;
@@ -64,8 +107,12 @@ void LayerManager::duplicateLayer(int index) {
     newLayer->clipped = src->clipped;
     newLayer->isPrivate = src->isPrivate;
     newLayer->type = src->type;
+    newLayer->savedBlendMode = src->savedBlendMode;
+    newLayer->depth = src->depth;
+    newLayer->expanded = src->expanded;
     
     m_layers.insert(m_layers.begin() + index + 1, std::move(newLayer));
+    invalidateComposite();
 }
 
 void LayerManager::mergeDown(int index) {
@@ -76,8 +123,8 @@ void LayerManager::mergeDown(int index) {
     
     if (!top->visible) return;
     
-    bottom->buffer->composite(*top->buffer, 0, 0, top->opacity);
-    removeLayer(index);
+    bottom->buffer->composite(*top->buffer, 0, 0, top->opacity, top->blendMode);
+    removeLayer(index);  // Invalidates the composite caches
 }
 
 Layer* LayerManager::getLayer(int index) {
@@ -90,9 +137,17 @@ const Layer* LayerManager::getLayer(int index) const {
     return m_layers[index].get();
 }
 
+Layer* LayerManager::findLayerById(int id) {
+    for (const auto& layer : m_layers) {
+        if (layer->id == id) return layer.get();
+    }
+    return nullptr;
+}
+
 void LayerManager::setActiveLayer(int index) {
-    if (index >= 0 && index < static_cast<int>(m_layers.size())) {
+    if (index >= 0 && index < static_cast<int>(m_layers.size()) && index != m_activeIndex) {
         m_activeIndex = index;
+        invalidateComposite();
     }
 }
 
@@ -100,6 +155,27 @@ Layer* LayerManager::getActiveLayer() {
     return getLayer(m_activeIndex);
 }
 
+size_t LayerManager::getLayerMemoryUsage(int index) const {
+    const Layer* layer = getLayer(index);
+    return layer ? layer->memoryUsage() : 0;
+}
+
+size_t LayerManager::getMemoryUsage() const {
+    std::unordered_set<const ImageBuffer::Tile*> counted;
+    size_t bytes = 0;
+    for (const auto& layer : m_layers) {
+        bytes += layer->memoryUsage(counted);
+    }
+    return bytes;
+}
+
+void LayerManager::setTileStore(std::shared_ptr<TileStore> store) {
+    m_tileStore = std::move(store);
+    for (const auto& layer : m_layers) layer->buffer->setTileStore(m_tileStore);
+    if (m_belowCache) m_belowCache->setTileStore(m_tileStore);
+    if (m_aboveCache) m_aboveCache->setTileStore(m_tileStore);
+}
+
 void LayerManager::sampleColor(int x, int y, uint8_t* r, uint8_t* g, uint8_t* b, uint8_t* a, int mode) const {
     if (x < 0 || x >= m_width || y < 0 || y >= m_height) {
         *r = *g = *b = *a = 0;
@@ -109,48 +185,190 @@ void LayerManager::sampleColor(int x, int y, uint8_t* r, uint8_t* g, uint8_t* b,
     if (mode == 1) { // Current Layer
         const Layer* l = getLayer(m_activeIndex);
         if (l) {
-            const uint8_t* p = l->buffer->pixelAt(x, y);
+            const ImageBuffer& buffer = *l->buffer;   // Reads must not allocate or detach tiles
+            const uint8_t* p = buffer.pixelAt(x, y);
             if (p) {
-                *r = p[0]; *g = p[1]; *b = p[2]; *a = p[3];
+                uint8_t px[4] = {p[0], p[1], p[2], p[3]};
+                color::unpremultiplyAlpha(px);
+                *r = px[0]; *g = px[1]; *b = px[2]; *a = px[3];
                 return;
             }
         }
     } else { // Composite
         // We could use compositeAll to a 1x1 buffer, but for many samplings 
         // a manual loop is faster.
+        // Premultiplied accumulation; one division at the end
         float fr = 0, fg = 0, fb = 0, fa = 0;
         for (const auto& layer : m_layers) {
             if (!layer->visible || layer->opacity < 0.01f) continue;
-            const uint8_t* p = layer->buffer->pixelAt(x, y);
+            const ImageBuffer& buffer = *layer->buffer;
+            const uint8_t* p = buffer.pixelAt(x, y);
             if (!p || p[3] == 0) continue;
 
-            float srcA = (p[3] / 255.0f) * layer->opacity;
-            float invA = 1.0f - srcA;
+            float opacity = layer->opacity;
+            float invA = 1.0f - (p[3] / 255.0f) * opacity;
             
-            fr = p[0] * srcA + fr * invA;
-            fg = p[1] * srcA + fg * invA;
-            fb = p[2] * srcA + fb * invA;
-            fa = srcA + fa * invA;
+            fr = p[0] * opacity + fr * invA;
+            fg = p[1] * opacity + fg * invA;
+            fb = p[2] * opacity + fb * invA;
+            fa = p[3] * opacity + fa * invA;
         }
-        *r = (uint8_t)std::clamp(fr, 0.0f, 255.0f);
-        *g = (uint8_t)std::clamp(fg, 0.0f, 255.0f);
-        *b = (uint8_t)std::clamp(fb, 0.0f, 255.0f);
-        *a = (uint8_t)std::clamp(fa * 255.0f, 0.0f, 255.0f);
+        float scale = fa > 0.0f ? 1.0f / fa : 0.0f;
+        *r = (uint8_t)std::clamp(fr * scale * 255.0f, 0.0f, 255.0f);
+        *g = (uint8_t)std::clamp(fg * scale * 255.0f, 0.0f, 255.0f);
+        *b = (uint8_t)std::clamp(fb * scale * 255.0f, 0.0f, 255.0f);
+        *a = (uint8_t)std::clamp(fa, 0.0f, 255.0f);
         return;
     }
     *r = *g = *b = *a = 0;
 }
 
+DirtyRect LayerManager::floodFill(int index, int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a,
+                                  const FillOptions& options, bool sampleAllLayers) {
+    Layer* layer = getLayer(index);
+    if (!layer || layer->locked) return DirtyRect();
+
+    DirtyRect filled;
+    if (sampleAllLayers) {
+        // Tiled: only tiles some layer covers get allocated
+        ImageBuffer composite(m_width, m_height, ImageBuffer::Storage::Tiled);
+        compositeAll(composite);
+        filled = artflow::floodFill(*layer->buffer, x, y, r, g, b, a, options, &composite);
+    } else {
+        filled = artflow::floodFill(*layer->buffer, x, y, r, g, b, a, options);
+    }
+    if (!filled.isEmpty() && index != m_activeIndex) invalidateComposite();
+    return filled;
+}
+
+const ImageBuffer& LayerManager::compositeBelowActive() {
+    if (!m_belowCache) {
+        m_belowCache = std::make_unique<ImageBuffer>(m_width, m_height, ImageBuffer::Storage::Tiled);
+        m_belowCache->setTileStore(m_tileStore);
+    }
+    if (!m_belowValid) {
+        compositeRange(*m_belowCache, 0, m_activeIndex);
+        m_belowValid = true;
+    }
+    return *m_belowCache;
+}
+
+const ImageBuffer& LayerManager::compositeAboveActive() {
+    if (!m_aboveCache) {
+        m_aboveCache = std::make_unique<ImageBuffer>(m_width, m_height, ImageBuffer::Storage::Tiled);
+        m_aboveCache->setTileStore(m_tileStore);
+    }
+    if (!m_aboveValid) {
+        compositeRange(*m_aboveCache, m_activeIndex + 1, static_cast<int>(m_layers.size()));
+        m_aboveValid = true;
+    }
+    return *m_aboveCache;
+}
+
+bool LayerManager::canCacheAboveActive() const {
+    for (int i = m_activeIndex + 1; i < static_cast<int>(m_layers.size()); ++i) {
+        const Layer& layer = *m_layers[i];
+        if (layer.visible && layer.blendMode != BlendMode::Normal) return false;
+    }
+    return true;
+}
+
+void LayerManager::invalidateComposite() {
+    m_belowValid = false;
+    m_aboveValid = false;
+}
+
+void LayerManager::compositeRange(ImageBuffer& output, int begin, int end) const {
+    std::vector<const Layer*> layers;
+    for (int i = std::max(begin, 0); i < end; ++i) {
+        if (m_layers[i]->visible) layers.push_back(m_layers[i].get());
+    }
+    compositeLayers(output, layers);
+}
+
 void LayerManager::compositeAll(ImageBuffer& output, bool skipPrivate) const {
-    output.clear();
-    
     // Composite from bottom to top
+    std::vector<const Layer*> layers;
     for (const auto& layer : m_layers) {
         if (layer->visible) {
             if (skipPrivate && layer->isPrivate) continue;
-            output.composite(*layer->buffer, 0, 0, layer->opacity);
+            layers.push_back(layer.get());
+        }
+    }
+    compositeLayers(output, layers);
+}
+
+void LayerManager::compositeLayers(ImageBuffer& output, const std::vector<const Layer*>& layers) const {
+    output.clear();
+    if (layers.empty()) return;
+
+    if (output.width() != m_width || output.height() != m_height) {
+        // Not canvas-sized: clip through the generic path
+        for (const Layer* layer : layers) {
+            output.composite(*layer->buffer, 0, 0, layer->opacity, layer->blendMode);
         }
+        return;
     }
+
+    // Tile-major: every output tile goes through the whole stack in a
+    // scratch tile that stays in cache, and tiles run in parallel. Layer
+    // tiles that are unallocated or fully transparent are left out; a tile
+    // none of the layers covers is never touched (stays unallocated).
+    constexpr int ts = ImageBuffer::kTileSize;
+    const int tilesX = (m_width + ts - 1) / ts;
+    const int tilesY = (m_height + ts - 1) / ts;
+
+    ThreadPool::shared().parallelFor(static_cast<size_t>(tilesX) * tilesY, [&](size_t index) {
+        const int tx = static_cast<int>(index % tilesX);
+        const int ty = static_cast<int>(index / tilesX);
+        const int w = std::min(ts, m_width - tx * ts);
+        const int h = std::min(ts, m_height - ty * ts);
+
+        alignas(64) uint8_t scratch[ImageBuffer::kTileBytes];
+        bool touched = false;
+
+        for (const Layer* layer : layers) {
+            const ImageBuffer& buffer = *layer->buffer;
+            const uint8_t* src;
+            size_t stride;
+            if (buffer.isTiled()) {
+                if (!buffer.isTileAllocated(tx, ty)) continue;
+                src = buffer.tileData(tx, ty);
+                stride = ImageBuffer::kTileStride;
+            } else {
+                stride = static_cast<size_t>(m_width) * 4;
+                src = buffer.data() + ty * ts * stride + tx * ts * 4;
+            }
+            if (!hasCoverage(src, w, h, stride)) continue;
+
+            if (!touched) {
+                std::memset(scratch, 0, sizeof(scratch));
+                touched = true;
+            }
+            const blend::RowKernel kernel = blend::rowKernel(layer->blendMode);
+            for (int y = 0; y < h; ++y) {
+                kernel(scratch + y * ImageBuffer::kTileStride, src + y * stride, w, layer->opacity);
+            }
+        }
+        if (!touched) return;
+
+        uint8_t* dst;
+        size_t dstStride;
+        if (output.isTiled()) {
+            dst = output.mutableTileData(tx, ty);
+            dstStride = ImageBuffer::kTileStride;
+        } else {
+            dstStride = static_cast<size_t>(m_width) * 4;
+            dst = output.data() + ty * ts * dstStride + tx * ts * 4;
+        }
+        for (int y = 0; y < h; ++y) {
+            std::memcpy(dst + y * dstStride, scratch + y * ImageBuffer::kTileStride, w * 4);
+        }
+    });
+}
+
+void LayerManager::blendColors(uint8_t* dst, const uint8_t* src, BlendMode mode, float opacity) {
+    blend::rowKernel(mode)(dst, src, 1, opacity);
 }
 
 } // namespace artflow
@@ -0,0 +1,203 @@
+/**
+ * ArtFlow Studio - Paint Thread Implementation
+ */
+
+#include "paint_thread.h"
+#include "layer_manager.h"
+#include "stroke_log.h"
+#include <algorithm>
+
+namespace artflow {
+
+PaintThread::PaintThread(LayerManager* layers, std::function<void()> notify)
+    : m_layers(layers)
+    , m_notify(std::move(notify))
+    , m_queue(kQueueCapacity)
+    , m_thread(&PaintThread::run, this) {
+}
+
+PaintThread::~PaintThread() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+void PaintThread::setLayerManager(LayerManager* layers) {
+    std::lock_guard<std::mutex> lock(m_canvasMutex);
+    m_layers = layers;
+}
+
+// ============================================================================
+// Input (UI thread)
+// ============================================================================
+
+void PaintThread::beginStroke(const Stroke& stroke, const StrokePoint& point) {
+    Event event;
+    event.type = Event::Type::Begin;
+    event.point = point;
+    event.stroke = std::make_shared<const Stroke>(stroke);
+    push(std::move(event));
+}
+
+bool PaintThread::addPoint(const StrokePoint& point) {
+    Event event;
+    event.type = Event::Type::Move;
+    event.point = point;
+    event.queued = Clock::now();
+    if (!m_queue.tryPush(std::move(event))) {
+        // Later segments start from the last rendered point, so a dropped
+        // point only straightens the path locally
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        wake();
+        return false;
+    }
+    m_queued.fetch_add(1, std::memory_order_relaxed);
+    wake();
+    return true;
+}
+
+void PaintThread::endStroke() {
+    Event event;
+    event.type = Event::Type::End;
+    push(std::move(event));
+}
+
+void PaintThread::push(Event&& event) {
+    event.queued = Clock::now();
+    while (!m_queue.tryPush(std::move(event))) {
+        // Full: let the paint thread catch up rather than lose a stroke edge
+        wake();
+        std::this_thread::yield();
+    }
+    m_queued.fetch_add(1, std::memory_order_relaxed);
+    wake();
+}
+
+void PaintThread::wake() {
+    // Pairs with the fence in run(): either the thread sees the new event
+    // before it sleeps, or we see it sleeping and notify
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake.notify_one();
+    }
+}
+
+void PaintThread::waitIdle() {
+    wake();
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_idle.wait(lock, [this] { return m_sleeping.load() && m_queue.empty(); });
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+
+DirtyRect PaintThread::takeDirty() {
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    const int front = m_backDirty;
+    m_backDirty ^= 1;
+    DirtyRect dirty = m_dirty[front];
+    m_dirty[front] = DirtyRect();
+    return dirty;
+}
+
+PaintThread::Stats PaintThread::stats() const {
+    Stats stats;
+    stats.eventsQueued = m_queued.load(std::memory_order_relaxed);
+    stats.eventsDropped = m_dropped.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    stats.eventsRendered = m_rendered;
+    stats.meanLatencyMs = m_rendered ? m_latencySumMs / m_rendered : 0.0;
+    stats.maxLatencyMs = m_latencyMaxMs;
+    return stats;
+}
+
+void PaintThread::resetStats() {
+    m_queued.store(0, std::memory_order_relaxed);
+    m_dropped.store(0, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    m_rendered = 0;
+    m_latencySumMs = 0.0;
+    m_latencyMaxMs = 0.0;
+}
+
+void PaintThread::publish(const DirtyRect& dirty, Clock::time_point queued, bool finished) {
+    const double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - queued).count();
+    bool notify = finished;
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        DirtyRect& back = m_dirty[m_backDirty];
+        if (!dirty.isEmpty() && back.isEmpty()) notify = true;   // UI has nothing pending yet
+        back.unite(dirty);
+
+        ++m_rendered;
+        m_latencySumMs += latencyMs;
+        m_latencyMaxMs = std::max(m_latencyMaxMs, latencyMs);
+    }
+    if (notify && m_notify) m_notify();
+}
+
+// ============================================================================
+// Paint thread
+// ============================================================================
+
+void PaintThread::run() {
+    Event event;
+    for (;;) {
+        if (m_queue.tryPop(event)) {
+            render(event);
+            event.stroke.reset();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        m_idle.notify_all();
+        m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+        m_sleeping.store(false, std::memory_order_relaxed);
+        if (m_stopping) break;   // Unrendered input is discarded
+    }
+}
+
+void PaintThread::render(const Event& event) {
+    if (event.type == Event::Type::End) {
+        if (m_stroke) m_engine.endStroke();
+        m_stroke.reset();
+        m_finishedStrokes.fetch_add(1, std::memory_order_release);
+        publish(DirtyRect(), event.queued, true);
+        return;
+    }
+
+    if (event.type == Event::Type::Begin) {
+        m_stroke = event.stroke;
+        m_engine.setBrush(m_stroke->brush);
+        m_engine.setColor(m_stroke->color);
+        m_engine.beginStroke(event.point, m_stroke->seed);
+    }
+    if (!m_stroke) return;
+
+    DirtyRect dirty;
+    {
+        std::lock_guard<std::mutex> lock(m_canvasMutex);
+        // Resolved per event: the layer may have been removed mid-stroke
+        Layer* layer = m_layers ? m_layers->findLayerById(m_stroke->layerId) : nullptr;
+        if (layer) {
+            Layer* maskLayer = m_stroke->maskLayerId >= 0 ? m_layers->findLayerById(m_stroke->maskLayerId) : nullptr;
+            const ImageBuffer* mask = maskLayer ? maskLayer->buffer.get() : nullptr;
+            const bool first = event.type == Event::Type::Begin;
+            dirty = renderStrokeStep(m_engine, *layer, mask, m_stroke->alphaLock,
+                                     first ? nullptr : &m_lastPoint, event.point, m_stroke->selection.get());
+        }
+    }
+    m_lastPoint = event.point;
+    publish(dirty, event.queued, false);
+}
+
+} // namespace artflow
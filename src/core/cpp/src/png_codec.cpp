@@ -0,0 +1,626 @@
+/**
+ * ArtFlow Studio - PNG Codec Implementation
+ */
+
+#include "png_codec.h"
+#include "color_utils.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <zlib.h>
+
+namespace artflow {
+namespace png {
+
+namespace {
+
+constexpr uint8_t kSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+constexpr uint8_t kIndexVersion = 1;
+constexpr size_t kIndexHeaderBytes = 9;          // version, bandRows, bandCount
+constexpr uint64_t kMaxChunkBytes = 0x7FFFFFFF;  // PNG limit on a chunk's length
+constexpr uint32_t kMaxDimension = 1u << 16;
+
+enum Filter : uint8_t { kNone = 0, kSub, kUp, kAverage, kPaeth };
+
+enum ColorType : uint8_t { kGray = 0, kRGB = 2, kPalette = 3, kGrayAlpha = 4, kRGBA = 6 };
+
+uint32_t get32(const uint8_t* in) {
+    return (uint32_t(in[0]) << 24) | (uint32_t(in[1]) << 16) | (uint32_t(in[2]) << 8) | in[3];
+}
+
+uint64_t get64(const uint8_t* in) {
+    return (uint64_t(get32(in)) << 32) | get32(in + 4);
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+}
+
+void put64(std::vector<uint8_t>& out, uint64_t value) {
+    put32(out, static_cast<uint32_t>(value >> 32));
+    put32(out, static_cast<uint32_t>(value));
+}
+
+void appendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t bytes) {
+    put32(out, static_cast<uint32_t>(bytes));
+    const size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + bytes);
+    put32(out, static_cast<uint32_t>(crc32(0L, &out[start], static_cast<uInt>(bytes + 4))));
+}
+
+// PNG spec 9.4
+inline int paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+// Undo filtering in place; false on an unknown filter type
+bool unfilterRow(uint8_t type, uint8_t* row, const uint8_t* prev, size_t bytes, size_t bpp) {
+    switch (type) {
+        case kNone:
+            return true;
+        case kSub:
+            for (size_t i = bpp; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]);
+            return true;
+        case kUp:
+            if (prev) {
+                for (size_t i = 0; i < bytes; ++i) row[i] = static_cast<uint8_t>(row[i] + prev[i]);
+            }
+            return true;
+        case kAverage:
+            for (size_t i = 0; i < bytes; ++i) {
+                const int a = i >= bpp ? row[i - bpp] : 0;
+                const int b = prev ? prev[i] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + ((a + b) >> 1));
+            }
+            return true;
+        case kPaeth:
+            for (size_t i = 0; i < bytes; ++i) {
+                const int a = i >= bpp ? row[i - bpp] : 0;
+                const int b = prev ? prev[i] : 0;
+                const int c = prev && i >= bpp ? prev[i - bpp] : 0;
+                row[i] = static_cast<uint8_t>(row[i] + paeth(a, b, c));
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+inline uint64_t residualCost(const uint8_t* residuals, size_t bytes) {
+    uint64_t cost = 0;
+    for (size_t i = 0; i < bytes; ++i) cost += static_cast<uint64_t>(std::abs(static_cast<int8_t>(residuals[i])));
+    return cost;
+}
+
+// Residuals of RGBA8 `row` under filter `type` against `prev` (the row
+// above; only read by Up, Average and Paeth)
+void filterRow(uint8_t type, const uint8_t* row, const uint8_t* prev, size_t bytes, uint8_t* out) {
+    constexpr size_t bpp = 4;
+    switch (type) {
+        case kSub:
+            for (size_t i = 0; i < bpp; ++i) out[i] = row[i];
+            for (size_t i = bpp; i < bytes; ++i) out[i] = static_cast<uint8_t>(row[i] - row[i - bpp]);
+            break;
+        case kUp:
+            for (size_t i = 0; i < bytes; ++i) out[i] = static_cast<uint8_t>(row[i] - prev[i]);
+            break;
+        case kAverage:
+            for (size_t i = 0; i < bpp; ++i) out[i] = static_cast<uint8_t>(row[i] - (prev[i] >> 1));
+            for (size_t i = bpp; i < bytes; ++i) {
+                out[i] = static_cast<uint8_t>(row[i] - ((row[i - bpp] + prev[i]) >> 1));
+            }
+            break;
+        case kPaeth:
+            for (size_t i = 0; i < bpp; ++i) out[i] = static_cast<uint8_t>(row[i] - prev[i]);
+            for (size_t i = bpp; i < bytes; ++i) {
+                out[i] = static_cast<uint8_t>(row[i] - paeth(row[i - bpp], prev[i], prev[i - bpp]));
+            }
+            break;
+        default:
+            std::memcpy(out, row, bytes);
+            break;
+    }
+}
+
+// Write the filter byte and filtered bytes of `row` to `out`, picking the
+// filter with the smallest sum of absolute (signed) residuals. Without
+// `prev` only filters that ignore the row above are tried.
+void filterBest(const uint8_t* row, const uint8_t* prev, size_t bytes, std::vector<uint8_t>& scratch, uint8_t* out) {
+    scratch.resize(bytes);
+    out[0] = kNone;
+    std::memcpy(out + 1, row, bytes);
+    uint64_t bestCost = residualCost(row, bytes);
+    const uint8_t last = prev ? kPaeth : kSub;
+    for (uint8_t type = kSub; type <= last && bestCost > 0; ++type) {
+        filterRow(type, row, prev, bytes, scratch.data());
+        const uint64_t cost = residualCost(scratch.data(), bytes);
+        if (cost < bestCost) {
+            bestCost = cost;
+            out[0] = type;
+            std::memcpy(out + 1, scratch.data(), bytes);
+        }
+    }
+}
+
+// Premultiply `rowCount` straight RGBA rows (`stride` bytes apart, `width`
+// pixels each) into one row of tiles; tiles with no visible pixel are left
+// nullptr so they stay unallocated
+void rowsToTiles(const uint8_t* rows, size_t stride, int width, int rowCount, ImageBuffer::TileHandle* tiles) {
+    constexpr int ts = ImageBuffer::kTileSize;
+    const int tilesX = (width + ts - 1) / ts;
+    for (int tx = 0; tx < tilesX; ++tx) {
+        const int x0 = tx * ts;
+        const int w = std::min(ts, width - x0);
+        bool visible = false;
+        for (int y = 0; y < rowCount && !visible; ++y) {
+            const uint8_t* src = rows + y * stride + x0 * 4;
+            for (int x = 0; x < w; ++x) {
+                if (src[x * 4 + 3] != 0) { visible = true; break; }
+            }
+        }
+        if (!visible) {
+            tiles[tx] = nullptr;
+            continue;
+        }
+        auto tile = std::make_shared<ImageBuffer::Tile>();
+        for (int y = 0; y < rowCount; ++y) {
+            uint8_t* dst = tile->data() + y * ImageBuffer::kTileStride;
+            std::memcpy(dst, rows + y * stride + x0 * 4, static_cast<size_t>(w) * 4);
+            color::premultiplyRow(dst, static_cast<size_t>(w));
+        }
+        tiles[tx] = std::move(tile);
+    }
+}
+
+struct Header {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t depth = 0;
+    uint8_t colorType = 0;
+    uint8_t interlace = 0;
+
+    int channels() const {
+        switch (colorType) {
+            case kRGB: return 3;
+            case kGrayAlpha: return 2;
+            case kRGBA: return 4;
+            default: return 1;
+        }
+    }
+    size_t rowBytes() const { return (static_cast<size_t>(width) * channels() * depth + 7) / 8; }
+    size_t filterUnit() const { return std::max<size_t>(1, static_cast<size_t>(channels()) * depth / 8); }
+
+    bool valid() const {
+        if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension) return false;
+        switch (colorType) {
+            case kGray: return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+            case kPalette: return depth == 1 || depth == 2 || depth == 4 || depth == 8;
+            case kRGB: case kGrayAlpha: case kRGBA: return depth == 8 || depth == 16;
+            default: return false;
+        }
+    }
+};
+
+// Everything a decoder needs besides the pixel data
+struct Image {
+    Header header;
+    std::array<std::array<uint8_t, 4>, 256> palette{};   // RGBA, alpha from tRNS
+    bool hasKey = false;                                   // tRNS color key (gray/RGB)
+    uint16_t key[3] = {0, 0, 0};
+    std::vector<std::pair<const uint8_t*, size_t>> idat;
+};
+
+bool fail(std::string* error, const char* message) {
+    if (error) *error = message;
+    return false;
+}
+
+bool parse(const uint8_t* data, size_t size, Image& image, std::string* error) {
+    if (size < 8 || std::memcmp(data, kSignature, 8) != 0) return fail(error, "not a PNG file");
+    for (auto& entry : image.palette) entry = {0, 0, 0, 255};
+
+    bool haveHeader = false;
+    size_t pos = 8;
+    while (true) {
+        if (size - pos < 12) return fail(error, "truncated PNG");
+        const uint32_t length = get32(data + pos);
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* payload = data + pos + 8;
+        if (length > size - pos - 12) return fail(error, "truncated PNG");
+
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (length < 13) return fail(error, "corrupt PNG header");
+            Header& h = image.header;
+            h.width = get32(payload);
+            h.height = get32(payload + 4);
+            h.depth = payload[8];
+            h.colorType = payload[9];
+            h.interlace = payload[12];
+            if (!h.valid() || payload[10] != 0 || payload[11] != 0) return fail(error, "unsupported PNG format");
+            if (h.interlace != 0) return fail(error, "interlaced PNGs are not supported");
+            haveHeader = true;
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            for (uint32_t i = 0; i < std::min<uint32_t>(length / 3, 256); ++i) {
+                image.palette[i] = {payload[i * 3], payload[i * 3 + 1], payload[i * 3 + 2], 255};
+            }
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            const Header& h = image.header;
+            if (h.colorType == kPalette) {
+                for (uint32_t i = 0; i < std::min<uint32_t>(length, 256); ++i) image.palette[i][3] = payload[i];
+            } else if (h.colorType == kGray && length >= 2) {
+                image.hasKey = true;
+                image.key[0] = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+            } else if (h.colorType == kRGB && length >= 6) {
+                image.hasKey = true;
+                for (int c = 0; c < 3; ++c) {
+                    image.key[c] = static_cast<uint16_t>((payload[c * 2] << 8) | payload[c * 2 + 1]);
+                }
+            }
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            image.idat.emplace_back(payload, length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        pos += 12 + static_cast<size_t>(length);
+    }
+    if (!haveHeader) return fail(error, "missing PNG header");
+    if (image.idat.empty()) return fail(error, "PNG has no image data");
+    return true;
+}
+
+// Sample `x` of a row packed at a sub-byte depth
+inline uint32_t packedSample(const uint8_t* row, uint32_t x, int depth) {
+    const uint32_t bit = x * depth;
+    const int shift = 8 - depth - static_cast<int>(bit & 7);
+    return (row[bit >> 3] >> shift) & ((1u << depth) - 1);
+}
+
+// One unfiltered row to straight RGBA8
+void expandRow(const Image& image, const uint8_t* row, uint8_t* out) {
+    const Header& h = image.header;
+    const uint32_t w = h.width;
+    const bool wide = h.depth == 16;
+    auto sample = [&](uint32_t i) -> uint32_t {   // Channel value i of the row at full depth
+        return wide ? (uint32_t(row[i * 2]) << 8) | row[i * 2 + 1] : row[i];
+    };
+
+    switch (h.colorType) {
+        case kRGBA:
+            if (!wide) {
+                std::memcpy(out, row, static_cast<size_t>(w) * 4);
+                return;
+            }
+            for (uint32_t i = 0; i < w * 4; ++i) out[i] = row[i * 2];
+            return;
+        case kGrayAlpha:
+            for (uint32_t x = 0; x < w; ++x) {
+                const uint8_t v = static_cast<uint8_t>(sample(x * 2) >> (wide ? 8 : 0));
+                out[x * 4 + 0] = out[x * 4 + 1] = out[x * 4 + 2] = v;
+                out[x * 4 + 3] = static_cast<uint8_t>(sample(x * 2 + 1) >> (wide ? 8 : 0));
+            }
+            return;
+        case kRGB:
+            for (uint32_t x = 0; x < w; ++x) {
+                const uint32_t r = sample(x * 3), g = sample(x * 3 + 1), b = sample(x * 3 + 2);
+                const bool keyed = image.hasKey && r == image.key[0] && g == image.key[1] && b == image.key[2];
+                out[x * 4 + 0] = static_cast<uint8_t>(r >> (wide ? 8 : 0));
+                out[x * 4 + 1] = static_cast<uint8_t>(g >> (wide ? 8 : 0));
+                out[x * 4 + 2] = static_cast<uint8_t>(b >> (wide ? 8 : 0));
+                out[x * 4 + 3] = keyed ? 0 : 255;
+            }
+            return;
+        case kGray:
+            for (uint32_t x = 0; x < w; ++x) {
+                uint32_t raw;
+                uint8_t v;
+                if (h.depth >= 8) {
+                    raw = sample(x);
+                    v = static_cast<uint8_t>(raw >> (wide ? 8 : 0));
+                } else {
+                    raw = packedSample(row, x, h.depth);
+                    v = static_cast<uint8_t>(raw * 255 / ((1u << h.depth) - 1));
+                }
+                out[x * 4 + 0] = out[x * 4 + 1] = out[x * 4 + 2] = v;
+                out[x * 4 + 3] = image.hasKey && raw == image.key[0] ? 0 : 255;
+            }
+            return;
+        case kPalette:
+            for (uint32_t x = 0; x < w; ++x) {
+                const uint32_t index = h.depth == 8 ? row[x] : packedSample(row, x, h.depth);
+                std::memcpy(out + x * 4, image.palette[index].data(), 4);
+            }
+            return;
+        default:
+            return;
+    }
+}
+
+} // anonymous namespace
+
+// ============================================================================
+// Encoding
+// ============================================================================
+
+std::vector<uint8_t> encode(const ImageBuffer& image, int level) {
+    const int width = image.width();
+    const int height = image.height();
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    const int bandCount = (height + kBandRows - 1) / kBandRows;
+
+    struct Band {
+        std::vector<uint8_t> deflated;
+        uLong adler = 1;
+        size_t rawBytes = 0;
+    };
+    std::vector<Band> bands(static_cast<size_t>(bandCount));
+
+    ThreadPool::shared().parallelFor(bands.size(), [&](size_t b) {
+        const int y0 = static_cast<int>(b) * kBandRows;
+        const int rows = std::min(kBandRows, height - y0);
+
+        std::vector<uint8_t> pixels(rowBytes * rows);
+        image.readRegion(0, y0, width, rows, pixels.data(), rowBytes);
+        color::unpremultiplyRow(pixels.data(), pixels.size() / 4);
+
+        Band& band = bands[b];
+        band.rawBytes = (rowBytes + 1) * rows;
+        std::vector<uint8_t> raw(band.rawBytes);
+        std::vector<uint8_t> scratch;
+        for (int y = 0; y < rows; ++y) {
+            const uint8_t* prev = y > 0 ? &pixels[(y - 1) * rowBytes] : nullptr;
+            filterBest(&pixels[y * rowBytes], prev, rowBytes, scratch, &raw[y * (rowBytes + 1)]);
+        }
+        band.adler = adler32(1L, raw.data(), static_cast<uInt>(raw.size()));
+
+        // A raw deflate stream of its own: bands before the last end with a
+        // sync flush (byte aligned, no final block) so they concatenate
+        z_stream stream{};
+        deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        band.deflated.resize(deflateBound(&stream, static_cast<uLong>(raw.size())) + 16);
+        stream.next_in = raw.data();
+        stream.avail_in = static_cast<uInt>(raw.size());
+        stream.next_out = band.deflated.data();
+        stream.avail_out = static_cast<uInt>(band.deflated.size());
+        deflate(&stream, b + 1 == bands.size() ? Z_FINISH : Z_SYNC_FLUSH);
+        band.deflated.resize(stream.total_out);
+        deflateEnd(&stream);
+    });
+
+    // zlib stream: header, the bands, Adler-32 of everything they inflate to
+    std::vector<uint8_t> stream = {0x78, 0x9C};
+    std::vector<uint8_t> index;
+    index.push_back(kIndexVersion);
+    put32(index, static_cast<uint32_t>(kBandRows));
+    put32(index, static_cast<uint32_t>(bandCount));
+    uLong adler = 1;
+    for (const Band& band : bands) {
+        put64(index, stream.size());
+        stream.insert(stream.end(), band.deflated.begin(), band.deflated.end());
+        adler = adler32_combine(adler, band.adler, static_cast<z_off_t>(band.rawBytes));
+    }
+    put64(index, stream.size());
+    put32(stream, static_cast<uint32_t>(adler));
+
+    std::vector<uint8_t> out(kSignature, kSignature + 8);
+    out.reserve(stream.size() + index.size() + 128);
+
+    std::vector<uint8_t> header;
+    put32(header, static_cast<uint32_t>(width));
+    put32(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, kRGBA, 0, 0, 0});
+    appendChunk(out, "IHDR", header.data(), header.size());
+    appendChunk(out, "afIX", index.data(), index.size());
+    for (size_t done = 0; done < stream.size();) {
+        const size_t bytes = static_cast<size_t>(std::min<uint64_t>(stream.size() - done, kMaxChunkBytes));
+        appendChunk(out, "IDAT", stream.data() + done, bytes);
+        done += bytes;
+    }
+    appendChunk(out, "IEND", nullptr, 0);
+    return out;
+}
+
+// ============================================================================
+// Decoding
+// ============================================================================
+
+std::unique_ptr<ImageBuffer> decode(const uint8_t* data, size_t size, std::string* error) {
+    Image image;
+    if (!parse(data, size, image, error)) return nullptr;
+
+    const Header& h = image.header;
+    const int width = static_cast<int>(h.width);
+    const int height = static_cast<int>(h.height);
+    const size_t rowBytes = h.rowBytes();
+    const size_t unit = h.filterUnit();
+    auto result = std::make_unique<ImageBuffer>(width, height, ImageBuffer::Storage::Tiled);
+
+    z_stream stream{};
+    if (inflateInit(&stream) != Z_OK) {
+        fail(error, "out of memory");
+        return nullptr;
+    }
+    size_t nextChunk = 0;
+
+    // Rows are inflated one band (tile row) at a time; the previous band's
+    // last row is kept for filters that look upward
+    std::vector<uint8_t> raw((rowBytes + 1) * kBandRows);
+    std::vector<uint8_t> prev(rowBytes);
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * 4 * kBandRows);
+    std::vector<ImageBuffer::TileHandle> tiles(static_cast<size_t>(result->tileCountX()));
+    bool ok = true;
+    for (int y0 = 0; y0 < height && ok; y0 += kBandRows) {
+        const int rows = std::min(kBandRows, height - y0);
+        stream.next_out = raw.data();
+        stream.avail_out = static_cast<uInt>((rowBytes + 1) * rows);
+        while (stream.avail_out > 0) {
+            if (stream.avail_in == 0) {
+                if (nextChunk == image.idat.size()) break;
+                stream.next_in = const_cast<Bytef*>(image.idat[nextChunk].first);
+                stream.avail_in = static_cast<uInt>(image.idat[nextChunk].second);
+                ++nextChunk;
+            }
+            const int status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) break;
+            if (status != Z_OK && status != Z_BUF_ERROR) break;
+        }
+        if (stream.avail_out > 0) {
+            ok = fail(error, "truncated or corrupt PNG data");
+            break;
+        }
+
+        for (int y = 0; y < rows && ok; ++y) {
+            uint8_t* row = &raw[y * (rowBytes + 1)];
+            const uint8_t* above = y > 0 ? row - rowBytes : (y0 > 0 ? prev.data() : nullptr);
+            if (!unfilterRow(row[0], row + 1, above, rowBytes, unit)) {
+                ok = fail(error, "corrupt PNG data");
+                break;
+            }
+            expandRow(image, row + 1, &rgba[static_cast<size_t>(y) * width * 4]);
+        }
+        if (!ok) break;
+        std::memcpy(prev.data(), &raw[(rows - 1) * (rowBytes + 1) + 1], rowBytes);
+
+        rowsToTiles(rgba.data(), static_cast<size_t>(width) * 4, width, rows, tiles.data());
+        const int ty = y0 / ImageBuffer::kTileSize;
+        for (int tx = 0; tx < result->tileCountX(); ++tx) {
+            if (tiles[tx]) result->setTileHandle(tx, ty, std::move(tiles[tx]));
+        }
+    }
+    inflateEnd(&stream);
+    if (!ok) return nullptr;
+    if (error) error->clear();
+    return result;
+}
+
+// ============================================================================
+// BandedPng
+// ============================================================================
+
+bool BandedPng::open(const std::string& path, uint64_t offset, uint64_t size) {
+    m_path.clear();
+    m_offsets.clear();
+    m_segments.clear();
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    in.seekg(0, std::ios::end);
+    const uint64_t fileSize = static_cast<uint64_t>(in.tellg());
+    if (offset > fileSize) return false;
+    const uint64_t end = offset + std::min(size, fileSize - offset);
+
+    auto readAt = [&](uint64_t at, void* out, size_t bytes) {
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(at));
+        return static_cast<bool>(in.read(static_cast<char*>(out), static_cast<std::streamsize>(bytes)));
+    };
+
+    uint8_t signature[8];
+    if (end - offset < 8 || !readAt(offset, signature, 8) || std::memcmp(signature, kSignature, 8) != 0) return false;
+
+    bool haveHeader = false;
+    uint64_t streamBytes = 0;
+    uint64_t pos = offset + 8;
+    while (true) {
+        uint8_t chunk[8];
+        if (end - pos < 12 || !readAt(pos, chunk, 8)) return false;
+        const uint32_t length = get32(chunk);
+        const uint8_t* type = chunk + 4;
+        if (length > end - pos - 12) return false;
+
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            uint8_t header[13];
+            if (length < 13 || !readAt(pos + 8, header, 13)) return false;
+            m_width = static_cast<int>(get32(header));
+            m_height = static_cast<int>(get32(header + 4));
+            // Only what encode() writes: 8-bit RGBA, not interlaced
+            if (header[8] != 8 || header[9] != kRGBA || header[12] != 0) return false;
+            if (m_width <= 0 || m_height <= 0 || m_width > int(kMaxDimension) || m_height > int(kMaxDimension)) {
+                return false;
+            }
+            haveHeader = true;
+        } else if (std::memcmp(type, "afIX", 4) == 0) {
+            std::vector<uint8_t> index(length);
+            if (length < kIndexHeaderBytes || !readAt(pos + 8, index.data(), length)) return false;
+            const uint32_t bandRows = get32(&index[1]);
+            const uint64_t bandCount = get32(&index[5]);
+            if (index[0] != kIndexVersion || bandRows != uint32_t(kBandRows)) return false;
+            if (length != kIndexHeaderBytes + (bandCount + 1) * 8) return false;
+            for (uint64_t i = 0; i <= bandCount; ++i) m_offsets.push_back(get64(&index[kIndexHeaderBytes + i * 8]));
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            m_segments.push_back({pos + 8, streamBytes, length});
+            streamBytes += length;
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        pos += 12 + static_cast<uint64_t>(length);
+    }
+
+    // The index has to describe this image's bands and lie inside its stream
+    if (!haveHeader || m_offsets.empty()) return false;
+    if (bandCount() != (m_height + kBandRows - 1) / kBandRows) return false;
+    if (m_offsets.front() < 2 || m_offsets.back() > streamBytes) return false;
+    if (!std::is_sorted(m_offsets.begin(), m_offsets.end())) return false;
+    m_path = path;
+    return true;
+}
+
+bool BandedPng::readStream(uint64_t begin, uint64_t end, std::vector<uint8_t>& out) const {
+    std::ifstream in(m_path, std::ios::binary);
+    if (!in) return false;
+    out.resize(static_cast<size_t>(end - begin));
+    size_t done = 0;
+    for (const Segment& segment : m_segments) {
+        const uint64_t from = std::max(begin, segment.streamOffset);
+        const uint64_t to = std::min(end, segment.streamOffset + segment.bytes);
+        if (from >= to) continue;
+        in.seekg(static_cast<std::streamoff>(segment.fileOffset + (from - segment.streamOffset)));
+        if (!in.read(reinterpret_cast<char*>(out.data() + done), static_cast<std::streamsize>(to - from))) return false;
+        done += static_cast<size_t>(to - from);
+    }
+    return done == out.size();
+}
+
+bool BandedPng::decodeBand(int index, ImageBuffer::TileHandle* tiles) const {
+    if (m_path.empty() || index < 0 || index >= bandCount()) return false;
+
+    std::vector<uint8_t> compressed;
+    if (!readStream(m_offsets[index], m_offsets[index + 1], compressed)) return false;
+
+    const int rows = std::min(kBandRows, m_height - index * kBandRows);
+    const size_t rowBytes = static_cast<size_t>(m_width) * 4;
+    std::vector<uint8_t> raw((rowBytes + 1) * rows);
+
+    // Every band but the last ends without a final block, so inflate stops
+    // short of Z_STREAM_END; what matters is that all rows came out
+    z_stream stream{};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) return false;
+    stream.next_in = compressed.data();
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    stream.next_out = raw.data();
+    stream.avail_out = static_cast<uInt>(raw.size());
+    const int status = inflate(&stream, Z_SYNC_FLUSH);
+    const bool complete = (status == Z_OK || status == Z_STREAM_END || status == Z_BUF_ERROR) &&
+                          stream.avail_out == 0;
+    inflateEnd(&stream);
+    if (!complete) return false;
+
+    for (int y = 0; y < rows; ++y) {
+        uint8_t* row = &raw[y * (rowBytes + 1)];
+        if (y == 0 && row[0] != kNone && row[0] != kSub) return false;   // Would need the band above
+        if (!unfilterRow(row[0], row + 1, y > 0 ? row - rowBytes : nullptr, rowBytes, 4)) return false;
+    }
+    rowsToTiles(raw.data() + 1, rowBytes + 1, m_width, rows, tiles);
+    return true;
+}
+
+} // namespace png
+} // namespace artflow
@@ -0,0 +1,839 @@
+/**
+ * ArtFlow Studio - Project File Implementation
+ */
+
+#include "project_file.h"
+#include "background_worker.h"
+#include "layer_manager.h"
+#include "png_codec.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <locale>
+#include <sstream>
+#include <zlib.h>
+
+namespace artflow {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr char kMetadataName[] = "project.json";
+constexpr char kLegacyMetadataName[] = "meta.json";
+constexpr char kPreviewName[] = "preview.png";
+constexpr char kTimelapseDir[] = "timelapse/";
+constexpr int kDefaultWidth = 1920;    // What the Python loader assumes
+constexpr int kDefaultHeight = 1080;
+constexpr int kMaxDimension = 1 << 16;
+constexpr size_t kCopyChunk = 1 << 20;
+
+bool fail(std::string* error, const std::string& message) {
+    if (error) *error = message;
+    return false;
+}
+
+bool hasSuffix(const std::string& name, const char* suffix) {
+    const size_t n = std::strlen(suffix);
+    if (name.size() < n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (std::tolower(static_cast<unsigned char>(name[name.size() - n + i])) != suffix[i]) return false;
+    }
+    return true;
+}
+
+std::string layerFileName(size_t index) {
+    return "layer_" + std::to_string(index) + ".png";
+}
+
+// ============================================================================
+// JSON (the subset project.json needs, which is all of it but exponents of
+// unusual size)
+// ============================================================================
+
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> items;                             // Array
+    std::vector<std::pair<std::string, JsonValue>> members;   // Object, in file order
+
+    const JsonValue* find(const char* key) const {
+        for (const auto& member : members) {
+            if (member.first == key) return &member.second;
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    JsonParser(const char* begin, const char* end) : m_pos(begin), m_end(end) {}
+
+    bool parse(JsonValue& out) {
+        if (!value(out, 0)) return false;
+        skipSpace();
+        return m_pos == m_end;
+    }
+
+private:
+    static constexpr int kMaxDepth = 64;
+
+    const char* m_pos;
+    const char* m_end;
+
+    void skipSpace() {
+        while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r')) ++m_pos;
+    }
+
+    bool literal(const char* word) {
+        const size_t n = std::strlen(word);
+        if (static_cast<size_t>(m_end - m_pos) < n || std::strncmp(m_pos, word, n) != 0) return false;
+        m_pos += n;
+        return true;
+    }
+
+    bool value(JsonValue& out, int depth) {
+        if (depth > kMaxDepth) return false;
+        skipSpace();
+        if (m_pos == m_end) return false;
+        switch (*m_pos) {
+            case '{': return object(out, depth);
+            case '[': return array(out, depth);
+            case '"': out.type = JsonValue::Type::String; return string(out.string);
+            case 't': out.type = JsonValue::Type::Bool; out.boolean = true; return literal("true");
+            case 'f': out.type = JsonValue::Type::Bool; out.boolean = false; return literal("false");
+            case 'n': out.type = JsonValue::Type::Null; return literal("null");
+            default: out.type = JsonValue::Type::Number; return number(out.number);
+        }
+    }
+
+    bool object(JsonValue& out, int depth) {
+        out.type = JsonValue::Type::Object;
+        ++m_pos;
+        skipSpace();
+        if (m_pos < m_end && *m_pos == '}') { ++m_pos; return true; }
+        while (true) {
+            skipSpace();
+            std::pair<std::string, JsonValue> member;
+            if (m_pos == m_end || *m_pos != '"' || !string(member.first)) return false;
+            skipSpace();
+            if (m_pos == m_end || *m_pos++ != ':') return false;
+            if (!value(member.second, depth + 1)) return false;
+            out.members.push_back(std::move(member));
+            skipSpace();
+            if (m_pos == m_end) return false;
+            if (*m_pos == ',') { ++m_pos; continue; }
+            return *m_pos++ == '}';
+        }
+    }
+
+    bool array(JsonValue& out, int depth) {
+        out.type = JsonValue::Type::Array;
+        ++m_pos;
+        skipSpace();
+        if (m_pos < m_end && *m_pos == ']') { ++m_pos; return true; }
+        while (true) {
+            JsonValue item;
+            if (!value(item, depth + 1)) return false;
+            out.items.push_back(std::move(item));
+            skipSpace();
+            if (m_pos == m_end) return false;
+            if (*m_pos == ',') { ++m_pos; continue; }
+            return *m_pos++ == ']';
+        }
+    }
+
+    bool hex4(uint32_t& out) {
+        if (m_end - m_pos < 4) return false;
+        out = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char c = *m_pos++;
+            out <<= 4;
+            if (c >= '0' && c <= '9') out |= c - '0';
+            else if (c >= 'a' && c <= 'f') out |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') out |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, uint32_t cp) {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    bool string(std::string& out) {
+        ++m_pos;   // Opening quote
+        while (m_pos < m_end) {
+            const char c = *m_pos++;
+            if (c == '"') return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (m_pos == m_end) return false;
+            switch (*m_pos++) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    // Python escapes everything outside ASCII, astral
+                    // characters as surrogate pairs
+                    uint32_t cp;
+                    if (!hex4(cp)) return false;
+                    if (cp >= 0xD800 && cp < 0xDC00 && m_end - m_pos >= 6 && m_pos[0] == '\\' && m_pos[1] == 'u') {
+                        m_pos += 2;
+                        uint32_t low;
+                        if (!hex4(low)) return false;
+                        if (low >= 0xDC00 && low < 0xE000) cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+
+    bool number(double& out) {
+        const char* start = m_pos;
+        while (m_pos < m_end && (std::isdigit(static_cast<unsigned char>(*m_pos)) || *m_pos == '-' ||
+                                 *m_pos == '+' || *m_pos == '.' || *m_pos == 'e' || *m_pos == 'E')) {
+            ++m_pos;
+        }
+        if (m_pos == start) return false;
+        // Parsed in the classic locale: the app's may use a decimal comma
+        std::istringstream in(std::string(start, m_pos));
+        in.imbue(std::locale::classic());
+        in >> out;
+        return !in.fail() && in.peek() == std::char_traits<char>::eof();
+    }
+};
+
+// Python's truthiness, which is what its loader applies to these fields
+bool boolOr(const JsonValue* value, bool fallback) {
+    if (!value) return fallback;
+    switch (value->type) {
+        case JsonValue::Type::Bool: return value->boolean;
+        case JsonValue::Type::Number: return value->number != 0.0;
+        case JsonValue::Type::String: return !value->string.empty();
+        case JsonValue::Type::Null: return false;
+        default: return !value->items.empty() || !value->members.empty();
+    }
+}
+
+double numberOr(const JsonValue* value, double fallback) {
+    if (!value) return fallback;
+    if (value->type == JsonValue::Type::Number) return value->number;
+    if (value->type == JsonValue::Type::Bool) return value->boolean ? 1.0 : 0.0;
+    return fallback;
+}
+
+std::string stringOr(const JsonValue* value, const std::string& fallback) {
+    return value && value->type == JsonValue::Type::String ? value->string : fallback;
+}
+
+void appendJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (const char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escaped[8];
+                    std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+std::string jsonNumber(double value) {
+    std::ostringstream out;
+    out.imbue(std::locale::classic());
+    out.precision(9);
+    out << value;
+    return out.str();
+}
+
+bool parseInfo(const std::string& text, ProjectInfo& info, std::string* error) {
+    JsonValue root;
+    JsonParser parser(text.data(), text.data() + text.size());
+    if (!parser.parse(root) || root.type != JsonValue::Type::Object) return fail(error, "Corrupt project metadata");
+
+    info = ProjectInfo();
+    info.width = static_cast<int>(numberOr(root.find("width"), kDefaultWidth));
+    info.height = static_cast<int>(numberOr(root.find("height"), kDefaultHeight));
+    if (info.width <= 0 || info.height <= 0 || info.width > kMaxDimension || info.height > kMaxDimension) {
+        return fail(error, "Invalid canvas size in project metadata");
+    }
+    info.name = stringOr(root.find("name"), "");
+    info.created = stringOr(root.find("created"), "");
+
+    const JsonValue* layers = root.find("layers");
+    if (!layers || layers->type != JsonValue::Type::Array) return true;
+    for (const JsonValue& item : layers->items) {
+        if (item.type != JsonValue::Type::Object) continue;
+        ProjectLayer layer;
+        layer.name = stringOr(item.find("name"), layer.name);
+        layer.type = stringOr(item.find("type"), layer.type);
+        layer.visible = boolOr(item.find("visible"), layer.visible);
+        layer.opacity = static_cast<float>(numberOr(item.find("opacity"), layer.opacity));
+        layer.blendMode = stringOr(item.find("blend_mode"), layer.blendMode);
+        layer.depth = static_cast<int>(numberOr(item.find("depth"), layer.depth));
+        layer.expanded = boolOr(item.find("expanded"), layer.expanded);
+        layer.locked = boolOr(item.find("locked"), layer.locked);
+        layer.alphaLock = boolOr(item.find("alpha_lock"), layer.alphaLock);
+        layer.clipped = boolOr(item.find("clipped"), layer.clipped);
+        layer.isPrivate = boolOr(item.find("is_private"), layer.isPrivate);
+        layer.filename = stringOr(item.find("filename"), "");
+        info.layers.push_back(std::move(layer));
+    }
+    return true;
+}
+
+// project.json as the Python app writes it (json.dumps with indent=4)
+std::string formatInfo(const ProjectInfo& info) {
+    std::string out = "{\n    \"version\": \"1.0\",\n";
+    if (!info.name.empty()) {
+        out += "    \"name\": ";
+        appendJsonString(out, info.name);
+        out += ",\n";
+    }
+    out += "    \"width\": " + std::to_string(info.width) + ",\n";
+    out += "    \"height\": " + std::to_string(info.height) + ",\n";
+    out += "    \"created\": ";
+    appendJsonString(out, info.created);
+    out += ",\n    \"layers\": [";
+
+    auto field = [&out](const char* key, const std::string& json, bool last = false) {
+        out += "            \"";
+        out += key;
+        out += "\": " + json + (last ? "\n" : ",\n");
+    };
+    auto quoted = [](const std::string& text) {
+        std::string json;
+        appendJsonString(json, text);
+        return json;
+    };
+    auto boolean = [](bool value) { return std::string(value ? "true" : "false"); };
+
+    for (size_t i = 0; i < info.layers.size(); ++i) {
+        const ProjectLayer& layer = info.layers[i];
+        out += i == 0 ? "\n        {\n" : ",\n        {\n";
+        field("index", std::to_string(i));
+        field("name", quoted(layer.name));
+        field("type", quoted(layer.type));
+        field("visible", boolean(layer.visible));
+        field("opacity", jsonNumber(layer.opacity));
+        field("blend_mode", quoted(layer.blendMode));
+        field("depth", std::to_string(layer.depth));
+        field("expanded", boolean(layer.expanded));
+        field("locked", boolean(layer.locked));
+        field("alpha_lock", boolean(layer.alphaLock));
+        field("clipped", boolean(layer.clipped));
+        field("is_private", boolean(layer.isPrivate));
+        field("filename", quoted(layer.filename), true);
+        out += "        }";
+    }
+    out += info.layers.empty() ? "]\n}" : "\n    ]\n}";
+    return out;
+}
+
+// ============================================================================
+// Output (archive or folder)
+// ============================================================================
+
+class ProjectSink {
+public:
+    explicit ProjectSink(ZipWriter* zip, const std::string& folder) : m_zip(zip), m_folder(folder) {}
+
+    bool add(const std::string& name, const void* data, size_t size, bool compress) {
+        if (m_zip) return m_zip->add(name, data, size, compress);
+        const fs::path path = m_folder / fs::path(name);
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        return out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size)) && out.flush();
+    }
+
+    bool addFile(const std::string& name, const std::string& source) {
+        if (m_zip) return m_zip->addFile(name, source);
+        const fs::path path = m_folder / fs::path(name);
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        if (fs::exists(path, ec) && fs::equivalent(path, source, ec)) return true;
+        return fs::copy_file(source, path, fs::copy_options::overwrite_existing, ec);
+    }
+
+private:
+    ZipWriter* m_zip;
+    fs::path m_folder;
+};
+
+bool writeProject(ProjectSink& sink, const ProjectSnapshot& project, const ProjectSaveOptions& options,
+                  bool sameFolder, std::string* error) {
+    ProjectInfo info = project.info;
+    for (size_t i = 0; i < info.layers.size(); ++i) info.layers[i].filename = layerFileName(i);
+    const std::string json = formatInfo(info);
+    if (!sink.add(kMetadataName, json.data(), json.size(), true)) return fail(error, "Cannot write project metadata");
+    if (!options.previewPng.empty() &&
+        !sink.add(kPreviewName, options.previewPng.data(), options.previewPng.size(), false)) {
+        return fail(error, "Cannot write project preview");
+    }
+
+    // Layer i is compressed while layer i - 1 is written
+    BackgroundWorker writer;
+    std::vector<uint8_t> written;
+    bool writeOk = true;
+    for (size_t i = 0; i < info.layers.size(); ++i) {
+        std::vector<uint8_t> png;
+        if (i < project.layers.size() && project.layers[i]) {
+            png = png::encode(*project.layers[i], options.compressionLevel);
+        } else {
+            png = png::encode(ImageBuffer(info.width, info.height, ImageBuffer::Storage::Tiled),
+                              options.compressionLevel);
+        }
+        writer.waitIdle();
+        if (!writeOk) break;
+        written = std::move(png);
+        writer.post([&sink, &written, &writeOk, i] {
+            writeOk = sink.add(layerFileName(i), written.data(), written.size(), false);
+        });
+    }
+    writer.waitIdle();
+    if (!writeOk) return fail(error, "Cannot write layer pixels");
+
+    std::vector<std::string> added;
+    for (const auto& file : options.files) {
+        if (!sink.addFile(file.first, file.second)) return fail(error, "Cannot copy " + file.second + " into the project");
+        added.push_back(file.first);
+    }
+
+    // Legacy JPEG frames live only in the old file; a folder saved over
+    // itself already has them
+    if (!options.carryTimelapseFrom.empty() && !sameFolder) {
+        ProjectReader source;
+        if (source.open(options.carryTimelapseFrom)) {
+            std::vector<uint8_t> data;
+            for (const std::string& name : source.timelapseMembers()) {
+                if (!hasSuffix(name, ".jpg") && !hasSuffix(name, ".jpeg")) continue;
+                if (std::find(added.begin(), added.end(), name) != added.end()) continue;
+                if (!source.read(name, data) || !sink.add(name, data.data(), data.size(), false)) {
+                    return fail(error, "Cannot copy timelapse frame " + name);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Input
+// ============================================================================
+
+// Loads tile rows of a layer from its band-indexed PNG on first access
+class BandLoader : public ImageBuffer::TileLoader {
+public:
+    BandLoader(png::BandedPng png, std::string name) : m_png(std::move(png)), m_name(std::move(name)) {}
+
+    bool loadTileRow(int ty, ImageBuffer::TileHandle* tiles) override {
+        if (m_png.decodeBand(ty, tiles)) return true;
+        std::cerr << "Project: unreadable tile row " << ty << " of " << m_name << std::endl;
+        return false;
+    }
+
+private:
+    png::BandedPng m_png;
+    std::string m_name;
+};
+
+// `image` at the project size: a PNG of another size is placed at the
+// origin, like the Python app does
+std::unique_ptr<ImageBuffer> fitToProject(std::unique_ptr<ImageBuffer> image, int width, int height) {
+    if (!image || (image->width() == width && image->height() == height)) return image;
+    auto fitted = std::make_unique<ImageBuffer>(width, height, ImageBuffer::Storage::Tiled);
+    fitted->composite(*image);
+    return fitted;
+}
+
+Layer::Type layerType(const std::string& name) {
+    if (name == "background") return Layer::Type::Background;
+    if (name == "group") return Layer::Type::Group;
+    return Layer::Type::Drawing;
+}
+
+const char* layerTypeName(Layer::Type type) {
+    switch (type) {
+        case Layer::Type::Background: return "background";
+        case Layer::Type::Group: return "group";
+        default: return "normal";
+    }
+}
+
+struct BlendModeName {
+    BlendMode mode;
+    const char* name;
+};
+
+constexpr BlendModeName kBlendModeNames[] = {
+    {BlendMode::Normal, "Normal"},
+    {BlendMode::Multiply, "Multiply"},
+    {BlendMode::Screen, "Screen"},
+    {BlendMode::Overlay, "Overlay"},
+    {BlendMode::SoftLight, "Soft Light"},
+    {BlendMode::HardLight, "Hard Light"},
+    {BlendMode::ColorDodge, "Color Dodge"},
+    {BlendMode::ColorBurn, "Color Burn"},
+    {BlendMode::Darken, "Darken"},
+    {BlendMode::Lighten, "Lighten"},
+    {BlendMode::Difference, "Difference"},
+    {BlendMode::Exclusion, "Exclusion"},
+};
+
+} // anonymous namespace
+
+// ============================================================================
+// Saving
+// ============================================================================
+
+bool saveProject(const std::string& path, const ProjectSnapshot& project, const ProjectSaveOptions& options,
+                 std::string* error) {
+    if (project.info.width <= 0 || project.info.height <= 0) return fail(error, "Project has no canvas size");
+
+    std::error_code ec;
+    // Rows that could not be read from the source loaded empty; writing
+    // them over it would lose them for good
+    if (!options.loadedFrom.empty() && fs::exists(fs::path(path), ec) &&
+        fs::equivalent(fs::path(path), fs::path(options.loadedFrom), ec)) {
+        for (size_t i = 0; i < project.layers.size(); ++i) {
+            if (!project.layers[i]) continue;
+            project.layers[i]->loadPendingTiles();
+            if (project.layers[i]->hasUnreadableTiles()) {
+                const std::string name = i < project.info.layers.size() ? project.info.layers[i].name : "Layer";
+                return fail(error, "Layer \"" + name + "\" could not be fully read from " + path +
+                                   "; save the project under another name");
+            }
+        }
+    }
+    if (!hasSuffix(path, ".aflow")) {
+        // Folder project, written in place
+        fs::create_directories(fs::path(path), ec);
+        if (!fs::is_directory(fs::path(path), ec)) return fail(error, "Cannot create project folder: " + path);
+        ProjectSink sink(nullptr, path);
+        const bool sameFolder = !options.carryTimelapseFrom.empty() &&
+                                fs::equivalent(fs::path(path), fs::path(options.carryTimelapseFrom), ec);
+        if (!writeProject(sink, project, options, sameFolder, error)) return false;
+        if (error) error->clear();
+        return true;
+    }
+
+    const std::string temp = path + ".tmp";
+    ZipWriter zip;
+    if (!zip.open(temp)) return fail(error, "Cannot write " + temp);
+    ProjectSink sink(&zip, std::string());
+    bool ok = writeProject(sink, project, options, false, error);
+    if (!zip.close() && ok) ok = fail(error, "Cannot write " + temp);
+    if (ok) {
+        fs::rename(fs::path(temp), fs::path(path), ec);
+        if (ec) ok = fail(error, "Cannot replace " + path + ": " + ec.message());
+    }
+    if (!ok) {
+        fs::remove(fs::path(temp), ec);
+        return false;
+    }
+    if (error) error->clear();
+    return true;
+}
+
+// ============================================================================
+// ProjectReader
+// ============================================================================
+
+bool ProjectReader::open(const std::string& path, std::string* error) {
+    m_zip.close();
+    m_path = path;
+    m_info = ProjectInfo();
+
+    std::error_code ec;
+    std::vector<uint8_t> metadata;
+    if (fs::is_directory(fs::path(path), ec)) {
+        m_isFolder = true;
+        if (!read(kMetadataName, metadata) && !read(kLegacyMetadataName, metadata)) {
+            return fail(error, "No project metadata in " + path);
+        }
+    } else if (ZipReader::isZipFile(path)) {
+        m_isFolder = false;
+        if (!m_zip.open(path)) return fail(error, "Unreadable project archive: " + path);
+        if (!read(kMetadataName, metadata) && !read(kLegacyMetadataName, metadata)) {
+            return fail(error, "No project metadata in " + path);
+        }
+    } else {
+        return fail(error, fs::exists(fs::path(path), ec) ? "Not a project file: " + path
+                                                            : "Project not found: " + path);
+    }
+    if (!parseInfo(std::string(metadata.begin(), metadata.end()), m_info, error)) return false;
+    if (error) error->clear();
+    return true;
+}
+
+bool ProjectReader::read(const std::string& name, std::vector<uint8_t>& out) {
+    if (m_isFolder) {
+        std::ifstream in(fs::path(m_path) / fs::path(name), std::ios::binary);
+        if (!in) return false;
+        in.seekg(0, std::ios::end);
+        out.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        return out.empty() || static_cast<bool>(in.read(reinterpret_cast<char*>(out.data()),
+                                                        static_cast<std::streamsize>(out.size())));
+    }
+    const ZipReader::Entry* entry = m_zip.find(name);
+    return entry && m_zip.read(*entry, out);
+}
+
+std::vector<std::unique_ptr<ImageBuffer>> ProjectReader::loadLayers(std::string* error) {
+    const int width = m_info.width;
+    const int height = m_info.height;
+    std::vector<std::unique_ptr<ImageBuffer>> layers(m_info.layers.size());
+    std::string problem;
+
+    // Band-indexed PNGs are only indexed here; the rest are read now and
+    // decoded together below
+    struct Encoded {
+        size_t layer;
+        std::vector<uint8_t> data;
+    };
+    std::vector<Encoded> encoded;
+    for (size_t i = 0; i < layers.size(); ++i) {
+        const std::string& name = m_info.layers[i].filename;
+        if (name.empty()) continue;
+
+        png::BandedPng banded;
+        bool indexed = false;
+        if (m_isFolder) {
+            const fs::path file = fs::path(m_path) / fs::path(name);
+            indexed = banded.open(file.string());
+        } else if (const ZipReader::Entry* entry = m_zip.find(name)) {
+            uint64_t offset = 0;
+            indexed = entry->method == ZipReader::kStored && m_zip.dataOffset(*entry, &offset) &&
+                      banded.open(m_path, offset, entry->size);
+        }
+        if (indexed && banded.width() == width && banded.height() == height) {
+            auto buffer = std::make_unique<ImageBuffer>(width, height, ImageBuffer::Storage::Tiled);
+            buffer->setTileLoader(std::make_shared<BandLoader>(std::move(banded), name));
+            layers[i] = std::move(buffer);
+            continue;
+        }
+
+        Encoded item{i, {}};
+        if (!read(name, item.data)) {
+            problem = "Missing layer image " + name;
+            continue;
+        }
+        encoded.push_back(std::move(item));
+    }
+
+    std::vector<std::string> problems(encoded.size());
+    ThreadPool::shared().parallelFor(encoded.size(), [&](size_t k) {
+        Encoded& item = encoded[k];
+        std::string message;
+        auto image = png::decode(item.data.data(), item.data.size(), &message);
+        if (!image) problems[k] = "Unreadable layer image " + m_info.layers[item.layer].filename + ": " + message;
+        layers[item.layer] = fitToProject(std::move(image), width, height);
+        std::vector<uint8_t>().swap(item.data);
+    });
+    for (const std::string& message : problems) {
+        if (!message.empty()) problem = message;
+    }
+
+    if (error) *error = problem;
+    return layers;
+}
+
+std::vector<std::string> ProjectReader::timelapseMembers() const {
+    std::vector<std::string> names;
+    if (m_isFolder) {
+        std::error_code ec;
+        const fs::path dir = fs::path(m_path) / "timelapse";
+        if (fs::is_directory(dir, ec)) {
+            for (const auto& entry : fs::directory_iterator(dir, ec)) {
+                if (entry.is_regular_file(ec)) names.push_back(kTimelapseDir + entry.path().filename().string());
+            }
+        }
+    } else {
+        const size_t prefix = std::strlen(kTimelapseDir);
+        for (const ZipReader::Entry& entry : m_zip.entries()) {
+            if (entry.name.size() > prefix && entry.name.compare(0, prefix, kTimelapseDir) == 0 &&
+                entry.name.back() != '/') {
+                names.push_back(entry.name);
+            }
+        }
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+bool ProjectReader::extract(const std::string& name, const std::string& target, std::string* error) {
+    std::error_code ec;
+    if (m_isFolder) {
+        if (!fs::copy_file(fs::path(m_path) / fs::path(name), fs::path(target),
+                           fs::copy_options::overwrite_existing, ec)) {
+            return fail(error, "Cannot copy " + name + ": " + ec.message());
+        }
+        return true;
+    }
+
+    const ZipReader::Entry* entry = m_zip.find(name);
+    if (!entry) return fail(error, "No " + name + " in " + m_path);
+    std::ofstream out(fs::path(target), std::ios::binary | std::ios::trunc);
+    if (!out) return fail(error, "Cannot write " + target);
+
+    // Stored members (timelapse containers) are copied in chunks straight
+    // from the archive; anything else is small enough to inflate whole
+    uint64_t offset = 0;
+    if (entry->method == ZipReader::kStored && m_zip.dataOffset(*entry, &offset)) {
+        std::ifstream in(fs::path(m_path), std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(offset));
+        std::vector<char> chunk(static_cast<size_t>(std::min<uint64_t>(entry->size, kCopyChunk)));
+        uLong crc = crc32(0L, Z_NULL, 0);
+        for (uint64_t done = 0; done < entry->size;) {
+            const size_t bytes = static_cast<size_t>(std::min<uint64_t>(entry->size - done, chunk.size()));
+            if (!in.read(chunk.data(), static_cast<std::streamsize>(bytes)) ||
+                !out.write(chunk.data(), static_cast<std::streamsize>(bytes))) {
+                return fail(error, "Cannot extract " + name);
+            }
+            crc = crc32(crc, reinterpret_cast<const Bytef*>(chunk.data()), static_cast<uInt>(bytes));
+            done += bytes;
+        }
+        if (static_cast<uint32_t>(crc) != entry->crc) return fail(error, "Corrupt project member " + name);
+    } else {
+        std::vector<uint8_t> data;
+        if (!m_zip.read(*entry, data)) return fail(error, "Corrupt project member " + name);
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+    if (!out.flush()) return fail(error, "Cannot write " + target);
+    return true;
+}
+
+// ============================================================================
+// LayerManager glue
+// ============================================================================
+
+const char* blendModeName(BlendMode mode) {
+    for (const BlendModeName& entry : kBlendModeNames) {
+        if (entry.mode == mode) return entry.name;
+    }
+    return "Normal";
+}
+
+BlendMode blendModeFromName(const std::string& name) {
+    for (const BlendModeName& entry : kBlendModeNames) {
+        if (name == entry.name) return entry.mode;
+    }
+    return BlendMode::Normal;
+}
+
+ProjectLayer projectLayer(const LayerManager& layers, int index) {
+    const Layer& layer = *layers.getLayer(index);
+    ProjectLayer meta;
+    meta.name = layer.name;
+    meta.type = layerTypeName(layer.type);
+    meta.visible = layer.visible;
+    meta.opacity = layer.opacity;
+    const bool keepName = layer.blendMode == BlendMode::Normal && !layer.savedBlendMode.empty();
+    meta.blendMode = keepName ? layer.savedBlendMode : blendModeName(layer.blendMode);
+    meta.depth = layer.depth;
+    meta.expanded = layer.expanded;
+    meta.locked = layer.locked;
+    meta.alphaLock = layer.alphaLock;
+    meta.clipped = layer.clipped;
+    meta.isPrivate = layer.isPrivate;
+    return meta;
+}
+
+void applyProjectLayer(const ProjectLayer& meta, LayerManager& layers, int index) {
+    Layer& layer = *layers.getLayer(index);
+    layer.name = meta.name;
+    layer.type = layerType(meta.type);
+    layer.visible = meta.visible;
+    layer.opacity = std::clamp(meta.opacity, 0.0f, 1.0f);
+    layer.blendMode = blendModeFromName(meta.blendMode);
+    layer.savedBlendMode = meta.blendMode == blendModeName(layer.blendMode) ? std::string() : meta.blendMode;
+    layer.depth = meta.depth;
+    layer.expanded = meta.expanded;
+    layer.locked = meta.locked;
+    layer.alphaLock = meta.alphaLock;
+    layer.clipped = meta.clipped;
+    layer.isPrivate = meta.isPrivate;
+}
+
+ProjectSnapshot snapshotProject(const LayerManager& layers) {
+    ProjectSnapshot project;
+    project.info.width = layers.width();
+    project.info.height = layers.height();
+    for (int i = 0; i < layers.getLayerCount(); ++i) {
+        project.info.layers.push_back(projectLayer(layers, i));
+
+        const ImageBuffer& source = *layers.getLayer(i)->buffer;
+        auto buffer = std::make_unique<ImageBuffer>(source.width(), source.height(), source.storage());
+        buffer->copyFrom(source);
+        project.layers.push_back(std::move(buffer));
+    }
+    return project;
+}
+
+std::unique_ptr<LayerManager> buildLayerStack(const ProjectInfo& info, std::vector<std::unique_ptr<ImageBuffer>> layers) {
+    auto stack = std::make_unique<LayerManager>(info.width, info.height);
+    for (size_t i = 0; i < info.layers.size(); ++i) {
+        const ProjectLayer& meta = info.layers[i];
+        // The stack starts with a background layer; it becomes layer 0
+        if (i > 0) stack->addLayer(meta.name, layerType(meta.type));
+        applyProjectLayer(meta, *stack, static_cast<int>(i));
+
+        Layer& layer = *stack->getLayer(static_cast<int>(i));
+        if (i < layers.size() && layers[i]) {
+            layer.buffer = fitToProject(std::move(layers[i]), info.width, info.height);
+        } else {
+            layer.buffer->clear();
+        }
+    }
+    if (!info.layers.empty()) stack->setActiveLayer(static_cast<int>(info.layers.size()) - 1);
+    return stack;
+}
+
+} // namespace artflow
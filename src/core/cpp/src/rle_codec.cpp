@@ -0,0 +1,84 @@
+/**
+ * ArtFlow Studio - RLE Codec Implementation
+ *
+ * Stream of blocks, each starting with a header byte:
+ *   0x80 | (n - 1)  -> run: one pixel repeated n times (n <= 128)
+ *   n - 1           -> literal: n pixels follow (n <= 128)
+ */
+
+#include "rle_codec.h"
+#include <cstring>
+
+namespace artflow {
+namespace rle {
+
+namespace {
+
+constexpr size_t kMaxBlock = 128;
+
+inline bool samePixel(const uint8_t* a, const uint8_t* b) {
+    return std::memcmp(a, b, 4) == 0;
+}
+
+} // namespace
+
+std::vector<uint8_t> encodePixels(const uint8_t* rgba, size_t pixelCount) {
+    std::vector<uint8_t> out;
+    out.reserve(64);
+
+    size_t i = 0;
+    while (i < pixelCount) {
+        // Measure the run starting at i
+        size_t run = 1;
+        while (i + run < pixelCount && run < kMaxBlock &&
+               samePixel(rgba + (i + run) * 4, rgba + i * 4)) {
+            ++run;
+        }
+
+        if (run >= 2) {
+            out.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+            out.insert(out.end(), rgba + i * 4, rgba + i * 4 + 4);
+            i += run;
+            continue;
+        }
+
+        // Literal block until the next run of at least two pixels
+        size_t start = i;
+        size_t count = 0;
+        while (i < pixelCount && count < kMaxBlock) {
+            if (i + 1 < pixelCount && samePixel(rgba + i * 4, rgba + (i + 1) * 4)) break;
+            ++i;
+            ++count;
+        }
+        out.push_back(static_cast<uint8_t>(count - 1));
+        out.insert(out.end(), rgba + start * 4, rgba + (start + count) * 4);
+    }
+    return out;
+}
+
+bool decodePixels(const uint8_t* data, size_t size, uint8_t* out, size_t pixelCount) {
+    size_t pos = 0;
+    size_t pixel = 0;
+    while (pos < size && pixel < pixelCount) {
+        uint8_t header = data[pos++];
+        size_t count = static_cast<size_t>(header & 0x7F) + 1;
+        if (pixel + count > pixelCount) return false;
+
+        if (header & 0x80) {
+            if (pos + 4 > size) return false;
+            for (size_t k = 0; k < count; ++k) {
+                std::memcpy(out + (pixel + k) * 4, data + pos, 4);
+            }
+            pos += 4;
+        } else {
+            if (pos + count * 4 > size) return false;
+            std::memcpy(out + pixel * 4, data + pos, count * 4);
+            pos += count * 4;
+        }
+        pixel += count;
+    }
+    return pixel == pixelCount && pos == size;
+}
+
+} // namespace rle
+} // namespace artflow
@@ -0,0 +1,420 @@
+/**
+ * ArtFlow Studio - Selection Mask Implementation
+ */
+
+#include "selection_mask.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace artflow {
+
+namespace {
+
+constexpr int kTile = SelectionMask::kTileSize;
+
+using SpanList = std::vector<std::pair<int, int>>;   // [x0, x1) runs, left to right
+
+// Even-odd scan conversion at pixel centers: pixel (x, y) is inside when
+// (x + 0.5, y + 0.5) is. Calls `row(y, spans)` for every row from the
+// polygon's first to its last, clipped to width x height (rows without a
+// span included); returns that row range as [first, last).
+template <typename RowFn>
+std::pair<int, int> scanPolygon(const float* xy, size_t count, int width, int height, RowFn row) {
+    struct Edge {
+        double yTop, yBottom;   // yTop < yBottom
+        double x;               // x at yTop
+        double slope;           // dx / dy
+    };
+    std::vector<Edge> edges;
+    edges.reserve(count);
+    double minY = xy[1], maxY = xy[1];
+    for (size_t i = 0; i < count; ++i) {
+        const size_t j = (i + 1) % count;
+        double x0 = xy[i * 2], y0 = xy[i * 2 + 1];
+        double x1 = xy[j * 2], y1 = xy[j * 2 + 1];
+        minY = std::min(minY, y0);
+        maxY = std::max(maxY, y0);
+        if (y0 == y1) continue;   // Horizontal edges never cross a center line
+        if (y0 > y1) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+        edges.push_back({y0, y1, x0, (x1 - x0) / (y1 - y0)});
+    }
+
+    // Rows whose center line lies in [minY, maxY)
+    const int first = std::max(0, static_cast<int>(std::ceil(minY - 0.5)));
+    const int last = std::min(height, static_cast<int>(std::ceil(maxY - 0.5)));
+    if (first >= last) return {0, 0};
+
+    // Edges enter the active list in order of their top
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.yTop < b.yTop; });
+    std::vector<const Edge*> active;
+    std::vector<double> crossings;
+    SpanList spans;
+    size_t next = 0;
+
+    for (int y = first; y < last; ++y) {
+        const double cy = y + 0.5;
+        while (next < edges.size() && edges[next].yTop <= cy) active.push_back(&edges[next++]);
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [cy](const Edge* e) { return e->yBottom <= cy; }),
+                     active.end());
+
+        crossings.clear();
+        for (const Edge* e : active) {
+            if (e->yTop <= cy) crossings.push_back(e->x + (cy - e->yTop) * e->slope);
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        spans.clear();
+        for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+            // Centers x + 0.5 in [a, b)
+            const int x0 = std::max(0, static_cast<int>(std::ceil(crossings[i] - 0.5)));
+            const int x1 = std::min(width, static_cast<int>(std::ceil(crossings[i + 1] - 0.5)));
+            if (x0 < x1) spans.emplace_back(x0, x1);
+        }
+        row(y, spans);
+    }
+    return {first, last};
+}
+
+} // anonymous namespace
+
+SelectionMask::SelectionMask(int width, int height)
+    : m_width(std::max(0, width))
+    , m_height(std::max(0, height))
+    , m_tilesX((m_width + kTile - 1) / kTile)
+    , m_tilesY((m_height + kTile - 1) / kTile)
+    , m_tiles(static_cast<size_t>(m_tilesX) * m_tilesY) {
+}
+
+const SelectionMask::TilePtr& SelectionMask::fullTile() {
+    static const TilePtr full = [] {
+        auto tile = std::make_shared<Tile>();
+        tile->fill(255);
+        return tile;
+    }();
+    return full;
+}
+
+const SelectionMask::Tile& SelectionMask::zeroTile() {
+    static const Tile zero{};
+    return zero;
+}
+
+const uint8_t* SelectionMask::tileData(int tx, int ty) const {
+    if (tx < 0 || tx >= m_tilesX || ty < 0 || ty >= m_tilesY) return nullptr;
+    const auto& tile = m_tiles[ty * m_tilesX + tx];
+    return tile ? tile->data() : zeroTile().data();
+}
+
+uint8_t* SelectionMask::mutableTile(int tx, int ty) {
+    auto& tile = m_tiles[ty * m_tilesX + tx];
+    if (!tile) {
+        tile = std::make_shared<Tile>();
+    } else if (tile.use_count() > 1) {
+        tile = std::make_shared<Tile>(*tile);  // Copy on write (and off the full tile)
+    }
+    return tile->data();
+}
+
+uint8_t SelectionMask::valueAt(int x, int y) const {
+    if (x < 0 || x >= m_width || y < 0 || y >= m_height) return 0;
+    return *rowData(x, y);
+}
+
+// ============================================================================
+// Filling
+// ============================================================================
+
+void SelectionMask::fillSpan(int y, int x0, int x1, uint8_t value) {
+    const int ty = y / kTile;
+    while (x0 < x1) {
+        const int tx = x0 / kTile;
+        const int end = std::min(x1, (tx + 1) * kTile);
+        const TilePtr& tile = m_tiles[ty * m_tilesX + tx];
+        // Already uniform with the value
+        if (!(value == 0 ? !tile : tile == fullTile())) {
+            std::memset(mutableTile(tx, ty) + (y % kTile) * kTile + x0 % kTile, value,
+                        static_cast<size_t>(end - x0));
+        }
+        x0 = end;
+    }
+}
+
+void SelectionMask::fillRect(const DirtyRect& area, uint8_t value) {
+    const DirtyRect rect = area.intersected(m_width, m_height);
+    if (rect.isEmpty()) return;
+
+    for (int ty = rect.y / kTile; ty <= (rect.y + rect.h - 1) / kTile; ++ty) {
+        for (int tx = rect.x / kTile; tx <= (rect.x + rect.w - 1) / kTile; ++tx) {
+            const DirtyRect tileRect = DirtyRect{tx * kTile, ty * kTile, kTile, kTile}.intersected(m_width, m_height);
+            const DirtyRect part = tileRect.intersected(rect);
+            // Tiles the rect covers become uniform without touching pixels
+            if (part.w == tileRect.w && part.h == tileRect.h) {
+                m_tiles[ty * m_tilesX + tx] = value ? fullTile() : nullptr;
+                continue;
+            }
+            for (int y = part.y; y < part.y + part.h; ++y) fillSpan(y, part.x, part.x + part.w, value);
+        }
+    }
+}
+
+void SelectionMask::clear() {
+    std::fill(m_tiles.begin(), m_tiles.end(), nullptr);
+    m_bounds = DirtyRect();
+}
+
+void SelectionMask::selectAll() {
+    std::fill(m_tiles.begin(), m_tiles.end(), fullTile());
+    m_bounds = DirtyRect{0, 0, m_width, m_height}.intersected(m_width, m_height);
+}
+
+void SelectionMask::invert() {
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        for (int tx = 0; tx < m_tilesX; ++tx) {
+            TilePtr& tile = m_tiles[ty * m_tilesX + tx];
+            if (!tile) {
+                tile = fullTile();
+            } else if (tile == fullTile()) {
+                tile = nullptr;
+            } else {
+                uint8_t* data = mutableTile(tx, ty);
+                for (size_t i = 0; i < kTileBytes; ++i) data[i] = static_cast<uint8_t>(255 - data[i]);
+            }
+        }
+    }
+    updateBounds();
+}
+
+void SelectionMask::selectRect(int x, int y, int w, int h, Op op) {
+    const DirtyRect rect = DirtyRect{x, y, w, h}.intersected(m_width, m_height);
+    switch (op) {
+    case Op::Replace:
+        clear();
+        [[fallthrough]];
+    case Op::Add:
+        fillRect(rect, 255);
+        m_bounds.unite(rect);
+        return;
+    case Op::Subtract:
+        if (!rect.intersects(m_bounds)) return;
+        fillRect(rect, 0);
+        break;
+    case Op::Intersect: {
+        // Clear what of the selection lies outside the rect
+        const DirtyRect b = m_bounds;
+        if (rect.isEmpty()) {
+            clear();
+            return;
+        }
+        const int rectBottom = rect.y + rect.h;
+        fillRect(DirtyRect{b.x, b.y, b.w, rect.y - b.y}, 0);
+        fillRect(DirtyRect{b.x, rectBottom, b.w, b.y + b.h - rectBottom}, 0);
+        fillRect(DirtyRect{b.x, rect.y, rect.x - b.x, rect.h}, 0);
+        fillRect(DirtyRect{rect.x + rect.w, rect.y, b.x + b.w - rect.x - rect.w, rect.h}, 0);
+        break;
+    }
+    }
+    updateBounds();
+}
+
+void SelectionMask::selectPolygon(const float* xy, size_t count, Op op) {
+    if (count < 3) {
+        // Degenerate shapes select nothing
+        if (op == Op::Replace || op == Op::Intersect) clear();
+        return;
+    }
+
+    switch (op) {
+    case Op::Replace:
+        clear();
+        [[fallthrough]];
+    case Op::Add: {
+        DirtyRect added;
+        scanPolygon(xy, count, m_width, m_height, [&](int y, const SpanList& spans) {
+            for (const auto& span : spans) {
+                fillSpan(y, span.first, span.second, 255);
+                added.unite(DirtyRect{span.first, y, span.second - span.first, 1});
+            }
+        });
+        // Lasso interiors fill whole tiles a row at a time; give those back
+        // to the shared full tile
+        if (!added.isEmpty()) {
+            for (int ty = added.y / kTile; ty <= (added.y + added.h - 1) / kTile; ++ty) {
+                for (int tx = added.x / kTile; tx <= (added.x + added.w - 1) / kTile; ++tx) compactTile(tx, ty);
+            }
+        }
+        m_bounds.unite(added);
+        return;
+    }
+    case Op::Subtract:
+        scanPolygon(xy, count, m_width, m_height, [&](int y, const SpanList& spans) {
+            for (const auto& span : spans) fillSpan(y, span.first, span.second, 0);
+        });
+        break;
+    case Op::Intersect: {
+        // Clear the gaps between spans across the selection's bounds, then
+        // the bands above and below the polygon
+        const DirtyRect b = m_bounds;
+        if (b.isEmpty()) return;
+        const int right = b.x + b.w;
+        const auto rows = scanPolygon(xy, count, m_width, m_height, [&](int y, const SpanList& spans) {
+            if (y < b.y || y >= b.y + b.h) return;
+            int x = b.x;
+            for (const auto& span : spans) {
+                fillSpan(y, x, std::clamp(span.first, x, right), 0);
+                x = std::clamp(span.second, x, right);
+            }
+            fillSpan(y, x, right, 0);
+        });
+        if (rows.first >= rows.second) {
+            clear();
+            return;
+        }
+        fillRect(DirtyRect{b.x, b.y, b.w, rows.first - b.y}, 0);
+        fillRect(DirtyRect{b.x, rows.second, b.w, b.y + b.h - rows.second}, 0);
+        break;
+    }
+    }
+    updateBounds();
+}
+
+// ============================================================================
+// Bounds
+// ============================================================================
+
+void SelectionMask::compactTile(int tx, int ty) {
+    TilePtr& tile = m_tiles[ty * m_tilesX + tx];
+    if (!tile || tile == fullTile()) return;
+    const int w = std::min(kTile, m_width - tx * kTile);
+    const int h = std::min(kTile, m_height - ty * kTile);
+    bool any = false, all = true;
+    for (int y = 0; y < h; ++y) {
+        const uint8_t* row = tile->data() + y * kTile;
+        for (int x = 0; x < w; ++x) {
+            any |= row[x] != 0;
+            all &= row[x] == 255;
+        }
+    }
+    if (!any) tile = nullptr;
+    else if (all) tile = fullTile();
+}
+
+// Tight box of the non-zero pixels. Owned tiles that turn out uniform go
+// back to the shared representations on the way.
+void SelectionMask::updateBounds() {
+    int minX = m_width, minY = m_height, maxX = -1, maxY = -1;
+
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        for (int tx = 0; tx < m_tilesX; ++tx) {
+            TilePtr& tile = m_tiles[ty * m_tilesX + tx];
+            if (!tile) continue;
+            const int x0 = tx * kTile;
+            const int y0 = ty * kTile;
+            const int w = std::min(kTile, m_width - x0);
+            const int h = std::min(kTile, m_height - y0);
+
+            if (tile != fullTile()) {
+                int tMinX = w, tMinY = h, tMaxX = -1, tMaxY = -1;
+                bool full = true;
+                for (int y = 0; y < h; ++y) {
+                    const uint8_t* row = tile->data() + y * kTile;
+                    int first = 0;
+                    while (first < w && row[first] == 0) ++first;
+                    if (first == w) {
+                        full = false;
+                        continue;
+                    }
+                    int last = w - 1;
+                    while (row[last] == 0) --last;
+                    tMinX = std::min(tMinX, first);
+                    tMaxX = std::max(tMaxX, last);
+                    tMinY = std::min(tMinY, y);
+                    tMaxY = y;
+                    if (full) {
+                        for (int x = 0; x < w; ++x) full &= row[x] == 255;
+                    }
+                }
+                if (tMaxY < 0) {
+                    tile = nullptr;
+                    continue;
+                }
+                if (full) {
+                    tile = fullTile();
+                } else {
+                    minX = std::min(minX, x0 + tMinX);
+                    maxX = std::max(maxX, x0 + tMaxX);
+                    minY = std::min(minY, y0 + tMinY);
+                    maxY = std::max(maxY, y0 + tMaxY);
+                    continue;
+                }
+            }
+            minX = std::min(minX, x0);
+            maxX = std::max(maxX, x0 + w - 1);
+            minY = std::min(minY, y0);
+            maxY = std::max(maxY, y0 + h - 1);
+        }
+    }
+    m_bounds = maxX < 0 ? DirtyRect() : DirtyRect{minX, minY, maxX - minX + 1, maxY - minY + 1};
+}
+
+// ============================================================================
+// Interop
+// ============================================================================
+
+void SelectionMask::readRegion(int x, int y, int w, int h, uint8_t* dst, size_t dstStride) const {
+    for (int row = 0; row < h; ++row) {
+        uint8_t* out = dst + row * dstStride;
+        const int py = y + row;
+        if (py < 0 || py >= m_height) {
+            std::memset(out, 0, static_cast<size_t>(w));
+            continue;
+        }
+        int px = x;
+        const int xEnd = x + w;
+        while (px < xEnd) {
+            if (px < 0 || px >= m_width) {
+                const int stop = px < 0 ? std::min(0, xEnd) : xEnd;
+                std::memset(out, 0, static_cast<size_t>(stop - px));
+                out += stop - px;
+                px = stop;
+                continue;
+            }
+            const int count = std::min({xEnd, m_width, (px / kTile + 1) * kTile}) - px;
+            std::memcpy(out, rowData(px, py), static_cast<size_t>(count));
+            out += count;
+            px += count;
+        }
+    }
+}
+
+void SelectionMask::writeRegion(int x, int y, int w, int h, const uint8_t* src, size_t srcStride) {
+    const DirtyRect rect = DirtyRect{x, y, w, h}.intersected(m_width, m_height);
+    if (rect.isEmpty()) return;
+    for (int py = rect.y; py < rect.y + rect.h; ++py) {
+        const uint8_t* in = src + (py - y) * srcStride + (rect.x - x);
+        int px = rect.x;
+        while (px < rect.x + rect.w) {
+            const int end = std::min(rect.x + rect.w, (px / kTile + 1) * kTile);
+            uint8_t* out = mutableTile(px / kTile, py / kTile) + (py % kTile) * kTile + px % kTile;
+            std::memcpy(out, in, static_cast<size_t>(end - px));
+            in += end - px;
+            px = end;
+        }
+    }
+    updateBounds();
+}
+
+size_t SelectionMask::memoryUsage() const {
+    size_t owned = 0;
+    for (const auto& tile : m_tiles) {
+        if (tile && tile != fullTile()) ++owned;
+    }
+    return owned * kTileBytes;
+}
+
+} // namespace artflow
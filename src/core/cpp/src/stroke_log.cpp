@@ -0,0 +1,437 @@
+/**
+ * ArtFlow Studio - Stroke Log Implementation
+ *
+ * File layout (integers little-endian, "varint" = LEB128, signed values
+ * zigzag-coded):
+ *   "AFSL" u32 version
+ *   varint brushCount, then per brush: u64 hash, brush fields
+ *   varint strokeCount, then per stroke: varint byteLength, stroke
+ *
+ * Stroke: varint layerId, varint maskLayerId, u8 alphaLock, u64 brushHash,
+ * u8 r g b a, u64 seed, varint pointCount, then per point the deltas from
+ * the previous point (the first from zero): varint x, y, pressure, time.
+ */
+
+#include "stroke_log.h"
+#include "layer_manager.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace artflow {
+
+namespace {
+
+constexpr char kMagic[4] = {'A', 'F', 'S', 'L'};
+constexpr uint32_t kVersion = 1;
+
+// ============================================================================
+// Byte coding
+// ============================================================================
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+void putSigned(std::vector<uint8_t>& out, int64_t value) {
+    putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void putFixed(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void putFloat(std::vector<uint8_t>& out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putFixed(out, bits, 4);
+}
+
+// Bounds-checked reader; any overrun clears `ok` and yields zeros
+struct Reader {
+    const uint8_t* data;
+    size_t size;
+    size_t pos = 0;
+    bool ok = true;
+
+    Reader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= size) break;
+            const uint8_t byte = data[pos++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t signedVarint() {
+        const uint64_t raw = varint();
+        return static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+    }
+
+    uint64_t fixed(int bytes) {
+        if (size - pos < static_cast<size_t>(bytes)) {
+            ok = false;
+            pos = size;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+        return value;
+    }
+
+    float floatValue() {
+        const uint32_t bits = static_cast<uint32_t>(fixed(4));
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+// ============================================================================
+// Brushes
+// ============================================================================
+
+void encodeBrush(std::vector<uint8_t>& out, const BrushSettings& b) {
+    putFloat(out, b.size);
+    putFloat(out, b.opacity);
+    putFloat(out, b.hardness);
+    putFloat(out, b.flow);
+    putFloat(out, b.spacing);
+    putFloat(out, b.grain);
+    out.push_back(b.sizeByPressure ? 1 : 0);
+    out.push_back(b.opacityByPressure ? 1 : 0);
+    putFloat(out, b.velocityDynamics);
+    putFloat(out, b.stabilization);
+    putFloat(out, b.streamline);
+    putFloat(out, b.jitter);
+    putSigned(out, b.textureId);
+    putFloat(out, b.textureScale);
+    putFloat(out, b.wetness);
+    putFloat(out, b.smudge);
+    out.push_back(static_cast<uint8_t>(b.type));
+}
+
+BrushSettings decodeBrush(Reader& in) {
+    BrushSettings b;
+    b.size = in.floatValue();
+    b.opacity = in.floatValue();
+    b.hardness = in.floatValue();
+    b.flow = in.floatValue();
+    b.spacing = in.floatValue();
+    b.grain = in.floatValue();
+    b.sizeByPressure = in.fixed(1) != 0;
+    b.opacityByPressure = in.fixed(1) != 0;
+    b.velocityDynamics = in.floatValue();
+    b.stabilization = in.floatValue();
+    b.streamline = in.floatValue();
+    b.jitter = in.floatValue();
+    b.textureId = static_cast<int>(in.signedVarint());
+    b.textureScale = in.floatValue();
+    b.wetness = in.floatValue();
+    b.smudge = in.floatValue();
+    const uint64_t type = in.fixed(1);
+    if (type > static_cast<uint64_t>(BrushSettings::Type::Custom)) in.ok = false;
+    b.type = static_cast<BrushSettings::Type>(type);
+    return b;
+}
+
+uint64_t fnv1a(const std::vector<uint8_t>& bytes) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (uint8_t byte : bytes) {
+        hash ^= byte;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool sameBrush(const BrushSettings& a, const BrushSettings& b) {
+    std::vector<uint8_t> ea, eb;
+    encodeBrush(ea, a);
+    encodeBrush(eb, b);
+    return ea == eb && a.tipImage == b.tipImage && a.paperTexture == b.paperTexture;
+}
+
+// ============================================================================
+// Strokes
+// ============================================================================
+
+// Decode one stroke; validates the whole record
+bool decodeStroke(Reader& in, StrokeLog::Stroke& stroke) {
+    stroke.layerId = static_cast<int>(in.signedVarint());
+    stroke.maskLayerId = static_cast<int>(in.signedVarint());
+    stroke.alphaLock = in.fixed(1) != 0;
+    stroke.brushHash = in.fixed(8);
+    stroke.color.r = static_cast<uint8_t>(in.fixed(1));
+    stroke.color.g = static_cast<uint8_t>(in.fixed(1));
+    stroke.color.b = static_cast<uint8_t>(in.fixed(1));
+    stroke.color.a = static_cast<uint8_t>(in.fixed(1));
+    stroke.seed = in.fixed(8);
+
+    const uint64_t count = in.varint();
+    // Every point takes at least four bytes
+    if (!in.ok || count == 0 || count > (in.size - in.pos) / 4) return false;
+
+    stroke.points.clear();
+    stroke.points.reserve(static_cast<size_t>(count));
+    int64_t x = 0, y = 0, pressure = 0;
+    uint64_t time = 0;
+    for (uint64_t i = 0; i < count && in.ok; ++i) {
+        x += in.signedVarint();
+        y += in.signedVarint();
+        pressure += in.signedVarint();
+        time += static_cast<uint64_t>(in.signedVarint());
+        StrokePoint point(x / StrokeLog::kPositionScale, y / StrokeLog::kPositionScale,
+                          pressure / StrokeLog::kPressureScale);
+        point.timestamp = time;
+        stroke.points.push_back(point);
+    }
+    return in.ok;
+}
+
+} // anonymous namespace
+
+DirtyRect renderStrokeStep(BrushEngine& engine, Layer& layer, const ImageBuffer* mask,
+                           bool alphaLock, const StrokePoint* previous, const StrokePoint& point,
+                           const SelectionMask* selection) {
+    if (!previous) {
+        if (engine.getBrush().usesWetMedia()) layer.ensureWetMaps();
+        return engine.renderDab(*layer.buffer, point.x, point.y, point.pressure, alphaLock, mask, selection);
+    }
+    return engine.renderStrokeSegment(*layer.buffer, *previous, point, alphaLock, mask, selection);
+}
+
+// ============================================================================
+// StrokeLog
+// ============================================================================
+
+StrokeLog::StrokeLog() : m_origin(Clock::now()) {
+}
+
+StrokePoint StrokeLog::quantize(const StrokePoint& point) {
+    StrokePoint q = point;
+    q.x = std::round(point.x * kPositionScale) / kPositionScale;
+    q.y = std::round(point.y * kPositionScale) / kPositionScale;
+    q.pressure = std::round(std::clamp(point.pressure, 0.0f, 1.0f) * kPressureScale) / kPressureScale;
+    q.tiltX = 0.0f;
+    q.tiltY = 0.0f;
+    return q;
+}
+
+uint64_t StrokeLog::elapsedMs() const {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_origin).count());
+}
+
+uint64_t StrokeLog::internBrush(const BrushSettings& brush) {
+    std::vector<uint8_t> encoded;
+    encodeBrush(encoded, brush);
+    // Brushes that differ only in their images share field bytes: probe on
+    uint64_t hash = fnv1a(encoded);
+    for (;;) {
+        auto it = m_brushes.find(hash);
+        if (it == m_brushes.end()) {
+            m_brushes.emplace(hash, brush);
+            return hash;
+        }
+        if (sameBrush(it->second, brush)) return hash;
+        ++hash;
+    }
+}
+
+void StrokeLog::beginStroke(int layerId, int maskLayerId, bool alphaLock, const BrushSettings& brush,
+                            const Color& color, uint64_t seed, const StrokePoint& point) {
+    m_header.clear();
+    putSigned(m_header, layerId);
+    putSigned(m_header, maskLayerId);
+    m_header.push_back(alphaLock ? 1 : 0);
+    putFixed(m_header, internBrush(brush), 8);
+    m_header.push_back(color.r);
+    m_header.push_back(color.g);
+    m_header.push_back(color.b);
+    m_header.push_back(color.a);
+    putFixed(m_header, seed, 8);
+
+    m_points.clear();
+    m_pointCount = 0;
+    m_lastX = m_lastY = m_lastPressure = 0;
+    m_lastTime = 0;
+    m_recording = true;
+    appendPoint(point);
+}
+
+void StrokeLog::addPoint(const StrokePoint& point) {
+    if (m_recording) appendPoint(point);
+}
+
+void StrokeLog::appendPoint(const StrokePoint& point) {
+    const int32_t x = static_cast<int32_t>(std::lround(point.x * kPositionScale));
+    const int32_t y = static_cast<int32_t>(std::lround(point.y * kPositionScale));
+    const int32_t pressure = static_cast<int32_t>(std::lround(std::clamp(point.pressure, 0.0f, 1.0f) * kPressureScale));
+    putSigned(m_points, static_cast<int64_t>(x) - m_lastX);
+    putSigned(m_points, static_cast<int64_t>(y) - m_lastY);
+    putSigned(m_points, static_cast<int64_t>(pressure) - m_lastPressure);
+    putSigned(m_points, static_cast<int64_t>(point.timestamp - m_lastTime));
+    m_lastX = x;
+    m_lastY = y;
+    m_lastPressure = pressure;
+    m_lastTime = point.timestamp;
+    ++m_pointCount;
+}
+
+void StrokeLog::endStroke() {
+    if (!m_recording) return;
+    m_recording = false;
+    m_offsets.push_back(m_data.size());
+    m_data.insert(m_data.end(), m_header.begin(), m_header.end());
+    putVarint(m_data, m_pointCount);
+    m_data.insert(m_data.end(), m_points.begin(), m_points.end());
+}
+
+void StrokeLog::cancelStroke() {
+    m_recording = false;
+}
+
+StrokeLog::Stroke StrokeLog::stroke(size_t index) const {
+    Stroke stroke;
+    if (index >= m_offsets.size()) return stroke;
+    const size_t begin = m_offsets[index];
+    const size_t end = index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_data.size();
+    Reader in(m_data.data() + begin, end - begin);
+    decodeStroke(in, stroke);
+    return stroke;
+}
+
+const BrushSettings* StrokeLog::brush(uint64_t hash) const {
+    auto it = m_brushes.find(hash);
+    return it != m_brushes.end() ? &it->second : nullptr;
+}
+
+void StrokeLog::truncate(size_t count) {
+    if (count >= m_offsets.size()) return;
+    m_data.resize(m_offsets[count]);
+    m_offsets.resize(count);
+}
+
+void StrokeLog::clear() {
+    m_brushes.clear();
+    m_data.clear();
+    m_offsets.clear();
+    m_recording = false;
+    m_origin = Clock::now();
+}
+
+DirtyRect StrokeLog::replay(LayerManager& layers, size_t first, size_t count) const {
+    DirtyRect dirty;
+    const size_t end = first + std::min(count, m_offsets.size() - std::min(first, m_offsets.size()));
+    BrushEngine engine;
+    for (size_t i = first; i < end; ++i) {
+        const Stroke s = stroke(i);
+        const BrushSettings* settings = brush(s.brushHash);
+        Layer* layer = layers.findLayerById(s.layerId);
+        if (!settings || !layer || s.points.empty()) continue;
+        Layer* maskLayer = s.maskLayerId >= 0 ? layers.findLayerById(s.maskLayerId) : nullptr;
+        const ImageBuffer* mask = maskLayer ? maskLayer->buffer.get() : nullptr;
+
+        engine.setBrush(*settings);
+        engine.setColor(s.color);
+        engine.beginStroke(s.points[0], s.seed);
+        dirty.unite(renderStrokeStep(engine, *layer, mask, s.alphaLock, nullptr, s.points[0]));
+        for (size_t p = 1; p < s.points.size(); ++p) {
+            dirty.unite(renderStrokeStep(engine, *layer, mask, s.alphaLock, &s.points[p - 1], s.points[p]));
+        }
+        engine.endStroke();
+    }
+    return dirty;
+}
+
+// ============================================================================
+// Serialization
+// ============================================================================
+
+std::vector<uint8_t> StrokeLog::serialize() const {
+    std::vector<uint8_t> out(kMagic, kMagic + 4);
+    putFixed(out, kVersion, 4);
+
+    // Sorted so equal logs give equal bytes
+    std::vector<uint64_t> hashes;
+    hashes.reserve(m_brushes.size());
+    for (const auto& entry : m_brushes) hashes.push_back(entry.first);
+    std::sort(hashes.begin(), hashes.end());
+    putVarint(out, hashes.size());
+    for (uint64_t hash : hashes) {
+        putFixed(out, hash, 8);
+        encodeBrush(out, m_brushes.at(hash));
+    }
+
+    putVarint(out, m_offsets.size());
+    for (size_t i = 0; i < m_offsets.size(); ++i) {
+        const size_t end = i + 1 < m_offsets.size() ? m_offsets[i + 1] : m_data.size();
+        putVarint(out, end - m_offsets[i]);
+        out.insert(out.end(), m_data.begin() + m_offsets[i], m_data.begin() + end);
+    }
+    return out;
+}
+
+bool StrokeLog::deserialize(const uint8_t* data, size_t size) {
+    if (size < 8 || std::memcmp(data, kMagic, 4) != 0) return false;
+    Reader in(data, size);
+    in.pos = 4;
+    if (in.fixed(4) != kVersion) return false;
+
+    std::unordered_map<uint64_t, BrushSettings> brushes;
+    const uint64_t brushCount = in.varint();
+    for (uint64_t i = 0; i < brushCount && in.ok; ++i) {
+        const uint64_t hash = in.fixed(8);
+        BrushSettings brush = decodeBrush(in);
+        if (in.ok) brushes[hash] = brush;
+    }
+
+    std::vector<uint8_t> strokes;
+    std::vector<size_t> offsets;
+    const uint64_t strokeCount = in.varint();
+    for (uint64_t i = 0; i < strokeCount && in.ok; ++i) {
+        const uint64_t length = in.varint();
+        if (!in.ok || length > size - in.pos) return false;
+        Reader record(data + in.pos, static_cast<size_t>(length));
+        Stroke check;
+        if (!decodeStroke(record, check) || record.pos != record.size) return false;
+        offsets.push_back(strokes.size());
+        strokes.insert(strokes.end(), data + in.pos, data + in.pos + length);
+        in.pos += static_cast<size_t>(length);
+    }
+    if (!in.ok || in.pos != size) return false;
+
+    m_brushes = std::move(brushes);
+    m_data = std::move(strokes);
+    m_offsets = std::move(offsets);
+    m_recording = false;
+    return true;
+}
+
+bool StrokeLog::saveToFile(const std::string& path) const {
+    const std::vector<uint8_t> bytes = serialize();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+bool StrokeLog::loadFromFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return deserialize(bytes.data(), bytes.size());
+}
+
+} // namespace artflow
@@ -0,0 +1,143 @@
+/**
+ * ArtFlow Studio - Thread Pool Implementation
+ */
+
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace artflow {
+
+namespace {
+
+// Set on pool workers and on a caller while it runs tasks, so nested loops
+// run inline
+thread_local bool t_insidePool = false;
+
+} // anonymous namespace
+
+struct ThreadPool::Batch {
+    const std::function<void(size_t)>* body = nullptr;
+    std::atomic<size_t> remaining{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished = false;   // Set under `mutex` by the last task
+};
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+ThreadPool::ThreadPool(unsigned workers) {
+    for (unsigned i = 0; i < workers; ++i) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < workers; ++i) {
+        m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) thread.join();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+    if (m_threads.empty() || count == 1 || t_insidePool) {
+        for (size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+
+    Batch batch;
+    batch.body = &body;
+    batch.remaining.store(count, std::memory_order_relaxed);
+
+    // Counted before dealing so a fast worker never takes it below zero
+    m_queued.fetch_add(count, std::memory_order_relaxed);
+
+    // Deal contiguous runs so neighbouring items start on the same worker
+    const size_t workers = m_queues.size();
+    const size_t perWorker = (count + workers - 1) / workers;
+    for (size_t w = 0; w < workers; ++w) {
+        const size_t begin = w * perWorker;
+        const size_t end = std::min(count, begin + perWorker);
+        if (begin >= end) break;
+        std::lock_guard<std::mutex> lock(m_queues[w]->mutex);
+        for (size_t i = begin; i < end; ++i) m_queues[w]->tasks.push_back({&batch, i});
+    }
+    {
+        // Pairs with the predicate check of sleeping workers
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+    }
+    m_wake.notify_all();
+
+    // Help out until nothing is left to take, then wait for tasks in flight
+    t_insidePool = true;
+    Task task;
+    while (batch.remaining.load(std::memory_order_acquire) > 0 && steal(static_cast<unsigned>(workers), task)) {
+        runTask(task);
+    }
+    t_insidePool = false;
+
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.done.wait(lock, [&batch] { return batch.finished; });
+}
+
+void ThreadPool::runTask(const Task& task) {
+    Batch& batch = *task.batch;
+    (*batch.body)(task.index);
+    if (batch.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // Last one. The caller returns (destroying the batch) only after
+        // seeing `finished` under the mutex, i.e. after this scope.
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        batch.finished = true;
+        batch.done.notify_all();
+    }
+}
+
+bool ThreadPool::popOwn(unsigned self, Task& task) {
+    Queue& queue = *m_queues[self];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    m_queued.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ThreadPool::steal(unsigned self, Task& task) {
+    const size_t count = m_queues.size();
+    for (size_t k = 1; k <= count; ++k) {
+        const size_t victim = (self + k) % count;
+        if (victim == self) continue;
+        Queue& queue = *m_queues[victim];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned self) {
+    t_insidePool = true;
+    Task task;
+    for (;;) {
+        if (popOwn(self, task) || steal(self, task)) {
+            runTask(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wake.wait(lock, [this] { return m_stopping || m_queued.load(std::memory_order_relaxed) > 0; });
+        if (m_stopping) return;
+    }
+}
+
+} // namespace artflow
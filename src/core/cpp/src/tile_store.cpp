@@ -0,0 +1,269 @@
+/**
+ * ArtFlow Studio - Tile Store Implementation
+ */
+
+#include "tile_store.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace artflow {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kTileBytes = ImageBuffer::kTileBytes;
+constexpr uint64_t kChunkBytes = static_cast<uint64_t>(TileStore::kChunkTiles) * kTileBytes;
+
+bool fail(std::string* error, const std::string& message) {
+    if (error) *error = message;
+    return false;
+}
+
+// Let the OS drop a tile's pages from memory; its contents stay in the file
+void handBack(uint8_t* address) {
+#if defined(_WIN32)
+    // Unlocking pages that are not locked removes them from the working set
+    VirtualUnlock(address, kTileBytes);
+#elif defined(__linux__)
+    // Unmaps the pages; as the mapping is shared, dirty ones stay in the
+    // page cache, which writes them back and reclaims them
+    madvise(address, kTileBytes, MADV_DONTNEED);
+#else
+    msync(address, kTileBytes, MS_ASYNC);
+    madvise(address, kTileBytes, MADV_DONTNEED);
+#endif
+}
+
+} // anonymous namespace
+
+struct TileStore::Chunk {
+    uint8_t* base = nullptr;
+    std::unique_ptr<std::atomic<uint8_t>[]> flags{new std::atomic<uint8_t>[kChunkTiles]()};
+#if defined(_WIN32)
+    HANDLE mapping = nullptr;
+#endif
+};
+
+std::shared_ptr<TileStore> TileStore::create(const std::string& directory, size_t residentBudgetBytes,
+                                             std::string* error) {
+    std::error_code ec;
+    const fs::path dir = directory.empty() ? fs::temp_directory_path(ec) : fs::path(directory);
+    std::shared_ptr<TileStore> store(new TileStore());
+
+#if defined(_WIN32)
+    wchar_t name[MAX_PATH];
+    if (!GetTempFileNameW(dir.wstring().c_str(), L"aft", 0, name)) {
+        fail(error, "Cannot create a scratch file in " + dir.string());
+        return nullptr;
+    }
+    HANDLE file = CreateFileW(name, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        DeleteFileW(name);
+        fail(error, "Cannot create a scratch file in " + dir.string());
+        return nullptr;
+    }
+    store->m_file = file;
+#else
+    std::string pattern = (dir / "artflow-tiles-XXXXXX").string();
+    const int file = mkstemp(&pattern[0]);
+    if (file < 0) {
+        fail(error, "Cannot create a scratch file in " + dir.string());
+        return nullptr;
+    }
+    unlink(pattern.c_str());   // Gone with the last descriptor, even after a crash
+    store->m_file = file;
+#endif
+
+    store->setResidentBudget(residentBudgetBytes);
+    return store;
+}
+
+TileStore::~TileStore() {
+    m_worker.waitIdle();   // A trim may still be walking the chunks
+    for (const auto& chunk : m_chunks) {
+#if defined(_WIN32)
+        UnmapViewOfFile(chunk->base);
+        CloseHandle(chunk->mapping);
+#else
+        munmap(chunk->base, kChunkBytes);
+#endif
+    }
+#if defined(_WIN32)
+    if (m_file) CloseHandle(m_file);
+#else
+    if (m_file >= 0) close(m_file);
+#endif
+}
+
+bool TileStore::grow(std::string* error) {
+    const uint64_t offset = m_chunks.size() * kChunkBytes;
+    auto chunk = std::make_unique<Chunk>();
+
+#if defined(_WIN32)
+    // Not sparse, so the space is there before any tile is written to it
+    const uint64_t end = offset + kChunkBytes;
+    LARGE_INTEGER size;
+    size.QuadPart = static_cast<LONGLONG>(end);
+    if (!SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+        return fail(error, "Cannot grow the scratch file");
+    }
+    chunk->mapping = CreateFileMappingW(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(end >> 32),
+                                        static_cast<DWORD>(end), nullptr);
+    void* view = chunk->mapping ? MapViewOfFile(chunk->mapping, FILE_MAP_ALL_ACCESS, static_cast<DWORD>(offset >> 32),
+                                                static_cast<DWORD>(offset), static_cast<SIZE_T>(kChunkBytes))
+                                : nullptr;
+    if (!view) {
+        if (chunk->mapping) CloseHandle(chunk->mapping);
+        return fail(error, "Cannot map the scratch file");
+    }
+#else
+#if defined(__linux__)
+    // Reserve the blocks: writing a page of a sparse file on a full disk
+    // would raise SIGBUS instead of failing here
+    if (posix_fallocate(m_file, static_cast<off_t>(offset), static_cast<off_t>(kChunkBytes)) != 0) {
+        return fail(error, "Cannot grow the scratch file");
+    }
+#else
+    if (ftruncate(m_file, static_cast<off_t>(offset + kChunkBytes)) != 0) return fail(error, "Cannot grow the scratch file");
+#endif
+    void* view = mmap(nullptr, kChunkBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, static_cast<off_t>(offset));
+    if (view == MAP_FAILED) return fail(error, "Cannot map the scratch file");
+#endif
+
+    chunk->base = static_cast<uint8_t*>(view);
+    m_chunks.push_back(std::move(chunk));
+    return true;
+}
+
+uint8_t* TileStore::address(size_t slot) const {
+    return m_chunks[slot / kChunkTiles]->base + (slot % kChunkTiles) * kTileBytes;
+}
+
+std::atomic<uint8_t>& TileStore::flags(size_t slot) const {
+    return m_chunks[slot / kChunkTiles]->flags[slot % kChunkTiles];
+}
+
+std::shared_ptr<TileStore::Tile> TileStore::allocate() {
+    size_t slot;
+    bool fresh = false;
+    Tile* tile;
+    std::atomic<uint8_t>* state;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_free.empty()) {
+            slot = m_free.back();   // Most recently freed: likely still resident
+            m_free.pop_back();
+        } else {
+            if (m_used == m_chunks.size() * kChunkTiles && !grow(nullptr)) return nullptr;
+            slot = m_used++;
+            fresh = true;
+        }
+        ++m_allocated;
+        tile = reinterpret_cast<Tile*>(address(slot));
+        state = &flags(slot);
+        state->fetch_or(kAllocated, std::memory_order_relaxed);
+    }
+    // Fresh file space reads as zeros; a reused slot holds an old tile
+    if (!fresh) std::memset(tile->data(), 0, kTileBytes);
+    touch(*state);
+    return std::shared_ptr<Tile>(tile, Release{shared_from_this(), slot, state});
+}
+
+void TileStore::release(size_t slot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Stays resident (and first in line for reuse) until trimmed
+    flags(slot).fetch_and(static_cast<uint8_t>(~kAllocated), std::memory_order_relaxed);
+    m_free.push_back(slot);
+    --m_allocated;
+}
+
+bool TileStore::owns(const ImageBuffer::TileHandle& tile) const {
+    const Release* release = std::get_deleter<Release>(tile);
+    return release && release->store.get() == this;
+}
+
+void TileStore::touch(std::atomic<uint8_t>& state) {
+    constexpr uint8_t kUsed = kResident | kReferenced;
+    if ((state.load(std::memory_order_relaxed) & kUsed) == kUsed) return;
+    if (state.fetch_or(kUsed, std::memory_order_relaxed) & kResident) return;
+
+    const size_t resident = m_residentTiles.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (resident > m_budgetTiles.load(std::memory_order_relaxed) && !m_trimQueued.exchange(true)) {
+        m_worker.post([this]() { trim(); });
+    }
+}
+
+void TileStore::setResidentBudget(size_t bytes) {
+    m_budgetTiles.store(std::max<size_t>(bytes / kTileBytes, 1), std::memory_order_relaxed);
+    if (m_residentTiles.load(std::memory_order_relaxed) > m_budgetTiles.load(std::memory_order_relaxed) &&
+        !m_trimQueued.exchange(true)) {
+        m_worker.post([this]() { trim(); });
+    }
+}
+
+size_t TileStore::allocatedBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_allocated * kTileBytes;
+}
+
+size_t TileStore::fileBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_chunks.size() * kChunkBytes;
+}
+
+void TileStore::trim() {
+    m_trimQueued.store(false);   // Touches from here on may queue another pass
+    std::vector<uint8_t*> cold;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        cold = sweep();
+    }
+    // Outside the lock: paging out may wait on I/O, allocations need not.
+    // A slot reused meanwhile just faults back in.
+    for (uint8_t* address : cold) handBack(address);
+}
+
+// Clock sweep: a tile used since the hand last passed loses its mark and
+// stays; one not used is marked not resident and returned. Free slots go
+// first, marked or not. Two rounds clear every mark, so the sweep ends.
+std::vector<uint8_t*> TileStore::sweep() {
+    const size_t budget = m_budgetTiles.load(std::memory_order_relaxed);
+    const size_t target = budget - budget / 8;
+    const size_t slots = m_used;
+    std::vector<uint8_t*> cold;
+    for (size_t step = 0; step < 2 * slots && m_residentTiles.load(std::memory_order_relaxed) > target; ++step) {
+        if (m_hand >= slots) m_hand = 0;
+        const size_t slot = m_hand++;
+        std::atomic<uint8_t>& state = flags(slot);
+        uint8_t current = state.load(std::memory_order_relaxed);
+        if (!(current & kResident)) continue;
+        if ((current & kAllocated) && (current & kReferenced)) {
+            state.fetch_and(static_cast<uint8_t>(~kReferenced), std::memory_order_relaxed);
+            continue;
+        }
+        // Skip it if it was used in the meantime
+        if (!state.compare_exchange_strong(current, current & kAllocated, std::memory_order_relaxed)) continue;
+        m_residentTiles.fetch_sub(1, std::memory_order_relaxed);
+        cold.push_back(address(slot));
+    }
+    return cold;
+}
+
+} // namespace artflow
@@ -0,0 +1,472 @@
+/**
+ * ArtFlow Studio - Timelapse Implementation
+ */
+
+#include "timelapse.h"
+#include "layer_manager.h"
+#include "rle_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace artflow {
+
+namespace {
+
+constexpr char kMagic[4] = {'A', 'F', 'T', 'L'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderBytes = 16;        // Magic, version, width, height
+constexpr size_t kFrameHeaderBytes = 17;   // Payload size, index, timestamp, type
+constexpr uint8_t kKeyFrame = 0;
+constexpr uint8_t kDeltaFrame = 1;
+constexpr int kTile = ImageBuffer::kTileSize;
+constexpr int kBlock = TimelapseWriter::kBlockSize;
+
+void putFixed(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void setFixed(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint64_t getFixed(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return value;
+}
+
+std::vector<uint8_t> fileHeader(int width, int height) {
+    std::vector<uint8_t> header(kMagic, kMagic + 4);
+    putFixed(header, kVersion, 4);
+    putFixed(header, static_cast<uint32_t>(width), 4);
+    putFixed(header, static_cast<uint32_t>(height), 4);
+    return header;
+}
+
+// Header fields of a container; false if `in` is not one
+bool parseHeader(const uint8_t* in, int* width, int* height) {
+    if (std::memcmp(in, kMagic, 4) != 0 || getFixed(in + 4, 4) != kVersion) return false;
+    *width = static_cast<int>(getFixed(in + 8, 4));
+    *height = static_cast<int>(getFixed(in + 12, 4));
+    return *width > 0 && *height > 0;
+}
+
+} // anonymous namespace
+
+// ============================================================================
+// TimelapseWriter
+// ============================================================================
+
+bool TimelapseWriter::open(const std::string& path, int width, int height) {
+    close();
+    if (width <= 0 || height <= 0) return false;
+
+    // Continue an existing container: count its whole frames and cut off a
+    // torn one at the end
+    uint32_t frames = 0;
+    std::error_code error;
+    const uint64_t fileSize = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+    if (fileSize > 0) {
+        std::ifstream in(path, std::ios::binary);
+        uint8_t header[kHeaderBytes];
+        int w = 0, h = 0;
+        if (!in.read(reinterpret_cast<char*>(header), kHeaderBytes) || !parseHeader(header, &w, &h) ||
+            w != width || h != height) {
+            return false;
+        }
+        uint64_t end = kHeaderBytes;
+        uint8_t frameHeader[kFrameHeaderBytes];
+        while (end + kFrameHeaderBytes <= fileSize) {
+            in.seekg(static_cast<std::streamoff>(end));
+            if (!in.read(reinterpret_cast<char*>(frameHeader), kFrameHeaderBytes)) break;
+            const uint64_t next = end + kFrameHeaderBytes + getFixed(frameHeader, 4);
+            if (next > fileSize) break;
+            end = next;
+            ++frames;
+        }
+        in.close();
+        if (end < fileSize) std::filesystem::resize_file(path, end, error);
+        if (error) return false;
+        m_file.open(path, std::ios::binary | std::ios::app);
+    } else {
+        m_file.open(path, std::ios::binary | std::ios::trunc);
+        const std::vector<uint8_t> header = fileHeader(width, height);
+        m_file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+        m_file.flush();
+    }
+    if (!m_file) {
+        m_file.close();
+        return false;
+    }
+
+    m_width = width;
+    m_height = height;
+    m_frameCount = frames;
+    m_sinceKeyFrame = 0;
+    m_hasPrevious = false;
+    m_previous.assign(static_cast<size_t>(width) * height * 4, 0);
+    return true;
+}
+
+void TimelapseWriter::close() {
+    if (m_file.is_open()) m_file.close();
+    m_file.clear();
+    m_hasPrevious = false;
+    m_previous.clear();
+    m_previous.shrink_to_fit();
+}
+
+bool TimelapseWriter::append(const uint8_t* pixels, size_t stride, uint64_t timestampMs) {
+    if (!m_file.is_open()) return false;
+
+    const bool key = !m_hasPrevious || m_sinceKeyFrame >= kKeyFrameInterval;
+    const size_t rowBytes = static_cast<size_t>(m_width) * 4;
+
+    std::vector<uint8_t> record(kFrameHeaderBytes + 4, 0);
+    std::vector<uint8_t> block(static_cast<size_t>(kBlock) * kBlock * 4);
+    uint32_t blockCount = 0;
+    for (int by = 0; by * kBlock < m_height; ++by) {
+        for (int bx = 0; bx * kBlock < m_width; ++bx) {
+            const int x0 = bx * kBlock;
+            const int y0 = by * kBlock;
+            const int bw = std::min(kBlock, m_width - x0);
+            const int bh = std::min(kBlock, m_height - y0);
+            const size_t bytes = static_cast<size_t>(bw) * 4;
+
+            bool changed = key;
+            for (int y = 0; y < bh && !changed; ++y) {
+                changed = std::memcmp(pixels + (y0 + y) * stride + x0 * 4,
+                                      m_previous.data() + (y0 + y) * rowBytes + x0 * 4, bytes) != 0;
+            }
+            if (!changed) continue;
+
+            for (int y = 0; y < bh; ++y) {
+                const uint8_t* src = pixels + (y0 + y) * stride + x0 * 4;
+                std::memcpy(block.data() + y * bytes, src, bytes);
+                std::memcpy(m_previous.data() + (y0 + y) * rowBytes + x0 * 4, src, bytes);
+            }
+            const std::vector<uint8_t> coded = rle::encodePixels(block.data(), static_cast<size_t>(bw) * bh);
+            putFixed(record, static_cast<uint32_t>(bx), 2);
+            putFixed(record, static_cast<uint32_t>(by), 2);
+            putFixed(record, coded.size(), 4);
+            record.insert(record.end(), coded.begin(), coded.end());
+            ++blockCount;
+        }
+    }
+
+    setFixed(record.data(), record.size() - kFrameHeaderBytes, 4);
+    setFixed(record.data() + 4, m_frameCount, 4);
+    setFixed(record.data() + 8, timestampMs, 8);
+    record[16] = key ? kKeyFrame : kDeltaFrame;
+    setFixed(record.data() + kFrameHeaderBytes, blockCount, 4);
+
+    m_file.write(reinterpret_cast<const char*>(record.data()), static_cast<std::streamsize>(record.size()));
+    m_file.flush();
+    if (!m_file) return false;
+
+    m_hasPrevious = true;
+    m_sinceKeyFrame = key ? 1 : m_sinceKeyFrame + 1;
+    ++m_frameCount;
+    return true;
+}
+
+// ============================================================================
+// TimelapseReader
+// ============================================================================
+
+bool TimelapseReader::open(const std::string& path, uint64_t offset, uint64_t size) {
+    m_file.close();
+    m_file.clear();
+    m_frames.clear();
+    m_current = SIZE_MAX;
+
+    std::error_code error;
+    const uint64_t fileSize = std::filesystem::file_size(path, error);
+    if (error || offset >= fileSize) return false;
+    const uint64_t end = offset + std::min(size, fileSize - offset);
+
+    m_file.open(path, std::ios::binary);
+    uint8_t header[kHeaderBytes];
+    m_file.seekg(static_cast<std::streamoff>(offset));
+    if (!m_file.read(reinterpret_cast<char*>(header), kHeaderBytes) || !parseHeader(header, &m_width, &m_height)) {
+        m_file.close();
+        return false;
+    }
+
+    // Index the whole frames; a torn one at the end is left out
+    uint64_t pos = offset + kHeaderBytes;
+    uint8_t frameHeader[kFrameHeaderBytes];
+    while (pos + kFrameHeaderBytes <= end) {
+        m_file.seekg(static_cast<std::streamoff>(pos));
+        if (!m_file.read(reinterpret_cast<char*>(frameHeader), kFrameHeaderBytes)) break;
+        Frame frame;
+        frame.bytes = static_cast<uint32_t>(getFixed(frameHeader, 4));
+        frame.offset = pos + kFrameHeaderBytes;
+        frame.timestampMs = getFixed(frameHeader + 8, 8);
+        frame.keyFrame = frameHeader[16] == kKeyFrame;
+        if (frame.offset + frame.bytes > end) break;
+        m_frames.push_back(frame);
+        pos = frame.offset + frame.bytes;
+    }
+    m_file.clear();
+    m_frame.assign(static_cast<size_t>(m_width) * m_height * 4, 0);
+    return true;
+}
+
+size_t TimelapseReader::keyFrameBefore(size_t index) const {
+    index = std::min(index, m_frames.size() - 1);
+    while (index > 0 && !m_frames[index].keyFrame) --index;
+    return index;
+}
+
+bool TimelapseReader::readFrame(size_t index, uint8_t* out, size_t stride) {
+    if (index >= m_frames.size()) return false;
+    if (m_current == SIZE_MAX || index < m_current || (index > m_current + 1 && keyFrameBefore(index) > m_current)) {
+        // Not reachable by deltas from the frame held: restart at a key frame
+        m_current = SIZE_MAX;
+        std::fill(m_frame.begin(), m_frame.end(), 0);
+        for (size_t i = keyFrameBefore(index); i <= index; ++i) {
+            if (!applyFrame(i)) return false;
+        }
+    } else {
+        for (size_t i = m_current + 1; i <= index; ++i) {
+            if (!applyFrame(i)) return false;
+        }
+    }
+
+    const size_t rowBytes = static_cast<size_t>(m_width) * 4;
+    for (int y = 0; y < m_height; ++y) {
+        std::memcpy(out + y * stride, m_frame.data() + y * rowBytes, rowBytes);
+    }
+    return true;
+}
+
+bool TimelapseReader::applyFrame(size_t index) {
+    const Frame& frame = m_frames[index];
+    m_current = SIZE_MAX;   // Until the frame is fully applied
+    m_payload.resize(frame.bytes);
+    m_file.seekg(static_cast<std::streamoff>(frame.offset));
+    if (!m_file.read(reinterpret_cast<char*>(m_payload.data()), frame.bytes) || frame.bytes < 4) {
+        m_file.clear();
+        return false;
+    }
+
+    const uint8_t* data = m_payload.data();
+    const size_t rowBytes = static_cast<size_t>(m_width) * 4;
+    const uint32_t blockCount = static_cast<uint32_t>(getFixed(data, 4));
+    std::vector<uint8_t> block(static_cast<size_t>(kBlock) * kBlock * 4);
+    size_t pos = 4;
+    for (uint32_t i = 0; i < blockCount; ++i) {
+        if (pos + 8 > frame.bytes) return false;
+        const int x0 = static_cast<int>(getFixed(data + pos, 2)) * kBlock;
+        const int y0 = static_cast<int>(getFixed(data + pos + 2, 2)) * kBlock;
+        const size_t bytes = static_cast<size_t>(getFixed(data + pos + 4, 4));
+        pos += 8;
+        if (x0 >= m_width || y0 >= m_height || bytes > frame.bytes - pos) return false;
+
+        const int bw = std::min(kBlock, m_width - x0);
+        const int bh = std::min(kBlock, m_height - y0);
+        if (!rle::decodePixels(data + pos, bytes, block.data(), static_cast<size_t>(bw) * bh)) return false;
+        pos += bytes;
+        for (int y = 0; y < bh; ++y) {
+            std::memcpy(m_frame.data() + (y0 + y) * rowBytes + x0 * 4, block.data() + y * bw * 4,
+                        static_cast<size_t>(bw) * 4);
+        }
+    }
+    m_current = index;
+    return true;
+}
+
+// ============================================================================
+// TimelapseRecorder
+// ============================================================================
+
+TimelapseRecorder::TimelapseRecorder(int canvasWidth, int canvasHeight, int maxSize)
+    : m_width(canvasWidth)
+    , m_height(canvasHeight)
+    , m_tilesX((canvasWidth + kTile - 1) / kTile)
+    , m_tilesY((canvasHeight + kTile - 1) / kTile)
+    , m_start(std::chrono::steady_clock::now())
+    , m_composite(canvasWidth, canvasHeight, ImageBuffer::Storage::Tiled) {
+    // Fit the long side into maxSize; never upscale
+    const double scale = std::min(1.0, static_cast<double>(std::max(maxSize, 1)) / std::max(canvasWidth, canvasHeight));
+    m_frameWidth = std::max(1, static_cast<int>(canvasWidth * scale + 0.5));
+    m_frameHeight = std::max(1, static_cast<int>(canvasHeight * scale + 0.5));
+    m_frame.assign(static_cast<size_t>(m_frameWidth) * m_frameHeight * 4, 0);
+}
+
+TimelapseRecorder::~TimelapseRecorder() {
+    m_worker.waitIdle();
+}
+
+bool TimelapseRecorder::open(const std::string& path) {
+    m_worker.waitIdle();
+    const bool ok = m_writer.open(path, m_frameWidth, m_frameHeight);
+    m_frameCount = m_writer.frameCount();
+    return ok;
+}
+
+void TimelapseRecorder::flush() {
+    m_worker.waitIdle();
+}
+
+void TimelapseRecorder::capture(const LayerManager& layers) {
+    auto snapshot = std::make_unique<Snapshot>();
+    snapshot->timestampMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - m_start).count());
+    for (int i = 0; i < layers.getLayerCount(); ++i) {
+        const Layer* layer = layers.getLayer(i);
+        if (!layer || !layer->visible || layer->isPrivate) continue;
+        const ImageBuffer& buffer = *layer->buffer;
+        if (buffer.width() != m_width || buffer.height() != m_height) continue;
+
+        LayerSnapshot shot;
+        shot.id = layer->id;
+        shot.opacity = layer->opacity;
+        shot.blendMode = layer->blendMode;
+        if (buffer.isTiled()) {
+            shot.buffer = buffer.tileSnapshot();
+        } else {
+            ImageBuffer tiled(m_width, m_height, ImageBuffer::Storage::Tiled);
+            tiled.copyFrom(buffer);
+            shot.buffer = tiled.tileSnapshot();
+        }
+        snapshot->layers.push_back(std::move(shot));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const bool queued = m_pending != nullptr;
+    m_pending = std::move(snapshot);
+    if (!queued) m_worker.post([this]() { processPending(); });
+}
+
+void TimelapseRecorder::processPending() {
+    std::unique_ptr<Snapshot> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        snapshot = std::move(m_pending);
+    }
+    if (!snapshot || !m_writer.isOpen()) return;
+
+    // Rows a lazily loaded layer has not needed yet are decoded here, off
+    // the canvas thread; while one stays pending the last frame's copy is
+    // reused, so it also counts as unchanged
+    for (size_t i = 0; i < snapshot->layers.size(); ++i) {
+        ImageBuffer::TileSnapshot& tiles = snapshot->layers[i].buffer;
+        if (!tiles.loader) continue;
+        const ImageBuffer::TileSnapshot* last = nullptr;
+        if (m_previous && i < m_previous->layers.size() && m_previous->layers[i].buffer.loader == tiles.loader) {
+            last = &m_previous->layers[i].buffer;
+        }
+        for (int ty = 0; ty < m_tilesY; ++ty) {
+            if (!tiles.isRowPending(ty)) continue;
+            const size_t row = static_cast<size_t>(ty) * m_tilesX;
+            if (last && last->isRowPending(ty)) {
+                std::copy_n(last->tiles.begin() + row, m_tilesX, tiles.tiles.begin() + row);
+            } else {
+                tiles.loadRow(ty, &tiles.tiles[row]);
+            }
+        }
+    }
+
+    // A tile changed if any layer's handle for it did (layers hold their
+    // tiles copy-on-write and m_previous keeps the old ones alive, so a
+    // write always yields a new tile); a different stack redoes them all
+    bool all = !m_previous || m_previous->layers.size() != snapshot->layers.size();
+    for (size_t i = 0; !all && i < snapshot->layers.size(); ++i) {
+        const LayerSnapshot& a = snapshot->layers[i];
+        const LayerSnapshot& b = m_previous->layers[i];
+        all = a.id != b.id || a.opacity != b.opacity || a.blendMode != b.blendMode;
+    }
+
+    DirtyRect dirty;
+    for (int ty = 0; ty < m_tilesY; ++ty) {
+        for (int tx = 0; tx < m_tilesX; ++tx) {
+            const size_t index = static_cast<size_t>(ty) * m_tilesX + tx;
+            bool changed = all;
+            for (size_t i = 0; !changed && i < snapshot->layers.size(); ++i) {
+                changed = snapshot->layers[i].buffer.tiles[index] != m_previous->layers[i].buffer.tiles[index];
+            }
+            if (!changed) continue;
+            compositeTile(*snapshot, tx, ty);
+            dirty.unite(DirtyRect{tx * kTile, ty * kTile, kTile, kTile});
+        }
+    }
+    const uint64_t timestamp = snapshot->timestampMs;
+    m_previous = std::move(snapshot);
+    if (dirty.isEmpty() && m_writer.frameCount() > 0) return;   // Nothing visible changed
+
+    downscale(dirty.intersected(m_width, m_height));
+    if (m_writer.append(m_frame.data(), static_cast<size_t>(m_frameWidth) * 4, timestamp)) {
+        m_frameCount = m_writer.frameCount();
+    }
+}
+
+// Same stacking as LayerManager::compositeAll() for one tile
+void TimelapseRecorder::compositeTile(const Snapshot& snapshot, int tx, int ty) {
+    const size_t index = static_cast<size_t>(ty) * m_tilesX + tx;
+    const int w = std::min(kTile, m_width - tx * kTile);
+    const int h = std::min(kTile, m_height - ty * kTile);
+
+    uint8_t* dst = nullptr;
+    for (const LayerSnapshot& layer : snapshot.layers) {
+        const ImageBuffer::TileHandle& tile = layer.buffer.tiles[index];
+        if (!tile) continue;
+        if (!dst) {
+            dst = m_composite.mutableTileData(tx, ty);
+            std::memset(dst, 0, ImageBuffer::kTileBytes);
+        }
+        const blend::RowKernel kernel = blend::rowKernel(layer.blendMode);
+        for (int y = 0; y < h; ++y) {
+            kernel(dst + y * ImageBuffer::kTileStride, tile->data() + y * ImageBuffer::kTileStride, w, layer.opacity);
+        }
+    }
+    if (!dst) m_composite.setTileHandle(tx, ty, nullptr);
+}
+
+// Box filter of the composite into the frame pixels that `area` (canvas
+// pixels) reaches. Frame pixel x averages canvas columns
+// [x * W / fw, (x + 1) * W / fw), likewise for rows.
+void TimelapseRecorder::downscale(const DirtyRect& area) {
+    if (area.isEmpty()) return;
+    const int64_t W = m_width, H = m_height, fw = m_frameWidth, fh = m_frameHeight;
+    auto srcX = [&](int64_t x) { return static_cast<int>(x * W / fw); };
+    auto srcY = [&](int64_t y) { return static_cast<int>(y * H / fh); };
+
+    const int fx0 = static_cast<int>(std::max<int64_t>(0, area.x * fw / W - 1));
+    const int fx1 = static_cast<int>(std::min<int64_t>(fw, (static_cast<int64_t>(area.x) + area.w) * fw / W + 2));
+    const int fy0 = static_cast<int>(std::max<int64_t>(0, area.y * fh / H - 1));
+    const int fy1 = static_cast<int>(std::min<int64_t>(fh, (static_cast<int64_t>(area.y) + area.h) * fh / H + 2));
+
+    const int sx0 = srcX(fx0);
+    const int sw = srcX(fx1) - sx0;
+    std::vector<uint8_t> band;
+    for (int fy = fy0; fy < fy1; ++fy) {
+        const int sy0 = srcY(fy);
+        const int sh = std::max(1, srcY(fy + 1) - sy0);
+        band.resize(static_cast<size_t>(sw) * sh * 4);
+        m_composite.readRegion(sx0, sy0, sw, sh, band.data(), static_cast<size_t>(sw) * 4);
+
+        uint8_t* out = m_frame.data() + (static_cast<size_t>(fy) * m_frameWidth + fx0) * 4;
+        for (int fx = fx0; fx < fx1; ++fx, out += 4) {
+            const int bx0 = srcX(fx) - sx0;
+            const int bx1 = std::max(bx0 + 1, srcX(fx + 1) - sx0);
+            uint32_t sum[4] = {0, 0, 0, 0};
+            for (int y = 0; y < sh; ++y) {
+                const uint8_t* p = band.data() + (static_cast<size_t>(y) * sw + bx0) * 4;
+                for (int x = bx0; x < bx1; ++x, p += 4) {
+                    sum[0] += p[0];
+                    sum[1] += p[1];
+                    sum[2] += p[2];
+                    sum[3] += p[3];
+                }
+            }
+            const uint32_t n = static_cast<uint32_t>((bx1 - bx0) * sh);
+            for (int c = 0; c < 4; ++c) out[c] = static_cast<uint8_t>((sum[c] + n / 2) / n);
+        }
+    }
+}
+
+} // namespace artflow
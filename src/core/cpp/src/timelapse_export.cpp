@@ -0,0 +1,641 @@
+/**
+ * ArtFlow Studio - Timelapse Export Implementation
+ */
+
+#include "timelapse_export.h"
+#include "background_worker.h"
+#include "blend_kernels.h"
+#include "thread_pool.h"
+#include "timelapse.h"
+#include "transform.h"
+#include "zip_archive.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <csignal>
+#include <pthread.h>
+#include <sys/wait.h>
+#endif
+
+namespace artflow {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr char kTimelapseDir[] = "timelapse/";
+constexpr size_t kJpegBatch = 16;   // JPEG frames read ahead of the encoder
+
+// ============================================================================
+// Sources
+// ============================================================================
+
+struct Container {
+    std::string path;
+    uint64_t offset = 0;
+    uint64_t size = UINT64_MAX;
+    int width = 0;
+    int height = 0;
+    size_t frames = 0;
+    Affine matrix;            // Frame -> video
+    bool identity = false;    // Frame already is the video frame
+};
+
+struct Sources {
+    std::vector<Container> containers;
+    std::string zipPath;              // JPEG frames are members of this archive
+    std::vector<std::string> jpegs;   // Member names, or file paths without an archive
+};
+
+bool hasSuffix(const std::string& name, const char* suffix) {
+    const size_t n = std::strlen(suffix);
+    if (name.size() < n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if (std::tolower(static_cast<unsigned char>(name[name.size() - n + i])) != suffix[i]) return false;
+    }
+    return true;
+}
+
+bool isJpegName(const std::string& name) { return hasSuffix(name, ".jpg") || hasSuffix(name, ".jpeg"); }
+
+bool addContainer(Sources& sources, const std::string& path, uint64_t offset, uint64_t size) {
+    TimelapseReader reader;
+    if (!reader.open(path, offset, size)) return false;
+    if (reader.frameCount() == 0) return true;   // Session without frames
+    Container container;
+    container.path = path;
+    container.offset = offset;
+    container.size = size;
+    container.width = reader.width();
+    container.height = reader.height();
+    container.frames = reader.frameCount();
+    sources.containers.push_back(std::move(container));
+    return true;
+}
+
+bool findSources(const std::string& source, Sources& sources, std::string& error) {
+    std::error_code ec;
+    if (fs::is_directory(source, ec)) {
+        // Project folder
+        std::vector<std::string> containers;
+        const fs::path dir = fs::path(source) / "timelapse";
+        if (fs::is_directory(dir, ec)) {
+            for (const auto& entry : fs::directory_iterator(dir, ec)) {
+                if (!entry.is_regular_file(ec)) continue;
+                const std::string path = entry.path().string();
+                if (hasSuffix(path, ".aftl")) containers.push_back(path);
+                else if (isJpegName(path)) sources.jpegs.push_back(path);
+            }
+        }
+        std::sort(containers.begin(), containers.end());
+        for (const std::string& path : containers) {
+            if (!addContainer(sources, path, 0, UINT64_MAX)) {
+                error = "Unreadable timelapse container: " + path;
+                return false;
+            }
+        }
+    } else if (ZipReader::isZipFile(source)) {
+        // Project archive; containers are read in place, so they must be stored
+        ZipReader zip;
+        if (!zip.open(source)) {
+            error = "Unreadable project archive: " + source;
+            return false;
+        }
+        std::vector<const ZipReader::Entry*> containers;
+        for (const ZipReader::Entry& entry : zip.entries()) {
+            if (entry.name.compare(0, std::strlen(kTimelapseDir), kTimelapseDir) != 0) continue;
+            if (hasSuffix(entry.name, ".aftl")) containers.push_back(&entry);
+            else if (isJpegName(entry.name)) sources.jpegs.push_back(entry.name);
+        }
+        std::sort(containers.begin(), containers.end(),
+                  [](const ZipReader::Entry* a, const ZipReader::Entry* b) { return a->name < b->name; });
+        for (const ZipReader::Entry* entry : containers) {
+            uint64_t offset = 0;
+            if (entry->method != ZipReader::kStored) {
+                error = "Timelapse container is compressed in the archive: " + entry->name;
+                return false;
+            }
+            if (!zip.dataOffset(*entry, &offset) || !addContainer(sources, source, offset, entry->size)) {
+                error = "Unreadable timelapse container: " + entry->name;
+                return false;
+            }
+        }
+        sources.zipPath = source;
+    } else if (fs::is_regular_file(source, ec)) {
+        // Bare container
+        if (!addContainer(sources, source, 0, UINT64_MAX)) {
+            error = "Not a project or timelapse file: " + source;
+            return false;
+        }
+    } else {
+        error = "Project not found: " + source;
+        return false;
+    }
+
+    std::sort(sources.jpegs.begin(), sources.jpegs.end());
+    if (!sources.containers.empty()) sources.jpegs.clear();   // Containers supersede legacy frames
+    if (sources.containers.empty() && sources.jpegs.empty()) {
+        error = "No frames found in project";
+        return false;
+    }
+    return true;
+}
+
+// Width and height of a baseline or progressive JPEG from its frame header
+bool jpegSize(const std::vector<uint8_t>& data, int* width, int* height) {
+    if (data.size() < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+    size_t pos = 2;
+    while (pos + 4 <= data.size()) {
+        if (data[pos] != 0xFF) return false;
+        const uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {   // Fill byte
+            ++pos;
+            continue;
+        }
+        const size_t length = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+        const bool frameHeader = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 &&
+                                 marker != 0xCC;
+        if (frameHeader) {
+            if (pos + 9 > data.size()) return false;
+            *height = (data[pos + 5] << 8) | data[pos + 6];
+            *width = (data[pos + 7] << 8) | data[pos + 8];
+            return *width > 0 && *height > 0;
+        }
+        pos += 2 + length;
+    }
+    return false;
+}
+
+bool readJpeg(ZipReader* zip, const std::string& name, std::vector<uint8_t>& out) {
+    if (zip) {
+        const ZipReader::Entry* entry = zip->find(name);
+        return entry && zip->read(*entry, out);
+    }
+    std::ifstream in(name, std::ios::binary | std::ios::ate);
+    if (!in) return false;
+    out.resize(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(out.size())));
+}
+
+// ============================================================================
+// Geometry and timing
+// ============================================================================
+
+// Video size for frames of `width` x `height`, as the Python exporter
+// sizes it: crop (or pad) to the aspect, cap the long side, round to even
+void videoSize(int width, int height, const TimelapseExportOptions& options, int* outW, int* outH) {
+    constexpr double kPortrait = 9.0 / 16.0;
+    double w = width, h = height;
+    switch (options.aspect) {
+    case TimelapseExportOptions::Aspect::Original:
+        break;
+    case TimelapseExportOptions::Aspect::Square:
+        w = h = options.letterbox ? std::max(w, h) : std::min(w, h);
+        break;
+    case TimelapseExportOptions::Aspect::Portrait:
+        if ((w / h > kPortrait) != options.letterbox) w = std::floor(h * kPortrait);
+        else h = std::floor(w / kPortrait);
+        break;
+    }
+    if (options.maxSize > 0 && std::max(w, h) > options.maxSize) {
+        const double scale = options.maxSize / std::max(w, h);
+        w = std::floor(w * scale);
+        h = std::floor(h * scale);
+    }
+    *outW = std::max(2, static_cast<int>(w) & ~1);
+    *outH = std::max(2, static_cast<int>(h) & ~1);
+}
+
+// Map from a frame into the video: centre crop filling it, or the whole
+// frame fitted inside it
+Affine frameToVideo(int width, int height, int videoW, int videoH, bool letterbox) {
+    if (letterbox) {
+        const double scale = std::min(static_cast<double>(videoW) / width, static_cast<double>(videoH) / height);
+        return Affine::scaling(scale, scale)
+            .then(Affine::translation((videoW - width * scale) * 0.5, (videoH - height * scale) * 0.5));
+    }
+    const double ratio = static_cast<double>(videoW) / videoH;
+    double cropW = width, cropH = height;
+    if (cropW / cropH > ratio) cropW = cropH * ratio;
+    else cropH = cropW / ratio;
+    return Affine::translation(-(width - cropW) * 0.5, -(height - cropH) * 0.5)
+        .then(Affine::scaling(videoW / cropW, videoH / cropH));
+}
+
+struct Timeline {
+    int fps = 30;
+    std::vector<size_t> frames;   // Source frame per video frame, before the hold
+    size_t hold = 0;              // Repeats of the last frame
+};
+
+Timeline timeline(size_t total, const TimelapseExportOptions& options) {
+    Timeline result;
+    double step = 1.0;
+    if (options.durationSec > 0.0) {
+        const double rate = total / options.durationSec;
+        if (rate <= 60.0) {
+            result.fps = std::max(10, static_cast<int>(rate));
+        } else {
+            result.fps = 60;
+            step = total / (options.durationSec * 60.0);
+        }
+    } else if (total < 30) {
+        result.fps = 10;
+    } else if (total < 100) {
+        result.fps = 15;
+    } else if (total < 300) {
+        result.fps = 24;
+    }
+    for (double at = 0.0; at < total; at += step) result.frames.push_back(static_cast<size_t>(at));
+    result.hold = static_cast<size_t>(std::max(0.0, result.fps * options.holdSec));
+    return result;
+}
+
+// ============================================================================
+// Encoder process
+// ============================================================================
+
+std::string quoteArg(const std::string& arg) {
+#ifdef _WIN32
+    return "\"" + arg + "\"";
+#else
+    std::string quoted = "'";
+    for (char c : arg) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+#endif
+}
+
+std::string colorHex(uint32_t rgba) {
+    char hex[16];
+    std::snprintf(hex, sizeof(hex), "0x%06X", rgba >> 8);
+    return hex;
+}
+
+/**
+ * EncoderPipe - Encoder child process fed through its stdin
+ *
+ * Writes block; write() and close() must come from one thread. On POSIX
+ * that thread ignores SIGPIPE, so an encoder that dies shows up as a
+ * failed write instead of killing the application.
+ */
+class EncoderPipe {
+public:
+    ~EncoderPipe() { close(); }
+
+    bool open(const std::string& command) {
+#ifdef _WIN32
+        // cmd.exe /c drops the outer quotes of a command that starts with one
+        m_pipe = popen(("\"" + command + "\"").c_str(), "wb");
+#else
+        m_pipe = popen(command.c_str(), "w");
+#endif
+        return m_pipe != nullptr;
+    }
+
+    bool write(const void* data, size_t bytes) {
+        if (!m_pipe || m_broken) return false;
+        if (!m_signalsBlocked) {
+#ifndef _WIN32
+            sigset_t set;
+            sigemptyset(&set);
+            sigaddset(&set, SIGPIPE);
+            pthread_sigmask(SIG_BLOCK, &set, nullptr);   // A pending SIGPIPE dies with the thread
+#endif
+            m_signalsBlocked = true;
+        }
+        m_broken = std::fwrite(data, 1, bytes, m_pipe) != bytes;
+        return !m_broken;
+    }
+
+    // Wait for the encoder; its exit code, or -1 if it could not be waited on
+    int close() {
+        if (!m_pipe) return -1;
+        const int status = pclose(m_pipe);
+        m_pipe = nullptr;
+#ifdef _WIN32
+        return status;
+#else
+        return status != -1 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#endif
+    }
+
+private:
+    FILE* m_pipe = nullptr;
+    bool m_broken = false;
+    bool m_signalsBlocked = false;
+};
+
+std::string encoderCommand(const TimelapseExportOptions& options, const std::string& input,
+                           const std::string& filter, const std::string& output) {
+    std::string command = quoteArg(options.encoder) + " -hide_banner -loglevel error -y " + input + " -i -";
+    if (!filter.empty()) command += " -vf " + quoteArg(filter);
+    command += " -c:v libx264 -preset medium -crf " + std::to_string(options.crf) +
+               " -pix_fmt yuv420p -movflags +faststart " + quoteArg(output);
+    return command;
+}
+
+bool finishEncoder(EncoderPipe& pipe, const TimelapseExportOptions& options, std::string& error) {
+    const int code = pipe.close();
+    if (code == 0) return true;
+    if (!error.empty()) return false;   // Already failed on our side
+    if (code == 127) {
+        error = "Video encoder not found (" + options.encoder + ")";   // Reported by the shell
+    } else {
+        error = "Video encoder failed (exit code " + std::to_string(code) + ")";
+    }
+    return false;
+}
+
+// ============================================================================
+// Container frames
+// ============================================================================
+
+/**
+ * Decodes and converts the frames of one range of a batch. Each slot has
+ * its own reader, and gets the same share of every batch, so its reader
+ * moves forward through the timelapse applying deltas.
+ */
+struct Slot {
+    TimelapseReader reader;
+    int container = -1;
+    std::vector<uint8_t> decoded;   // Frame, premultiplied RGBA
+    std::vector<uint8_t> scaled;    // Video size, premultiplied RGBA
+    std::vector<uint8_t> row;       // Background row to composite onto
+};
+
+// `pixels` (video size, premultiplied) over the background as RGB24
+void flatten(const uint8_t* pixels, int width, int height, uint32_t background, Slot& slot, uint8_t* out) {
+    const size_t rowBytes = static_cast<size_t>(width) * 4;
+    const uint8_t bg[4] = {static_cast<uint8_t>(background >> 24), static_cast<uint8_t>(background >> 16),
+                           static_cast<uint8_t>(background >> 8), 255};
+    const blend::RowKernel normal = blend::rowKernel(BlendMode::Normal);
+    slot.row.resize(rowBytes);
+    for (int y = 0; y < height; ++y) {
+        uint8_t* row = slot.row.data();
+        for (int x = 0; x < width; ++x) std::memcpy(row + x * 4, bg, 4);
+        normal(row, pixels + y * rowBytes, width, 1.0f);
+        uint8_t* dst = out + static_cast<size_t>(y) * width * 3;
+        for (int x = 0; x < width; ++x) {
+            dst[x * 3 + 0] = row[x * 4 + 0];
+            dst[x * 3 + 1] = row[x * 4 + 1];
+            dst[x * 3 + 2] = row[x * 4 + 2];
+        }
+    }
+}
+
+bool renderFrame(const std::vector<Container>& containers, size_t frame, int videoW, int videoH,
+                 uint32_t background, Slot& slot, uint8_t* out) {
+    int index = 0;
+    while (frame >= containers[index].frames) frame -= containers[index++].frames;
+    const Container& container = containers[index];
+
+    if (slot.container != index) {
+        if (!slot.reader.open(container.path, container.offset, container.size)) return false;
+        slot.container = index;
+        slot.decoded.resize(static_cast<size_t>(container.width) * container.height * 4);
+    }
+    const size_t stride = static_cast<size_t>(container.width) * 4;
+    if (!slot.reader.readFrame(frame, slot.decoded.data(), stride)) return false;
+
+    if (container.identity) {
+        flatten(slot.decoded.data(), videoW, videoH, background, slot, out);
+        return true;
+    }
+    TransformSource source(slot.decoded.data(), container.width, container.height, stride);
+    slot.scaled.assign(static_cast<size_t>(videoW) * videoH * 4, 0);
+    transformImage(source, container.matrix, slot.scaled.data(), videoW, videoH,
+                   static_cast<size_t>(videoW) * 4, Resampling::Bicubic);
+    flatten(slot.scaled.data(), videoW, videoH, background, slot, out);
+    return true;
+}
+
+bool exportContainers(std::vector<Container>& containers, const std::string& output,
+                      const TimelapseExportOptions& options, const TimelapseExportProgress& progress,
+                      std::string& error) {
+    const Container& last = containers.back();
+    int videoW = 0, videoH = 0;
+    videoSize(last.width, last.height, options, &videoW, &videoH);
+    size_t total = 0;
+    for (Container& container : containers) {
+        container.matrix = frameToVideo(container.width, container.height, videoW, videoH, options.letterbox);
+        container.identity = container.width == videoW && container.height == videoH &&
+                             container.matrix.m11 == 1.0 && container.matrix.m22 == 1.0 &&
+                             container.matrix.dx == 0.0 && container.matrix.dy == 0.0;
+        total += container.frames;
+    }
+    const Timeline plan = timeline(total, options);
+    const int framesTotal = static_cast<int>(plan.frames.size() + plan.hold);
+
+    const std::string input = "-f rawvideo -pix_fmt rgb24 -s " + std::to_string(videoW) + "x" +
+                              std::to_string(videoH) + " -framerate " + std::to_string(plan.fps);
+    EncoderPipe pipe;
+    if (!pipe.open(encoderCommand(options, input, std::string(), output))) {
+        error = "Could not start the video encoder (" + options.encoder + ")";
+        return false;
+    }
+
+    // Two batches: one being converted while the worker writes the other
+    ThreadPool& pool = ThreadPool::shared();
+    const size_t slotCount = pool.workerCount() + 1;
+    const size_t batchFrames = slotCount * 2;
+    const size_t frameBytes = static_cast<size_t>(videoW) * videoH * 3;
+    std::vector<Slot> slots(slotCount);
+    std::vector<uint8_t> batches[2] = {std::vector<uint8_t>(batchFrames * frameBytes),
+                                       std::vector<uint8_t>(batchFrames * frameBytes)};
+
+    std::atomic<bool> writeFailed{false};
+    std::atomic<int> written{0};
+    bool ok = true;
+    {
+        BackgroundWorker writer;   // Finishes its jobs before `pipe` and the batches go away
+        for (size_t first = 0, batch = 0; first < plan.frames.size() && ok; first += batchFrames, ++batch) {
+            const size_t count = std::min(batchFrames, plan.frames.size() - first);
+            uint8_t* frames = batches[batch % 2].data();
+
+            std::atomic<bool> decodeFailed{false};
+            pool.parallelFor(slotCount, [&](size_t s) {
+                const size_t begin = count * s / slotCount;
+                const size_t end = count * (s + 1) / slotCount;
+                for (size_t i = begin; i < end && !decodeFailed.load(std::memory_order_relaxed); ++i) {
+                    if (!renderFrame(containers, plan.frames[first + i], videoW, videoH, options.background,
+                                     slots[s], frames + i * frameBytes)) {
+                        decodeFailed.store(true);
+                    }
+                }
+            });
+            if (decodeFailed.load()) {
+                error = "Timelapse frame could not be decoded";
+                ok = false;
+                break;
+            }
+
+            writer.waitIdle();   // The other batch is free again
+            if (writeFailed.load()) {
+                ok = false;
+                break;
+            }
+            if (progress && !progress(written.load(), framesTotal)) {
+                error = "Export cancelled";
+                ok = false;
+                break;
+            }
+
+            const bool lastBatch = first + count == plan.frames.size();
+            writer.post([&, frames, count, lastBatch] {
+                for (size_t i = 0; i < count && !writeFailed.load(); ++i) {
+                    if (!pipe.write(frames + i * frameBytes, frameBytes)) writeFailed.store(true);
+                    else written.fetch_add(1);
+                }
+                // Hold the final frame
+                const uint8_t* lastFrame = frames + (count - 1) * frameBytes;
+                for (size_t i = 0; lastBatch && i < plan.hold && !writeFailed.load(); ++i) {
+                    if (!pipe.write(lastFrame, frameBytes)) writeFailed.store(true);
+                    else written.fetch_add(1);
+                }
+            });
+        }
+        writer.waitIdle();
+        if (ok && writeFailed.load()) ok = false;
+        writer.post([&] {
+            // Closed on the writing thread, where SIGPIPE is blocked
+            if (!finishEncoder(pipe, options, error)) ok = false;
+        });
+    }
+    if (ok && progress) progress(written.load(), framesTotal);
+    return ok;
+}
+
+// ============================================================================
+// JPEG frames
+// ============================================================================
+
+bool exportJpegs(const Sources& sources, const std::string& output, const TimelapseExportOptions& options,
+                 const TimelapseExportProgress& progress, std::string& error) {
+    ZipReader archive;
+    ZipReader* zip = nullptr;
+    if (!sources.zipPath.empty()) {
+        if (!archive.open(sources.zipPath)) {
+            error = "Unreadable project archive: " + sources.zipPath;
+            return false;
+        }
+        zip = &archive;
+    }
+
+    // Sized from the last frame, like the Python exporter
+    std::vector<uint8_t> lastFrame;
+    int frameW = 0, frameH = 0;
+    if (!readJpeg(zip, sources.jpegs.back(), lastFrame) || !jpegSize(lastFrame, &frameW, &frameH)) {
+        error = "Unreadable timelapse frame: " + sources.jpegs.back();
+        return false;
+    }
+    int videoW = 0, videoH = 0;
+    videoSize(frameW, frameH, options, &videoW, &videoH);
+    const Timeline plan = timeline(sources.jpegs.size(), options);
+    const int framesTotal = static_cast<int>(plan.frames.size() + plan.hold);
+
+    // The encoder decodes (threaded) and scales, so frames go in as stored
+    const std::string size = std::to_string(videoW) + ":" + std::to_string(videoH);
+    std::string filter;
+    if (options.letterbox) {
+        filter = "scale=" + size + ":force_original_aspect_ratio=decrease:force_divisible_by=2:flags=area," +
+                 "pad=" + size + ":(ow-iw)/2:(oh-ih)/2:color=" + colorHex(options.background);
+    } else {
+        filter = "scale=" + size + ":force_original_aspect_ratio=increase:flags=area,crop=" + size;
+    }
+    filter += ",setsar=1";
+    const std::string input = "-f image2pipe -framerate " + std::to_string(plan.fps) + " -c:v mjpeg -threads 0";
+
+    EncoderPipe pipe;
+    if (!pipe.open(encoderCommand(options, input, filter, output))) {
+        error = "Could not start the video encoder (" + options.encoder + ")";
+        return false;
+    }
+
+    std::vector<std::vector<uint8_t>> batches[2] = {std::vector<std::vector<uint8_t>>(kJpegBatch),
+                                                    std::vector<std::vector<uint8_t>>(kJpegBatch)};
+    std::atomic<bool> writeFailed{false};
+    std::atomic<int> written{0};
+    bool ok = true;
+    {
+        BackgroundWorker writer;
+        for (size_t first = 0, batch = 0; first < plan.frames.size() && ok; first += kJpegBatch, ++batch) {
+            const size_t count = std::min(kJpegBatch, plan.frames.size() - first);
+            std::vector<std::vector<uint8_t>>& frames = batches[batch % 2];
+            for (size_t i = 0; i < count; ++i) {
+                const std::string& name = sources.jpegs[plan.frames[first + i]];
+                if (!readJpeg(zip, name, frames[i])) {
+                    error = "Unreadable timelapse frame: " + name;
+                    ok = false;
+                    break;
+                }
+            }
+            if (!ok) break;
+
+            writer.waitIdle();
+            if (writeFailed.load()) {
+                ok = false;
+                break;
+            }
+            if (progress && !progress(written.load(), framesTotal)) {
+                error = "Export cancelled";
+                ok = false;
+                break;
+            }
+            writer.post([&, count, batch] {
+                for (size_t i = 0; i < count && !writeFailed.load(); ++i) {
+                    const std::vector<uint8_t>& data = batches[batch % 2][i];
+                    if (!pipe.write(data.data(), data.size())) writeFailed.store(true);
+                    else written.fetch_add(1);
+                }
+            });
+        }
+        writer.post([&] {
+            for (size_t i = 0; ok && i < plan.hold && !writeFailed.load(); ++i) {
+                if (!pipe.write(lastFrame.data(), lastFrame.size())) writeFailed.store(true);
+                else written.fetch_add(1);
+            }
+            if (writeFailed.load()) ok = false;
+            if (!finishEncoder(pipe, options, error)) ok = false;
+        });
+    }
+    if (ok && progress) progress(written.load(), framesTotal);
+    return ok;
+}
+
+} // anonymous namespace
+
+bool exportTimelapse(const std::string& source, const std::string& output, const TimelapseExportOptions& options,
+                     const TimelapseExportProgress& progress, std::string* error) {
+    std::string message;
+    Sources sources;
+    bool ok = findSources(source, sources, message);
+    if (ok) {
+        ok = sources.containers.empty() ? exportJpegs(sources, output, options, progress, message)
+                                        : exportContainers(sources.containers, output, options, progress, message);
+        if (!ok) {
+            std::error_code ec;
+            fs::remove(output, ec);
+        }
+    }
+    if (error) *error = ok ? std::string() : message;
+    return ok;
+}
+
+} // namespace artflow
@@ -0,0 +1,500 @@
+/**
+ * ArtFlow Studio - Transform Implementation
+ *
+ * Each target pixel center is mapped back into the source and filtered
+ * with a separable kernel (weights from a lookup table, normalized over
+ * the whole footprint so taps outside the source fade the edge). The tap
+ * loop accumulates all four channels at once: one __m128 per pixel with
+ * SSE4.1, plain floats otherwise.
+ */
+
+#include "transform.h"
+#include "color_utils.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE4_1__) || defined(__AVX__)
+#include <smmintrin.h>
+#define ARTFLOW_TRANSFORM_SSE41 1
+#endif
+
+namespace artflow {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int kTile = ImageBuffer::kTileSize;
+
+// ============================================================================
+// Kernels
+// ============================================================================
+
+constexpr int kLutResolution = 1024;   // Table entries per unit of distance
+constexpr int kMaxTaps = 16;           // Per axis; support 3 at filter scale 2 needs 13
+constexpr double kMaxFilterScale = 2.0;
+
+double kernelSupport(Resampling quality) {
+    switch (quality) {
+    case Resampling::Bilinear: return 1.0;
+    case Resampling::Bicubic: return 2.0;
+    case Resampling::Lanczos3: return 3.0;
+    }
+    return 1.0;
+}
+
+double evaluateKernel(Resampling quality, double t) {
+    t = std::fabs(t);
+    switch (quality) {
+    case Resampling::Bilinear:
+        return t < 1.0 ? 1.0 - t : 0.0;
+    case Resampling::Bicubic:   // Catmull-Rom (a = -0.5)
+        if (t < 1.0) return (1.5 * t - 2.5) * t * t + 1.0;
+        if (t < 2.0) return ((-0.5 * t + 2.5) * t - 4.0) * t + 2.0;
+        return 0.0;
+    case Resampling::Lanczos3:
+        if (t < 1e-8) return 1.0;
+        if (t >= 3.0) return 0.0;
+        return 3.0 * std::sin(kPi * t) * std::sin(kPi * t / 3.0) / (kPi * kPi * t * t);
+    }
+    return 0.0;
+}
+
+// Kernel sampled over [0, support], kLutResolution entries per unit
+class KernelTable {
+public:
+    explicit KernelTable(Resampling quality)
+        : m_support(kernelSupport(quality))
+        , m_values(static_cast<size_t>(m_support * kLutResolution) + 1) {
+        for (size_t i = 0; i < m_values.size(); ++i) {
+            m_values[i] = static_cast<float>(evaluateKernel(quality, static_cast<double>(i) / kLutResolution));
+        }
+    }
+
+    double support() const { return m_support; }
+
+    float operator()(double t) const {
+        const size_t i = static_cast<size_t>(std::fabs(t) * kLutResolution + 0.5);
+        return i < m_values.size() ? m_values[i] : 0.0f;
+    }
+
+private:
+    double m_support;
+    std::vector<float> m_values;
+};
+
+const KernelTable& kernelTable(Resampling quality) {
+    static const KernelTable bilinear(Resampling::Bilinear);
+    static const KernelTable bicubic(Resampling::Bicubic);
+    static const KernelTable lanczos(Resampling::Lanczos3);
+    switch (quality) {
+    case Resampling::Bicubic: return bicubic;
+    case Resampling::Lanczos3: return lanczos;
+    default: return bilinear;
+    }
+}
+
+// Taps of one axis: source indices [first, first + count) that lie inside
+// the level, with their normalized weights
+struct Taps {
+    int first = 0;
+    int count = 0;
+    float weights[kMaxTaps];
+};
+
+// Kernel of radius `radius` (filterScale * support) centered on `center`
+// over a level `size` pixels long
+inline void computeTaps(const KernelTable& kernel, double center, double filterScale, double radius,
+                        int size, Taps& taps) {
+    const int begin = static_cast<int>(std::ceil(center - radius));
+    const int end = std::min(begin + kMaxTaps, static_cast<int>(std::floor(center + radius)) + 1);
+    const double inv = 1.0 / filterScale;
+
+    float all[kMaxTaps];
+    float sum = 0.0f;
+    for (int i = begin; i < end; ++i) {
+        const float w = kernel((i - center) * inv);
+        all[i - begin] = w;
+        sum += w;
+    }
+    const float norm = sum != 0.0f ? 1.0f / sum : 0.0f;
+
+    const int first = std::max(begin, 0);
+    const int last = std::min(end, size);
+    taps.first = first;
+    taps.count = std::max(0, last - first);
+    for (int i = 0; i < taps.count; ++i) taps.weights[i] = all[first - begin + i] * norm;
+}
+
+// ============================================================================
+// Filtering
+// ============================================================================
+
+// Weighted sum of the taps, clamped to a valid premultiplied pixel
+inline void filterPixel(const TransformSource::Level& level, const Taps& tx, const Taps& ty, uint8_t* out) {
+    const size_t stride = static_cast<size_t>(level.width) * 4;
+    const uint8_t* base = level.pixels.data() + ty.first * stride + tx.first * 4;
+
+#if ARTFLOW_TRANSFORM_SSE41
+    __m128 acc = _mm_setzero_ps();
+    for (int j = 0; j < ty.count; ++j) {
+        const uint8_t* p = base + j * stride;
+        __m128 row = _mm_setzero_ps();
+        for (int i = 0; i < tx.count; ++i, p += 4) {
+            int32_t bits;
+            std::memcpy(&bits, p, 4);
+            const __m128 px = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(bits)));
+            row = _mm_add_ps(row, _mm_mul_ps(px, _mm_set1_ps(tx.weights[i])));
+        }
+        acc = _mm_add_ps(acc, _mm_mul_ps(row, _mm_set1_ps(ty.weights[j])));
+    }
+    // Overshoot (bicubic, Lanczos) is clamped: alpha to [0, 255], color to
+    // [0, alpha]
+    const __m128 alpha = _mm_min_ps(_mm_max_ps(_mm_shuffle_ps(acc, acc, _MM_SHUFFLE(3, 3, 3, 3)), _mm_setzero_ps()),
+                                    _mm_set1_ps(255.0f));
+    acc = _mm_min_ps(_mm_max_ps(acc, _mm_setzero_ps()), alpha);
+    __m128i i32 = _mm_cvtps_epi32(acc);
+    i32 = _mm_packus_epi32(i32, i32);
+    i32 = _mm_packus_epi16(i32, i32);
+    const int32_t bits = _mm_cvtsi128_si32(i32);
+    std::memcpy(out, &bits, 4);
+#else
+    float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int j = 0; j < ty.count; ++j) {
+        const uint8_t* p = base + j * stride;
+        float row[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < tx.count; ++i, p += 4) {
+            const float w = tx.weights[i];
+            for (int c = 0; c < 4; ++c) row[c] += p[c] * w;
+        }
+        const float w = ty.weights[j];
+        for (int c = 0; c < 4; ++c) acc[c] += row[c] * w;
+    }
+    const float alpha = std::clamp(acc[3], 0.0f, 255.0f);
+    for (int c = 0; c < 3; ++c) out[c] = static_cast<uint8_t>(std::clamp(acc[c], 0.0f, alpha) + 0.5f);
+    out[3] = static_cast<uint8_t>(alpha + 0.5f);
+#endif
+}
+
+// x range [*x0, *x1) where a + b * x lies in [lo, hi]
+inline void solveSpan(double a, double b, double lo, double hi, double* x0, double* x1) {
+    if (std::fabs(b) < 1e-12) {
+        if (a < lo || a > hi) *x1 = *x0;
+        return;
+    }
+    double p = (lo - a) / b;
+    double q = (hi - a) / b;
+    if (p > q) std::swap(p, q);
+    *x0 = std::max(*x0, p);
+    *x1 = std::min(*x1, q);
+}
+
+// Resample into any target; `store(y, x, count, pixels)` writes a row run
+template <typename Store>
+DirtyRect resample(const TransformSource& source, const Affine& matrix, int width, int height,
+                   Resampling quality, Store store) {
+    if (source.isEmpty() || !matrix.isInvertible()) return DirtyRect();
+    const Affine inv = matrix.inverted();
+    const KernelTable& kernel = kernelTable(quality);
+
+    // Source pixels per target pixel along each source axis; shrinking
+    // reads the level that brings this under 2
+    const double footprintX = std::hypot(inv.m11, inv.m21);
+    const double footprintY = std::hypot(inv.m12, inv.m22);
+    int levelIndex = 0;
+    for (double f = std::max(footprintX, footprintY); f >= 2.0 && levelIndex < source.maxLevel(); f *= 0.5) {
+        ++levelIndex;
+    }
+    const TransformSource::Level& level = source.level(levelIndex);
+    const double levelScale = static_cast<double>(1 << levelIndex);
+    const double filterX = std::clamp(footprintX / levelScale, 1.0, kMaxFilterScale);
+    const double filterY = std::clamp(footprintY / levelScale, 1.0, kMaxFilterScale);
+    const double radiusX = kernel.support() * filterX;
+    const double radiusY = kernel.support() * filterY;
+
+    // Target area: the source rect mapped, padded by the kernel reach
+    const DirtyRect& rect = source.rect();
+    const int pad = static_cast<int>(std::ceil(std::max(radiusX, radiusY) * levelScale)) + 1;
+    const DirtyRect area = matrix.mapRect(DirtyRect{rect.x - pad, rect.y - pad, rect.w + 2 * pad, rect.h + 2 * pad})
+                               .intersected(width, height);
+    if (area.isEmpty()) return DirtyRect();
+
+    // Level coordinates of a target pixel center:
+    //   cu = (u - rect.x) / levelScale - 0.5, with (u, v) = inv(x + 0.5, y + 0.5)
+    const double su = 1.0 / levelScale;
+    const double loU = (-radiusX - 1.0 + 0.5) * levelScale + rect.x;
+    const double hiU = (level.width + radiusX + 0.5) * levelScale + rect.x;
+    const double loV = (-radiusY - 1.0 + 0.5) * levelScale + rect.y;
+    const double hiV = (level.height + radiusY + 0.5) * levelScale + rect.y;
+
+    // Bands of whole tile rows, so tasks never share a tile
+    const int firstBand = area.y / kTile;
+    const int bandCount = (area.y + area.h - 1) / kTile - firstBand + 1;
+    ThreadPool::shared().parallelFor(static_cast<size_t>(bandCount), [&](size_t band) {
+        const int y0 = std::max(area.y, (firstBand + static_cast<int>(band)) * kTile);
+        const int y1 = std::min(area.y + area.h, (firstBand + static_cast<int>(band) + 1) * kTile);
+        std::vector<uint8_t> row(static_cast<size_t>(area.w) * 4);
+        Taps tapsX, tapsY;
+
+        for (int y = y0; y < y1; ++y) {
+            const double cy = y + 0.5;
+            // u(x) = uy + inv.m11 x, v(x) = vy + inv.m12 x
+            const double uy = inv.m21 * cy + inv.dx + 0.5 * inv.m11;
+            const double vy = inv.m22 * cy + inv.dy + 0.5 * inv.m12;
+            double fx0 = area.x;
+            double fx1 = area.x + area.w;
+            solveSpan(uy, inv.m11, loU, hiU, &fx0, &fx1);
+            solveSpan(vy, inv.m12, loV, hiV, &fx0, &fx1);
+            const int x0 = std::max(area.x, static_cast<int>(std::floor(fx0)));
+            const int x1 = std::min(area.x + area.w, static_cast<int>(std::ceil(fx1)) + 1);
+            if (x0 >= x1) continue;
+
+            uint8_t* out = row.data();
+            for (int x = x0; x < x1; ++x, out += 4) {
+                const double u = uy + inv.m11 * x;
+                const double v = vy + inv.m12 * x;
+                computeTaps(kernel, (u - rect.x) * su - 0.5, filterX, radiusX, level.width, tapsX);
+                computeTaps(kernel, (v - rect.y) * su - 0.5, filterY, radiusY, level.height, tapsY);
+                if (tapsX.count == 0 || tapsY.count == 0) {
+                    std::memset(out, 0, 4);
+                    continue;
+                }
+                filterPixel(level, tapsX, tapsY, out);
+            }
+            store(y, x0, x1 - x0, row.data());
+        }
+    });
+    return area;
+}
+
+} // anonymous namespace
+
+// ============================================================================
+// Affine
+// ============================================================================
+
+Affine Affine::rotation(double degrees) {
+    const double r = degrees * kPi / 180.0;
+    const double c = std::cos(r);
+    const double s = std::sin(r);
+    return {c, s, -s, c, 0.0, 0.0};
+}
+
+Affine Affine::then(const Affine& next) const {
+    Affine r;
+    r.m11 = m11 * next.m11 + m12 * next.m21;
+    r.m12 = m11 * next.m12 + m12 * next.m22;
+    r.m21 = m21 * next.m11 + m22 * next.m21;
+    r.m22 = m21 * next.m12 + m22 * next.m22;
+    r.dx = dx * next.m11 + dy * next.m21 + next.dx;
+    r.dy = dx * next.m12 + dy * next.m22 + next.dy;
+    return r;
+}
+
+bool Affine::isInvertible() const {
+    return std::fabs(determinant()) > 1e-12;
+}
+
+Affine Affine::inverted() const {
+    const double det = determinant();
+    if (std::fabs(det) <= 1e-12) return Affine();
+    const double inv = 1.0 / det;
+    Affine r;
+    r.m11 = m22 * inv;
+    r.m12 = -m12 * inv;
+    r.m21 = -m21 * inv;
+    r.m22 = m11 * inv;
+    r.dx = (m21 * dy - m22 * dx) * inv;
+    r.dy = (m12 * dx - m11 * dy) * inv;
+    return r;
+}
+
+DirtyRect Affine::mapRect(const DirtyRect& rect) const {
+    if (rect.isEmpty()) return DirtyRect();
+    const double xs[2] = {static_cast<double>(rect.x), static_cast<double>(rect.x + rect.w)};
+    const double ys[2] = {static_cast<double>(rect.y), static_cast<double>(rect.y + rect.h)};
+    double minX = 0, minY = 0, maxX = 0, maxY = 0;
+    for (int i = 0; i < 4; ++i) {
+        double x, y;
+        map(xs[i & 1], ys[i >> 1], &x, &y);
+        if (i == 0 || x < minX) minX = x;
+        if (i == 0 || x > maxX) maxX = x;
+        if (i == 0 || y < minY) minY = y;
+        if (i == 0 || y > maxY) maxY = y;
+    }
+    // Keep far-off corners from overflowing int
+    constexpr double kLimit = 1 << 28;
+    const int x0 = static_cast<int>(std::floor(std::clamp(minX, -kLimit, kLimit)));
+    const int y0 = static_cast<int>(std::floor(std::clamp(minY, -kLimit, kLimit)));
+    const int x1 = static_cast<int>(std::ceil(std::clamp(maxX, -kLimit, kLimit)));
+    const int y1 = static_cast<int>(std::ceil(std::clamp(maxY, -kLimit, kLimit)));
+    return DirtyRect{x0, y0, x1 - x0, y1 - y0};
+}
+
+// ============================================================================
+// TransformSource
+// ============================================================================
+
+TransformSource::TransformSource(const ImageBuffer& image, const DirtyRect& rect, const SelectionMask* selection)
+    : m_rect(rect.intersected(image.width(), image.height())) {
+    auto base = std::make_unique<Level>();
+    base->width = m_rect.w;
+    base->height = m_rect.h;
+    base->pixels.resize(static_cast<size_t>(m_rect.w) * m_rect.h * 4);
+    if (!m_rect.isEmpty()) {
+        image.readRegion(m_rect.x, m_rect.y, m_rect.w, m_rect.h, base->pixels.data(), static_cast<size_t>(m_rect.w) * 4);
+    }
+
+    if (selection && !m_rect.isEmpty()) {
+        for (int y = 0; y < m_rect.h; ++y) {
+            uint8_t* p = base->pixels.data() + static_cast<size_t>(y) * m_rect.w * 4;
+            int x = m_rect.x;
+            while (x < m_rect.x + m_rect.w) {
+                const int end = std::min(m_rect.x + m_rect.w, (x / kTile + 1) * kTile);
+                const uint8_t* sel = selection->rowData(x, m_rect.y + y);
+                for (; x < end; ++x, ++sel, p += 4) {
+                    if (*sel == 255) continue;
+                    for (int c = 0; c < 4; ++c) p[c] = static_cast<uint8_t>(color::div255(p[c] * static_cast<uint32_t>(*sel)));
+                }
+            }
+        }
+    }
+    m_levels.push_back(std::move(base));
+}
+
+TransformSource::TransformSource(const uint8_t* pixels, int width, int height, size_t stride)
+    : m_rect{0, 0, std::max(0, width), std::max(0, height)} {
+    auto base = std::make_unique<Level>();
+    base->width = m_rect.w;
+    base->height = m_rect.h;
+    base->pixels.resize(static_cast<size_t>(m_rect.w) * m_rect.h * 4);
+    for (int y = 0; y < m_rect.h; ++y) {
+        std::memcpy(base->pixels.data() + static_cast<size_t>(y) * m_rect.w * 4, pixels + y * stride,
+                    static_cast<size_t>(m_rect.w) * 4);
+    }
+    m_levels.push_back(std::move(base));
+}
+
+int TransformSource::maxLevel() const {
+    int levels = 0;
+    for (int w = m_rect.w, h = m_rect.h; w > 1 || h > 1; w = (w + 1) / 2, h = (h + 1) / 2) ++levels;
+    return levels;
+}
+
+const TransformSource::Level& TransformSource::level(int index) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    index = std::clamp(index, 0, maxLevel());
+    while (static_cast<int>(m_levels.size()) <= index) {
+        // 2x2 box average of the previous level; an odd last row/column
+        // averages the pixels it has
+        const Level& src = *m_levels.back();
+        auto dst = std::make_unique<Level>();
+        dst->width = (src.width + 1) / 2;
+        dst->height = (src.height + 1) / 2;
+        dst->pixels.resize(static_cast<size_t>(dst->width) * dst->height * 4);
+        const size_t srcStride = static_cast<size_t>(src.width) * 4;
+        for (int y = 0; y < dst->height; ++y) {
+            const int sy = y * 2;
+            const int rows = sy + 1 < src.height ? 2 : 1;
+            uint8_t* out = dst->pixels.data() + static_cast<size_t>(y) * dst->width * 4;
+            for (int x = 0; x < dst->width; ++x, out += 4) {
+                const int sx = x * 2;
+                const int cols = sx + 1 < src.width ? 2 : 1;
+                const uint8_t* p = src.pixels.data() + sy * srcStride + sx * 4;
+                const uint32_t n = static_cast<uint32_t>(rows * cols);
+                for (int c = 0; c < 4; ++c) {
+                    uint32_t sum = p[c];
+                    if (cols == 2) sum += p[4 + c];
+                    if (rows == 2) sum += p[srcStride + c] + (cols == 2 ? p[srcStride + 4 + c] : 0u);
+                    out[c] = static_cast<uint8_t>((sum + n / 2) / n);
+                }
+            }
+        }
+        m_levels.push_back(std::move(dst));
+    }
+    return *m_levels[index];
+}
+
+// ============================================================================
+// Entry points
+// ============================================================================
+
+DirtyRect transformImage(const TransformSource& source, const Affine& matrix, ImageBuffer& target,
+                         Resampling quality) {
+    const int width = target.width();
+    return resample(source, matrix, width, target.height(), quality,
+                    [&](int y, int x, int count, const uint8_t* pixels) {
+        if (!target.isTiled()) {
+            std::memcpy(target.data() + (static_cast<size_t>(y) * width + x) * 4, pixels, static_cast<size_t>(count) * 4);
+            return;
+        }
+        // Chunks per tile; all-transparent chunks leave empty tiles alone
+        const int end = x + count;
+        while (x < end) {
+            const int chunkEnd = std::min(end, (x / kTile + 1) * kTile);
+            const int tx = x / kTile;
+            const int ty = y / kTile;
+            bool visible = target.isTileAllocated(tx, ty);
+            for (int i = x; i < chunkEnd && !visible; ++i) visible = pixels[(i - x) * 4 + 3] != 0;
+            if (visible) {
+                std::memcpy(target.mutableTileData(tx, ty) + (y % kTile) * ImageBuffer::kTileStride + (x % kTile) * 4,
+                            pixels, static_cast<size_t>(chunkEnd - x) * 4);
+            }
+            pixels += (chunkEnd - x) * 4;
+            x = chunkEnd;
+        }
+    });
+}
+
+DirtyRect transformImage(const TransformSource& source, const Affine& matrix,
+                         uint8_t* pixels, int width, int height, size_t stride,
+                         Resampling quality) {
+    if (!pixels) return DirtyRect();
+    return resample(source, matrix, width, height, quality,
+                    [&](int y, int x, int count, const uint8_t* row) {
+        std::memcpy(pixels + y * stride + static_cast<size_t>(x) * 4, row, static_cast<size_t>(count) * 4);
+    });
+}
+
+void eraseRegion(ImageBuffer& image, const DirtyRect& rect, const SelectionMask* selection) {
+    const DirtyRect area = rect.intersected(image.width(), image.height());
+    if (area.isEmpty()) return;
+
+    // Fade [x, end) of row y by the selection (or clear it)
+    auto eraseRun = [&](uint8_t* p, int x, int end, int y) {
+        if (!selection) {
+            std::memset(p, 0, static_cast<size_t>(end - x) * 4);
+            return;
+        }
+        const uint8_t* sel = selection->rowData(x, y);
+        for (; x < end; ++x, ++sel, p += 4) {
+            const uint32_t keep = 255u - *sel;
+            for (int c = 0; c < 4; ++c) p[c] = static_cast<uint8_t>(color::div255(p[c] * keep));
+        }
+    };
+
+    for (int ty = area.y / kTile; ty <= (area.y + area.h - 1) / kTile; ++ty) {
+        for (int tx = area.x / kTile; tx <= (area.x + area.w - 1) / kTile; ++tx) {
+            if (image.isTiled() && !image.isTileAllocated(tx, ty)) continue;
+            if (selection && selection->isTileEmpty(tx, ty)) continue;
+            const DirtyRect tileRect = DirtyRect{tx * kTile, ty * kTile, kTile, kTile}.intersected(image.width(), image.height());
+            const DirtyRect part = tileRect.intersected(area);
+            const bool whole = part.w == tileRect.w && part.h == tileRect.h &&
+                               (!selection || selection->isTileFull(tx, ty));
+            if (whole && image.isTiled()) {
+                image.setTileHandle(tx, ty, nullptr);
+                continue;
+            }
+            for (int y = part.y; y < part.y + part.h; ++y) {
+                uint8_t* row = image.isTiled()
+                    ? image.mutableTileData(tx, ty) + (y - tileRect.y) * ImageBuffer::kTileStride + (part.x - tileRect.x) * 4
+                    : image.data() + (static_cast<size_t>(y) * image.width() + part.x) * 4;
+                eraseRun(row, part.x, part.x + part.w, y);
+            }
+        }
+    }
+}
+
+} // namespace artflow
@@ -0,0 +1,357 @@
+/**
+ * ArtFlow Studio - Undo Stack Implementation
+ */
+
+#include "undo_stack.h"
+#include "background_worker.h"
+#include "layer_manager.h"
+#include "rle_codec.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace artflow {
+
+namespace {
+
+constexpr size_t kTilePixels = static_cast<size_t>(ImageBuffer::kTileSize) * ImageBuffer::kTileSize;
+
+// One tile of a history step. Holds the pixels to install on the next
+// undo/redo of the step: either a raw tile handle (until the worker has
+// compressed it), RLE data, or nothing for an empty tile.
+struct TileRecord {
+    int index = 0;
+    ImageBuffer::TileHandle raw;
+    std::shared_ptr<const std::vector<uint8_t>> packed;
+    bool empty = false;
+
+    size_t bytes() const {
+        if (raw) return ImageBuffer::kTileBytes;
+        return packed ? packed->size() : 0;
+    }
+};
+
+} // anonymous namespace
+
+struct UndoStack::Entry {
+    int layerId = -1;
+    size_t logPosition = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    std::vector<TileRecord> tiles;
+    size_t bytes = 0;
+
+    void updateBytes() {
+        bytes = 0;
+        for (const auto& tile : tiles) bytes += tile.bytes();
+    }
+};
+
+struct UndoStack::Patch {
+    std::shared_ptr<Entry> entry;
+    std::vector<ImageBuffer::TileHandle> tiles;  // Parallel to entry->tiles
+    unsigned generation = 0;
+};
+
+UndoStack::UndoStack(size_t memoryLimit)
+    : m_memoryLimit(memoryLimit)
+    , m_worker(std::make_unique<BackgroundWorker>())
+{
+}
+
+UndoStack::~UndoStack() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_generation;  // Pending patches are no longer delivered
+    }
+    m_worker.reset();
+}
+
+void UndoStack::setMemoryLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memoryLimit = bytes;
+    enforceLimitLocked();
+}
+
+size_t UndoStack::memoryLimit() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryLimit;
+}
+
+size_t UndoStack::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return usageLocked();
+}
+
+// ============================================================================
+// Stroke recording
+// ============================================================================
+
+void UndoStack::beginStroke(int layerId, const ImageBuffer& buffer, size_t logPosition) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        cancelStepLocked();
+    }
+    m_recording = true;
+    m_strokeLayerId = layerId;
+    m_strokeLogPosition = logPosition;
+    m_strokeBase = buffer.tileSnapshot();
+}
+
+void UndoStack::endStroke(const ImageBuffer& buffer) {
+    if (!m_recording) return;
+    m_recording = false;
+
+    ImageBuffer::TileSnapshot base = std::move(m_strokeBase);
+    m_strokeBase = ImageBuffer::TileSnapshot();
+    if (!buffer.isTiled()) return;
+
+    int tilesX = buffer.tileCountX();
+    int tilesY = buffer.tileCountY();
+    if (base.tiles.size() != static_cast<size_t>(tilesX) * tilesY) return;
+
+    // Tiles the stroke wrote were detached from the saved handles. A row
+    // pending at the start has no handles: if it is still pending nothing
+    // touched it, else its tiles are compared with the loader's.
+    auto entry = std::make_shared<Entry>();
+    entry->layerId = m_strokeLayerId;
+    entry->logPosition = m_strokeLogPosition;
+    entry->tilesX = tilesX;
+    entry->tilesY = tilesY;
+    std::vector<ImageBuffer::TileHandle> loaded(static_cast<size_t>(tilesX));
+    for (int ty = 0; ty < tilesY; ++ty) {
+        const bool pending = base.isRowPending(ty);
+        if (pending) {
+            if (buffer.isTileRowPending(ty)) continue;
+            std::fill(loaded.begin(), loaded.end(), nullptr);
+            base.loadRow(ty, loaded.data());
+        }
+        for (int tx = 0; tx < tilesX; ++tx) {
+            const int i = ty * tilesX + tx;
+            ImageBuffer::TileHandle& before = pending ? loaded[tx] : base.tiles[i];
+            const ImageBuffer::TileHandle current = buffer.tileHandle(tx, ty);
+            if (pending ? ImageBuffer::samePixels(current, before) : current == before) continue;
+
+            TileRecord record;
+            record.index = i;
+            record.empty = (before == nullptr);
+            record.raw = std::move(before);
+            entry->tiles.push_back(std::move(record));
+        }
+    }
+    if (entry->tiles.empty()) return;
+    entry->updateBytes();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_redoStack.clear();
+        m_undoStack.push_back(entry);
+        enforceLimitLocked();
+    }
+    compress(entry);
+}
+
+void UndoStack::cancelStroke() {
+    m_recording = false;
+    m_strokeBase = ImageBuffer::TileSnapshot();
+}
+
+// ============================================================================
+// Undo / Redo
+// ============================================================================
+
+bool UndoStack::undo(PatchCallback ready) {
+    return requestStep(true, std::move(ready));
+}
+
+bool UndoStack::redo(PatchCallback ready) {
+    return requestStep(false, std::move(ready));
+}
+
+bool UndoStack::requestStep(bool isUndo, PatchCallback ready) {
+    auto patch = std::make_shared<Patch>();
+    std::vector<TileRecord> sources;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto& from = isUndo ? m_undoStack : m_redoStack;
+        auto& to = isUndo ? m_redoStack : m_undoStack;
+        if (m_inFlight || from.empty()) return false;
+
+        patch->entry = std::move(from.back());
+        from.pop_back();
+        to.push_back(patch->entry);
+        patch->generation = m_generation;
+        sources = patch->entry->tiles;  // Handles only, pixels stay shared
+        m_inFlight = true;
+        m_inFlightUndo = isUndo;
+        m_inFlightEntry = patch->entry;
+    }
+
+    m_worker->post([this, patch, sources = std::move(sources), ready = std::move(ready)]() {
+        patch->tiles.reserve(sources.size());
+        for (const auto& source : sources) {
+            if (source.empty) {
+                patch->tiles.emplace_back();
+            } else if (source.raw) {
+                patch->tiles.push_back(source.raw);
+            } else {
+                auto tile = std::make_shared<ImageBuffer::Tile>();
+                if (!source.packed || !rle::decodePixels(source.packed->data(), source.packed->size(),
+                                                         tile->data(), kTilePixels)) {
+                    tile->fill(0);
+                }
+                patch->tiles.push_back(std::move(tile));
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (patch->generation != m_generation) return;
+        }
+        ready(patch);
+    });
+    return true;
+}
+
+int UndoStack::apply(const std::shared_ptr<Patch>& patch, LayerManager& layers) {
+    if (!patch || !patch->entry) return -1;
+
+    Entry& entry = *patch->entry;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (patch->generation != m_generation) return -1;
+        m_inFlight = false;
+        m_inFlightEntry.reset();
+
+        Layer* layer = layers.findLayerById(entry.layerId);
+        if (!layer) return -1;
+        ImageBuffer& buffer = *layer->buffer;
+        if (buffer.tileCountX() != entry.tilesX || buffer.tileCountY() != entry.tilesY) return -1;
+
+        // Swap: the layer gets the patch, the entry keeps the current tiles
+        // for the opposite direction
+        for (size_t i = 0; i < entry.tiles.size(); ++i) {
+            TileRecord& record = entry.tiles[i];
+            int tx = record.index % entry.tilesX;
+            int ty = record.index / entry.tilesX;
+
+            ImageBuffer::TileHandle current = buffer.tileHandle(tx, ty);
+            buffer.setTileHandle(tx, ty, patch->tiles[i]);
+
+            record.empty = (current == nullptr);
+            record.raw = std::move(current);
+            record.packed.reset();
+        }
+        entry.updateBytes();
+        enforceLimitLocked();
+    }
+
+    compress(patch->entry);
+    return entry.layerId;
+}
+
+// A step requested but not applied yet goes back to the stack it came from
+void UndoStack::cancelStepLocked() {
+    if (!m_inFlight) return;
+    ++m_generation;
+    m_inFlight = false;
+    auto& from = m_inFlightUndo ? m_undoStack : m_redoStack;
+    auto& to = m_inFlightUndo ? m_redoStack : m_undoStack;
+    auto it = std::find(to.begin(), to.end(), m_inFlightEntry);
+    if (it != to.end()) {
+        to.erase(it);
+        from.push_back(std::move(m_inFlightEntry));
+    }
+    m_inFlightEntry.reset();
+}
+
+bool UndoStack::canUndo() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_undoStack.empty();
+}
+
+bool UndoStack::canRedo() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_redoStack.empty();
+}
+
+size_t UndoStack::redoLogPosition() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The next redo is the earliest undone step
+    return m_redoStack.empty() ? SIZE_MAX : m_redoStack.back()->logPosition;
+}
+
+bool UndoStack::isBusy() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_inFlight;
+}
+
+void UndoStack::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_undoStack.clear();
+    m_redoStack.clear();
+    m_inFlight = false;
+    m_inFlightEntry.reset();
+    ++m_generation;
+    m_recording = false;
+    m_strokeBase = ImageBuffer::TileSnapshot();
+}
+
+void UndoStack::waitIdle() {
+    m_worker->waitIdle();
+}
+
+// ============================================================================
+// Compression and memory limit
+// ============================================================================
+
+void UndoStack::compress(const std::shared_ptr<Entry>& entry) {
+    m_worker->post([this, entry]() {
+        std::vector<std::pair<size_t, ImageBuffer::TileHandle>> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (size_t i = 0; i < entry->tiles.size(); ++i) {
+                if (entry->tiles[i].raw) pending.emplace_back(i, entry->tiles[i].raw);
+            }
+        }
+        if (pending.empty()) return;
+
+        std::vector<std::shared_ptr<const std::vector<uint8_t>>> packed;
+        packed.reserve(pending.size());
+        for (const auto& item : pending) {
+            packed.push_back(std::make_shared<const std::vector<uint8_t>>(
+                rle::encodePixels(item.second->data(), kTilePixels)));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < pending.size(); ++i) {
+            TileRecord& record = entry->tiles[pending[i].first];
+            if (record.raw != pending[i].second) continue;  // Swapped by apply() meanwhile
+            record.packed = std::move(packed[i]);
+            record.raw.reset();
+        }
+        entry->updateBytes();
+        enforceLimitLocked();
+    });
+}
+
+size_t UndoStack::usageLocked() const {
+    size_t bytes = 0;
+    for (const auto& entry : m_undoStack) bytes += entry->bytes;
+    for (const auto& entry : m_redoStack) bytes += entry->bytes;
+    return bytes;
+}
+
+void UndoStack::enforceLimitLocked() {
+    // The most recent step is always kept, even if it alone exceeds the limit
+    size_t usage = usageLocked();
+    size_t drop = 0;
+    while (usage > m_memoryLimit && drop + 1 < m_undoStack.size()) {
+        usage -= m_undoStack[drop]->bytes;
+        ++drop;
+    }
+    if (drop > 0) {
+        m_undoStack.erase(m_undoStack.begin(), m_undoStack.begin() + drop);
+    }
+}
+
+} // namespace artflow
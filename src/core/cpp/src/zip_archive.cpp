@@ -0,0 +1,477 @@
+/**
+ * ArtFlow Studio - Zip Archive Implementation
+ */
+
+#include "zip_archive.h"
+#include <algorithm>
+#include <ctime>
+#include <zlib.h>
+
+namespace artflow {
+
+namespace {
+
+constexpr uint32_t kLocalHeaderSig = 0x04034b50;
+constexpr uint32_t kCentralHeaderSig = 0x02014b50;
+constexpr uint32_t kEndSig = 0x06054b50;
+constexpr uint32_t kEnd64Sig = 0x06064b50;
+constexpr uint32_t kEnd64LocatorSig = 0x07064b50;
+constexpr uint16_t kZip64ExtraId = 0x0001;
+
+constexpr size_t kLocalHeaderBytes = 30;
+constexpr size_t kCentralHeaderBytes = 46;
+constexpr size_t kEndBytes = 22;
+constexpr size_t kEnd64Bytes = 56;
+constexpr size_t kEnd64LocatorBytes = 20;
+constexpr size_t kMaxComment = 0xFFFF;
+
+constexpr uint32_t kSaturated32 = 0xFFFFFFFFu;   // "See the zip64 record"
+constexpr uint16_t kSaturated16 = 0xFFFF;
+constexpr uint16_t kVersion = 20;                // 2.0: deflate
+constexpr uint16_t kVersionZip64 = 45;
+constexpr uint16_t kFlagUtf8 = 0x0800;
+constexpr size_t kCopyChunk = 1 << 20;
+constexpr size_t kInflateChunk = 1 << 20;        // Output allocated ahead of inflate(), at least
+
+uint64_t getFixed(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    return value;
+}
+
+void putFixed(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+bool needsZip64(const ZipReader::Entry& entry) {
+    return entry.size >= kSaturated32 || entry.compressedSize >= kSaturated32;
+}
+
+} // anonymous namespace
+
+bool ZipReader::isZipFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    uint8_t sig[4];
+    if (!in.read(reinterpret_cast<char*>(sig), 4)) return false;
+    const uint32_t value = static_cast<uint32_t>(getFixed(sig, 4));
+    return value == kLocalHeaderSig || value == kEndSig;   // The latter: empty archive
+}
+
+bool ZipReader::open(const std::string& path) {
+    close();
+    m_file.open(path, std::ios::binary);
+    if (!m_file) return false;
+    m_file.seekg(0, std::ios::end);
+    const std::streamoff size = m_file.tellg();
+    if (size < static_cast<std::streamoff>(kEndBytes) || !readDirectory(static_cast<uint64_t>(size))) {
+        close();
+        return false;
+    }
+    m_path = path;
+    return true;
+}
+
+void ZipReader::close() {
+    if (m_file.is_open()) m_file.close();
+    m_file.clear();
+    m_path.clear();
+    m_entries.clear();
+    m_index.clear();
+    m_dataEnd = 0;
+}
+
+const ZipReader::Entry* ZipReader::find(const std::string& name) const {
+    auto it = m_index.find(name);
+    return it != m_index.end() ? &m_entries[it->second] : nullptr;
+}
+
+bool ZipReader::readAt(uint64_t offset, void* out, size_t bytes) {
+    m_file.clear();
+    m_file.seekg(static_cast<std::streamoff>(offset));
+    return static_cast<bool>(m_file.read(static_cast<char*>(out), static_cast<std::streamsize>(bytes)));
+}
+
+bool ZipReader::readDirectory(uint64_t fileSize) {
+    // The end record sits in the last 22 bytes plus an optional comment
+    const size_t tailBytes = static_cast<size_t>(std::min<uint64_t>(fileSize, kEndBytes + kMaxComment));
+    std::vector<uint8_t> tail(tailBytes);
+    const uint64_t tailStart = fileSize - tailBytes;
+    if (!readAt(tailStart, tail.data(), tailBytes)) return false;
+
+    size_t end = SIZE_MAX;
+    for (size_t i = tailBytes - kEndBytes + 1; i-- > 0;) {
+        if (getFixed(&tail[i], 4) == kEndSig) {
+            end = i;
+            break;
+        }
+    }
+    if (end == SIZE_MAX) return false;
+
+    uint64_t count = getFixed(&tail[end + 10], 2);
+    uint64_t directorySize = getFixed(&tail[end + 12], 4);
+    uint64_t directoryOffset = getFixed(&tail[end + 16], 4);
+
+    // Zip64: the real values are in a second end record found via a locator
+    if (end >= kEnd64LocatorBytes && getFixed(&tail[end - kEnd64LocatorBytes], 4) == kEnd64LocatorSig) {
+        const uint64_t end64Offset = getFixed(&tail[end - kEnd64LocatorBytes + 8], 8);
+        uint8_t end64[kEnd64Bytes];
+        if (!readAt(end64Offset, end64, kEnd64Bytes) || getFixed(end64, 4) != kEnd64Sig) return false;
+        count = getFixed(end64 + 32, 8);
+        directorySize = getFixed(end64 + 40, 8);
+        directoryOffset = getFixed(end64 + 48, 8);
+    }
+    if (directoryOffset > fileSize || directorySize > fileSize - directoryOffset) return false;
+    m_dataEnd = directoryOffset;
+
+    std::vector<uint8_t> directory(static_cast<size_t>(directorySize));
+    if (directorySize > 0 && !readAt(directoryOffset, directory.data(), directory.size())) return false;
+
+    m_entries.reserve(static_cast<size_t>(std::min<uint64_t>(count, directory.size() / kCentralHeaderBytes)));
+    size_t pos = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (pos + kCentralHeaderBytes > directory.size()) return false;
+        const uint8_t* h = &directory[pos];
+        if (getFixed(h, 4) != kCentralHeaderSig) return false;
+        const size_t nameBytes = static_cast<size_t>(getFixed(h + 28, 2));
+        const size_t extraBytes = static_cast<size_t>(getFixed(h + 30, 2));
+        const size_t commentBytes = static_cast<size_t>(getFixed(h + 32, 2));
+        if (pos + kCentralHeaderBytes + nameBytes + extraBytes + commentBytes > directory.size()) return false;
+
+        Entry entry;
+        entry.flags = static_cast<uint16_t>(getFixed(h + 8, 2));
+        entry.method = static_cast<uint16_t>(getFixed(h + 10, 2));
+        entry.crc = static_cast<uint32_t>(getFixed(h + 16, 4));
+        entry.compressedSize = getFixed(h + 20, 4);
+        entry.size = getFixed(h + 24, 4);
+        entry.headerOffset = getFixed(h + 42, 4);
+        entry.name.assign(reinterpret_cast<const char*>(h + kCentralHeaderBytes), nameBytes);
+        std::replace(entry.name.begin(), entry.name.end(), '\\', '/');
+
+        // Zip64 extra field: 8-byte values for the fields saturated above,
+        // in this order
+        const uint8_t* extra = h + kCentralHeaderBytes + nameBytes;
+        for (size_t e = 0; e + 4 <= extraBytes;) {
+            const uint16_t id = static_cast<uint16_t>(getFixed(extra + e, 2));
+            const size_t bytes = static_cast<size_t>(getFixed(extra + e + 2, 2));
+            if (e + 4 + bytes > extraBytes) break;
+            if (id == kZip64ExtraId) {
+                const uint8_t* field = extra + e + 4;
+                size_t used = 0;
+                for (uint64_t* value : {&entry.size, &entry.compressedSize, &entry.headerOffset}) {
+                    if (*value != 0xFFFFFFFFu) continue;
+                    if (used + 8 > bytes) break;
+                    *value = getFixed(field + used, 8);
+                    used += 8;
+                }
+            }
+            e += 4 + bytes;
+        }
+
+        // Member data lies between its local header and the directory;
+        // sizes that point past it are corrupt (or forged)
+        if (entry.headerOffset > directoryOffset ||
+            entry.compressedSize > directoryOffset - entry.headerOffset ||
+            directoryOffset - entry.headerOffset - entry.compressedSize < kLocalHeaderBytes + nameBytes) {
+            return false;
+        }
+        if (entry.method == kStored && entry.size != entry.compressedSize) return false;
+
+        m_index.emplace(entry.name, m_entries.size());
+        m_entries.push_back(std::move(entry));
+        pos += kCentralHeaderBytes + nameBytes + extraBytes + commentBytes;
+    }
+    return true;
+}
+
+bool ZipReader::dataOffset(const Entry& entry, uint64_t* offset) {
+    // The local header repeats name and extra with lengths of its own
+    uint8_t header[kLocalHeaderBytes];
+    if (!readAt(entry.headerOffset, header, kLocalHeaderBytes) || getFixed(header, 4) != kLocalHeaderSig) {
+        return false;
+    }
+    *offset = entry.headerOffset + kLocalHeaderBytes + getFixed(header + 26, 2) + getFixed(header + 28, 2);
+    return *offset <= m_dataEnd && entry.compressedSize <= m_dataEnd - *offset;
+}
+
+bool ZipReader::read(const Entry& entry, std::vector<uint8_t>& out) {
+    if (entry.flags & 1) return false;   // Encrypted
+    if (entry.method != kStored && entry.method != kDeflated) return false;
+    if (entry.size > SIZE_MAX || entry.compressedSize > SIZE_MAX) return false;
+
+    uint64_t offset = 0;
+    if (!dataOffset(entry, &offset)) return false;
+
+    if (entry.method == kStored) {
+        // Sizes are checked against the file by readDirectory() and dataOffset()
+        out.resize(static_cast<size_t>(entry.size));
+        if (entry.size > 0 && !readAt(offset, out.data(), out.size())) return false;
+    } else {
+        m_compressed.resize(static_cast<size_t>(entry.compressedSize));
+        if (entry.compressedSize > 0 && !readAt(offset, m_compressed.data(), m_compressed.size())) return false;
+
+        // Raw deflate (no zlib header). The declared size is only a limit:
+        // `out` grows with what actually inflates, so a forged size cannot
+        // make it allocate ahead of the data. avail_* are 32-bit, so feed
+        // and grow in chunks.
+        const size_t size = static_cast<size_t>(entry.size);
+        z_stream stream{};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) return false;
+        out.clear();
+        stream.next_in = m_compressed.data();
+        size_t inLeft = m_compressed.size();
+        int status = Z_OK;
+        while (status == Z_OK) {
+            if (stream.avail_in == 0) {
+                stream.avail_in = static_cast<uInt>(std::min<size_t>(inLeft, UINT32_MAX));
+                inLeft -= stream.avail_in;
+            }
+            if (stream.avail_out == 0 && out.size() < size) {
+                const size_t used = out.size();
+                const size_t grow = std::min<size_t>({size - used, std::max(used, kInflateChunk), UINT32_MAX});
+                out.resize(used + grow);
+                stream.next_out = out.data() + used;
+                stream.avail_out = static_cast<uInt>(grow);
+            }
+            status = inflate(&stream, Z_NO_FLUSH);
+            if (status == Z_BUF_ERROR &&
+                ((stream.avail_in == 0 && inLeft > 0) || (stream.avail_out == 0 && out.size() < size))) {
+                status = Z_OK;
+            }
+        }
+        const bool complete = status == Z_STREAM_END && stream.total_out == entry.size;
+        inflateEnd(&stream);
+        if (!complete) return false;
+    }
+
+    // crc32() takes 32-bit lengths too
+    uLong crc = crc32(0L, Z_NULL, 0);
+    for (size_t done = 0; done < out.size();) {
+        const uInt chunk = static_cast<uInt>(std::min<size_t>(out.size() - done, UINT32_MAX));
+        crc = crc32(crc, out.data() + done, chunk);
+        done += chunk;
+    }
+    return static_cast<uint32_t>(crc) == entry.crc;
+}
+
+// ============================================================================
+// ZipWriter
+// ============================================================================
+
+ZipWriter::~ZipWriter() {
+    if (isOpen()) close();
+}
+
+bool ZipWriter::open(const std::string& path) {
+    if (isOpen()) close();
+    m_file.open(path, std::ios::binary | std::ios::trunc);
+    m_offset = 0;
+    m_ok = static_cast<bool>(m_file);
+    m_entries.clear();
+
+    // Every member gets the time the archive was started (DOS format)
+    const std::time_t now = std::time(nullptr);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    m_dosTime = static_cast<uint16_t>((local.tm_hour << 11) | (local.tm_min << 5) | (local.tm_sec / 2));
+    m_dosDate = static_cast<uint16_t>((std::max(local.tm_year - 80, 0) << 9) | ((local.tm_mon + 1) << 5) | local.tm_mday);
+    return m_ok;
+}
+
+bool ZipWriter::write(const void* data, size_t bytes) {
+    if (!m_ok) return false;
+    m_ok = static_cast<bool>(m_file.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes)));
+    m_offset += bytes;
+    return m_ok;
+}
+
+bool ZipWriter::writeLocalHeader(const ZipReader::Entry& entry) {
+    const bool zip64 = needsZip64(entry);
+    std::vector<uint8_t> header;
+    header.reserve(kLocalHeaderBytes + entry.name.size() + 20);
+    putFixed(header, kLocalHeaderSig, 4);
+    putFixed(header, zip64 ? kVersionZip64 : kVersion, 2);
+    putFixed(header, entry.flags, 2);
+    putFixed(header, entry.method, 2);
+    putFixed(header, m_dosTime, 2);
+    putFixed(header, m_dosDate, 2);
+    putFixed(header, entry.crc, 4);
+    putFixed(header, zip64 ? kSaturated32 : entry.compressedSize, 4);
+    putFixed(header, zip64 ? kSaturated32 : entry.size, 4);
+    putFixed(header, entry.name.size(), 2);
+    putFixed(header, zip64 ? 20 : 0, 2);
+    header.insert(header.end(), entry.name.begin(), entry.name.end());
+    if (zip64) {
+        putFixed(header, kZip64ExtraId, 2);
+        putFixed(header, 16, 2);
+        putFixed(header, entry.size, 8);
+        putFixed(header, entry.compressedSize, 8);
+    }
+    return write(header.data(), header.size());
+}
+
+bool ZipWriter::add(const std::string& name, const void* data, size_t size, bool compress) {
+    if (!isOpen() || !m_ok || name.size() > kSaturated16) return false;
+
+    ZipReader::Entry entry;
+    entry.name = name;
+    entry.flags = kFlagUtf8;
+    entry.size = size;
+    entry.headerOffset = m_offset;
+
+    const Bytef* bytes = static_cast<const Bytef*>(data);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    for (size_t done = 0; done < size;) {
+        const uInt chunk = static_cast<uInt>(std::min<size_t>(size - done, UINT32_MAX));
+        crc = crc32(crc, bytes + done, chunk);
+        done += chunk;
+    }
+    entry.crc = static_cast<uint32_t>(crc);
+
+    // Deflated members are small (metadata); anything zlib cannot take in
+    // one call is stored instead
+    std::vector<uint8_t> deflated;
+    if (compress && size > 0 && size < UINT32_MAX) {
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK) {
+            deflated.resize(deflateBound(&stream, static_cast<uLong>(size)));
+            stream.next_in = const_cast<Bytef*>(bytes);
+            stream.avail_in = static_cast<uInt>(size);
+            stream.next_out = deflated.data();
+            stream.avail_out = static_cast<uInt>(deflated.size());
+            if (deflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out < size) {
+                deflated.resize(stream.total_out);
+                entry.method = ZipReader::kDeflated;
+            }
+            deflateEnd(&stream);
+        }
+    }
+    const bool deflate = entry.method == ZipReader::kDeflated;
+    entry.compressedSize = deflate ? deflated.size() : size;
+
+    if (!writeLocalHeader(entry)) return false;
+    if (!write(deflate ? deflated.data() : data, static_cast<size_t>(entry.compressedSize))) return false;
+    m_entries.push_back(std::move(entry));
+    return true;
+}
+
+bool ZipWriter::addFile(const std::string& name, const std::string& path) {
+    if (!isOpen() || !m_ok || name.size() > kSaturated16) return false;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    in.seekg(0, std::ios::end);
+    const uint64_t size = static_cast<uint64_t>(in.tellg());
+    in.seekg(0);
+
+    ZipReader::Entry entry;
+    entry.name = name;
+    entry.flags = kFlagUtf8;
+    entry.size = size;
+    entry.compressedSize = size;
+    entry.headerOffset = m_offset;
+    if (!writeLocalHeader(entry)) return false;
+
+    // The CRC is known once the data is through; patch it into the header
+    std::vector<char> chunk(static_cast<size_t>(std::min<uint64_t>(size, kCopyChunk)));
+    uLong crc = crc32(0L, Z_NULL, 0);
+    for (uint64_t done = 0; done < size;) {
+        const size_t bytes = static_cast<size_t>(std::min<uint64_t>(size - done, chunk.size()));
+        if (!in.read(chunk.data(), static_cast<std::streamsize>(bytes))) {
+            m_ok = false;
+            return false;
+        }
+        crc = crc32(crc, reinterpret_cast<const Bytef*>(chunk.data()), static_cast<uInt>(bytes));
+        if (!write(chunk.data(), bytes)) return false;
+        done += bytes;
+    }
+    entry.crc = static_cast<uint32_t>(crc);
+
+    std::vector<uint8_t> field;
+    putFixed(field, entry.crc, 4);
+    m_file.seekp(static_cast<std::streamoff>(entry.headerOffset + 14));
+    m_file.write(reinterpret_cast<const char*>(field.data()), 4);
+    m_file.seekp(static_cast<std::streamoff>(m_offset));
+    m_ok = static_cast<bool>(m_file);
+    if (!m_ok) return false;
+
+    m_entries.push_back(std::move(entry));
+    return true;
+}
+
+bool ZipWriter::close() {
+    if (!isOpen()) return false;
+
+    std::vector<uint8_t> directory;
+    for (const ZipReader::Entry& entry : m_entries) {
+        // Saturated fields move to the zip64 extra, in this order
+        std::vector<uint8_t> extra;
+        for (uint64_t value : {entry.size, entry.compressedSize, entry.headerOffset}) {
+            if (value >= kSaturated32) putFixed(extra, value, 8);
+        }
+        const bool zip64 = !extra.empty();
+
+        putFixed(directory, kCentralHeaderSig, 4);
+        putFixed(directory, kVersionZip64, 2);
+        putFixed(directory, zip64 ? kVersionZip64 : kVersion, 2);
+        putFixed(directory, entry.flags, 2);
+        putFixed(directory, entry.method, 2);
+        putFixed(directory, m_dosTime, 2);
+        putFixed(directory, m_dosDate, 2);
+        putFixed(directory, entry.crc, 4);
+        putFixed(directory, std::min<uint64_t>(entry.compressedSize, kSaturated32), 4);
+        putFixed(directory, std::min<uint64_t>(entry.size, kSaturated32), 4);
+        putFixed(directory, entry.name.size(), 2);
+        putFixed(directory, zip64 ? extra.size() + 4 : 0, 2);
+        putFixed(directory, 0, 2);   // Comment
+        putFixed(directory, 0, 2);   // Disk
+        putFixed(directory, 0, 2);   // Internal attributes
+        putFixed(directory, 0, 4);   // External attributes
+        putFixed(directory, std::min<uint64_t>(entry.headerOffset, kSaturated32), 4);
+        directory.insert(directory.end(), entry.name.begin(), entry.name.end());
+        if (zip64) {
+            putFixed(directory, kZip64ExtraId, 2);
+            putFixed(directory, extra.size(), 2);
+            directory.insert(directory.end(), extra.begin(), extra.end());
+        }
+    }
+
+    const uint64_t directoryOffset = m_offset;
+    const uint64_t directorySize = directory.size();
+    const uint64_t count = m_entries.size();
+    if (count >= kSaturated16 || directoryOffset >= kSaturated32 || directorySize >= kSaturated32) {
+        const uint64_t end64Offset = directoryOffset + directorySize;
+        putFixed(directory, kEnd64Sig, 4);
+        putFixed(directory, kEnd64Bytes - 12, 8);   // Size of the rest of the record
+        putFixed(directory, kVersionZip64, 2);
+        putFixed(directory, kVersionZip64, 2);
+        putFixed(directory, 0, 4);
+        putFixed(directory, 0, 4);
+        putFixed(directory, count, 8);
+        putFixed(directory, count, 8);
+        putFixed(directory, directorySize, 8);
+        putFixed(directory, directoryOffset, 8);
+
+        putFixed(directory, kEnd64LocatorSig, 4);
+        putFixed(directory, 0, 4);
+        putFixed(directory, end64Offset, 8);
+        putFixed(directory, 1, 4);   // Disks
+    }
+    putFixed(directory, kEndSig, 4);
+    putFixed(directory, 0, 2);
+    putFixed(directory, 0, 2);
+    putFixed(directory, std::min<uint64_t>(count, kSaturated16), 2);
+    putFixed(directory, std::min<uint64_t>(count, kSaturated16), 2);
+    putFixed(directory, std::min<uint64_t>(directorySize, kSaturated32), 4);
+    putFixed(directory, std::min<uint64_t>(directoryOffset, kSaturated32), 4);
+    putFixed(directory, 0, 2);   // Comment
+
+    write(directory.data(), directory.size());
+    m_file.close();
+    m_entries.clear();
+    return m_ok && !m_file.fail();
+}
+
+} // namespace artflow
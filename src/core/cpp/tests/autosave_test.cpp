@@ -0,0 +1,196 @@
+/**
+ * ArtFlow Studio - Autosave Tests
+ * Journal replay after a simulated crash
+ */
+
+#include "autosave.h"
+#include "layer_manager.h"
+#include "project_file.h"
+#include "test_support.h"
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+using namespace artflow;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string g_path;
+
+bool sameStack(const LayerManager& a, const LayerManager& b) {
+    if (a.getLayerCount() != b.getLayerCount()) return false;
+    for (int i = 0; i < a.getLayerCount(); ++i) {
+        if (a.getLayer(i)->name != b.getLayer(i)->name) return false;
+        if (a.getLayer(i)->opacity != b.getLayer(i)->opacity) return false;
+        if (!test::samePixels(*a.getLayer(i)->buffer, *b.getLayer(i)->buffer)) return false;
+    }
+    return true;
+}
+
+// The saved project, with its journal replayed if `replay`
+std::unique_ptr<LayerManager> open(bool replay, bool* replayed = nullptr,
+                                   std::vector<AutosaveLayerState>* recovered = nullptr) {
+    ProjectReader reader;
+    std::string error;
+    if (!reader.open(g_path, &error)) return nullptr;
+    ProjectInfo info = reader.info();
+    auto buffers = reader.loadLayers(&error);
+    if (replay) {
+        const bool ok = replayAutosave(g_path, info, buffers, recovered, &error);
+        if (replayed) *replayed = ok;
+    }
+    return buildLayerStack(info, std::move(buffers));
+}
+
+std::string savedStamp() {
+    ProjectReader reader;
+    reader.open(g_path);
+    return reader.info().created;
+}
+
+void saveInitial() {
+    LayerManager layers(300, 200);
+    layers.addLayer("A");
+    layers.addLayer("B");
+    layers.getLayer(1)->buffer->fill(10, 20, 30, 255);
+    auto snapshot = snapshotProject(layers);
+    snapshot.info.created = "2026-01-01T00:00:00.000";
+    std::string error;
+    CHECK(saveProject(g_path, snapshot, {}, &error));
+}
+
+void testRecovery() {
+    auto live = open(false);
+    CHECK(live != nullptr);
+    if (!live) return;
+    {
+        AutosaveJournal journal;
+        journal.start(g_path, savedStamp(), *live);
+        live->getLayer(1)->buffer->setPixel(5, 5, 255, 0, 0, 255);
+        journal.checkpoint(*live);
+        const int added = live->addLayer("C");
+        live->getLayer(added)->buffer->setPixel(150, 100, 0, 255, 0, 255);
+        live->getLayer(added)->opacity = 0.5f;
+        journal.checkpoint(*live);
+        live->moveLayer(added, 0);
+        live->getLayer(2)->buffer->setPixel(299, 199, 1, 2, 3, 4);
+        journal.checkpoint(*live);
+        journal.flush();
+    }   // Crash: the journal stays
+    CHECK(fs::exists(autosaveJournalPath(g_path)));
+
+    bool replayed = false;
+    std::vector<AutosaveLayerState> recovered;
+    auto back = open(true, &replayed, &recovered);
+    CHECK(replayed && back && sameStack(*back, *live));
+    CHECK(recovered.size() == static_cast<size_t>(live->getLayerCount()));
+
+    // Journaling again from the recovered state keeps the recovered changes
+    { AutosaveJournal journal; journal.start(g_path, savedStamp(), *back, recovered); }
+    auto again = open(true, &replayed);
+    CHECK(replayed && again && sameStack(*again, *live));
+}
+
+void testCompactionAndTornTail() {
+    bool replayed = false;
+    std::vector<AutosaveLayerState> recovered;
+    auto live = open(true, &replayed, &recovered);
+    CHECK(live != nullptr);
+    if (!live) return;
+    {
+        AutosaveJournal journal;
+        journal.start(g_path, savedStamp(), *live, recovered);
+        std::mt19937 rng(1);
+        ImageBuffer& buffer = *live->getLayer(1)->buffer;
+        for (int k = 0; k < 50; ++k) {
+            for (int y = 0; y < 200; ++y) {
+                for (int x = 0; x < 300; ++x) {
+                    buffer.setPixel(x, y, static_cast<uint8_t>(rng()), static_cast<uint8_t>(rng()),
+                                    static_cast<uint8_t>(rng()), 255);
+                }
+            }
+            journal.checkpoint(*live);
+        }
+        journal.flush();
+        const auto before = fs::file_size(autosaveJournalPath(g_path));
+        journal.checkpoint(*live);   // Idle: superseded tiles are dropped
+        journal.flush();
+        CHECK(fs::file_size(autosaveJournalPath(g_path)) < before);
+
+        live->getLayer(0)->buffer->setPixel(1, 1, 9, 9, 9, 9);
+        journal.checkpoint(*live);
+        journal.flush();
+    }
+    // A record cut short by the crash is ignored
+    if (FILE* file = std::fopen(autosaveJournalPath(g_path).c_str(), "ab")) {
+        std::fwrite("\x02\0\0\0\xff\0\0\0garbage", 1, 15, file);
+        std::fclose(file);
+    }
+    auto back = open(true, &replayed);
+    CHECK(replayed && back && sameStack(*back, *live));
+}
+
+void testDiscardAndMismatch() {
+    auto live = open(true);
+    CHECK(live != nullptr);
+    if (!live) return;
+    {
+        AutosaveJournal journal;
+        journal.start(g_path, savedStamp(), *live);
+        journal.stop(true);   // Saved: the journal goes
+        journal.flush();
+    }
+    CHECK(!fs::exists(autosaveJournalPath(g_path)));
+
+    // A journal written against another save is refused
+    {
+        AutosaveJournal journal;
+        journal.start(g_path, "another save", *live);
+        live->getLayer(1)->buffer->setPixel(7, 7, 7, 7, 7, 255);
+        journal.checkpoint(*live);
+    }
+    bool replayed = true;
+    auto back = open(true, &replayed);
+    CHECK(!replayed && back && back->getLayer(1)->buffer->pixelAt(7, 7)[0] != 7);
+}
+
+// Rows loaded after the journal started are compared with the saved
+// pixels: loading alone journals nothing
+void testLoadedRows() {
+    auto live = open(false);
+    CHECK(live != nullptr && live->getLayer(1)->buffer->hasPendingTiles());
+    if (!live) return;
+    {
+        AutosaveJournal journal;
+        journal.start(g_path, savedStamp(), *live);
+        for (int i = 0; i < live->getLayerCount(); ++i) live->getLayer(i)->buffer->loadPendingTiles();
+        live->getLayer(1)->buffer->setPixel(70, 70, 255, 0, 0, 255);   // Tile (1, 1)
+        journal.checkpoint(*live);
+        journal.flush();
+    }
+    bool replayed = false;
+    std::vector<AutosaveLayerState> recovered;
+    auto back = open(true, &replayed, &recovered);
+    CHECK(replayed && back && sameStack(*back, *live));
+    CHECK(recovered.size() == 3);
+    if (recovered.size() == 3) {
+        CHECK(recovered[0].changedTiles.empty() && recovered[2].changedTiles.empty());
+        CHECK(recovered[1].changedTiles == std::vector<uint32_t>{6});
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    const std::string dir = test::scratchDirectory("autosave");
+    g_path = dir + "/project.aflow";
+    saveInitial();
+    testRecovery();
+    testCompactionAndTornTail();
+    testDiscardAndMismatch();
+    testLoadedRows();
+    fs::remove_all(dir);
+    return test::result();
+}
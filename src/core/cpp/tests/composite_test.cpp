@@ -0,0 +1,134 @@
+/**
+ * ArtFlow Studio - Compositing Tests
+ * The parallel tile-major composite against layer-by-layer compositing
+ */
+
+#include "layer_manager.h"
+#include "test_support.h"
+#include <cmath>
+#include <memory>
+
+using namespace artflow;
+
+namespace {
+
+// Not a multiple of the tile size, so edge tiles are partial
+constexpr int kWidth = 300;
+constexpr int kHeight = 200;
+
+void paintStack(LayerManager& layers) {
+    const BlendMode modes[] = {BlendMode::Normal, BlendMode::Multiply, BlendMode::Screen,
+                               BlendMode::Overlay, BlendMode::SoftLight, BlendMode::Difference};
+    layers.getLayer(0)->buffer->fill(250, 250, 240, 255);
+    for (int l = 0; l < 6; ++l) {
+        Layer* layer = layers.getLayer(layers.addLayer("Layer"));
+        layer->blendMode = modes[l];
+        layer->opacity = (l % 3) ? 0.7f : 1.0f;
+        for (int i = 0; i < 20; ++i) {
+            layer->buffer->drawCircle(20.0f + l * 40 + i * 6, 40.0f + l * 20 + 25 * std::sin(i * 0.3f), 12.0f + l * 2,
+                                      static_cast<uint8_t>(40 * l), static_cast<uint8_t>(255 - 30 * l), 100, 200, 0.5f);
+        }
+        // Allocated but transparent again: must not change the result
+        layer->buffer->drawCircle(280, 180, 15, 0, 0, 0, 255, 1.0f, 0.0f, false, true);
+    }
+    layers.getLayer(3)->visible = false;
+}
+
+// The stack one layer at a time through ImageBuffer::composite()
+std::unique_ptr<ImageBuffer> serialComposite(const LayerManager& layers) {
+    auto out = std::make_unique<ImageBuffer>(kWidth, kHeight);
+    for (int i = 0; i < layers.getLayerCount(); ++i) {
+        const Layer* layer = layers.getLayer(i);
+        if (layer->visible) out->composite(*layer->buffer, 0, 0, layer->opacity, layer->blendMode);
+    }
+    return out;
+}
+
+void testMatchesSerial() {
+    LayerManager layers(kWidth, kHeight);
+    paintStack(layers);
+    const auto expected = serialComposite(layers);
+
+    ImageBuffer linear(kWidth, kHeight);
+    layers.compositeAll(linear);
+    CHECK(test::samePixels(linear, *expected));
+
+    ImageBuffer tiled(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    layers.compositeAll(tiled);
+    CHECK(test::samePixels(tiled, *expected));
+
+    // Without the opaque background most tiles are sparse or empty
+    layers.getLayer(0)->visible = false;
+    layers.compositeAll(tiled);
+    CHECK(test::samePixels(tiled, *serialComposite(layers)));
+    CHECK(!tiled.isTileAllocated(0, tiled.tileCountY() - 1));
+}
+
+void testRepeatable() {
+    LayerManager layers(kWidth, kHeight);
+    paintStack(layers);
+    ImageBuffer first(kWidth, kHeight);
+    ImageBuffer second(kWidth, kHeight);
+    layers.compositeAll(first);
+    for (int run = 0; run < 5; ++run) {
+        layers.compositeAll(second);
+        CHECK(test::samePixels(first, second));
+    }
+}
+
+void testEmptyStack() {
+    LayerManager layers(kWidth, kHeight);
+    layers.getLayer(0)->visible = false;
+    ImageBuffer out(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    out.fill(1, 2, 3, 255);
+    layers.compositeAll(out);
+    CHECK(out.memoryUsage() == 0);
+}
+
+// A duplicated layer shares its tiles until painted: each layer's figure
+// counts them, the total counts them once
+void testSharedTileMemory() {
+    LayerManager layers(kWidth, kHeight);
+    layers.getLayer(0)->buffer->fill(250, 250, 240, 255);
+    const size_t single = layers.getMemoryUsage();
+    CHECK(single > 0);
+
+    layers.duplicateLayer(0);
+    CHECK(layers.getLayerCount() == 2);
+    CHECK(layers.getLayerMemoryUsage(0) == single);
+    CHECK(layers.getLayerMemoryUsage(1) == single);
+    CHECK(layers.getMemoryUsage() == single);
+
+    layers.getLayer(1)->buffer->drawCircle(10.0f, 10.0f, 4.0f, 200, 20, 20, 255, 1.0f);   // Tile (0, 0) only
+    CHECK(layers.getMemoryUsage() == single + ImageBuffer::kTileBytes);
+}
+
+// Sampling reads tiles in place: nothing is allocated or detached
+void testSampleColorReadOnly() {
+    LayerManager layers(kWidth, kHeight);
+    layers.getLayer(0)->buffer->drawCircle(30.0f, 30.0f, 10.0f, 200, 20, 20, 255, 1.0f);
+    layers.duplicateLayer(0);
+    layers.addLayer("Empty");
+    const size_t before = layers.getMemoryUsage();
+
+    uint8_t r, g, b, a;
+    for (int mode = 0; mode < 2; ++mode) {
+        for (int y = 0; y < kHeight; y += 37) {
+            for (int x = 0; x < kWidth; x += 41) layers.sampleColor(x, y, &r, &g, &b, &a, mode);
+        }
+    }
+    layers.sampleColor(30, 30, &r, &g, &b, &a, 0);
+    CHECK(r == 200 && g == 20 && b == 20 && a == 255);
+    CHECK(layers.getMemoryUsage() == before);
+}
+
+} // anonymous namespace
+
+int main() {
+    testMatchesSerial();
+    testRepeatable();
+    testEmptyStack();
+    testSharedTileMemory();
+    testSampleColorReadOnly();
+    return test::result();
+}
@@ -0,0 +1,159 @@
+/**
+ * ArtFlow Studio - Flood Fill Tests
+ */
+
+#include "flood_fill.h"
+#include "layer_manager.h"
+#include "test_support.h"
+#include <vector>
+
+using namespace artflow;
+
+namespace {
+
+int countColor(const ImageBuffer& image, uint8_t r, uint8_t g, uint8_t b) {
+    int count = 0;
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            const uint8_t* p = image.pixelAt(x, y);
+            if (p[0] == r && p[1] == g && p[2] == b && p[3] == 255) ++count;
+        }
+    }
+    return count;
+}
+
+// One-pixel black outline of [x0, x1] x [y0, y1]
+void drawBox(ImageBuffer& image, int x0, int y0, int x1, int y1) {
+    for (int x = x0; x <= x1; ++x) {
+        image.setPixel(x, y0, 0, 0, 0);
+        image.setPixel(x, y1, 0, 0, 0);
+    }
+    for (int y = y0; y <= y1; ++y) {
+        image.setPixel(x0, y, 0, 0, 0);
+        image.setPixel(x1, y, 0, 0, 0);
+    }
+}
+
+void testInsideOutline() {
+    for (auto storage : {ImageBuffer::Storage::Linear, ImageBuffer::Storage::Tiled}) {
+        // The box crosses tile seams on both axes
+        ImageBuffer image(300, 200, storage);
+        drawBox(image, 50, 50, 150, 150);
+        const DirtyRect filled = floodFill(image, 100, 100, 255, 0, 0, 255);
+        CHECK(countColor(image, 255, 0, 0) == 99 * 99);
+        CHECK(filled.x == 51 && filled.y == 51 && filled.w == 99 && filled.h == 99);
+        CHECK(countColor(image, 0, 0, 0) == 4 * 100);   // Outline untouched
+    }
+}
+
+void testWholeImageAndEdges() {
+    ImageBuffer image(130, 70, ImageBuffer::Storage::Tiled);
+    const DirtyRect filled = floodFill(image, 129, 69, 0, 200, 0, 255);   // Seed in the last pixel
+    CHECK(countColor(image, 0, 200, 0) == 130 * 70);
+    CHECK(filled.x == 0 && filled.y == 0 && filled.w == 130 && filled.h == 70);
+
+    // Seeds outside the image fill nothing
+    ImageBuffer other(40, 40);
+    CHECK(floodFill(other, -1, 5, 255, 0, 0, 255).isEmpty());
+    CHECK(floodFill(other, 5, 40, 255, 0, 0, 255).isEmpty());
+    CHECK(countColor(other, 255, 0, 0) == 0);
+}
+
+void testExpandAndContract() {
+    ImageBuffer grown(300, 200);
+    drawBox(grown, 50, 50, 150, 150);
+    FillOptions options;
+    options.expand = 2;
+    floodFill(grown, 100, 100, 255, 0, 0, 255, options);
+    // Grows over the 1 px outline, not beyond the 2 px reach
+    CHECK(countColor(grown, 255, 0, 0) > 99 * 99);
+    CHECK(grown.pixelAt(50, 100)[0] == 255);
+    CHECK(grown.pixelAt(47, 100)[3] == 0);
+
+    // Shrinking a fill that covers the whole image leaves it whole: the
+    // image border is not a region edge
+    ImageBuffer full(300, 200);
+    options.expand = -3;
+    floodFill(full, 10, 10, 255, 0, 0, 255, options);
+    CHECK(countColor(full, 255, 0, 0) == 300 * 200);
+}
+
+void testSelection() {
+    std::vector<uint8_t> selection(300 * 200, 0);
+    for (int y = 0; y < 100; ++y) {
+        for (int x = 0; x < 100; ++x) selection[y * 300 + x] = 255;
+    }
+    FillOptions options;
+    options.selection = selection.data();
+    options.selectionStride = 300;
+
+    ImageBuffer image(300, 200);
+    floodFill(image, 5, 5, 255, 0, 0, 255, options);
+    CHECK(countColor(image, 255, 0, 0) == 100 * 100);
+
+    // A seed outside the selection fills nothing
+    ImageBuffer outside(300, 200);
+    CHECK(floodFill(outside, 200, 150, 255, 0, 0, 255, options).isEmpty());
+    CHECK(countColor(outside, 255, 0, 0) == 0);
+
+    // A SelectionMask takes precedence over the byte selection
+    SelectionMask mask(300, 200);
+    mask.selectRect(0, 0, 50, 20);
+    options.selectionMask = &mask;
+    ImageBuffer masked(300, 200, ImageBuffer::Storage::Tiled);
+    floodFill(masked, 5, 5, 255, 0, 0, 255, options);
+    CHECK(countColor(masked, 255, 0, 0) == 50 * 20);
+}
+
+void testTolerance() {
+    ImageBuffer gradient(256, 10);
+    for (int y = 0; y < 10; ++y) {
+        for (int x = 0; x < 256; ++x) {
+            const uint8_t v = static_cast<uint8_t>(x);
+            gradient.setPixel(x, y, v, v, v);
+        }
+    }
+    FillOptions options;
+    options.tolerance = 20;
+    floodFill(gradient, 0, 0, 255, 0, 0, 255, options);
+    CHECK(countColor(gradient, 255, 0, 0) == 21 * 10);
+}
+
+void testRawPixels() {
+    // Caller memory in BGRA order, with row padding
+    const int width = 70;
+    const int height = 40;
+    const size_t stride = width * 4 + 16;
+    std::vector<uint8_t> pixels(stride * height, 0);
+    for (int y = 0; y < height; ++y) pixels[y * stride + 35 * 4 + 3] = 255;   // Opaque column
+    const uint8_t color[4] = {10, 20, 30, 255};
+    const DirtyRect filled = floodFill(pixels.data(), width, height, stride, 0, 0, color);
+    CHECK(filled.x == 0 && filled.w == 35 && filled.h == height);
+    CHECK(pixels[5 * stride + 34 * 4] == 10 && pixels[5 * stride + 36 * 4 + 3] == 0);
+    CHECK(pixels[5 * stride + width * 4] == 0);   // Padding untouched
+}
+
+void testSampleAllLayers() {
+    // The outline is on another layer; the fill lands on the target layer
+    LayerManager layers(200, 200);
+    layers.getLayer(0)->visible = false;
+    const int ink = layers.addLayer("Ink");
+    const int paint = layers.addLayer("Paint");
+    drawBox(*layers.getLayer(ink)->buffer, 20, 20, 120, 120);
+    layers.floodFill(paint, 60, 60, 0, 0, 255, 255, FillOptions(), true);
+    CHECK(countColor(*layers.getLayer(paint)->buffer, 0, 0, 255) == 99 * 99);
+    CHECK(countColor(*layers.getLayer(ink)->buffer, 0, 0, 255) == 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    testInsideOutline();
+    testWholeImageAndEdges();
+    testExpandAndContract();
+    testSelection();
+    testTolerance();
+    testRawPixels();
+    testSampleAllLayers();
+    return test::result();
+}
@@ -0,0 +1,149 @@
+/**
+ * ArtFlow Studio - Lazy Tile Tests
+ * Undo history and timelapse frames of layers with rows still pending
+ */
+
+#include "layer_manager.h"
+#include "test_support.h"
+#include "timelapse.h"
+#include "undo_stack.h"
+#include <atomic>
+#include <future>
+#include <vector>
+
+using namespace artflow;
+
+namespace {
+
+constexpr int kWidth = 256;
+constexpr int kHeight = 256;
+constexpr int kTilesX = kWidth / ImageBuffer::kTileSize;
+constexpr int kTilesY = kHeight / ImageBuffer::kTileSize;
+
+// Opaque tiles, a shade per tile; counts the rows it makes
+class ShadeLoader : public ImageBuffer::TileLoader {
+public:
+    std::atomic<int> loads{0};
+
+    bool loadTileRow(int ty, ImageBuffer::TileHandle* tiles) override {
+        ++loads;
+        for (int tx = 0; tx < kTilesX; ++tx) {
+            auto tile = std::make_shared<ImageBuffer::Tile>();
+            for (size_t i = 0; i < tile->size(); i += 4) {
+                (*tile)[i] = static_cast<uint8_t>(60 * ty);
+                (*tile)[i + 1] = static_cast<uint8_t>(60 * tx);
+                (*tile)[i + 2] = 90;
+                (*tile)[i + 3] = 255;
+            }
+            tiles[tx] = std::move(tile);
+        }
+        return true;
+    }
+};
+
+int pendingRows(const ImageBuffer& buffer) {
+    int rows = 0;
+    for (int ty = 0; ty < buffer.tileCountY(); ++ty) rows += buffer.isTileRowPending(ty);
+    return rows;
+}
+
+std::unique_ptr<ImageBuffer> loadedCopy() {
+    auto buffer = std::make_unique<ImageBuffer>(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    buffer->setTileLoader(std::make_shared<ShadeLoader>());
+    buffer->loadPendingTiles();
+    return buffer;
+}
+
+void step(UndoStack& history, LayerManager& layers, bool undo) {
+    std::promise<std::shared_ptr<UndoStack::Patch>> ready;
+    auto patch = ready.get_future();
+    auto deliver = [&ready](std::shared_ptr<UndoStack::Patch> p) { ready.set_value(std::move(p)); };
+    const bool requested = undo ? history.undo(deliver) : history.redo(deliver);
+    CHECK(requested);
+    if (requested) CHECK(history.apply(patch.get(), layers) >= 0);
+}
+
+// A stroke leaves the rows it does not reach pending, and undoing it
+// restores the rows it loaded
+void testUndoStroke() {
+    LayerManager layers(kWidth, kHeight);
+    Layer& layer = *layers.getLayer(0);
+    ImageBuffer& buffer = *layer.buffer;
+    auto loader = std::make_shared<ShadeLoader>();
+    buffer.setTileLoader(loader);
+
+    UndoStack history;
+    history.beginStroke(layer.id, buffer);
+    CHECK(loader->loads == 0);
+    buffer.drawCircle(100.0f, 96.0f, 12.0f, 250, 20, 20, 255, 1.0f);   // Tile row 1 only
+    buffer.tileData(0, 2);                                              // Row 2 read, not written
+    history.endStroke(buffer);
+    CHECK(loader->loads == 4);   // Rows 1 and 2, then again for the before-images
+    CHECK(pendingRows(buffer) == kTilesY - 2);
+    CHECK(history.canUndo());
+
+    const auto painted = buffer.getBytes();
+    step(history, layers, true);
+    CHECK(test::samePixels(buffer, *loadedCopy()));
+    step(history, layers, false);
+    CHECK(buffer.getBytes() == painted);
+}
+
+// Frames of a layer with pending rows match those of the loaded layer,
+// without the capture loading anything
+void testTimelapse() {
+    const std::string dir = test::scratchDirectory("lazy_tiles");
+
+    LayerManager lazy(kWidth, kHeight);
+    auto loader = std::make_shared<ShadeLoader>();
+    lazy.getLayer(0)->buffer->setTileLoader(loader);
+    LayerManager loaded(kWidth, kHeight);
+    loaded.getLayer(0)->buffer->copyFrom(*loadedCopy());
+
+    TimelapseRecorder lazyRecorder(kWidth, kHeight);
+    TimelapseRecorder loadedRecorder(kWidth, kHeight);
+    CHECK(lazyRecorder.open(dir + "/lazy.aftl"));
+    CHECK(loadedRecorder.open(dir + "/loaded.aftl"));
+
+    lazyRecorder.capture(lazy);
+    loadedRecorder.capture(loaded);
+    lazyRecorder.flush();
+    CHECK(pendingRows(*lazy.getLayer(0)->buffer) == kTilesY);
+    CHECK(loader->loads == kTilesY);   // Decoded for the frame by the recorder
+
+    // Nothing changed: the pending rows count as the same tiles
+    lazyRecorder.capture(lazy);
+    lazyRecorder.flush();
+    CHECK(loader->loads == kTilesY);
+    CHECK(lazyRecorder.frameCount() == 1);
+
+    for (LayerManager* layers : {&lazy, &loaded}) {
+        layers->getLayer(0)->buffer->drawCircle(40.0f, 200.0f, 20.0f, 10, 200, 30, 255, 0.8f);
+    }
+    lazyRecorder.capture(lazy);
+    loadedRecorder.capture(loaded);
+    lazyRecorder.flush();
+    loadedRecorder.flush();
+    CHECK(lazyRecorder.frameCount() == 2 && loadedRecorder.frameCount() == 2);
+
+    TimelapseReader lazyFrames;
+    TimelapseReader loadedFrames;
+    CHECK(lazyFrames.open(dir + "/lazy.aftl") && loadedFrames.open(dir + "/loaded.aftl"));
+    CHECK(lazyFrames.frameCount() == 2 && loadedFrames.frameCount() == 2);
+    const size_t stride = static_cast<size_t>(lazyFrames.width()) * 4;
+    std::vector<uint8_t> a(stride * lazyFrames.height());
+    std::vector<uint8_t> b(a.size());
+    for (size_t i = 0; i < 2 && lazyFrames.frameCount() == 2 && loadedFrames.frameCount() == 2; ++i) {
+        CHECK(lazyFrames.readFrame(i, a.data(), stride) && loadedFrames.readFrame(i, b.data(), stride));
+        CHECK(a == b);
+    }
+    std::filesystem::remove_all(dir);
+}
+
+} // anonymous namespace
+
+int main() {
+    testUndoStroke();
+    testTimelapse();
+    return test::result();
+}
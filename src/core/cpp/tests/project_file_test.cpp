@@ -0,0 +1,369 @@
+/**
+ * ArtFlow Studio - Project File Tests
+ * Zip and .aflow round trips, and damaged files being refused
+ */
+
+#include "layer_manager.h"
+#include "project_file.h"
+#include "test_support.h"
+#include "zip_archive.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace artflow;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string g_dir;
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+std::vector<uint8_t> sampleBytes(size_t size, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i) bytes[i] = static_cast<uint8_t>(i % 7 == 0 ? rng() : i / 64);
+    return bytes;
+}
+
+// Overwrite a 32-bit field of `name`'s central directory header
+bool patchCentralHeader(std::vector<uint8_t>& archive, const std::string& name, size_t field, uint32_t value) {
+    const uint8_t signature[] = {0x50, 0x4b, 0x01, 0x02};
+    for (size_t pos = 0; pos + 46 + name.size() <= archive.size(); ++pos) {
+        if (!std::equal(signature, signature + 4, archive.begin() + static_cast<std::ptrdiff_t>(pos))) continue;
+        const size_t nameBytes = archive[pos + 28] | (archive[pos + 29] << 8);
+        if (nameBytes != name.size() ||
+            !std::equal(name.begin(), name.end(), archive.begin() + static_cast<std::ptrdiff_t>(pos + 46))) {
+            continue;
+        }
+        for (int i = 0; i < 4; ++i) archive[pos + field + i] = static_cast<uint8_t>(value >> (8 * i));
+        return true;
+    }
+    return false;
+}
+
+// A stack with blend modes, opacity, hidden and partly painted layers
+std::unique_ptr<LayerManager> sampleStack() {
+    auto layers = std::make_unique<LayerManager>(300, 200);
+    layers->getLayer(0)->buffer->fill(240, 230, 220, 255);
+    Layer* ink = layers->getLayer(layers->addLayer("Ink"));
+    for (int i = 0; i < 30; ++i) ink->buffer->drawCircle(20.0f + i * 9, 100.0f, 14.0f, 20, 40, 200, 180, 0.6f);
+    ink->blendMode = BlendMode::Multiply;
+    ink->opacity = 0.75f;
+    Layer* hidden = layers->getLayer(layers->addLayer("Hidden"));
+    hidden->buffer->setPixel(299, 199, 1, 2, 3, 4);
+    hidden->visible = false;
+    hidden->alphaLock = true;
+    return layers;
+}
+
+void checkSameStack(const LayerManager& actual, const LayerManager& expected) {
+    CHECK(actual.getLayerCount() == expected.getLayerCount());
+    if (actual.getLayerCount() != expected.getLayerCount()) return;
+    for (int i = 0; i < expected.getLayerCount(); ++i) {
+        const Layer* a = actual.getLayer(i);
+        const Layer* e = expected.getLayer(i);
+        CHECK(a->name == e->name);
+        CHECK(a->blendMode == e->blendMode);
+        CHECK(std::abs(a->opacity - e->opacity) < 1e-3f);
+        CHECK(a->visible == e->visible && a->alphaLock == e->alphaLock);
+        CHECK(test::samePixels(*a->buffer, *e->buffer));
+    }
+}
+
+std::unique_ptr<LayerManager> load(const std::string& path, std::string* error) {
+    ProjectReader reader;
+    if (!reader.open(path, error)) return nullptr;
+    auto buffers = reader.loadLayers(error);
+    return buildLayerStack(reader.info(), std::move(buffers));
+}
+
+// ============================================================================
+// Zip
+// ============================================================================
+
+void testZipRoundTrip() {
+    const std::string path = g_dir + "/members.zip";
+    const auto stored = sampleBytes(100000, 1);
+    const auto deflated = sampleBytes(70000, 2);
+    {
+        ZipWriter zip;
+        CHECK(zip.open(path));
+        CHECK(zip.add("stored.bin", stored.data(), stored.size(), false));
+        CHECK(zip.add("dir/deflated.bin", deflated.data(), deflated.size(), true));
+        CHECK(zip.add("empty", nullptr, 0, true));
+        CHECK(zip.close());
+    }
+    CHECK(ZipReader::isZipFile(path));
+    ZipReader zip;
+    CHECK(zip.open(path));
+    CHECK(zip.entries().size() == 3);
+    std::vector<uint8_t> out;
+    const ZipReader::Entry* entry = zip.find("stored.bin");
+    CHECK(entry && entry->method == ZipReader::kStored && zip.read(*entry, out) && out == stored);
+    entry = zip.find("dir/deflated.bin");
+    CHECK(entry && entry->method == ZipReader::kDeflated && entry->compressedSize < entry->size);
+    CHECK(entry && zip.read(*entry, out) && out == deflated);
+    entry = zip.find("empty");
+    CHECK(entry && zip.read(*entry, out) && out.empty());
+    CHECK(zip.find("missing") == nullptr);
+
+    // Stored members can be read in place
+    uint64_t offset = 0;
+    entry = zip.find("stored.bin");
+    CHECK(entry && zip.dataOffset(*entry, &offset));
+    const auto file = readFile(path);
+    CHECK(offset + stored.size() <= file.size() &&
+          std::equal(stored.begin(), stored.end(), file.begin() + static_cast<std::ptrdiff_t>(offset)));
+}
+
+void testZipCorrupt() {
+    const std::string path = g_dir + "/members.zip";
+    const auto original = readFile(path);
+    const std::string damaged = g_dir + "/damaged.zip";
+    ZipReader zip;
+
+    // Not an archive at all
+    writeFile(damaged, sampleBytes(5000, 3));
+    CHECK(!ZipReader::isZipFile(damaged) && !zip.open(damaged));
+    writeFile(damaged, {});
+    CHECK(!zip.open(damaged));
+
+    // Cut short: the central directory is gone
+    writeFile(damaged, std::vector<uint8_t>(original.begin(), original.begin() + original.size() / 2));
+    CHECK(!zip.open(damaged));
+
+    // A flipped bit in member data fails its CRC (or inflate)
+    for (const char* name : {"stored.bin", "dir/deflated.bin"}) {
+        CHECK(zip.open(path));
+        const ZipReader::Entry* entry = zip.find(name);
+        uint64_t offset = 0;
+        CHECK(entry && zip.dataOffset(*entry, &offset));
+        zip.close();
+        auto bytes = original;
+        bytes[static_cast<size_t>(offset) + 100] ^= 0x10;
+        writeFile(damaged, bytes);
+        std::vector<uint8_t> out;
+        CHECK(zip.open(damaged));
+        entry = zip.find(name);
+        CHECK(entry && !zip.read(*entry, out));
+        zip.close();
+    }
+}
+
+void testZipForgedSizes() {
+    // Central directory fields: 20 compressed size, 24 size, 42 header offset
+    const auto original = readFile(g_dir + "/members.zip");
+    const std::string forged = g_dir + "/forged.zip";
+    ZipReader zip;
+
+    // Member data running past the end of the file
+    auto bytes = original;
+    CHECK(patchCentralHeader(bytes, "stored.bin", 20, 0xFFFFFFF0u));
+    CHECK(patchCentralHeader(bytes, "stored.bin", 24, 0xFFFFFFF0u));
+    writeFile(forged, bytes);
+    CHECK(!zip.open(forged));
+
+    bytes = original;
+    CHECK(patchCentralHeader(bytes, "dir/deflated.bin", 42, static_cast<uint32_t>(original.size() - 10)));
+    writeFile(forged, bytes);
+    CHECK(!zip.open(forged));
+
+    // Stored members cannot declare another uncompressed size
+    bytes = original;
+    CHECK(patchCentralHeader(bytes, "stored.bin", 24, 10));
+    writeFile(forged, bytes);
+    CHECK(!zip.open(forged));
+
+    // A deflated member claiming 2 GB: refused without allocating it
+    bytes = original;
+    CHECK(patchCentralHeader(bytes, "dir/deflated.bin", 24, 0x7FFFFFFFu));
+    writeFile(forged, bytes);
+    CHECK(zip.open(forged));
+    const ZipReader::Entry* entry = zip.find("dir/deflated.bin");
+    std::vector<uint8_t> out;
+    CHECK(entry && !zip.read(*entry, out));
+    CHECK(out.capacity() < (64u << 20));
+
+    // One claiming less than it holds
+    bytes = original;
+    CHECK(patchCentralHeader(bytes, "dir/deflated.bin", 24, 1000));
+    writeFile(forged, bytes);
+    CHECK(zip.open(forged));
+    entry = zip.find("dir/deflated.bin");
+    CHECK(entry && !zip.read(*entry, out));
+}
+
+// ============================================================================
+// Projects
+// ============================================================================
+
+void testProjectRoundTrip() {
+    const auto layers = sampleStack();
+    for (const char* name : {"/roundtrip.aflow", "/roundtrip_folder"}) {
+        const std::string path = g_dir + name;
+        auto snapshot = snapshotProject(*layers);
+        snapshot.info.name = "Round trip";
+        std::string error;
+        CHECK(saveProject(path, snapshot, {}, &error));
+        CHECK(error.empty());
+
+        ProjectReader reader;
+        CHECK(reader.open(path, &error));
+        CHECK(reader.info().width == 300 && reader.info().height == 200);
+        CHECK(reader.info().name == "Round trip");
+        CHECK(reader.info().layers.size() == 3);
+        auto loaded = load(path, &error);
+        CHECK(loaded && error.empty());
+        if (loaded) checkSameStack(*loaded, *layers);
+    }
+    CHECK(!fs::exists(g_dir + "/roundtrip.aflow.tmp"));
+}
+
+void testProjectDamaged() {
+    const std::string path = g_dir + "/roundtrip.aflow";
+    const auto original = readFile(path);
+    const std::string damaged = g_dir + "/damaged.aflow";
+    std::string error;
+    ProjectReader reader;
+
+    CHECK(!reader.open(g_dir + "/missing.aflow", &error) && !error.empty());
+
+    writeFile(damaged, std::vector<uint8_t>(original.begin(), original.end() - 30));
+    error.clear();
+    CHECK(!reader.open(damaged, &error) && !error.empty());
+
+    writeFile(damaged, sampleBytes(4096, 4));
+    error.clear();
+    CHECK(!reader.open(damaged, &error) && !error.empty());
+
+    // A folder project missing a layer image loads it empty and says so
+    const std::string folder = g_dir + "/roundtrip_folder";
+    fs::remove(fs::path(folder) / "layer_1.png");
+    CHECK(reader.open(folder, &error));
+    auto buffers = reader.loadLayers(&error);
+    CHECK(buffers.size() == 3 && buffers[0] && !buffers[1] && buffers[2]);
+    CHECK(error.find("layer_1.png") != std::string::npos);
+}
+
+// A layer of another size keeps its pixels, placed at the origin
+void testProjectLayerSize() {
+    ProjectInfo info;
+    info.width = 300;
+    info.height = 200;
+    info.layers.resize(2);
+    std::vector<std::unique_ptr<ImageBuffer>> buffers;
+    buffers.push_back(std::make_unique<ImageBuffer>(120, 80, ImageBuffer::Storage::Tiled));
+    buffers[0]->setPixel(119, 79, 200, 100, 50, 255);
+    buffers.push_back(std::make_unique<ImageBuffer>(400, 250, ImageBuffer::Storage::Tiled));
+    buffers[1]->setPixel(299, 199, 10, 20, 30, 255);
+    buffers[1]->setPixel(350, 10, 10, 20, 30, 255);
+
+    auto stack = buildLayerStack(info, std::move(buffers));
+    CHECK(stack->getLayerCount() == 2);
+    const ImageBuffer& small = *stack->getLayer(0)->buffer;
+    const ImageBuffer& large = *stack->getLayer(1)->buffer;
+    CHECK(small.width() == 300 && small.height() == 200);
+    CHECK(large.width() == 300 && large.height() == 200);
+    CHECK(small.pixelAt(119, 79)[3] == 255 && small.pixelAt(120, 79)[3] == 0);
+    CHECK(large.pixelAt(299, 199)[3] == 255);
+}
+
+// Metadata the native stack does not use (a blend mode written by the
+// Python app, group nesting) is saved back as it was loaded
+void testProjectForeignMetadata() {
+    const std::string path = g_dir + "/foreign.aflow";
+    const auto layers = sampleStack();
+    auto snapshot = snapshotProject(*layers);
+    snapshot.info.layers[1].blendMode = "Add";
+    snapshot.info.layers[1].depth = 2;
+    snapshot.info.layers[1].expanded = false;
+    std::string error;
+    CHECK(saveProject(path, snapshot, {}, &error));
+
+    auto loaded = load(path, &error);
+    CHECK(loaded != nullptr);
+    if (!loaded) return;
+    CHECK(loaded->getLayer(1)->blendMode == BlendMode::Normal);
+    CHECK(saveProject(path, snapshotProject(*loaded), {}, &error));
+
+    ProjectReader reader;
+    CHECK(reader.open(path, &error) && reader.info().layers.size() == 3);
+    if (reader.info().layers.size() != 3) return;
+    const ProjectLayer& meta = reader.info().layers[1];
+    CHECK(meta.blendMode == "Add" && meta.depth == 2 && !meta.expanded);
+    CHECK(reader.info().layers[2].blendMode == "Normal" && reader.info().layers[2].expanded);
+
+    // Choosing a mode replaces the foreign one
+    loaded->getLayer(1)->blendMode = BlendMode::Screen;
+    CHECK(projectLayer(*loaded, 1).blendMode == "Screen");
+}
+
+// A lazy layer whose rows turn unreadable loads them empty, is marked, and
+// keeps the save from overwriting its source
+void testProjectUnreadableRows() {
+    const std::string folder = g_dir + "/unreadable_folder";
+    const auto layers = sampleStack();
+    std::string error;
+    CHECK(saveProject(folder, snapshotProject(*layers), {}, &error));
+
+    ProjectReader reader;
+    CHECK(reader.open(folder, &error));
+    auto buffers = reader.loadLayers(&error);
+    CHECK(buffers.size() == 3 && buffers[1] && buffers[1]->hasPendingTiles());
+
+    // Zero the ink layer's compressed data behind the reader's back
+    const std::string ink = (fs::path(folder) / "layer_1.png").string();
+    auto bytes = readFile(ink);
+    const std::string idat = "IDAT";
+    const auto found = std::search(bytes.begin(), bytes.end(), idat.begin(), idat.end());
+    CHECK(found != bytes.end());
+    std::fill(found + 4, found + 4 + static_cast<std::ptrdiff_t>((bytes.end() - found) / 2), uint8_t(0));
+    writeFile(ink, bytes);
+
+    buffers[1]->loadPendingTiles();
+    CHECK(buffers[1]->hasUnreadableTiles());
+    CHECK(!buffers[0]->hasUnreadableTiles() && !buffers[2]->hasUnreadableTiles());
+    auto stack = buildLayerStack(reader.info(), std::move(buffers));
+
+    ProjectSaveOptions options;
+    options.loadedFrom = folder;
+    error.clear();
+    CHECK(!saveProject(folder, snapshotProject(*stack), options, &error));
+    CHECK(error.find("Ink") != std::string::npos);
+    CHECK(readFile(ink) == bytes);
+
+    // Elsewhere is fine, and so is the source once the layer is replaced
+    CHECK(saveProject(g_dir + "/unreadable_copy.aflow", snapshotProject(*stack), options, &error));
+    stack->getLayer(1)->buffer->clear();
+    CHECK(saveProject(folder, snapshotProject(*stack), options, &error));
+}
+
+} // anonymous namespace
+
+int main() {
+    g_dir = test::scratchDirectory("project_file");
+    testZipRoundTrip();
+    testZipCorrupt();
+    testZipForgedSizes();
+    testProjectRoundTrip();
+    testProjectDamaged();
+    testProjectLayerSize();
+    testProjectForeignMetadata();
+    testProjectUnreadableRows();
+    fs::remove_all(g_dir);
+    return test::result();
+}
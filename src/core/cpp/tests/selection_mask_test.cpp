@@ -0,0 +1,198 @@
+/**
+ * ArtFlow Studio - Selection Mask Tests
+ * Rect and polygon operations against a per-pixel reference
+ */
+
+#include "blend_kernels.h"
+#include "selection_mask.h"
+#include "test_support.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace artflow;
+
+namespace {
+
+// Even-odd test of a pixel center, as selectPolygon() documents. Centers
+// within a hair of an edge may land either way and set `*ambiguous`.
+bool insidePolygon(const std::vector<float>& xy, double x, double y, bool* ambiguous) {
+    bool inside = false;
+    const size_t n = xy.size() / 2;
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+        const double xi = xy[i * 2], yi = xy[i * 2 + 1];
+        const double xj = xy[j * 2], yj = xy[j * 2 + 1];
+        if ((yi > y) == (yj > y)) continue;
+        const double crossing = xi + (y - yi) * (xj - xi) / (yj - yi);
+        if (std::fabs(x - crossing) < 1e-3) *ambiguous = true;
+        if (x < crossing) inside = !inside;
+    }
+    return inside;
+}
+
+// Pixels flagged in `ambiguous` are not compared
+bool matches(const SelectionMask& mask, const std::vector<uint8_t>& expected, const std::vector<uint8_t>& ambiguous) {
+    const int w = mask.width();
+    const int h = mask.height();
+    std::vector<uint8_t> actual(static_cast<size_t>(w) * h);
+    mask.readRegion(0, 0, w, h, actual.data(), w);
+    bool anyAmbiguous = false;
+    for (size_t i = 0; i < actual.size(); ++i) {
+        if (ambiguous[i]) {
+            anyAmbiguous = true;
+        } else if (actual[i] != expected[i]) {
+            return false;
+        }
+    }
+    if (anyAmbiguous) return true;
+
+    // bounds() is the exact box of the selected pixels
+    int minX = w, minY = h, maxX = -1, maxY = -1;
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            if (!expected[y * w + x]) continue;
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        }
+    }
+    const DirtyRect& b = mask.bounds();
+    if (maxX < 0) return b.isEmpty();
+    return b.x == minX && b.y == minY && b.w == maxX - minX + 1 && b.h == maxY - minY + 1;
+}
+
+void testRandomOperations() {
+    std::mt19937 rng(3);
+    for (int round = 0; round < 100; ++round) {
+        // Sizes around and off the tile size, shapes hanging over the edges
+        const int w = 1 + static_cast<int>(rng() % 200);
+        const int h = 1 + static_cast<int>(rng() % 200);
+        SelectionMask mask(w, h);
+        std::vector<uint8_t> expected(static_cast<size_t>(w) * h, 0);
+        std::vector<uint8_t> ambiguous(expected.size(), 0);   // Once unsure, for the rest of the round
+
+        for (int step = 0; step < 5; ++step) {
+            const auto op = static_cast<SelectionMask::Op>(rng() % 4);
+            std::vector<uint8_t> shape(expected.size(), 0);
+            if (rng() % 2) {
+                const int n = 3 + static_cast<int>(rng() % 8);
+                std::vector<float> xy;
+                for (int i = 0; i < n; ++i) {
+                    xy.push_back(static_cast<int>(rng() % (w + 40)) - 20 + (rng() % 4) * 0.25f);
+                    xy.push_back(static_cast<int>(rng() % (h + 40)) - 20 + (rng() % 4) * 0.25f);
+                }
+                mask.selectPolygon(xy.data(), n, op);
+                for (int y = 0; y < h; ++y) {
+                    for (int x = 0; x < w; ++x) {
+                        bool unsure = false;
+                        shape[y * w + x] = insidePolygon(xy, x + 0.5, y + 0.5, &unsure) ? 255 : 0;
+                        if (unsure) ambiguous[y * w + x] = 1;
+                    }
+                }
+            } else {
+                const int rx = static_cast<int>(rng() % (w + 40)) - 20;
+                const int ry = static_cast<int>(rng() % (h + 40)) - 20;
+                const int rw = static_cast<int>(rng() % w);
+                const int rh = static_cast<int>(rng() % h);
+                mask.selectRect(rx, ry, rw, rh, op);
+                for (int y = 0; y < h; ++y) {
+                    for (int x = 0; x < w; ++x) {
+                        shape[y * w + x] = (x >= rx && x < rx + rw && y >= ry && y < ry + rh) ? 255 : 0;
+                    }
+                }
+            }
+            for (size_t i = 0; i < expected.size(); ++i) {
+                switch (op) {
+                    case SelectionMask::Op::Replace: expected[i] = shape[i]; break;
+                    case SelectionMask::Op::Add: expected[i] |= shape[i]; break;
+                    case SelectionMask::Op::Subtract: if (shape[i]) expected[i] = 0; break;
+                    case SelectionMask::Op::Intersect: if (!shape[i]) expected[i] = 0; break;
+                }
+            }
+            if (rng() % 5 == 0) {
+                mask.invert();
+                for (auto& v : expected) v = static_cast<uint8_t>(255 - v);
+            }
+            CHECK(matches(mask, expected, ambiguous));
+        }
+    }
+}
+
+void testDegenerateShapes() {
+    SelectionMask mask(100, 100);
+    mask.selectRect(10, 10, 0, 20);   // Zero width
+    CHECK(mask.isEmpty());
+    mask.selectRect(-50, -50, 20, 20);   // Wholly outside
+    CHECK(mask.isEmpty());
+    const float line[] = {10, 10, 60, 60};
+    mask.selectPolygon(line, 2);
+    CHECK(mask.isEmpty());
+
+    mask.selectAll();
+    CHECK(mask.valueAt(0, 0) == 255 && mask.valueAt(99, 99) == 255);
+    CHECK(mask.bounds().w == 100 && mask.bounds().h == 100);
+    mask.invert();
+    CHECK(mask.isEmpty() && mask.memoryUsage() == 0);
+}
+
+void testSparseStorage() {
+    // Only tiles on the edge of a selection own memory
+    SelectionMask mask(1024, 1024);
+    mask.selectRect(64, 64, 512, 512);   // Tile-aligned: shares the full tile
+    CHECK(mask.memoryUsage() == 0);
+    CHECK(mask.isTileFull(1, 1) && mask.isTileEmpty(0, 0));
+    mask.selectRect(100, 100, 10, 10, SelectionMask::Op::Subtract);
+    CHECK(mask.memoryUsage() == SelectionMask::kTileBytes);
+    CHECK(mask.valueAt(105, 105) == 0 && mask.valueAt(99, 105) == 255);
+}
+
+// Composite clipped to a selection with soft edges: unselected pixels stay,
+// fully selected ones blend at the layer opacity, partly selected ones at
+// the opacity scaled by the selection (to within rounding)
+void testClippedComposite() {
+    constexpr int kSize = 200;
+    SelectionMask mask(kSize, kSize);
+    mask.selectRect(30, 30, 140, 140);
+    std::vector<uint8_t> ramp(150 * 40);
+    for (size_t i = 0; i < ramp.size(); ++i) ramp[i] = static_cast<uint8_t>((i % 150) * 255 / 149);
+    mask.writeRegion(10, 80, 150, 40, ramp.data(), 150);
+
+    for (BlendMode mode : {BlendMode::Normal, BlendMode::Multiply}) {
+        ImageBuffer layer(kSize, kSize, ImageBuffer::Storage::Tiled);
+        layer.drawCircle(100.0f, 100.0f, 90.0f, 200, 60, 20, 220, 0.4f);
+        ImageBuffer base(kSize, kSize, ImageBuffer::Storage::Tiled);
+        base.fill(40, 120, 230, 255);
+        ImageBuffer out(kSize, kSize, ImageBuffer::Storage::Tiled);
+        out.copyFrom(base);
+        out.composite(layer, 0, 0, 0.8f, mode, &mask);
+
+        int worst = 0;
+        for (int y = 0; y < kSize; ++y) {
+            for (int x = 0; x < kSize; ++x) {
+                const uint8_t v = mask.valueAt(x, y);
+                uint8_t expected[4];
+                std::copy(base.pixelAt(x, y), base.pixelAt(x, y) + 4, expected);
+                if (v != 0) blend::rowKernel(mode)(expected, layer.pixelAt(x, y), 1, 0.8f * (v / 255.0f));
+                const uint8_t* actual = std::as_const(out).pixelAt(x, y);
+                for (int c = 0; c < 4; ++c) {
+                    const int diff = std::abs(actual[c] - expected[c]);
+                    worst = std::max(worst, (v == 0 || v == 255) ? diff * 256 : diff);
+                }
+            }
+        }
+        CHECK(worst <= 1);
+    }
+}
+
+} // anonymous namespace
+
+int main() {
+    testRandomOperations();
+    testDegenerateShapes();
+    testSparseStorage();
+    testClippedComposite();
+    return test::result();
+}
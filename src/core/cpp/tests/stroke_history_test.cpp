@@ -0,0 +1,106 @@
+/**
+ * ArtFlow Studio - Stroke History Tests
+ * The legacy canvas's tile-delta undo of brush strokes
+ */
+
+#include "../../brushes/brush_engine.h"
+#include "../../brushes/brush_stroke.h"
+#include "../../canvas/tile_history.h"
+#include "../../layers/layer.h"
+#include "test_support.h"
+#include <cmath>
+
+using namespace artflow;
+
+namespace {
+
+constexpr int kTile = TileHistory::kTileSize;
+
+// Canvas::captureStrokeArea(): save the tiles the next render step can touch
+void captureStrokeArea(TileHistory& history, const Layer& layer, const BrushStroke& stroke) {
+    Rect bounds = stroke.pendingBounds();
+    int x0 = static_cast<int>(std::floor(bounds.x));
+    int y0 = static_cast<int>(std::floor(bounds.y));
+    int x1 = static_cast<int>(std::ceil(bounds.x + bounds.width));
+    int y1 = static_cast<int>(std::ceil(bounds.y + bounds.height));
+    history.captureRect(layer, x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+// Paint from (x, y) towards the tile seam at x = kTile as Canvas does,
+// stopping short of it so only the edges of the dabs cross
+void paintToSeam(TileHistory& history, Layer& layer, BrushEngine& engine, float x, float y) {
+    BrushStroke stroke;
+    stroke.setBrushEngine(&engine);
+    history.beginStroke(layer, 0);
+    stroke.addPoint(Point(x, y));
+    const float end = kTile - engine.getSettings().size * 0.75f;
+    for (float px = x + 2.0f; px <= end; px += 2.0f) {
+        stroke.addPoint(Point(px, y));
+        captureStrokeArea(history, layer, stroke);
+        stroke.renderTo(layer);
+    }
+    captureStrokeArea(history, layer, stroke);
+    stroke.finalizeTo(layer);
+    history.commitStroke(layer);
+}
+
+bool paintedPast(const Layer& layer, int column) {
+    const auto& data = layer.getData();
+    for (int y = 0; y < layer.getHeight(); ++y) {
+        for (int x = column; x < layer.getWidth(); ++x) {
+            if (data[(static_cast<size_t>(y) * layer.getWidth() + x) * 4 + 3] != 0) return true;
+        }
+    }
+    return false;
+}
+
+void testUndoAcrossSeam(float size, float hardness) {
+    BrushEngine engine;
+    BrushSettings settings;
+    settings.size = size;
+    settings.hardness = hardness;
+    settings.color = Color(0.8f, 0.1f, 0.2f, 1.0f);
+    engine.setSettings(settings);
+
+    TileHistory history;
+    TileHistory::LayerStack layers;
+    layers.push_back(std::make_unique<Layer>(kTile * 2, kTile * 2));
+    Layer& layer = *layers[0];
+    int active = 0;
+    const std::vector<uint8_t> before = layer.getData();
+
+    paintToSeam(history, layer, engine, 20.0f, kTile - 8.0f);
+    const std::vector<uint8_t> after = layer.getData();
+    CHECK(paintedPast(layer, kTile));   // The dabs spill into the next tiles
+
+    CHECK(history.undo(layers, active));
+    CHECK(layers[0]->getData() == before);
+    CHECK(history.redo(layers, active));
+    CHECK(layers[0]->getData() == after);
+}
+
+void testPendingBoundsCoverDabs() {
+    BrushEngine engine;
+    BrushSettings settings;
+    settings.size = 15.0f;
+    engine.setSettings(settings);
+
+    BrushStroke stroke;
+    stroke.setBrushEngine(&engine);
+    stroke.addPoint(Point(50.0f, 40.0f));
+    const Rect bounds = stroke.pendingBounds();
+    // A full-pressure round dab is size * 2 across
+    CHECK(bounds.x <= 50.0f - settings.size);
+    CHECK(bounds.x + bounds.width >= 50.0f + settings.size);
+    CHECK(bounds.y <= 40.0f - settings.size);
+    CHECK(bounds.y + bounds.height >= 40.0f + settings.size);
+}
+
+} // anonymous namespace
+
+int main() {
+    testUndoAcrossSeam(12.0f, 1.0f);
+    testUndoAcrossSeam(20.0f, 0.8f);
+    testPendingBoundsCoverDabs();
+    return test::result();
+}
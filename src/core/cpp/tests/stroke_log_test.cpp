@@ -0,0 +1,153 @@
+/**
+ * ArtFlow Studio - Stroke Log Tests
+ * Replay against live painting, with undo and redo in between
+ */
+
+#include "layer_manager.h"
+#include "stroke_log.h"
+#include "test_support.h"
+#include "undo_stack.h"
+#include <cmath>
+#include <future>
+#include <vector>
+
+using namespace artflow;
+
+namespace {
+
+constexpr int kWidth = 300;
+constexpr int kHeight = 200;
+
+// A canvas as CanvasItem drives it: strokes go to the layer, the undo
+// history and the log
+struct Session {
+    LayerManager layers{kWidth, kHeight};
+    UndoStack history;
+    StrokeLog log;
+    int layerId;
+
+    Session() {
+        layers.getLayer(0)->visible = false;
+        layerId = layers.getLayer(layers.addLayer("Paint"))->id;
+    }
+
+    ImageBuffer& buffer() { return *layers.findLayerById(layerId)->buffer; }
+
+    void stroke(float y, uint8_t red) {
+        // Steps that could be redone are dropped by this stroke
+        const size_t undone = history.redoLogPosition();
+        if (undone < log.strokeCount()) log.truncate(undone);
+        history.beginStroke(layerId, buffer(), log.strokeCount());
+
+        BrushSettings brush;
+        brush.size = 12.0f;
+        const Color color(red, 40, 200, 255);
+        const uint64_t seed = BrushEngine::newStrokeSeed();
+        BrushEngine engine;
+        engine.setBrush(brush);
+        engine.setColor(color);
+
+        StrokePoint previous = StrokeLog::quantize(StrokePoint(20.0f, y, 0.5f));
+        log.beginStroke(layerId, -1, false, brush, color, seed, previous);
+        engine.beginStroke(previous, seed);
+        Layer& layer = *layers.findLayerById(layerId);
+        renderStrokeStep(engine, layer, nullptr, false, nullptr, previous);
+        for (int i = 1; i < 60; ++i) {
+            const StrokePoint point = StrokeLog::quantize(
+                StrokePoint(20.0f + i * 4.3f, y + 15.0f * std::sin(i * 0.2f), 0.3f + 0.01f * i));
+            renderStrokeStep(engine, layer, nullptr, false, &previous, point);
+            log.addPoint(point);
+            previous = point;
+        }
+        engine.endStroke();
+        log.endStroke();
+        history.endStroke(buffer());
+    }
+
+    void step(bool undo) {
+        std::promise<std::shared_ptr<UndoStack::Patch>> ready;
+        auto patch = ready.get_future();
+        auto deliver = [&ready](std::shared_ptr<UndoStack::Patch> p) { ready.set_value(std::move(p)); };
+        const bool requested = undo ? history.undo(deliver) : history.redo(deliver);
+        CHECK(requested);
+        if (requested) CHECK(history.apply(patch.get(), layers) == layerId);
+    }
+
+    // The log replayed on an empty canvas gives what is on screen
+    bool replayMatches() const {
+        LayerManager replayed(kWidth, kHeight);
+        replayed.getLayer(0)->visible = false;
+        replayed.addLayer("Paint");
+        log.replay(replayed);
+        const Layer* expected = layers.getLayer(1);
+        const Layer* actual = replayed.findLayerById(layerId);
+        return actual && test::samePixels(*actual->buffer, *expected->buffer);
+    }
+};
+
+void testReplay() {
+    Session session;
+    session.stroke(50, 200);
+    session.stroke(100, 100);
+    CHECK(session.log.strokeCount() == 2);
+    CHECK(session.replayMatches());
+}
+
+void testStrokeUndoStroke() {
+    Session session;
+    session.stroke(50, 200);
+    session.stroke(100, 100);
+    session.step(true);
+    // Undone but still redoable: kept until another edit drops it
+    CHECK(session.log.strokeCount() == 2);
+    CHECK(session.history.redoLogPosition() == 1);
+
+    session.stroke(150, 30);
+    CHECK(!session.history.canRedo());
+    CHECK(session.log.strokeCount() == 2);
+    CHECK(session.replayMatches());
+}
+
+void testUndoRedoStroke() {
+    Session session;
+    session.stroke(50, 200);
+    session.stroke(100, 100);
+    session.step(true);
+    session.step(true);
+    session.step(false);   // The first stroke is back; the second still undone
+    CHECK(session.history.redoLogPosition() == 1);
+
+    session.stroke(150, 30);
+    CHECK(session.log.strokeCount() == 2);
+    CHECK(session.replayMatches());
+}
+
+void testSerialized() {
+    Session session;
+    session.stroke(50, 200);
+    session.stroke(100, 100);
+    session.step(true);
+    session.stroke(150, 30);
+
+    const auto bytes = session.log.serialize();
+    StrokeLog loaded;
+    CHECK(loaded.deserialize(bytes.data(), bytes.size()));
+    CHECK(loaded.strokeCount() == 2);
+    CHECK(loaded.serialize() == bytes);
+
+    CHECK(!bytes.empty());
+    std::vector<uint8_t> cut(bytes.begin(), bytes.end() - 1);
+    StrokeLog rejected;
+    CHECK(!rejected.deserialize(cut.data(), cut.size()));
+    CHECK(rejected.strokeCount() == 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    testReplay();
+    testStrokeUndoStroke();
+    testUndoRedoStroke();
+    testSerialized();
+    return test::result();
+}
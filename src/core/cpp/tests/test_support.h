@@ -0,0 +1,52 @@
+/**
+ * ArtFlow Studio - Test Support
+ * Checks and scratch files shared by the core tests
+ */
+
+#pragma once
+
+#include "image_buffer.h"
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+namespace artflow {
+namespace test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+// Unlike assert(), also checked in release builds; a failure is reported
+// and the test goes on
+#define CHECK(condition)                                                                    \
+    do {                                                                                    \
+        if (!(condition)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            ++::artflow::test::failures();                                                  \
+        }                                                                                   \
+    } while (0)
+
+// Exit code of main()
+inline int result() {
+    if (failures()) std::fprintf(stderr, "%d check(s) failed\n", failures());
+    return failures() ? 1 : 0;
+}
+
+// An empty directory of its own for a test's files
+inline std::string scratchDirectory(const std::string& name) {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / ("artflow-test-" + name);
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir.string();
+}
+
+inline bool samePixels(const ImageBuffer& a, const ImageBuffer& b) {
+    if (a.width() != b.width() || a.height() != b.height()) return false;
+    return a.getBytes() == b.getBytes();
+}
+
+} // namespace test
+} // namespace artflow
@@ -0,0 +1,86 @@
+/**
+ * ArtFlow Studio - Thread Pool Tests
+ */
+
+#include "test_support.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <vector>
+
+using namespace artflow;
+
+namespace {
+
+void testEveryIndexOnce() {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> hits(1000);
+    for (int run = 0; run < 50; ++run) {
+        pool.parallelFor(hits.size(), [&](size_t i) { hits[i].fetch_add(1); });
+    }
+    for (const auto& hit : hits) CHECK(hit.load() == 50);
+}
+
+void testEmptyAndSingle() {
+    ThreadPool pool(2);
+    int calls = 0;
+    pool.parallelFor(0, [&](size_t) { ++calls; });
+    CHECK(calls == 0);
+    pool.parallelFor(1, [&](size_t i) { calls += static_cast<int>(i) + 1; });
+    CHECK(calls == 1);
+}
+
+void testNoWorkers() {
+    // The caller runs everything
+    ThreadPool pool(0);
+    CHECK(pool.workerCount() == 0);
+    std::vector<int> hits(100);
+    pool.parallelFor(hits.size(), [&](size_t i) { ++hits[i]; });
+    for (int hit : hits) CHECK(hit == 1);
+}
+
+void testNested() {
+    // Inner loops run serially on the task's thread instead of deadlocking
+    ThreadPool pool(3);
+    std::vector<std::atomic<int>> hits(64 * 16);
+    pool.parallelFor(64, [&](size_t outer) {
+        pool.parallelFor(16, [&](size_t inner) { hits[outer * 16 + inner].fetch_add(1); });
+    });
+    for (const auto& hit : hits) CHECK(hit.load() == 1);
+}
+
+void testUnevenItems() {
+    ThreadPool pool(4);
+    std::atomic<long long> sum{0};
+    pool.parallelFor(200, [&](size_t i) {
+        long long local = 0;
+        const size_t work = (i % 10 == 0) ? 200000 : 10;   // A few heavy items to steal around
+        for (size_t k = 0; k < work; ++k) local += static_cast<long long>(k % 3);
+        sum.fetch_add(local);
+    });
+    long long expected = 0;
+    for (size_t i = 0; i < 200; ++i) {
+        const size_t work = (i % 10 == 0) ? 200000 : 10;
+        for (size_t k = 0; k < work; ++k) expected += static_cast<long long>(k % 3);
+    }
+    CHECK(sum.load() == expected);
+}
+
+void testShared() {
+    ThreadPool& pool = ThreadPool::shared();
+    CHECK(&pool == &ThreadPool::shared());
+    std::atomic<size_t> total{0};
+    pool.parallelFor(10000, [&](size_t i) { total.fetch_add(i); });
+    CHECK(total.load() == 10000u * 9999u / 2);
+}
+
+} // anonymous namespace
+
+int main() {
+    testEveryIndexOnce();
+    testEmptyAndSingle();
+    testNoWorkers();
+    testNested();
+    testUnevenItems();
+    testShared();
+    return test::result();
+}
@@ -0,0 +1,126 @@
+/**
+ * ArtFlow Studio - Tile Store Tests
+ * Eviction to the scratch file and reload on access
+ */
+
+#include "layer_manager.h"
+#include "test_support.h"
+#include "tile_store.h"
+#include <filesystem>
+
+using namespace artflow;
+
+namespace {
+
+constexpr int kSize = 2048;   // 1024 tiles (16 MB) per layer
+constexpr size_t kBudget = 4u << 20;
+
+std::string g_dir;
+
+uint8_t expectedRed(int layer) { return static_cast<uint8_t>(layer * 40); }
+
+void paint(ImageBuffer& buffer, int layer) {
+    for (int y = 0; y < kSize; y += 3) {
+        for (int x = 0; x < kSize; x += 61) {
+            buffer.setPixel(x, y, expectedRed(layer), static_cast<uint8_t>(x), static_cast<uint8_t>(y), 255);
+        }
+    }
+}
+
+bool intact(const ImageBuffer& buffer, int layer) {
+    for (int y = 0; y < kSize; y += 3 * 31) {
+        for (int x = 0; x < kSize; x += 61) {
+            const uint8_t* p = buffer.pixelAt(x, y);
+            if (p[0] != expectedRed(layer) || p[1] != static_cast<uint8_t>(x) || p[2] != static_cast<uint8_t>(y) ||
+                p[3] != 255) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void testEvictAndReload() {
+    std::string error;
+    auto store = TileStore::create(g_dir, kBudget, &error);
+    CHECK(store != nullptr);
+    if (!store) return;
+    {
+        LayerManager layers(kSize, kSize);
+        layers.setTileStore(store);
+        for (int i = 1; i <= 3; ++i) paint(*layers.getLayer(layers.addLayer("Layer"))->buffer, i);
+
+        // Far more allocated than the budget; trimming hands the rest back
+        CHECK(store->allocatedBytes() >= 3 * 1024 * ImageBuffer::kTileBytes);
+        CHECK(store->fileBytes() >= store->allocatedBytes());
+        store->trim();
+        CHECK(store->residentBytes() <= kBudget);
+
+        // Evicted tiles come back from the file
+        for (int i = 1; i <= 3; ++i) CHECK(intact(*layers.getLayer(i)->buffer, i));
+        store->trim();
+        CHECK(store->residentBytes() <= kBudget);
+        CHECK(intact(*layers.getLayer(2)->buffer, 2));
+
+        // Copy-on-write: a held handle keeps the old tile, in the store
+        ImageBuffer& buffer = *layers.getLayer(2)->buffer;
+        const auto held = buffer.tileHandle(0, 0);
+        buffer.setPixel(0, 0, 1, 2, 3, 255);
+        CHECK(held != buffer.tileHandle(0, 0));
+        CHECK(store->owns(held) && store->owns(buffer.tileHandle(0, 0)));
+        CHECK((*held)[0] == expectedRed(2));
+
+        // Composites can live in the store too
+        ImageBuffer out(kSize, kSize, ImageBuffer::Storage::Tiled);
+        out.setTileStore(store);
+        layers.compositeAll(out);
+        CHECK(out.pixelAt(61, 3)[3] == 255);
+
+        const size_t before = store->allocatedBytes();
+        layers.removeLayer(3);
+        CHECK(store->allocatedBytes() < before);
+    }
+    // Everything released once the buffers are gone; the store outlives them
+    CHECK(store->allocatedBytes() == 0);
+}
+
+void testReuseAndMigration() {
+    auto store = TileStore::create(g_dir, kBudget);
+    CHECK(store != nullptr);
+    if (!store) return;
+
+    // Freed slots are reused, so the file does not grow
+    {
+        ImageBuffer a(512, 512, ImageBuffer::Storage::Tiled);
+        a.setTileStore(store);
+        a.fill(1, 2, 3, 255);
+    }
+    const size_t fileBytes = store->fileBytes();
+    {
+        ImageBuffer b(512, 512, ImageBuffer::Storage::Tiled);
+        b.setTileStore(store);
+        b.setPixel(10, 10, 9, 9, 9, 255);
+        CHECK(b.pixelAt(11, 10)[3] == 0);   // Reused slots start zeroed
+        CHECK(b.pixelAt(10, 10)[0] == 9);
+    }
+    CHECK(store->fileBytes() == fileBytes);
+
+    // Heap tiles move into the store, sharing kept
+    ImageBuffer heap(300, 300, ImageBuffer::Storage::Tiled);
+    heap.fill(10, 20, 30, 255);
+    heap.setPixel(5, 5, 255, 0, 0, 255);
+    heap.setTileStore(store);
+    CHECK(store->owns(heap.tileHandle(0, 0)));
+    CHECK(heap.tileHandle(1, 1) == heap.tileHandle(2, 2));
+    CHECK(heap.pixelAt(5, 5)[0] == 255 && heap.pixelAt(100, 100)[2] == 30);
+}
+
+} // anonymous namespace
+
+int main() {
+    g_dir = test::scratchDirectory("tile_store");
+    testEvictAndReload();
+    testReuseAndMigration();
+    std::filesystem::remove_all(g_dir);
+    return test::result();
+}
@@ -0,0 +1,197 @@
+/**
+ * ArtFlow Studio - Transform Tests
+ * Resampling taps against direct computation
+ */
+
+#include "test_support.h"
+#include "transform.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace artflow;
+
+namespace {
+
+constexpr int kWidth = 300;
+constexpr int kHeight = 200;
+constexpr Resampling kQualities[] = {Resampling::Bilinear, Resampling::Bicubic, Resampling::Lanczos3};
+
+// Random valid premultiplied pixels (color <= alpha)
+void randomize(ImageBuffer& image, unsigned seed) {
+    std::mt19937 rng(seed);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            uint8_t* p = image.pixelAt(x, y);
+            p[3] = static_cast<uint8_t>(rng());
+            for (int c = 0; c < 3; ++c) p[c] = static_cast<uint8_t>(p[3] ? rng() % (p[3] + 1) : 0);
+        }
+    }
+}
+
+bool isPremultiplied(const ImageBuffer& image) {
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            const uint8_t* p = image.pixelAt(x, y);
+            if (p[0] > p[3] || p[1] > p[3] || p[2] > p[3]) return false;
+        }
+    }
+    return true;
+}
+
+void testAffine() {
+    const Affine m = Affine::translation(-5, 3).then(Affine::rotation(33)).then(Affine::scaling(1.7, 0.6));
+    double x, y;
+    m.map(12, 34, &x, &y);
+    m.inverted().map(x, y, &x, &y);
+    CHECK(std::fabs(x - 12) < 1e-9 && std::fabs(y - 34) < 1e-9);
+    CHECK(!Affine::scaling(0, 1).isInvertible());
+}
+
+void testIntegerTranslation() {
+    // Every kernel is 1 at 0 and 0 at the other integers: a whole-pixel
+    // move copies the pixels exactly
+    ImageBuffer src(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    randomize(src, 1);
+    TransformSource source(src, DirtyRect{10, 20, 200, 150});
+    for (Resampling quality : kQualities) {
+        ImageBuffer dst(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+        transformImage(source, Affine::translation(7, -4), dst, quality);
+        int mismatches = 0;
+        for (int y = 0; y < kHeight; ++y) {
+            for (int x = 0; x < kWidth; ++x) {
+                const int sx = x - 7;
+                const int sy = y + 4;
+                const bool inside = sx >= 10 && sx < 210 && sy >= 20 && sy < 170;
+                const uint8_t* d = dst.pixelAt(x, y);
+                for (int c = 0; c < 4; ++c) {
+                    if (d[c] != (inside ? src.pixelAt(sx, sy)[c] : 0)) {
+                        ++mismatches;
+                        break;
+                    }
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+void testHalfPixelBilinear() {
+    // Half a pixel to the right: each target pixel is the mean of two
+    // source neighbours; outside the source counts as transparent
+    ImageBuffer src(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    randomize(src, 2);
+    TransformSource source(src, DirtyRect{0, 0, kWidth, kHeight});
+    ImageBuffer dst(kWidth + 1, kHeight, ImageBuffer::Storage::Tiled);
+    transformImage(source, Affine::translation(0.5, 0), dst, Resampling::Bilinear);
+
+    int worst = 0;
+    for (int y = 0; y < kHeight; ++y) {
+        for (int x = 0; x <= kWidth; ++x) {
+            const uint8_t* left = x > 0 ? src.pixelAt(x - 1, y) : nullptr;
+            const uint8_t* right = x < kWidth ? src.pixelAt(x, y) : nullptr;
+            const uint8_t* d = dst.pixelAt(x, y);
+            for (int c = 0; c < 4; ++c) {
+                const float expected = 0.5f * ((left ? left[c] : 0) + (right ? right[c] : 0));
+                worst = std::max(worst, static_cast<int>(std::ceil(std::fabs(d[c] - expected))));
+            }
+        }
+    }
+    CHECK(worst <= 1);   // Halves may round either way
+}
+
+void testPremultipliedOutput() {
+    // Bicubic and Lanczos overshoot; the result must stay valid
+    ImageBuffer src(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    randomize(src, 3);
+    TransformSource source(src, DirtyRect{0, 0, kWidth, kHeight});
+    const Affine m = Affine::translation(-150, -100).then(Affine::rotation(17)).then(Affine::scaling(1.3, 0.8))
+                         .then(Affine::translation(150, 100));
+    for (Resampling quality : kQualities) {
+        ImageBuffer dst(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+        transformImage(source, m, dst, quality);
+        CHECK(isPremultiplied(dst));
+    }
+}
+
+void testConstantInterior() {
+    // Weights are normalized, so a flat image stays flat inside at any
+    // scale, including ones that read a smaller level
+    ImageBuffer flat(256, 256, ImageBuffer::Storage::Tiled);
+    flat.fill(100, 50, 10, 200);
+    const std::vector<uint8_t> expected(flat.pixelAt(0, 0), flat.pixelAt(0, 0) + 4);
+    TransformSource source(flat, DirtyRect{0, 0, 256, 256});
+    for (double scale : {0.05, 0.3, 0.9, 2.5}) {
+        for (Resampling quality : kQualities) {
+            ImageBuffer out(600, 600, ImageBuffer::Storage::Tiled);
+            const Affine m = Affine::translation(-128, -128).then(Affine::rotation(27))
+                                 .then(Affine::scaling(scale, scale)).then(Affine::translation(300, 300));
+            const DirtyRect written = transformImage(source, m, out, quality);
+            const uint8_t* center = out.pixelAt(300, 300);
+            for (int c = 0; c < 4; ++c) CHECK(std::abs(center[c] - expected[c]) <= 1);
+            CHECK(written.x <= 300 && written.x + written.w > 300);
+            if (scale < 1.0) CHECK(!out.isTileAllocated(0, 0));   // Transparent tiles stay unallocated
+        }
+    }
+}
+
+void testCallerMemory() {
+    ImageBuffer src(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    randomize(src, 4);
+    TransformSource source(src, DirtyRect{0, 0, kWidth, kHeight});
+    const Affine m = Affine::translation(3, 2);
+    ImageBuffer expected(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    transformImage(source, m, expected, Resampling::Bicubic);
+
+    const size_t stride = kWidth * 4 + 32;
+    std::vector<uint8_t> pixels(stride * kHeight, 0);
+    transformImage(source, m, pixels.data(), kWidth, kHeight, stride, Resampling::Bicubic);
+    bool same = true;
+    for (int y = 0; y < kHeight; ++y) {
+        for (int x = 0; x < kWidth; ++x) {
+            for (int c = 0; c < 4; ++c) same &= pixels[y * stride + x * 4 + c] == expected.pixelAt(x, y)[c];
+        }
+    }
+    CHECK(same);
+}
+
+void testErase() {
+    ImageBuffer src(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    randomize(src, 5);
+    SelectionMask selection(kWidth, kHeight);
+    selection.selectRect(50, 50, 100, 80);
+    ImageBuffer erased(kWidth, kHeight, ImageBuffer::Storage::Tiled);
+    erased.copyFrom(src);
+    eraseRegion(erased, selection.bounds(), &selection);
+    int mismatches = 0;
+    for (int y = 0; y < kHeight; ++y) {
+        for (int x = 0; x < kWidth; ++x) {
+            const bool inside = selection.valueAt(x, y) != 0;
+            for (int c = 0; c < 4; ++c) {
+                if (erased.pixelAt(x, y)[c] != (inside ? 0 : src.pixelAt(x, y)[c])) {
+                    ++mismatches;
+                    break;
+                }
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+
+    eraseRegion(erased, DirtyRect{0, 0, kWidth, kHeight});
+    CHECK(erased.memoryUsage() == 0);
+}
+
+} // anonymous namespace
+
+int main() {
+    testAffine();
+    testIntegerTranslation();
+    testHalfPixelBilinear();
+    testPremultipliedOutput();
+    testConstantInterior();
+    testCallerMemory();
+    testErase();
+    return test::result();
+}
@@ -0,0 +1,90 @@
+/**
+ * ArtFlow Studio - Undo Stack Tests
+ * Steps that are requested while a stroke is being recorded
+ */
+
+#include "layer_manager.h"
+#include "test_support.h"
+#include "undo_stack.h"
+#include <future>
+#include <vector>
+
+using namespace artflow;
+
+namespace {
+
+constexpr int kWidth = 300;
+constexpr int kHeight = 200;
+
+std::shared_ptr<UndoStack::Patch> request(UndoStack& history, bool undo) {
+    std::promise<std::shared_ptr<UndoStack::Patch>> ready;
+    auto patch = ready.get_future();
+    auto deliver = [&ready](std::shared_ptr<UndoStack::Patch> p) { ready.set_value(std::move(p)); };
+    const bool requested = undo ? history.undo(deliver) : history.redo(deliver);
+    CHECK(requested);
+    return requested ? patch.get() : nullptr;
+}
+
+void stroke(UndoStack& history, Layer& layer, float x, uint8_t r) {
+    history.beginStroke(layer.id, *layer.buffer);
+    layer.buffer->drawCircle(x, 100.0f, 20.0f, r, 40, 40, 255, 1.0f);
+    history.endStroke(*layer.buffer);
+}
+
+// Undo requested, then a stroke before the patch is applied: the undo is
+// called off, and undoing the stroke does not bring back pixels from
+// before the step that was to be undone
+void testStrokeBeforeUndoApplies() {
+    LayerManager layers(kWidth, kHeight);
+    Layer& layer = *layers.getLayer(0);
+    UndoStack history;
+    const auto blank = layer.buffer->getBytes();
+    stroke(history, layer, 60.0f, 200);
+    const auto first = layer.buffer->getBytes();
+
+    auto patch = request(history, true);
+    CHECK(history.isBusy());
+    stroke(history, layer, 200.0f, 90);
+    const auto second = layer.buffer->getBytes();
+    CHECK(!history.isBusy());
+    CHECK(history.apply(patch, layers) == -1);   // Called off
+    CHECK(layer.buffer->getBytes() == second);
+    CHECK(!history.canRedo());
+
+    CHECK(history.apply(request(history, true), layers) == layer.id);
+    CHECK(layer.buffer->getBytes() == first);
+    CHECK(history.apply(request(history, true), layers) == layer.id);
+    CHECK(layer.buffer->getBytes() == blank);
+    CHECK(!history.canUndo());
+}
+
+// Redo requested, then a stroke: the step stays undone and the stroke
+// drops it as usual
+void testStrokeBeforeRedoApplies() {
+    LayerManager layers(kWidth, kHeight);
+    Layer& layer = *layers.getLayer(0);
+    UndoStack history;
+    const auto blank = layer.buffer->getBytes();
+    stroke(history, layer, 60.0f, 200);
+    CHECK(history.apply(request(history, true), layers) == layer.id);
+    CHECK(history.canRedo());
+
+    auto patch = request(history, false);
+    stroke(history, layer, 200.0f, 90);
+    const auto second = layer.buffer->getBytes();
+    CHECK(history.apply(patch, layers) == -1);
+    CHECK(layer.buffer->getBytes() == second);
+    CHECK(!history.canRedo());
+
+    CHECK(history.apply(request(history, true), layers) == layer.id);
+    CHECK(layer.buffer->getBytes() == blank);
+    CHECK(!history.canUndo());
+}
+
+} // anonymous namespace
+
+int main() {
+    testStrokeBeforeUndoApplies();
+    testStrokeBeforeRedoApplies();
+    return test::result();
+}
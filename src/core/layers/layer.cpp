@@ -4,6 +4,8 @@
 
 #include "layer.h"
 #include "../canvas/canvas.h"
+#include "blend_kernels.h"
+#include "color_utils.h"
 #include <algorithm>
 #include <cstring>
 
@@ -49,16 +51,34 @@ void Layer::setData(const std::vector<uint8_t>& data) {
     }
 }
 
+void Layer::readRect(int x, int y, int w, int h, uint8_t* dst) const {
+    for (int row = 0; row < h; ++row) {
+        size_t srcIdx = (static_cast<size_t>(y + row) * m_width + x) * 4;
+        std::memcpy(dst + static_cast<size_t>(row) * w * 4, &m_data[srcIdx], static_cast<size_t>(w) * 4);
+    }
+}
+
+void Layer::writeRect(int x, int y, int w, int h, const uint8_t* src) {
+    for (int row = 0; row < h; ++row) {
+        size_t dstIdx = (static_cast<size_t>(y + row) * m_width + x) * 4;
+        std::memcpy(&m_data[dstIdx], src + static_cast<size_t>(row) * w * 4, static_cast<size_t>(w) * 4);
+    }
+}
+
 void Layer::clear() {
     std::fill(m_data.begin(), m_data.end(), 0);
 }
 
 void Layer::fill(const Color& color) {
+    uint8_t px[4] = {
+        static_cast<uint8_t>(color.r * 255),
+        static_cast<uint8_t>(color.g * 255),
+        static_cast<uint8_t>(color.b * 255),
+        static_cast<uint8_t>(color.a * 255)
+    };
+    color::premultiplyAlpha(px);
     for (size_t i = 0; i < m_data.size(); i += 4) {
-        m_data[i + 0] = static_cast<uint8_t>(color.r * 255);
-        m_data[i + 1] = static_cast<uint8_t>(color.g * 255);
-        m_data[i + 2] = static_cast<uint8_t>(color.b * 255);
-        m_data[i + 3] = static_cast<uint8_t>(color.a * 255);
+        std::memcpy(&m_data[i], px, 4);
     }
 }
 
@@ -73,26 +93,8 @@ void Layer::copyFrom(const Layer& other) {
 void Layer::mergeWith(const Layer& other) {
     if (!other.m_visible || other.m_width != m_width || other.m_height != m_height) return;
     
-    for (int i = 0; i < m_width * m_height; ++i) {
-        size_t idx = i * 4;
-        float srcA = (other.m_data[idx + 3] / 255.0f) * other.m_opacity;
-        if (srcA < 0.001f) continue;
-        
-        float srcR = other.m_data[idx] / 255.0f;
-        float srcG = other.m_data[idx + 1] / 255.0f;
-        float srcB = other.m_data[idx + 2] / 255.0f;
-        
-        float dstR = m_data[idx] / 255.0f;
-        float dstG = m_data[idx + 1] / 255.0f;
-        float dstB = m_data[idx + 2] / 255.0f;
-        float dstA = m_data[idx + 3] / 255.0f;
-        
-        float outA = srcA + dstA * (1.0f - srcA);
-        m_data[idx] = static_cast<uint8_t>(((srcR * srcA + dstR * dstA * (1 - srcA)) / outA) * 255);
-        m_data[idx + 1] = static_cast<uint8_t>(((srcG * srcA + dstG * dstA * (1 - srcA)) / outA) * 255);
-        m_data[idx + 2] = static_cast<uint8_t>(((srcB * srcA + dstB * dstA * (1 - srcA)) / outA) * 255);
-        m_data[idx + 3] = static_cast<uint8_t>(outA * 255);
-    }
+    // Integer premultiplied source-over over the whole buffer
+    blend::rowKernel(BlendMode::Normal)(m_data.data(), other.m_data.data(), m_width * m_height, other.m_opacity);
 }
 
 } // namespace artflow
@@ -41,9 +41,15 @@ public:
     int getHeight() const { return m_height; }
     void resize(int width, int height);
     
+    // Premultiplied RGBA8 (see color_utils.h)
     const std::vector<uint8_t>& getData() const { return m_data; }
     void setData(const std::vector<uint8_t>& data);
     
+    // Copy a rectangle of RGBA pixels (tightly packed) out of / into the layer.
+    // The rectangle must lie inside the layer.
+    void readRect(int x, int y, int w, int h, uint8_t* dst) const;
+    void writeRect(int x, int y, int w, int h, const uint8_t* src);
+    
     void clear();
     void fill(const Color& color);
     void copyFrom(const Layer& other);
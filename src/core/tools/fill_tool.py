@@ -1,8 +1,13 @@
-from PyQt6.QtCore import pyqtSlot, pyqtProperty, pyqtSignal
-from PyQt6.QtGui import QImage, QColor
+from PyQt6.QtCore import Qt, pyqtSlot, pyqtProperty, pyqtSignal
+from PyQt6.QtGui import QImage, QColor, QPainter
 import cv2
 import numpy as np
 
+try:
+    import artflow_native as native
+except ImportError:
+    native = None
+
 class FillToolMixin:
     """
     Mixin for QCanvasItem to handle Fill Tool logic (Bucket Fill, Lasso Fill).
@@ -75,6 +80,12 @@ class FillToolMixin:
         try:
             # Vista strided segura
             arr_view = np.ndarray(shape=(h, w, 4), dtype=np.uint8, buffer=ptr, strides=(bpl, 4, 1))
+
+            if native is not None:
+                self._native_color_drop(arr_view, ix, iy, new_color)
+                self.update()
+                self.layersChanged.emit(self.getLayersList())
+                return
             
             # --- LÓGICA ROBUSTA (SIMPLIFICADA) ---
             # Volvemos a lo que funcionaba: Relleno de 3 canales sin máscaras complejas
@@ -163,6 +174,42 @@ class FillToolMixin:
             import traceback
             traceback.print_exc()
 
+    def _native_color_drop(self, arr_view, ix, iy, new_color):
+        """Scanline fill in place on the layer's pixels (no full-canvas copies)."""
+        h, w = arr_view.shape[:2]
+
+        sel_view = None
+        if getattr(self, "_selection_active", False) and getattr(self, "_native_selection", None) is not None:
+            # Tiles of the native mask are read in place
+            sel_view = self._native_selection
+        elif getattr(self, "_selection_active", False) and getattr(self, "_selection_mask", None):
+            sel = self._selection_mask
+            sel_ptr = sel.bits()
+            sel_ptr.setsize(sel.sizeInBytes())
+            sel_view = np.ndarray(shape=(h, w), dtype=np.uint8, buffer=sel_ptr, strides=(sel.bytesPerLine(), 1))
+
+        sample_view = None
+        if self._fill_sample_all:
+            # Same format as the layer so channels line up
+            composite = QImage(w, h, QImage.Format.Format_ARGB32)
+            composite.fill(Qt.GlobalColor.transparent)
+            painter = QPainter(composite)
+            for layer in self.layers:
+                if layer.visible and layer.opacity > 0:
+                    painter.setOpacity(layer.opacity)
+                    painter.setCompositionMode(layer.blend_mode)
+                    painter.drawImage(0, 0, layer.image)
+            painter.end()
+            comp_ptr = composite.bits()
+            comp_ptr.setsize(composite.sizeInBytes())
+            sample_view = np.ndarray(shape=(h, w, 4), dtype=np.uint8, buffer=comp_ptr,
+                                     strides=(composite.bytesPerLine(), 4, 1))
+
+        # ARGB32 is B, G, R, A in memory
+        color = (new_color.blue(), new_color.green(), new_color.red(), 255)
+        native.floodFillPixels(arr_view, ix, iy, color, self._fill_tolerance, self._fill_expand,
+                               sel_view, sample_view)
+
     def apply_lasso_fill(self):
         """Fills the polygon defined by self._lasso_points."""
         if not self.layers or self._active_layer_index < 0: return
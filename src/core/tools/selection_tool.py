@@ -3,10 +3,25 @@ from PyQt6.QtGui import QImage, QColor, QPainter, QPolygonF, QBrush, QPen
 import cv2
 import numpy as np
 
+try:
+    import artflow_native as native
+except ImportError:
+    native = None
+
+if native is not None:
+    _NATIVE_OPS = {
+        "replace": native.SelectionMask.Op.Replace,
+        "add": native.SelectionMask.Op.Add,
+        "subtract": native.SelectionMask.Op.Subtract,
+        "intersect": native.SelectionMask.Op.Intersect,
+    }
+
 class SelectionToolMixin:
     """
     Mixin for QCanvasItem to handle Selection logic (Rect, Lasso, Magic Wand).
     Manages _selection_mask (QImage, Format_Grayscale8). 0=Unselected, 255=Selected.
+    With the native module, shapes are rasterized into a native SelectionMask
+    (_native_selection) and only the changed area is copied into the QImage.
     """
     
     selectionChanged = pyqtSignal()
@@ -14,6 +29,7 @@ class SelectionToolMixin:
     def _init_selection_tool(self):
         # Selection State
         self._selection_mask = None # QImage(Grayscale8) or None if no selection
+        self._native_selection = None # native.SelectionMask mirrored into _selection_mask
         self._selection_active = False
         self._marching_ants_offset = 0
         
@@ -29,10 +45,39 @@ class SelectionToolMixin:
         if self._selection_mask is None or self._selection_mask.width() != w or self._selection_mask.height() != h:
             self._selection_mask = QImage(w, h, QImage.Format.Format_Grayscale8)
             self._selection_mask.fill(0)
-            
+            self._native_selection = None
+
+    def _ensure_native_selection(self):
+        """Native mask of the canvas size, in sync with _selection_mask."""
+        self._ensure_selection_buffer()
+        if self._native_selection is None:
+            w, h = self._canvas_width, self._canvas_height
+            self._native_selection = native.SelectionMask(w, h)
+            self._native_selection.fromArray(self._selection_view())
+        return self._native_selection
+
+    def _selection_view(self):
+        """(h, w) uint8 view of the QImage mask (rows are padded to 4 bytes)."""
+        mask = self._selection_mask
+        ptr = mask.bits()
+        ptr.setsize(mask.sizeInBytes())
+        return np.ndarray(shape=(mask.height(), mask.width()), dtype=np.uint8, buffer=ptr,
+                          strides=(mask.bytesPerLine(), 1))
+
+    def _apply_native_selection(self, op):
+        """Run op(mask) on the native mask and copy what it changed to the QImage."""
+        sel = self._ensure_native_selection()
+        changed = sel.bounds()
+        op(sel)
+        # Every op only changes pixels inside the old or the new bounds
+        changed.unite(sel.bounds())
+        if not changed.isEmpty():
+            sel.readInto(self._selection_view(), changed)
+
     @pyqtSlot()
     def clearSelection(self):
         self._selection_mask = None
+        self._native_selection = None
         self._selection_active = False
         self.selectionChanged.emit()
         self.update()
@@ -41,12 +86,21 @@ class SelectionToolMixin:
     def selectAll(self):
         self._ensure_selection_buffer()
         self._selection_mask.fill(255)
+        if self._native_selection is not None:
+            self._native_selection.selectAll()
         self._selection_active = True
         self.selectionChanged.emit()
         self.update()
 
     @pyqtSlot(int, int, int, int, str)
     def selectRect(self, x, y, w, h, mode="replace"):
+        if native is not None:
+            self._apply_native_selection(lambda sel: sel.selectRect(x, y, w, h, _NATIVE_OPS[mode]))
+            self._selection_active = True
+            self.selectionChanged.emit()
+            self.update()
+            return
+
         self._ensure_selection_buffer()
         painter = QPainter(self._selection_mask)
         
@@ -147,7 +201,15 @@ class SelectionToolMixin:
         mode: 'replace', 'add', 'subtract'
         """
         if not points or len(points) < 3: return
-        
+
+        if native is not None:
+            xy = np.array([(p.x(), p.y()) for p in points], dtype=np.float32)
+            self._apply_native_selection(lambda sel: sel.selectPolygon(xy, _NATIVE_OPS[mode]))
+            self._selection_active = True
+            self.selectionChanged.emit()
+            self.update()
+            return
+
         self._ensure_selection_buffer()
         painter = QPainter(self._selection_mask)
         
@@ -1,10 +1,39 @@
-from PyQt6.QtCore import pyqtSlot, pyqtProperty, pyqtSignal, QPointF, QRectF, Qt
+from PyQt6.QtCore import pyqtSlot, pyqtProperty, pyqtSignal, QPointF, QRectF, Qt, QTimer
 from PyQt6.QtGui import QImage, QColor, QPainter, QTransform, QBrush
+from concurrent.futures import ThreadPoolExecutor
 import numpy as np
 
+try:
+    import artflow_native as native
+except ImportError:
+    native = None
+
+if native is not None:
+    _NATIVE_QUALITY = {
+        "bilinear": native.Resampling.Bilinear,
+        "bicubic": native.Resampling.Bicubic,
+        "lanczos": native.Resampling.Lanczos3,
+    }
+
+
+def _pixel_view(image):
+    """(h, w, 4) uint8 view of 32-bit QImage bits (rows may be padded)."""
+    ptr = image.bits()
+    ptr.setsize(image.sizeInBytes())
+    return np.ndarray(shape=(image.height(), image.width(), 4), dtype=np.uint8, buffer=ptr,
+                      strides=(image.bytesPerLine(), 4, 1))
+
+
+def _native_affine(m):
+    return native.Affine(m.m11(), m.m12(), m.m21(), m.m22(), m.dx(), m.dy())
+
+
 class TransformToolMixin:
     """
     Mixin for QCanvasItem to handle Transformation logic (Scale, Rotate, Translate).
+    With the native module the content is resampled by artflow_native: a
+    bilinear proxy at about screen resolution while the matrix changes, and
+    a full-resolution pass on a worker thread on apply.
     """
     
     transformChanged = pyqtSignal()
@@ -15,6 +44,10 @@ class TransformToolMixin:
         self._transform_matrix = QTransform()
         self._transform_orig_pos = QPointF(0,0)
         self._transform_preview = None # Cached resultant image
+        self._transform_source = None # native.TransformSource of the premultiplied content
+        self._transform_preview_scale = 1.0 # Preview pixels per canvas pixel
+        self._transform_job = None # Future of the final native pass
+        self._transform_executor = None
         
     @pyqtSlot()
     def startTransform(self):
@@ -31,6 +64,10 @@ class TransformToolMixin:
         
         # 2. Reset Matrix
         self._transform_matrix.reset()
+        if native is not None:
+            premul = self._transform_buffer.convertToFormat(QImage.Format.Format_ARGB32_Premultiplied)
+            self._transform_source = native.TransformSource(_pixel_view(premul))
+            self._render_transform_preview()
         
         # 3. Clear original content from layer (it's now "floating")
         # In a real app we might hide it or use a "floating layer".
@@ -69,20 +106,52 @@ class TransformToolMixin:
         m.translate(-cx, -cy)
         
         self._transform_matrix = m
+        self._render_transform_preview()
         self.update()
 
     @pyqtSlot(float, float, float, float, float, float)
     def updateTransformMatrix(self, m11, m12, m13, m21, m22, m23):
         """Updates the matrix from QML."""
         self._transform_matrix.setMatrix(m11, m12, m13, m21, m22, m23, 0.0, 0.0, 1.0)
+        self._render_transform_preview()
         self.update()
 
+    def _render_transform_preview(self):
+        """Resamples the native proxy: at most 1:1 and 2048 px on the long side."""
+        if self._transform_source is None or self._transform_job is not None: return
+        w, h = self._transform_buffer.width(), self._transform_buffer.height()
+        s = min(max(self._zoom_level, 0.125), 1.0, 2048.0 / max(w, h))
+        pw, ph = max(1, int(np.ceil(w * s))), max(1, int(np.ceil(h * s)))
+        preview = self._transform_preview
+        if preview is None or preview.width() != pw or preview.height() != ph:
+            preview = QImage(pw, ph, QImage.Format.Format_ARGB32_Premultiplied)
+        preview.fill(0)
+        matrix = _native_affine(self._transform_matrix).then(native.Affine.scaling(s, s))
+        native.transformPixels(self._transform_source, matrix, _pixel_view(preview), native.Resampling.Bilinear)
+        self._transform_preview = preview
+        self._transform_preview_scale = s
+
     @pyqtSlot()
-    def applyTransform(self):
+    @pyqtSlot(str)
+    def applyTransform(self, quality="bicubic"):
         """Burns the transformed buffer back into the layer."""
         if not self._transform_active or self._transform_buffer is None: return
+        if self._transform_job is not None: return
         
         layer = self.layers[self._active_layer_index]
+
+        if self._transform_source is not None:
+            # Full resolution off the GUI thread (the native call releases
+            # the GIL); the proxy stays up until the result is burnt in
+            result = QImage(layer.image.width(), layer.image.height(), QImage.Format.Format_ARGB32_Premultiplied)
+            result.fill(0)
+            if self._transform_executor is None:
+                self._transform_executor = ThreadPoolExecutor(max_workers=1)
+            self._transform_job = self._transform_executor.submit(
+                native.transformPixels, self._transform_source, _native_affine(self._transform_matrix),
+                _pixel_view(result), _NATIVE_QUALITY.get(quality, native.Resampling.Bicubic))
+            self._poll_transform_job(layer, result)
+            return
         
         # Render transformed buffer
         painter = QPainter(layer.image)
@@ -97,14 +166,37 @@ class TransformToolMixin:
         self._transform_buffer = None
         self.isTransformingChanged.emit(False)
         self.update()
+
+    def _poll_transform_job(self, layer, result):
+        if not self._transform_job.done():
+            QTimer.singleShot(16, lambda: self._poll_transform_job(layer, result))
+            return
+        self._transform_job.result()  # Re-raises a worker error
+        self._transform_job = None
+
+        painter = QPainter(layer.image)
+        painter.drawImage(0, 0, result)
+        painter.end()
+
+        self._reset_native_transform()
+        self._transform_active = False
+        self._transform_buffer = None
+        self.isTransformingChanged.emit(False)
+        self.update()
+
+    def _reset_native_transform(self):
+        self._transform_source = None
+        self._transform_preview = None
         
     @pyqtSlot()
     def cancelTransform(self):
         """Restores the original content."""
         if not self._transform_active or self._transform_buffer is None: return
+        if self._transform_job is not None: return
         
         layer = self.layers[self._active_layer_index]
         layer.image = self._transform_buffer.copy() # Restore
+        self._reset_native_transform()
         
         self._transform_active = False
         self._transform_buffer = None
@@ -119,6 +211,15 @@ class TransformToolMixin:
         # View Transform
         painter.translate(self._view_offset)
         painter.scale(self._zoom_level, self._zoom_level)
+
+        if self._transform_preview is not None:
+            # Native proxy: already transformed, in canvas space scaled down
+            s = self._transform_preview_scale
+            painter.scale(1.0 / s, 1.0 / s)
+            painter.setRenderHint(QPainter.RenderHint.SmoothPixmapTransform)
+            painter.drawImage(0, 0, self._transform_preview)
+            painter.restore()
+            return
         
         # User Transform
         painter.setTransform(self._transform_matrix, True)
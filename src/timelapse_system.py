@@ -8,6 +8,11 @@ from PyQt6.QtCore import QObject, pyqtSlot, pyqtSignal, QUrl
 from PyQt6.QtGui import QImage
 from PyQt6.QtQuick import QQuickImageProvider
 
+try:
+    import artflow_native as native
+except ImportError:
+    native = None
+
 class TimelapseController(QObject):
     previewReady = pyqtSignal(str) # Returns path to Animated Image
     previewError = pyqtSignal(str)
@@ -19,16 +24,20 @@ class TimelapseController(QObject):
         self.frames = []
         self._lock = threading.Lock()
 
+    @staticmethod
+    def _local_path(project_path):
+        """Handle file:/// conversion for path."""
+        if project_path.startswith("file:///"):
+            return QUrl(project_path).toLocalFile()
+        if project_path.startswith("file:"):
+            return project_path[5:]
+        return project_path
+
     def _extract_frames_to_temp(self, project_path):
         """Helper to extract frames to a new temp dir. Returns (temp_dir, frame_paths_list)."""
         new_temp_dir = tempfile.mkdtemp(prefix="ArtFlow_TL_")
         extracted_frames = []
-        
-        # Handle file:/// conversion for path
-        if project_path.startswith("file:///"):
-            project_path = QUrl(project_path).toLocalFile()
-        elif project_path.startswith("file:"):
-             project_path = project_path[5:]
+        project_path = self._local_path(project_path)
              
         if not os.path.exists(project_path):
             try: os.rmdir(new_temp_dir)
@@ -145,9 +154,35 @@ class TimelapseController(QObject):
         thread.daemon = True
         thread.start()
 
+    def _export_native(self, project_path, output_path, duration_sec, aspect_mode, quality_mode):
+        """Stream the frames straight from the project into ffmpeg (no temp
+        dir, constant memory). Returns False when the native exporter or
+        ffmpeg is unavailable and the OpenCV path should run instead."""
+        if native is None or shutil.which("ffmpeg") is None:
+            return False
+
+        options = native.TimelapseExportOptions()
+        options.aspect = {1: native.TimelapseExportOptions.Aspect.Square,
+                          2: native.TimelapseExportOptions.Aspect.Portrait}.get(
+                              aspect_mode, native.TimelapseExportOptions.Aspect.Original)
+        options.maxSize = 1080 if quality_mode == 0 else 0
+        options.durationSec = float(duration_sec)
+        print(f"[TLS] Native export to {output_path} (Dur:{duration_sec}s, Aspect:{aspect_mode}, Quality:{quality_mode})...")
+
+        ok, message = native.exportTimelapse(self._local_path(project_path), output_path, options)
+        if ok:
+            print("[TLS] Export Success")
+            self.videoExportFinished.emit(True, output_path)
+        else:
+            print(f"[TLS] Export Error: {message}")
+            self.videoExportFinished.emit(False, message)
+        return True
+
     def _export_worker(self, project_path, output_path, duration_sec=0, aspect_mode=0, quality_mode=1):
         temp_dir = None
         try:
+            if self._export_native(project_path, output_path, duration_sec, aspect_mode, quality_mode):
+                return
             print(f"[TLS] Exporting to {output_path} (Dur:{duration_sec}s, Aspect:{aspect_mode}, Quality:{quality_mode})...")
             temp_dir, frames = self._extract_frames_to_temp(project_path)
             